@@ -3,8 +3,13 @@
 #include <perspective/config.h>
 #include <perspective/test_utils.h>
 #include <perspective/context_one.h>
+#include <perspective/context_zero.h>
+#include <perspective/gnode.h>
 #include <perspective/node_processor.h>
 #include <perspective/storage.h>
+#include <perspective/column.h>
+#include <perspective/mask.h>
+#include <random>
 
 using namespace perspective;
 
@@ -82,3 +87,194 @@ BENCHMARK_F(PBench, Scalar3)(benchmark::State& st)
         auto v = mktscalar<const char*>("abcdefghijklmnopqrstuvwxyz");
     }
 }
+
+// Filtered clone of a 1M row column with status, for mask densities
+// of 0.1% to 99%. range(0) is the density in tenths of a percent and
+// range(1) selects an optimized (compressed where smaller) mask.
+template <typename DATA_T>
+static void
+Column_CloneMask(benchmark::State& state)
+{
+    const t_uindex nrows = 1 << 20;
+    t_dtype dtype = type_to_dtype<DATA_T>();
+    t_column col(dtype, true, nrows);
+    col.init();
+    col.set_size(nrows);
+    col.valid_raw_fill();
+
+    std::mt19937 gen(0);
+    std::bernoulli_distribution d(state.range(0) / 1000.0);
+    t_mask mask(nrows);
+    for (t_uindex idx = 0; idx < nrows; ++idx)
+    {
+        mask.set(idx, d(gen));
+    }
+
+    if (state.range(1))
+        mask.optimize();
+
+    for (auto _ : state)
+    {
+        auto cloned = col.clone(mask);
+        benchmark::DoNotOptimize(cloned);
+    }
+
+    state.SetItemsProcessed(state.iterations() * nrows);
+}
+
+#define PSP_CLONE_MASK_ARGS                                                    \
+    ArgsProduct({{1, 10, 100, 500, 900, 990}, {0, 1}})
+
+BENCHMARK_TEMPLATE(Column_CloneMask, t_uint8)->PSP_CLONE_MASK_ARGS;
+BENCHMARK_TEMPLATE(Column_CloneMask, t_int16)->PSP_CLONE_MASK_ARGS;
+BENCHMARK_TEMPLATE(Column_CloneMask, t_int32)->PSP_CLONE_MASK_ARGS;
+BENCHMARK_TEMPLATE(Column_CloneMask, t_float64)->PSP_CLONE_MASK_ARGS;
+
+// Sustained ingest into an implicit pkey gnode keeping the last 1M
+// rows. range(0) selects ring storage over a row count retention
+// policy.
+static void
+Gnode_WindowedIngest(benchmark::State& state)
+{
+    const t_uindex window = 1 << 20;
+    const t_uindex batch = 1 << 14;
+    t_schema isch{{"i", "f"}, {DTYPE_INT64, DTYPE_FLOAT64}};
+
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_IMPLICIT_PKEYED;
+    options.m_port_schema = isch;
+    if (state.range(0))
+        options.m_ring_capacity = window;
+    else
+        options.m_retention_rows = window;
+    auto gn = t_gnode::build(options);
+
+    t_table tbl(isch);
+    tbl.init();
+    tbl.extend(batch);
+    auto icol = tbl.get_column("i");
+    auto fcol = tbl.get_column("f");
+    for (t_uindex idx = 0; idx < batch; ++idx)
+    {
+        icol->set_nth<t_int64>(idx, idx, STATUS_VALID);
+        fcol->set_nth<t_float64>(idx, idx * 0.5, STATUS_VALID);
+    }
+
+    // Fill the window before timing
+    for (t_uindex idx = 0; idx < window / batch; ++idx)
+    {
+        gn->_send_and_process(tbl);
+    }
+
+    for (auto _ : state)
+    {
+        gn->_send_and_process(tbl);
+    }
+
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(Gnode_WindowedIngest)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Fills a table of nrows with a string column of ncats distinct
+// values and a float column. The strings are long enough to be stored
+// out of line in a scalar.
+static std::shared_ptr<t_table>
+make_category_table(t_uindex nrows, t_uindex ncats)
+{
+    t_schema isch{{"s", "v"}, {DTYPE_STR, DTYPE_FLOAT64}};
+    auto tbl = std::make_shared<t_table>(isch);
+    tbl->init();
+    tbl->extend(nrows);
+    auto scol = tbl->get_column("s");
+    auto vcol = tbl->get_column("v");
+    std::vector<t_str> cats;
+    for (t_uindex idx = 0; idx < ncats; ++idx)
+    {
+        cats.push_back("category_" + std::to_string(idx));
+    }
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<t_uindex> d(0, ncats - 1);
+    for (t_uindex idx = 0; idx < nrows; ++idx)
+    {
+        scol->set_nth<const char*>(idx, cats[d(gen)].c_str());
+        vcol->set_nth<t_float64>(idx, idx * 0.5, STATUS_VALID);
+    }
+    return tbl;
+}
+
+// Sorts 1M scalars. range(0) selects strings over float64.
+static void
+Scalar_Sort(benchmark::State& state)
+{
+    const t_uindex n = 1 << 20;
+    auto tbl = make_category_table(n, 1 << 12);
+    auto col = tbl->get_const_column(state.range(0) ? "s" : "v");
+    t_tscalvec values(n);
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        values[idx] = col->get_scalar(idx);
+    }
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        t_tscalvec sorted(values);
+        state.ResumeTiming();
+        std::sort(sorted.begin(), sorted.end());
+        benchmark::DoNotOptimize(sorted.data());
+    }
+
+    state.counters["scalar_bytes"] = sizeof(t_tscalar);
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(Scalar_Sort)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Builds a one level pivot with a sum over 1M rows
+static void
+Ctx1_TreeBuild(benchmark::State& state)
+{
+    const t_uindex n = 1 << 20;
+    auto tbl = make_category_table(n, 1 << 12);
+
+    for (auto _ : state)
+    {
+        t_gnode_options options;
+        options.m_gnode_type = GNODE_TYPE_IMPLICIT_PKEYED;
+        options.m_port_schema = tbl->get_schema();
+        auto gn = t_gnode::build(options);
+        auto ctx1 = t_ctx1::build(tbl->get_schema(),
+            t_config(t_pivotvec{t_pivot("s")},
+                t_aggspecvec{t_aggspec("v", AGGTYPE_SUM, "v")}));
+        gn->register_context("ctx1", ctx1);
+        gn->_send_and_process(*tbl);
+        ctx1->set_depth(1);
+        benchmark::DoNotOptimize(ctx1->get_row_count());
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(Ctx1_TreeBuild)->Unit(benchmark::kMillisecond);
+
+// Reads every cell of a flat view of 256K rows
+static void
+Ctx0_GetData(benchmark::State& state)
+{
+    const t_uindex n = 1 << 18;
+    auto tbl = make_category_table(n, 1 << 12);
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_IMPLICIT_PKEYED;
+    options.m_port_schema = tbl->get_schema();
+    auto gn = t_gnode::build(options);
+    auto ctx0 = t_ctx0::build(tbl->get_schema(), t_config{{"s", "v"}});
+    gn->register_context("ctx0", ctx0);
+    gn->_send_and_process(*tbl);
+
+    for (auto _ : state)
+    {
+        auto cells = ctx0->get_data(0, n, 0, 2);
+        benchmark::DoNotOptimize(cells.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * n * 2);
+}
+BENCHMARK(Ctx0_GetData)->Unit(benchmark::kMillisecond);
@@ -117,9 +117,8 @@ t_aggspec::t_aggspec(const t_str& aggname, const t_str& disp_aggname,
 {
 }
 
-#ifdef PSP_ENABLE_WASM
 t_aggspec::t_aggspec(const t_str& name, t_aggtype agg,
-    const t_depvec& dependencies, emscripten::val& kernel)
+    const t_depvec& dependencies, t_kernel& kernel)
     : m_name(name)
     , m_disp_name(name)
     , m_agg(agg)
@@ -127,7 +126,6 @@ t_aggspec::t_aggspec(const t_str& name, t_aggtype agg,
     , m_kernel(new t_kernel(kernel))
 {
 }
-#endif
 
 t_aggspec::~t_aggspec() {}
 
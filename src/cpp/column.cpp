@@ -403,6 +403,14 @@ t_column::reserve(t_uindex size)
         m_status->reserve(get_dtype_size(DTYPE_UINT8) * size);
 }
 
+void
+t_column::shrink(t_uindex nelems)
+{
+    m_data->shrink(get_dtype_size(m_dtype) * nelems);
+    if (is_status_enabled())
+        m_status->shrink(get_dtype_size(DTYPE_UINT8) * nelems);
+}
+
 t_lstore*
 t_column::_get_data_lstore()
 {
@@ -875,6 +883,18 @@ t_column::clear()
     m_size = 0;
 }
 
+t_mem_usage
+t_column::get_memory_usage(const t_str& name) const
+{
+    t_mem_usage rv(name);
+    rv.add(m_data->get_memory_usage("data"));
+    if (is_status_enabled())
+        rv.add(m_status->get_memory_usage("status"));
+    if (is_vlen())
+        rv.add(m_vocab->get_memory_usage());
+    return rv;
+}
+
 void
 t_column::pprint() const
 {
@@ -964,11 +984,14 @@ t_column::clone(const t_mask& mask) const
     rval->init();
     rval->set_size(mask.size());
 
-    rval->m_data->fill(*m_data, mask, get_dtype_size(get_dtype()));
-
     if (rval->is_status_enabled())
     {
-        rval->m_status->fill(*m_status, mask, sizeof(t_status));
+        rval->m_data->fill(*m_data, mask, get_dtype_size(get_dtype()),
+            rval->m_status.get(), m_status.get());
+    }
+    else
+    {
+        rval->m_data->fill(*m_data, mask, get_dtype_size(get_dtype()));
     }
 
     if (is_vlen_dtype(get_dtype()))
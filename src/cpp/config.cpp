@@ -9,6 +9,7 @@
 
 #include <perspective/first.h>
 #include <perspective/config.h>
+#include <perspective/time_bucket.h>
 
 namespace perspective
 {
@@ -289,8 +290,9 @@ t_config::populate_sortby(const t_pivotvec& pivots)
     {
         const t_pivot& pivot = pivots[idx];
 
-        PSP_VERBOSE_ASSERT(pivot.mode() == PIVOT_MODE_NORMAL,
-            "Only normal pivots supported for now");
+        PSP_VERBOSE_ASSERT(
+            pivot.mode() == PIVOT_MODE_NORMAL || is_time_bucket(pivot.mode()),
+            "Only normal and time bucket pivots supported for now");
         t_str pstr = pivot.colname();
         if (m_sortby.find(pstr) == m_sortby.end())
             m_sortby[pstr] = pstr;
@@ -30,14 +30,20 @@ namespace perspective
 t_ctx_grouped_pkey::t_ctx_grouped_pkey(
     const t_schema& schema, const t_config& pivot_config)
     : t_ctxbase<t_ctx_grouped_pkey>(schema, pivot_config)
+    , m_has_label(!pivot_config.get_grouping_label_column().empty())
     , m_depth(0)
     , m_depth_set(false)
+    , m_incremental(true)
+    , m_next_nidx(1)
 {
 }
 
 t_ctx_grouped_pkey::t_ctx_grouped_pkey()
-    : m_depth(0)
+    : m_has_label(false)
+    , m_depth(0)
     , m_depth_set(false)
+    , m_incremental(true)
+    , m_next_nidx(1)
 {
 }
 
@@ -206,7 +212,12 @@ t_ctx_grouped_pkey::notify(const t_table& flattened, const t_table& delta,
 {
     PSP_TRACE_SENTINEL();
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
-    rebuild();
+    psp_log_time(repr() + " notify.enter");
+    if (!m_incremental || !update_tree(flattened, current))
+    {
+        rebuild();
+    }
+    psp_log_time(repr() + " notify.exit");
 }
 
 void
@@ -215,6 +226,8 @@ t_ctx_grouped_pkey::step_begin()
     PSP_TRACE_SENTINEL();
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
     reset_step_state();
+    m_viewport_changed = false;
+    set_viewport_filter();
 }
 
 void
@@ -228,6 +241,35 @@ t_ctx_grouped_pkey::step_end()
     {
         set_depth(m_depth);
     }
+    update_viewport_changed();
+}
+
+void
+t_ctx_grouped_pkey::get_viewport_rows(const t_viewport& viewport,
+    std::vector<t_uindex>& out, std::vector<t_bool>& columns) const
+{
+    // Column 0 is the row path, aggregate aggidx is column aggidx + 1
+    t_index naggs = m_config.get_num_aggregates();
+    columns.resize(naggs);
+    for (t_index aggidx = std::max<t_index>(viewport.m_bcol - 1, 0);
+         aggidx < std::min<t_index>(viewport.m_ecol - 1, naggs); ++aggidx)
+    {
+        columns[aggidx] = true;
+    }
+
+    t_tvidx bidx = std::max<t_tvidx>(viewport.m_bidx, 0);
+    t_tvidx eidx = std::min<t_tvidx>(viewport.m_eidx, m_traversal->size());
+    for (t_tvidx idx = bidx; idx < eidx; ++idx)
+    {
+        out.push_back(0);
+        out.push_back(m_traversal->get_tree_index(idx));
+    }
+}
+
+std::vector<t_cell_deltas*>
+t_ctx_grouped_pkey::get_viewport_deltas()
+{
+    return {&m_tree->get_deltas()};
 }
 
 t_aggspecvec
@@ -494,12 +536,12 @@ t_ctx_grouped_pkey::get_cell_delta(t_tvidx bidx, t_tvidx eidx) const
     for (t_tvidx idx = bidx; idx < eidx; ++idx)
     {
         t_ptidx ptidx = m_traversal->get_tree_index(idx);
-        auto iterators = deltas->get<by_tc_nidx_aggidx>().equal_range(ptidx);
-        for (auto iter = iterators.first; iter != iterators.second; ++iter)
-        {
-            rval.push_back(t_cellupd(
-                idx, iter->m_aggidx + 1, iter->m_old_value, iter->m_new_value));
-        }
+        deltas.for_each_cell(ptidx,
+            [&](t_uindex aggidx, const t_tscalar& old_value,
+                const t_tscalar& new_value) {
+                rval.push_back(
+                    t_cellupd(idx, aggidx + 1, old_value, new_value));
+            });
     }
     return rval;
 }
@@ -512,8 +554,16 @@ t_ctx_grouped_pkey::reset()
         pivots, m_config.get_aggregates(), m_schema, m_config);
     m_tree->init();
     m_tree->set_deltas_enabled(get_feature_state(CTX_FEAT_DELTA));
+    m_tree->set_minmax_enabled(get_feature_state(CTX_FEAT_MINMAX));
     m_traversal = std::shared_ptr<t_traversal>(
         new t_traversal(m_tree, m_config.handle_nan_sort()));
+    m_incremental = true;
+    m_pkey_nidx.clear();
+    m_child_nidx.clear();
+    m_orphans.clear();
+    m_orphan_parents.clear();
+    m_free_nidx.clear();
+    m_next_nidx = 1;
 }
 
 void
@@ -538,6 +588,19 @@ t_ctx_grouped_pkey::get_trees()
     return rval;
 }
 
+t_mem_usage
+t_ctx_grouped_pkey::get_memory_usage() const
+{
+    PSP_TRACE_SENTINEL();
+    PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+    t_mem_usage rv(m_name);
+    rv.add(m_tree->get_memory_usage());
+    rv.add(m_traversal->get_memory_usage());
+    if (m_symtable)
+        rv.add(m_symtable->get_memory_usage());
+    return rv;
+}
+
 t_bool
 t_ctx_grouped_pkey::has_deltas() const
 {
@@ -667,6 +730,7 @@ t_ctx_grouped_pkey::rebuild()
     }
 
     std::unordered_map<t_tscalar, t_uidxpair> p_range_map;
+    t_uindex ninserted = 0;
 
     t_uindex brange = nroot_children;
     for (t_uindex idx = nroot_children; idx < nrows; ++idx)
@@ -711,8 +775,18 @@ t_ctx_grouped_pkey::rebuild()
         t_stnode node(
             nidx, pidx, value, pnode.m_depth + 1, sortby_value, 1, nidx);
 
-        m_tree->insert_node(node);
-        m_tree->add_pkey(nidx, m_symtable->get_interned_tscalar(rec.m_pkey));
+        auto pkey = m_symtable->get_interned_tscalar(rec.m_pkey);
+        if (m_tree->insert_node(node))
+            ++ninserted;
+        m_tree->add_pkey(nidx, pkey);
+
+        m_pkey_nidx[pkey] = nidx;
+        m_child_nidx[value] = nidx;
+        if (rec.m_is_rchild && rec.m_parent.is_valid()
+            && rec.m_parent != rec.m_child)
+        {
+            add_orphan(m_symtable->get_interned_tscalar(rec.m_parent), nidx);
+        }
 
         auto riter = p_range_map.find(rec.m_child);
 
@@ -730,6 +804,12 @@ t_ctx_grouped_pkey::rebuild()
     }
 
     psp_log_time(repr() + " rebuild.post_queue");
+
+    // Rows in parent cycles or with repeated child values are left
+    // out of the tree, which later batches cannot patch up
+    m_incremental = ninserted == nrows && child_ridx_map.size() == nrows;
+    m_next_nidx = nrows + 1;
+
     auto aggtable = m_tree->_get_aggtable();
     aggtable->extend(nrows + 1);
 
@@ -764,6 +844,9 @@ t_ctx_grouped_pkey::rebuild()
     );
 #endif
 
+    // The aggregates above were written around the tree, count them now
+    m_tree->set_minmax_enabled(get_feature_state(CTX_FEAT_MINMAX));
+
     m_traversal = std::shared_ptr<t_traversal>(
         new t_traversal(m_tree, m_config.handle_nan_sort()));
 
@@ -777,6 +860,338 @@ t_ctx_grouped_pkey::rebuild()
     psp_log_time(repr() + " rebuild.exit");
 }
 
+t_bool
+t_ctx_grouped_pkey::update_tree(
+    const t_table& flattened, const t_table& current)
+{
+    const t_str& child_col_name = m_config.get_child_pkey_column();
+    const t_column* pkey_col = flattened.get_const_column("psp_pkey").get();
+    const t_column* op_col = flattened.get_const_column("psp_op").get();
+    const t_column* child_col = current.get_const_column(child_col_name).get();
+    const t_column* parent_col
+        = current.get_const_column(m_config.get_parent_pkey_column()).get();
+    const t_column* sortby_col
+        = current.get_const_column(m_config.get_sort_by(child_col_name))
+              .get();
+
+    // Only identity aggregates are materialized, as in rebuild
+    const t_aggspecvec& aggspecs = m_config.get_aggregates();
+    std::vector<t_uindex> aggnums;
+    t_colcptrvec aggcols;
+    for (t_uindex aggnum = 0, loop_end = aggspecs.size(); aggnum < loop_end;
+         ++aggnum)
+    {
+        const t_aggspec& spec = aggspecs[aggnum];
+        if (spec.agg() != AGGTYPE_IDENTITY)
+            continue;
+        aggnums.push_back(aggnum);
+        aggcols.push_back(
+            current.get_const_column(spec.get_first_depname()).get());
+    }
+    t_tscalvec aggvalues(aggnums.size());
+
+    t_masksptr msk;
+    if (m_config.has_filters())
+    {
+        msk = filter_table_for_config(current, m_config);
+    }
+
+    auto intern = [this](const t_tscalar& s) {
+        return s.is_valid() ? m_symtable->get_interned_tscalar(s) : s;
+    };
+
+    for (t_uindex idx = 0, loop_end = flattened.size(); idx < loop_end; ++idx)
+    {
+        t_tscalar pkey = pkey_col->get_scalar(idx);
+        t_op op = static_cast<t_op>(*(op_col->get_nth<t_uint8>(idx)));
+        auto iter = m_pkey_nidx.find(pkey);
+
+        if (op == OP_DELETE || (msk && !msk->get(idx)))
+        {
+            if (iter != m_pkey_nidx.end())
+                remove_tree_node(iter->second);
+            continue;
+        }
+
+        t_tscalar child = intern(child_col->get_scalar(idx));
+        t_tscalar parent = intern(parent_col->get_scalar(idx));
+        t_tscalar sortby_value = intern(sortby_col->get_scalar(idx));
+
+        for (t_uindex aidx = 0, aend = aggcols.size(); aidx < aend; ++aidx)
+        {
+            aggvalues[aidx] = aggcols[aidx]->get_scalar(idx);
+        }
+
+        t_bool applied = iter == m_pkey_nidx.end()
+            ? add_tree_node(
+                  pkey, child, parent, sortby_value, aggnums, aggvalues)
+            : update_tree_node(
+                  iter->second, child, parent, sortby_value, aggnums,
+                  aggvalues);
+
+        if (!applied)
+            return false;
+    }
+
+    return true;
+}
+
+t_bool
+t_ctx_grouped_pkey::add_tree_node(const t_tscalar& pkey,
+    const t_tscalar& child, const t_tscalar& parent,
+    const t_tscalar& sortby_value, const std::vector<t_uindex>& aggnums,
+    const t_tscalvec& aggvalues)
+{
+    if (m_child_nidx.find(child) != m_child_nidx.end())
+        return false;
+
+    t_bool orphan;
+    t_uindex pidx = resolve_parent(child, parent, orphan);
+
+    t_uindex nidx = m_next_nidx;
+    if (m_free_nidx.empty())
+    {
+        ++m_next_nidx;
+    }
+    else
+    {
+        nidx = m_free_nidx.back();
+        m_free_nidx.pop_back();
+    }
+
+    // Aggregate rows are indexed by node, as in rebuild
+    auto aggtable = m_tree->_get_aggtable();
+    if (nidx >= aggtable->size())
+    {
+        t_float64 scale = 1.3;
+        aggtable->extend(
+            std::max<t_uindex>(nidx + 1, scale * aggtable->size()));
+    }
+    for (auto col : aggtable->get_columns())
+    {
+        col->set_valid(nidx, false);
+    }
+
+    t_stnode node(nidx, pidx, child, m_tree->get_depth(pidx) + 1,
+        sortby_value, 1, nidx);
+    m_tree->insert_node(node);
+
+    t_tscalar pkey_ = m_symtable->get_interned_tscalar(pkey);
+    m_tree->add_pkey(nidx, pkey_);
+    m_tree->set_aggregates(nidx, aggnums, aggvalues);
+
+    m_pkey_nidx[pkey_] = nidx;
+    m_child_nidx[child] = nidx;
+    if (orphan)
+        add_orphan(parent, nidx);
+
+    auto ancestry = m_tree->get_ancestry(nidx);
+    m_traversal->add_node(m_sortby, ancestry, ancestry.size() - 1);
+    m_rows_changed = true;
+
+    return adopt_orphans(child, nidx);
+}
+
+t_bool
+t_ctx_grouped_pkey::update_tree_node(t_uindex nidx, const t_tscalar& child,
+    const t_tscalar& parent, const t_tscalar& sortby_value,
+    const std::vector<t_uindex>& aggnums, const t_tscalvec& aggvalues)
+{
+    t_stnode node = m_tree->get_node(nidx);
+    t_bool child_changed = node.m_value != child;
+
+    if (child_changed)
+    {
+        if (m_child_nidx.find(child) != m_child_nidx.end())
+            return false;
+        release_children(nidx);
+        m_child_nidx.erase(node.m_value);
+        m_child_nidx[child] = nidx;
+    }
+
+    t_bool orphan;
+    t_uindex pidx = resolve_parent(child, parent, orphan);
+    if (pidx != node.m_pidx && is_ancestor(nidx, pidx))
+        return false;
+
+    remove_orphan(nidx);
+    if (orphan)
+        add_orphan(parent, nidx);
+
+    if (child_changed || pidx != node.m_pidx
+        || sortby_value != node.m_sort_value)
+    {
+        node.m_pidx = pidx;
+        node.m_value = child;
+        node.set_sort_value(sortby_value);
+        relink_node(node);
+    }
+
+    m_tree->set_aggregates(nidx, aggnums, aggvalues);
+
+    return !child_changed || adopt_orphans(child, nidx);
+}
+
+void
+t_ctx_grouped_pkey::remove_tree_node(t_uindex nidx)
+{
+    release_children(nidx);
+    remove_orphan(nidx);
+
+    t_tvidx tvidx = m_traversal->get_traversal_index(nidx);
+    if (tvidx != INVALID_INDEX)
+        m_traversal->remove_subtree(tvidx);
+
+    for (const auto& pkey : m_tree->get_pkeys_for_leaf(nidx))
+    {
+        m_pkey_nidx.erase(pkey);
+    }
+
+    m_child_nidx.erase(m_tree->get_value(nidx));
+    m_tree->remove_node(nidx);
+    m_free_nidx.push_back(nidx);
+    m_rows_changed = true;
+}
+
+t_uindex
+t_ctx_grouped_pkey::resolve_parent(
+    const t_tscalar& child, const t_tscalar& parent, t_bool& orphan) const
+{
+    orphan = false;
+    if (!parent.is_valid() || parent == child)
+        return 0;
+
+    auto iter = m_child_nidx.find(parent);
+    if (iter == m_child_nidx.end())
+    {
+        orphan = true;
+        return 0;
+    }
+    return iter->second;
+}
+
+void
+t_ctx_grouped_pkey::release_children(t_uindex nidx)
+{
+    t_tscalar value = m_tree->get_value(nidx);
+    for (auto cidx : m_tree->get_child_idx(nidx))
+    {
+        t_stnode cnode = m_tree->get_node(cidx);
+        cnode.m_pidx = 0;
+        relink_node(cnode);
+        add_orphan(value, cidx);
+    }
+}
+
+t_bool
+t_ctx_grouped_pkey::adopt_orphans(const t_tscalar& child, t_uindex nidx)
+{
+    std::vector<t_uindex> orphans;
+    auto range = m_orphans.equal_range(child);
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+        orphans.push_back(iter->second);
+    }
+
+    for (auto oidx : orphans)
+    {
+        if (is_ancestor(oidx, nidx))
+            return false;
+        remove_orphan(oidx);
+        t_stnode onode = m_tree->get_node(oidx);
+        onode.m_pidx = nidx;
+        relink_node(onode);
+    }
+    return true;
+}
+
+void
+t_ctx_grouped_pkey::add_orphan(const t_tscalar& parent, t_uindex nidx)
+{
+    m_orphans.insert(std::make_pair(parent, nidx));
+    m_orphan_parents[nidx] = parent;
+}
+
+void
+t_ctx_grouped_pkey::remove_orphan(t_uindex nidx)
+{
+    auto piter = m_orphan_parents.find(nidx);
+    if (piter == m_orphan_parents.end())
+        return;
+
+    auto range = m_orphans.equal_range(piter->second);
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+        if (iter->second == nidx)
+        {
+            m_orphans.erase(iter);
+            break;
+        }
+    }
+    m_orphan_parents.erase(piter);
+}
+
+void
+t_ctx_grouped_pkey::relink_node(const t_stnode& node)
+{
+    t_uindex nidx = node.m_idx;
+
+    // Take the subtree out of the traversal, remembering open nodes
+    std::vector<t_ptidx> expanded;
+    t_tvidx tvidx = m_traversal->get_traversal_index(nidx);
+    if (tvidx != INVALID_INDEX)
+    {
+        t_tvidx eidx = tvidx + m_traversal->get_node(tvidx).m_ndesc + 1;
+        for (t_tvidx idx = tvidx; idx < eidx; ++idx)
+        {
+            t_tvnode tvnode = m_traversal->get_node(idx);
+            if (tvnode.m_expanded)
+                expanded.push_back(tvnode.m_tnid);
+        }
+        m_traversal->remove_subtree(tvidx);
+    }
+
+    t_stnode updated = node;
+    updated.m_depth = m_tree->get_depth(node.m_pidx) + 1;
+    m_tree->update_node(updated);
+
+    std::vector<t_uindex> queue = m_tree->get_child_idx(nidx);
+    while (!queue.empty())
+    {
+        t_uindex cidx = queue.back();
+        queue.pop_back();
+        t_stnode cnode = m_tree->get_node(cidx);
+        t_depth depth = m_tree->get_depth(cnode.m_pidx) + 1;
+        if (cnode.m_depth == depth)
+            continue;
+        cnode.m_depth = depth;
+        m_tree->update_node(cnode);
+        auto children = m_tree->get_child_idx(cidx);
+        queue.insert(queue.end(), children.begin(), children.end());
+    }
+
+    auto ancestry = m_tree->get_ancestry(nidx);
+    m_traversal->add_node(m_sortby, ancestry, ancestry.size() - 1);
+    for (auto tnid : expanded)
+    {
+        t_tvidx exp_idx = m_traversal->get_traversal_index(tnid);
+        if (exp_idx != INVALID_INDEX)
+            m_traversal->expand_node(m_sortby, exp_idx);
+    }
+    m_rows_changed = true;
+}
+
+t_bool
+t_ctx_grouped_pkey::is_ancestor(t_uindex nidx, t_uindex desc) const
+{
+    for (t_uindex idx = desc; idx != 0; idx = m_tree->get_parent_idx(idx))
+    {
+        if (idx == nidx)
+            return true;
+    }
+    return false;
+}
+
 void
 t_ctx_grouped_pkey::pprint() const
 {
@@ -40,6 +40,7 @@ t_ctx1::init()
     m_tree->init();
     m_traversal = std::shared_ptr<t_traversal>(
         new t_traversal(m_tree, m_config.handle_nan_sort()));
+    m_traversal->set_lazy(get_feature_state(CTX_FEAT_LAZY_EXPANSION));
     m_minmax = t_minmaxvec(m_config.get_num_aggregates());
     m_init = true;
 }
@@ -196,6 +197,8 @@ t_ctx1::step_begin()
     PSP_TRACE_SENTINEL();
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
     reset_step_state();
+    m_viewport_changed = false;
+    set_viewport_filter();
 }
 
 void
@@ -209,6 +212,35 @@ t_ctx1::step_end()
     {
         set_depth(m_depth);
     }
+    update_viewport_changed();
+}
+
+void
+t_ctx1::get_viewport_rows(const t_viewport& viewport,
+    std::vector<t_uindex>& out, std::vector<t_bool>& columns) const
+{
+    // Column 0 is the row path, aggregate aggidx is column aggidx + 1
+    t_index naggs = m_config.get_num_aggregates();
+    columns.resize(naggs);
+    for (t_index aggidx = std::max<t_index>(viewport.m_bcol - 1, 0);
+         aggidx < std::min<t_index>(viewport.m_ecol - 1, naggs); ++aggidx)
+    {
+        columns[aggidx] = true;
+    }
+
+    t_tvidx bidx = std::max<t_tvidx>(viewport.m_bidx, 0);
+    t_tvidx eidx = std::min<t_tvidx>(viewport.m_eidx, m_traversal->size());
+    for (t_tvidx idx = bidx; idx < eidx; ++idx)
+    {
+        out.push_back(0);
+        out.push_back(m_traversal->get_tree_index(idx));
+    }
+}
+
+std::vector<t_cell_deltas*>
+t_ctx1::get_viewport_deltas()
+{
+    return {&m_tree->get_deltas()};
 }
 
 t_aggspec
@@ -375,6 +407,14 @@ t_ctx1::set_minmax_enabled(bool enabled_state)
     m_tree->set_minmax_enabled(enabled_state);
 }
 
+void
+t_ctx1::set_lazy_expansion(bool enabled_state)
+{
+    m_features[CTX_FEAT_LAZY_EXPANSION] = enabled_state;
+    if (m_traversal)
+        m_traversal->set_lazy(enabled_state);
+}
+
 t_minmaxvec
 t_ctx1::get_min_max() const
 {
@@ -408,12 +448,12 @@ t_ctx1::get_cell_delta(t_tvidx bidx, t_tvidx eidx) const
     for (t_tvidx idx = bidx; idx < eidx; ++idx)
     {
         t_ptidx ptidx = m_traversal->get_tree_index(idx);
-        auto iterators = deltas->get<by_tc_nidx_aggidx>().equal_range(ptidx);
-        for (auto iter = iterators.first; iter != iterators.second; ++iter)
-        {
-            rval.push_back(t_cellupd(
-                idx, iter->m_aggidx + 1, iter->m_old_value, iter->m_new_value));
-        }
+        deltas.for_each_cell(ptidx,
+            [&](t_uindex aggidx, const t_tscalar& old_value,
+                const t_tscalar& new_value) {
+                rval.push_back(
+                    t_cellupd(idx, aggidx + 1, old_value, new_value));
+            });
     }
     return rval;
 }
@@ -426,8 +466,10 @@ t_ctx1::reset()
         pivots, m_config.get_aggregates(), m_schema, m_config);
     m_tree->init();
     m_tree->set_deltas_enabled(get_feature_state(CTX_FEAT_DELTA));
+    m_tree->set_minmax_enabled(get_feature_state(CTX_FEAT_MINMAX));
     m_traversal = std::shared_ptr<t_traversal>(
         new t_traversal(m_tree, m_config.handle_nan_sort()));
+    m_traversal->set_lazy(get_feature_state(CTX_FEAT_LAZY_EXPANSION));
 }
 
 void
@@ -457,6 +499,17 @@ t_ctx1::get_trees()
     return rval;
 }
 
+t_mem_usage
+t_ctx1::get_memory_usage() const
+{
+    PSP_TRACE_SENTINEL();
+    PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+    t_mem_usage rv(m_name);
+    rv.add(m_tree->get_memory_usage());
+    rv.add(m_traversal->get_memory_usage());
+    return rv;
+}
+
 t_uindex
 t_ctx1::get_leaf_count() const
 {
@@ -23,6 +23,7 @@ t_ctx2::t_ctx2()
     , m_row_depth_set(false)
     , m_column_depth(0)
     , m_column_depth_set(false)
+    , m_rollup(false)
 {
 }
 
@@ -32,6 +33,7 @@ t_ctx2::t_ctx2(const t_schema& schema, const t_config& pivot_config)
     , m_row_depth_set(false)
     , m_column_depth(0)
     , m_column_depth_set(false)
+    , m_rollup(false)
 {
 }
 
@@ -51,32 +53,57 @@ t_ctx2::repr() const
     return ss.str();
 }
 
+// Aggregates a coarser tree can fold from the strands of a finer one,
+// either as deltas or by recomputing over the pkeys of the node
+static t_bool
+is_rollup_agg(t_aggtype agg)
+{
+    switch (agg)
+    {
+        case AGGTYPE_SUM:
+        case AGGTYPE_PCT_SUM_PARENT:
+        case AGGTYPE_PCT_SUM_GRAND_TOTAL:
+        case AGGTYPE_COUNT:
+        case AGGTYPE_SCALED_DIV:
+        case AGGTYPE_SCALED_ADD:
+        case AGGTYPE_SCALED_MUL:
+        case AGGTYPE_MUL:
+        case AGGTYPE_MEAN:
+        case AGGTYPE_WEIGHTED_MEAN:
+        case AGGTYPE_UNIQUE:
+        case AGGTYPE_ANY:
+        case AGGTYPE_MEDIAN:
+        case AGGTYPE_JOIN:
+        case AGGTYPE_DOMINANT:
+        case AGGTYPE_FIRST:
+        case AGGTYPE_LAST:
+        case AGGTYPE_AND:
+        case AGGTYPE_OR:
+        case AGGTYPE_SUM_ABS:
+        case AGGTYPE_SUM_NOT_NULL:
+        case AGGTYPE_DISTINCT_COUNT:
+        case AGGTYPE_DISTINCT_LEAF:
+        case AGGTYPE_UDF_JS_REDUCE_FLOAT64:
+            return true;
+        default:
+            return false;
+    }
+}
+
 void
 t_ctx2::init()
 {
-    m_trees = std::vector<t_stree_sptr>(get_num_trees());
-
-    for (t_uindex treeidx = 0, tree_loop_end = m_trees.size();
-         treeidx < tree_loop_end; ++treeidx)
+    m_rollup = true;
+    for (const auto& spec : m_config.get_aggregates())
     {
-        t_pivotvec pivots;
-        if (treeidx > 0)
-        {
-            pivots.insert(pivots.end(), m_config.get_row_pivots().begin(),
-                m_config.get_row_pivots().begin() + treeidx);
-        }
-
-        pivots.insert(pivots.end(), m_config.get_column_pivots().begin(),
-            m_config.get_column_pivots().end());
-
-        m_trees[treeidx] = std::make_shared<t_stree>(
-            pivots, m_config.get_aggregates(), m_schema, m_config);
-
-        m_trees[treeidx]->init();
+        m_rollup = m_rollup && is_rollup_agg(spec.agg());
     }
 
+    init_trees();
+
     m_rtraversal
         = std::make_shared<t_traversal>(rtree(), m_config.handle_nan_sort());
+    m_rtraversal->set_lazy(get_feature_state(CTX_FEAT_LAZY_EXPANSION));
 
     m_ctraversal
         = std::make_shared<t_traversal>(ctree(), m_config.handle_nan_sort());
@@ -88,6 +115,8 @@ void
 t_ctx2::step_begin()
 {
     reset_step_state();
+    m_viewport_changed = false;
+    set_viewport_filter();
 }
 
 void
@@ -102,6 +131,45 @@ t_ctx2::step_end()
     {
         set_depth(HEADER_COLUMN, m_column_depth);
     }
+    update_viewport_changed();
+}
+
+void
+t_ctx2::get_viewport_rows(const t_viewport& viewport,
+    std::vector<t_uindex>& out, std::vector<t_bool>& columns) const
+{
+    // Cells already pick the aggregates, so every column is kept
+    auto ext = sanitize_get_data_extents(*this, viewport.m_bidx,
+        viewport.m_eidx, std::max<t_tvidx>(viewport.m_bcol, 1),
+        viewport.m_ecol);
+
+    std::vector<t_uidxpair> cells;
+    for (t_index ridx = ext.m_srow; ridx < ext.m_erow; ++ridx)
+    {
+        for (t_index cidx = ext.m_scol; cidx < ext.m_ecol; ++cidx)
+        {
+            cells.push_back(t_idxpair(ridx, cidx));
+        }
+    }
+
+    for (const auto& c : resolve_cells(cells))
+    {
+        if (c.m_idx < 0)
+            continue;
+        out.push_back(c.m_treenum);
+        out.push_back(c.m_idx);
+    }
+}
+
+std::vector<t_cell_deltas*>
+t_ctx2::get_viewport_deltas()
+{
+    std::vector<t_cell_deltas*> rval;
+    for (auto& tr : m_trees)
+    {
+        rval.push_back(&tr->get_deltas());
+    }
+    return rval;
 }
 
 t_index
@@ -356,30 +424,18 @@ t_ctx2::notify(const t_table& flattened, const t_table& delta,
     const t_table& existed)
 {
     psp_log_time(repr() + " notify.enter");
-    for (t_uindex tree_idx = 0, loop_end = m_trees.size(); tree_idx < loop_end;
-         ++tree_idx)
+    // Finest first, coarser trees read pkeys from rtree
+    std::pair<t_table_sptr, t_table_sptr> strand_values;
+    for (t_uindex tree_idx = m_trees.size(); tree_idx-- > 0;)
     {
-        if (is_rtree_idx(tree_idx))
-        {
-            notify_sparse_tree(rtree(), m_rtraversal, true,
-                m_config.get_aggregates(), m_config.get_sortby_pairs(),
-                m_row_sortby, flattened, delta, prev, current, transitions,
-                existed, m_config, *m_state);
-        }
-        else if (is_ctree_idx(tree_idx))
+        if (!m_rollup || is_rtree_idx(tree_idx))
         {
-            notify_sparse_tree(ctree(), m_ctraversal, true,
-                m_config.get_aggregates(), m_config.get_sortby_pairs(),
-                m_column_sortby, flattened, delta, prev, current, transitions,
-                existed, m_config, *m_state);
-        }
-        else
-        {
-            notify_sparse_tree(m_trees[tree_idx], t_trav_sptr(0), false,
-                m_config.get_aggregates(), m_config.get_sortby_pairs(),
-                t_sortsvec(), flattened, delta, prev, current, transitions,
-                existed, m_config, *m_state);
+            strand_values = m_trees[tree_idx]->build_strand_table(flattened,
+                delta, prev, current, transitions, m_config.get_aggregates(),
+                m_config);
         }
+
+        notify_tree(tree_idx, strand_values.first, strand_values.second);
     }
 
     if (!m_sortby.empty())
@@ -816,13 +872,12 @@ t_ctx2::get_step_delta(t_tvidx bidx, t_tvidx eidx)
 
         const auto& deltas = m_trees[c.m_treenum]->get_deltas();
 
-        auto iterators = deltas->get<by_tc_nidx_aggidx>().equal_range(c.m_idx);
-
-        for (auto iter = iterators.first; iter != iterators.second; ++iter)
-        {
-            updvec.push_back(t_cellupd(
-                c.m_ridx, c.m_cidx, iter->m_old_value, iter->m_new_value));
-        }
+        deltas.for_each_cell(c.m_idx,
+            [&](t_uindex, const t_tscalar& old_value,
+                const t_tscalar& new_value) {
+                updvec.push_back(
+                    t_cellupd(c.m_ridx, c.m_cidx, old_value, new_value));
+            });
     }
 
     clear_deltas();
@@ -838,27 +893,16 @@ t_ctx2::get_min_max() const
 void
 t_ctx2::reset()
 {
-    for (t_uindex treeidx = 0, tree_loop_end = m_trees.size();
-         treeidx < tree_loop_end; ++treeidx)
+    init_trees();
+    for (auto& tr : m_trees)
     {
-        t_pivotvec pivots;
-        if (treeidx > 0)
-        {
-            pivots.insert(pivots.end(), m_config.get_row_pivots().begin(),
-                m_config.get_row_pivots().begin() + treeidx);
-        }
-
-        pivots.insert(pivots.end(), m_config.get_column_pivots().begin(),
-            m_config.get_column_pivots().end());
-
-        m_trees[treeidx] = std::make_shared<t_stree>(
-            pivots, m_config.get_aggregates(), m_schema, m_config);
-        m_trees[treeidx]->init();
-        m_trees[treeidx]->set_deltas_enabled(get_feature_state(CTX_FEAT_DELTA));
+        tr->set_deltas_enabled(get_feature_state(CTX_FEAT_DELTA));
+        tr->set_minmax_enabled(get_feature_state(CTX_FEAT_MINMAX));
     }
 
     m_rtraversal
         = std::make_shared<t_traversal>(rtree(), m_config.handle_nan_sort());
+    m_rtraversal->set_lazy(get_feature_state(CTX_FEAT_LAZY_EXPANSION));
     m_ctraversal
         = std::make_shared<t_traversal>(ctree(), m_config.handle_nan_sort());
 }
@@ -915,6 +959,15 @@ t_ctx2::set_minmax_enabled(bool enabled_state)
     }
 }
 
+void
+t_ctx2::set_lazy_expansion(bool enabled_state)
+{
+    // Column headers stay materialized, there are few of them
+    m_features[CTX_FEAT_LAZY_EXPANSION] = enabled_state;
+    if (m_rtraversal)
+        m_rtraversal->set_lazy(enabled_state);
+}
+
 t_streeptr_vec
 t_ctx2::get_trees()
 {
@@ -928,6 +981,29 @@ t_ctx2::get_trees()
     return rval;
 }
 
+t_mem_usage
+t_ctx2::get_memory_usage() const
+{
+    PSP_TRACE_SENTINEL();
+    PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+    t_mem_usage rv(m_name);
+    for (t_uindex idx = 0, loop_end = m_trees.size(); idx < loop_end; ++idx)
+    {
+        auto tree = m_trees[idx]->get_memory_usage();
+        tree.m_name = "tree_" + std::to_string(idx);
+        rv.add(tree);
+    }
+
+    auto rtrav = m_rtraversal->get_memory_usage();
+    rtrav.m_name = "row_traversal";
+    rv.add(rtrav);
+
+    auto ctrav = m_ctraversal->get_memory_usage();
+    ctrav.m_name = "column_traversal";
+    rv.add(ctrav);
+    return rv;
+}
+
 t_uindex
 t_ctx2::get_leaf_count(t_header header) const
 {
@@ -1084,30 +1160,80 @@ t_ctx2::has_deltas() const
 void
 t_ctx2::notify(const t_table& flattened)
 {
-    for (t_uindex tree_idx = 0, loop_end = m_trees.size(); tree_idx < loop_end;
-         ++tree_idx)
+    std::pair<t_table_sptr, t_table_sptr> strand_values;
+    for (t_uindex tree_idx = m_trees.size(); tree_idx-- > 0;)
     {
-        if (is_rtree_idx(tree_idx))
+        if (!m_rollup || is_rtree_idx(tree_idx))
         {
-            notify_sparse_tree(rtree(), m_rtraversal, true,
-                m_config.get_aggregates(), m_config.get_sortby_pairs(),
-                m_row_sortby, flattened, m_config, *m_state);
+            strand_values = m_trees[tree_idx]->build_strand_table(
+                flattened, m_config.get_aggregates(), m_config);
         }
-        else if (is_ctree_idx(tree_idx))
+
+        notify_tree(tree_idx, strand_values.first, strand_values.second);
+    }
+}
+
+void
+t_ctx2::init_trees()
+{
+    m_trees = std::vector<t_stree_sptr>(get_num_trees());
+
+    for (t_uindex treeidx = 0, tree_loop_end = m_trees.size();
+         treeidx < tree_loop_end; ++treeidx)
+    {
+        t_pivotvec pivots;
+        if (treeidx > 0)
         {
-            notify_sparse_tree(ctree(), m_ctraversal, true,
-                m_config.get_aggregates(), m_config.get_sortby_pairs(),
-                m_column_sortby, flattened, m_config, *m_state);
+            pivots.insert(pivots.end(), m_config.get_row_pivots().begin(),
+                m_config.get_row_pivots().begin() + treeidx);
         }
-        else
+
+        pivots.insert(pivots.end(), m_config.get_column_pivots().begin(),
+            m_config.get_column_pivots().end());
+
+        m_trees[treeidx] = std::make_shared<t_stree>(
+            pivots, m_config.get_aggregates(), m_schema, m_config);
+
+        m_trees[treeidx]->init();
+    }
+
+    // rtree pivots on every column a coarser tree does, so its strands
+    // net out to the same per node deltas. Coarser trees fold those
+    // and read pkeys back from rtree rather than indexing them again.
+    if (m_rollup)
+    {
+        for (t_uindex treeidx = 0, tree_loop_end = m_trees.size() - 1;
+             treeidx < tree_loop_end; ++treeidx)
         {
-            notify_sparse_tree(m_trees[tree_idx], t_trav_sptr(0), false,
-                m_config.get_aggregates(), m_config.get_sortby_pairs(),
-                t_sortsvec(), flattened, m_config, *m_state);
+            m_trees[treeidx]->set_pkey_source(rtree(), treeidx);
         }
     }
 }
 
+void
+t_ctx2::notify_tree(
+    t_uindex tree_idx, t_table_sptr strands, t_table_sptr strand_deltas)
+{
+    if (is_rtree_idx(tree_idx))
+    {
+        notify_sparse_tree_common(strands, strand_deltas, rtree(),
+            m_rtraversal, true, m_config.get_aggregates(),
+            m_config.get_sortby_pairs(), m_row_sortby, *m_state);
+    }
+    else if (is_ctree_idx(tree_idx))
+    {
+        notify_sparse_tree_common(strands, strand_deltas, ctree(),
+            m_ctraversal, true, m_config.get_aggregates(),
+            m_config.get_sortby_pairs(), m_column_sortby, *m_state);
+    }
+    else
+    {
+        notify_sparse_tree_common(strands, strand_deltas, m_trees[tree_idx],
+            t_trav_sptr(0), false, m_config.get_aggregates(),
+            m_config.get_sortby_pairs(), t_sortsvec(), *m_state);
+    }
+}
+
 void
 t_ctx2::pprint() const
 {
@@ -19,12 +19,18 @@
 namespace perspective
 {
 
-t_ctx0::t_ctx0() {}
+t_ctx0::t_ctx0()
+    : m_delta_gen(0)
+    , m_topk(0)
+{
+}
 
 t_ctx0::t_ctx0(const t_schema& schema, const t_config& config)
     : t_ctxbase<t_ctx0>(schema, config)
     , m_minmax(m_config.get_num_columns())
+    , m_delta_gen(0)
     , m_has_delta(false)
+    , m_topk(0)
 
 {
 }
@@ -45,10 +51,12 @@ t_ctx0::step_begin()
     if (!m_init)
         return;
 
-    m_deltas = std::make_shared<t_zcdeltas>();
+    clear_cell_deltas();
     m_rows_changed = false;
     m_columns_changed = false;
+    m_viewport_changed = false;
     m_traversal->step_begin();
+    set_viewport_filter();
 }
 
 void
@@ -64,12 +72,13 @@ t_ctx0::step_end()
     t_uindex ncols = m_config.get_num_columns();
     t_minmaxvec rval(ncols);
 
-    auto pkeys = m_traversal->get_pkeys();
+    // Order does not matter for min and max
+    auto rows = m_traversal->get_unordered_rows();
     auto stbl = m_state->get_table();
 
 #ifdef PSP_PARALLEL_FOR
     PSP_PFOR(0, int(ncols), 1,
-        [&rval, &stbl, pkeys, this](int colidx)
+        [&rval, &stbl, &rows, this](int colidx)
 #else
     for (t_uindex colidx = 0; colidx < ncols; ++colidx)
 #endif
@@ -80,7 +89,7 @@ t_ctx0::step_end()
             {
                 auto v = m_state->reduce<std::function<
                     std::pair<t_tscalar, t_tscalar>(const t_tscalvec&)>>(
-                    pkeys, colname, get_vec_min_max);
+                    rows, colname, get_vec_min_max);
 
                 rval[colidx].m_min = v.first;
                 rval[colidx].m_max = v.second;
@@ -91,6 +100,37 @@ t_ctx0::step_end()
 #endif
 
     m_minmax = rval;
+    update_viewport_changed();
+}
+
+void
+t_ctx0::get_viewport_rows(const t_viewport& viewport,
+    std::vector<t_uindex>& out, std::vector<t_bool>& columns) const
+{
+    t_index ncols = m_config.get_num_columns();
+    columns.resize(ncols);
+    for (t_index cidx = std::max<t_index>(viewport.m_bcol, 0);
+         cidx < std::min<t_index>(viewport.m_ecol, ncols); ++cidx)
+    {
+        columns[cidx] = true;
+    }
+
+    t_tvidx bidx = std::max<t_tvidx>(viewport.m_bidx, 0);
+    t_tvidx eidx = std::min(viewport.m_eidx, m_traversal->size());
+    if (bidx >= eidx)
+        return;
+
+    for (auto ridx : m_traversal->get_rows(bidx, eidx))
+    {
+        out.push_back(0);
+        out.push_back(ridx);
+    }
+}
+
+std::vector<t_cell_deltas*>
+t_ctx0::get_viewport_deltas()
+{
+    return {&m_deltas};
 }
 
 // ASGGrid data interface
@@ -117,13 +157,13 @@ t_ctx0::get_data(t_tvidx start_row, t_tvidx end_row, t_tvidx start_col,
     t_index stride = ext.m_ecol - ext.m_scol;
     t_tscalvec values(nrows * stride);
 
-    t_tscalvec pkeys = m_traversal->get_pkeys(ext.m_srow, ext.m_erow);
+    std::vector<t_uindex> rows = m_traversal->get_rows(ext.m_srow, ext.m_erow);
     auto none = mknone();
 
     for (t_index cidx = ext.m_scol; cidx < ext.m_ecol; ++cidx)
     {
-        t_tscalvec out_data(pkeys.size());
-        m_state->read_column(m_config.col_at(cidx), pkeys, out_data);
+        t_tscalvec out_data(rows.size());
+        m_state->read_column(m_config.col_at(cidx), rows, out_data);
 
         for (t_index ridx = ext.m_srow; ridx < ext.m_erow; ++ridx)
         {
@@ -160,6 +200,28 @@ t_ctx0::reset_sortby()
     m_traversal->sort_by(m_state, m_config, t_sortsvec());
 }
 
+void
+t_ctx0::set_topk(t_uindex nrows)
+{
+    m_topk = nrows;
+    if (m_traversal)
+        m_traversal->set_topk(nrows);
+}
+
+void
+t_ctx0::remap_rows(const std::vector<t_uidxpair>& moves)
+{
+    m_traversal->remap_rows(moves);
+    m_deltas.remap_rows(moves);
+}
+
+void
+t_ctx0::set_state(t_gstate_sptr state)
+{
+    m_state = state;
+    m_traversal->set_state(state);
+}
+
 t_tscalar
 t_ctx0::get_column_name(t_index idx)
 {
@@ -175,7 +237,10 @@ void
 t_ctx0::init()
 {
     m_traversal = std::make_shared<t_ftrav>(m_config.handle_nan_sort());
-    m_deltas = std::make_shared<t_zcdeltas>();
+    m_traversal->set_topk(m_topk);
+    m_deltas.init(m_config.get_num_columns());
+    // Cell deltas are always captured
+    m_features[CTX_FEAT_DELTA] = true;
     m_symtable = std::make_shared<t_symtable>();
     m_init = true;
 }
@@ -223,14 +288,14 @@ t_ctx0::get_cell_data(const std::vector<t_uidxpair>& cells) const
     }
 
     // Order aligned with cells
-    t_tscalvec pkeys = get_all_pkeys(cells);
+    std::vector<t_uindex> rows = m_traversal->get_all_rows(cells);
     t_tscalvec out_data;
     out_data.reserve(cells.size());
 
-    for (t_index idx = 0, loop_end = pkeys.size(); idx < loop_end; ++idx)
+    for (t_index idx = 0, loop_end = rows.size(); idx < loop_end; ++idx)
     {
         t_str colname = m_config.col_at(cells[idx].second);
-        out_data.push_back(m_state->get(pkeys[idx], colname));
+        out_data.push_back(m_state->get_at(rows[idx], colname));
     }
 
     return out_data;
@@ -239,67 +304,26 @@ t_ctx0::get_cell_data(const std::vector<t_uidxpair>& cells) const
 t_cellupdvec
 t_ctx0::get_cell_delta(t_tvidx bidx, t_tvidx eidx) const
 {
-    t_tscalset pkeys;
-    t_tscalar prev_pkey;
-    prev_pkey.set(t_none());
+    t_cellupdvec rval;
+    if (m_deltas.empty())
+        return rval;
+
+    // Sorted views have always reported row eidx as well
+    if (!m_traversal->empty_sort_by())
+        ++eidx;
 
     bidx = std::min(bidx, m_traversal->size());
     eidx = std::min(eidx, m_traversal->size());
 
-    t_cellupdvec rval;
-
-    if (m_traversal->empty_sort_by())
-    {
-        t_tscalvec pkey_vec = m_traversal->get_pkeys(bidx, eidx);
-        for (t_index idx = 0, loop_end = pkey_vec.size(); idx < loop_end; ++idx)
-        {
-            const t_tscalar& pkey = pkey_vec[idx];
-            t_tvidx row = bidx + idx;
-            iterpair_by_zc_pkey_colidx iters
-                = m_deltas->get<by_zc_pkey_colidx>().equal_range(pkey);
-            for (iter_by_zc_pkey_colidx iter = iters.first;
-                 iter != iters.second; ++iter)
-            {
-                t_cellupd cellupd;
-                cellupd.row = row;
-                cellupd.column = iter->m_colidx;
-                cellupd.old_value = iter->m_old_value;
-                cellupd.new_value = iter->m_new_value;
-                rval.push_back(cellupd);
-            }
-        }
-    }
-    else
+    std::vector<t_uindex> rows = m_traversal->get_rows(bidx, eidx);
+    for (t_index idx = 0, loop_end = rows.size(); idx < loop_end; ++idx)
     {
-        for (iter_by_zc_pkey_colidx iter
-             = m_deltas->get<by_zc_pkey_colidx>().begin();
-             iter != m_deltas->get<by_zc_pkey_colidx>().end(); ++iter)
-        {
-            if (prev_pkey != iter->m_pkey)
-            {
-                pkeys.insert(iter->m_pkey);
-                prev_pkey = iter->m_pkey;
-            }
-        }
-
-        t_tscaltvimap r_indices;
-        m_traversal->get_row_indices(pkeys, r_indices);
-
-        for (iter_by_zc_pkey_colidx iter
-             = m_deltas->get<by_zc_pkey_colidx>().begin();
-             iter != m_deltas->get<by_zc_pkey_colidx>().end(); ++iter)
-        {
-            t_tvidx row = r_indices[iter->m_pkey];
-            if (bidx <= row && row <= eidx)
-            {
-                t_cellupd cellupd;
-                cellupd.row = row;
-                cellupd.column = iter->m_colidx;
-                cellupd.old_value = iter->m_old_value;
-                cellupd.new_value = iter->m_new_value;
-                rval.push_back(cellupd);
-            }
-        }
+        t_tvidx row = bidx + idx;
+        m_deltas.for_each_cell(rows[idx],
+            [&](t_uindex colidx, const t_tscalar& old_value,
+                const t_tscalar& new_value) {
+                rval.push_back(t_cellupd(row, colidx, old_value, new_value));
+            });
     }
     return rval;
 }
@@ -312,7 +336,7 @@ t_ctx0::get_step_delta(t_tvidx bidx, t_tvidx eidx)
     bool rows_changed = m_rows_changed || !m_traversal->empty_sort_by();
     t_stepdelta rval(
         rows_changed, m_columns_changed, get_cell_delta(bidx, eidx));
-    m_deltas->clear();
+    clear_cell_deltas();
     clear_deltas();
     return rval;
 }
@@ -333,7 +357,7 @@ void
 t_ctx0::reset()
 {
     m_traversal->reset();
-    m_deltas = std::make_shared<t_zcdeltas>();
+    clear_cell_deltas();
     m_minmax = t_minmaxvec(m_config.get_num_columns());
     m_has_delta = false;
 }
@@ -359,6 +383,8 @@ t_ctx0::notify(const t_table& flattened, const t_table& delta,
     t_col_csptr existed_sptr = existed.get_const_column("psp_existed");
     const t_column* existed_col = existed_sptr.get();
 
+    // Each pkey is resolved to its gstate row once, here
+    std::vector<t_uindex> row_ids(nrecs, t_cell_deltas::m_npos);
     t_bool delete_encountered = false;
     if (m_config.has_filters())
     {
@@ -367,8 +393,7 @@ t_ctx0::notify(const t_table& flattened, const t_table& delta,
 
         for (t_uindex idx = 0; idx < nrecs; ++idx)
         {
-            t_tscalar pkey
-                = m_symtable->get_interned_tscalar(pkey_col->get_scalar(idx));
+            t_tscalar pkey = pkey_col->get_scalar(idx);
 
             t_uint8 op_ = *(op_col->get_nth<t_uint8>(idx));
             t_op op = static_cast<t_op>(op_);
@@ -380,30 +405,34 @@ t_ctx0::notify(const t_table& flattened, const t_table& delta,
                 {
                     t_bool filter_curr = msk_curr->get(idx);
                     t_bool filter_prev = msk_prev->get(idx) && existed;
+                    t_uindex ridx = m_state->lookup(pkey).m_idx;
+                    row_ids[idx] = ridx;
 
                     if (filter_prev)
                     {
                         if (filter_curr)
                         {
-                            m_traversal->update_row(m_state, m_config, pkey);
+                            m_traversal->update_row(m_state, m_config, ridx);
                         }
                         else
                         {
-                            m_traversal->delete_row(pkey);
+                            m_traversal->delete_row(ridx);
                         }
                     }
                     else
                     {
                         if (filter_curr)
                         {
-                            m_traversal->add_row(m_state, m_config, pkey);
+                            m_traversal->add_row(m_state, m_config, ridx);
                         }
                     }
                 }
                 break;
                 case OP_DELETE:
                 {
-                    m_traversal->delete_row(pkey);
+                    t_rlookup lookup = m_state->lookup_erased(pkey);
+                    if (lookup.m_exists)
+                        m_traversal->delete_row(lookup.m_idx);
                     delete_encountered = true;
                 }
                 break;
@@ -415,8 +444,8 @@ t_ctx0::notify(const t_table& flattened, const t_table& delta,
             }
         }
         psp_log_time(repr() + " notify.has_filter_path.updated_traversal");
-        calc_step_delta(flattened, prev, curr, transitions);
-        m_has_delta = m_deltas->size() > 0 || delete_encountered;
+        calc_step_delta(row_ids, prev, curr, transitions);
+        m_has_delta = !m_deltas.empty() || delete_encountered;
         psp_log_time(repr() + " notify.has_filter_path.exit");
 
         return;
@@ -424,8 +453,7 @@ t_ctx0::notify(const t_table& flattened, const t_table& delta,
 
     for (t_uindex idx = 0; idx < nrecs; ++idx)
     {
-        t_tscalar pkey
-            = m_symtable->get_interned_tscalar(pkey_col->get_scalar(idx));
+        t_tscalar pkey = pkey_col->get_scalar(idx);
         t_uint8 op_ = *(op_col->get_nth<t_uint8>(idx));
         t_op op = static_cast<t_op>(op_);
         t_bool existed = *(existed_col->get_nth<t_bool>(idx));
@@ -434,19 +462,23 @@ t_ctx0::notify(const t_table& flattened, const t_table& delta,
         {
             case OP_INSERT:
             {
+                t_uindex ridx = m_state->lookup(pkey).m_idx;
+                row_ids[idx] = ridx;
                 if (existed)
                 {
-                    m_traversal->update_row(m_state, m_config, pkey);
+                    m_traversal->update_row(m_state, m_config, ridx);
                 }
                 else
                 {
-                    m_traversal->add_row(m_state, m_config, pkey);
+                    m_traversal->add_row(m_state, m_config, ridx);
                 }
             }
             break;
             case OP_DELETE:
             {
-                m_traversal->delete_row(pkey);
+                t_rlookup lookup = m_state->lookup_erased(pkey);
+                if (lookup.m_exists)
+                    m_traversal->delete_row(lookup.m_idx);
                 delete_encountered = true;
             }
             break;
@@ -459,23 +491,22 @@ t_ctx0::notify(const t_table& flattened, const t_table& delta,
     }
 
     psp_log_time(repr() + " notify.no_filter_path.updated_traversal");
-    calc_step_delta(flattened, prev, curr, transitions);
-    m_has_delta = m_deltas->size() > 0 || delete_encountered;
+    calc_step_delta(row_ids, prev, curr, transitions);
+    m_has_delta = !m_deltas.empty() || delete_encountered;
     psp_log_time(repr() + " notify.no_filter_path.exit");
 }
 
 void
-t_ctx0::calc_step_delta(const t_table& flattened, const t_table& prev,
-    const t_table& curr, const t_table& transitions)
+t_ctx0::calc_step_delta(const std::vector<t_uindex>& row_ids,
+    const t_table& prev, const t_table& curr, const t_table& transitions)
 {
-    t_uindex nrows = flattened.size();
+    t_uindex nrows = row_ids.size();
 
     PSP_VERBOSE_ASSERT(prev.size() == nrows, "Shape violation detected");
     PSP_VERBOSE_ASSERT(curr.size() == nrows, "Shape violation detected");
 
-    const t_column* pkey_col = flattened.get_const_column("psp_pkey").get();
-
     t_uindex ncols = m_config.get_num_columns();
+    t_intern_lease& strings = m_delta_strings[m_delta_gen];
 
     for (t_uindex cidx = 0; cidx < ncols; ++cidx)
     {
@@ -487,6 +518,9 @@ t_ctx0::calc_step_delta(const t_table& flattened, const t_table& prev,
 
         for (t_uindex ridx = 0; ridx < nrows; ++ridx)
         {
+            if (row_ids[ridx] == t_cell_deltas::m_npos)
+                continue;
+
             const t_uint8* trans_ = tcol->get_nth<t_uint8>(ridx);
             t_uint8 trans = *trans_;
             t_value_transition tr = static_cast<t_value_transition>(trans);
@@ -497,18 +531,15 @@ t_ctx0::calc_step_delta(const t_table& flattened, const t_table& prev,
                 case VALUE_TRANSITION_NEQ_FT:
                 case VALUE_TRANSITION_NEQ_TDT:
                 {
-                    m_deltas->insert(t_zcdelta(
-                        get_interned_tscalar(pkey_col->get_scalar(ridx)), cidx,
-                        mknone(),
-                        get_interned_tscalar(ccol->get_scalar(ridx))));
+                    m_deltas.insert(row_ids[ridx], cidx, mknone(),
+                        strings.get_interned_tscalar(ccol->get_scalar(ridx)));
                 }
                 break;
                 case VALUE_TRANSITION_NEQ_TT:
                 {
-                    m_deltas->insert(t_zcdelta(
-                        get_interned_tscalar(pkey_col->get_scalar(ridx)), cidx,
-                        get_interned_tscalar(pcol->get_scalar(ridx)),
-                        get_interned_tscalar(ccol->get_scalar(ridx))));
+                    m_deltas.insert(row_ids[ridx], cidx,
+                        strings.get_interned_tscalar(pcol->get_scalar(ridx)),
+                        strings.get_interned_tscalar(ccol->get_scalar(ridx)));
                 }
                 break;
                 default:
@@ -549,6 +580,24 @@ t_ctx0::get_trees()
     return t_streeptr_vec();
 }
 
+t_mem_usage
+t_ctx0::get_memory_usage() const
+{
+    PSP_TRACE_SENTINEL();
+    PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+    t_mem_usage rv(m_name);
+    rv.add(m_traversal->get_memory_usage());
+    rv.add(m_deltas.get_memory_usage());
+    rv.add(mem_usage_vector("minmax", m_minmax));
+    if (m_symtable)
+        rv.add(m_symtable->get_memory_usage());
+    t_mem_usage strings("delta_strings");
+    strings.add(m_delta_strings[0].get_memory_usage());
+    strings.add(m_delta_strings[1].get_memory_usage());
+    rv.add(strings);
+    return rv;
+}
+
 t_bool
 t_ctx0::has_deltas() const
 {
@@ -572,8 +621,7 @@ t_ctx0::notify(const t_table& flattened)
 
         for (t_uindex idx = 0; idx < nrecs; ++idx)
         {
-            t_tscalar pkey
-                = m_symtable->get_interned_tscalar(pkey_col->get_scalar(idx));
+            t_tscalar pkey = pkey_col->get_scalar(idx);
             t_uint8 op_ = *(op_col->get_nth<t_uint8>(idx));
             t_op op = static_cast<t_op>(op_);
 
@@ -583,7 +631,8 @@ t_ctx0::notify(const t_table& flattened)
                 {
                     if (msk->get(idx))
                     {
-                        m_traversal->add_row(m_state, m_config, pkey);
+                        m_traversal->add_row(
+                            m_state, m_config, m_state->lookup(pkey).m_idx);
                     }
                 }
                 break;
@@ -599,8 +648,7 @@ t_ctx0::notify(const t_table& flattened)
 
     for (t_uindex idx = 0; idx < nrecs; ++idx)
     {
-        t_tscalar pkey
-            = m_symtable->get_interned_tscalar(pkey_col->get_scalar(idx));
+        t_tscalar pkey = pkey_col->get_scalar(idx);
         t_uint8 op_ = *(op_col->get_nth<t_uint8>(idx));
         t_op op = static_cast<t_op>(op_);
 
@@ -608,7 +656,8 @@ t_ctx0::notify(const t_table& flattened)
         {
             case OP_INSERT:
             {
-                m_traversal->add_row(m_state, m_config, pkey);
+                m_traversal->add_row(
+                    m_state, m_config, m_state->lookup(pkey).m_idx);
             }
             break;
             default:
@@ -729,6 +778,21 @@ t_ctx0::clear_deltas()
     m_has_delta = false;
 }
 
+void
+t_ctx0::clear_cell_deltas()
+{
+    m_deltas.clear();
+
+    // Values handed out before this clear stay readable until the
+    // next one, so a step delta can be read after get_step_delta
+    // clears
+    if (m_delta_strings[m_delta_gen].size() > 0)
+    {
+        m_delta_gen ^= 1;
+        m_delta_strings[m_delta_gen].clear();
+    }
+}
+
 void
 t_ctx0::unity_init_load_step_end()
 {
@@ -8,6 +8,8 @@
  */
 
 #include <perspective/custom_column.h>
+#include <perspective/table.h>
+#include <sstream>
 
 namespace perspective
 {
@@ -19,7 +21,7 @@ t_custom_column::t_custom_column(const t_custom_column_recipe& ccr)
     , m_where_keys(ccr.m_where_keys)
     , m_where_values(ccr.m_where_values)
     , m_base_case(ccr.m_base_case)
-
+    , m_num_computed(0)
 {
 }
 
@@ -32,6 +34,7 @@ t_custom_column::t_custom_column(const std::vector<t_str>& icols,
     , m_where_keys(where_keys)
     , m_where_values(where_values)
     , m_base_case(base_case)
+    , m_num_computed(0)
 {
 }
 
@@ -84,4 +87,71 @@ t_custom_column::get_base_case() const
     return m_base_case;
 }
 
+void
+t_custom_column::init(const t_schema& schema)
+{
+    PSP_VERBOSE_ASSERT(m_where_keys.size() == m_where_values.size(),
+        "Mismatched where keys and values");
+
+    if (!schema.has_column(m_ocol))
+    {
+        PSP_COMPLAIN_AND_ABORT(
+            ("Custom column " + m_ocol + " not in schema").c_str());
+    }
+
+    std::stringstream ss;
+    for (t_uindex idx = 0, loop_end = m_where_keys.size(); idx < loop_end;
+         ++idx)
+    {
+        ss << "if((" << m_expr << ") == (" << m_where_keys[idx] << "), ("
+           << m_where_values[idx] << "), ";
+    }
+    ss << (m_where_keys.empty() ? m_expr
+                                : (m_base_case.empty() ? "null" : m_base_case));
+    for (t_uindex idx = 0, loop_end = m_where_keys.size(); idx < loop_end;
+         ++idx)
+    {
+        ss << ")";
+    }
+
+    auto expression = std::make_shared<t_expression>(ss.str(), schema);
+    if (!expression->can_store_as(schema.get_dtype(m_ocol)))
+    {
+        PSP_COMPLAIN_AND_ABORT(
+            ("Custom column " + m_ocol + " cannot hold its expression")
+                .c_str());
+    }
+    m_expression = expression;
+}
+
+const std::vector<t_str>&
+t_custom_column::get_expression_icols() const
+{
+    PSP_VERBOSE_ASSERT(m_expression, "Custom column not initialized");
+    return m_expression->get_icols();
+}
+
+void
+t_custom_column::compute(t_table& tbl) const
+{
+    PSP_VERBOSE_ASSERT(m_expression, "Custom column not initialized");
+    m_expression->compute(tbl, tbl.get_column(m_ocol).get());
+    m_num_computed += tbl.size();
+}
+
+void
+t_custom_column::compute(
+    t_table& tbl, const std::vector<t_uindex>& rows) const
+{
+    PSP_VERBOSE_ASSERT(m_expression, "Custom column not initialized");
+    m_expression->compute(tbl, rows, tbl.get_column(m_ocol).get());
+    m_num_computed += rows.size();
+}
+
+t_uindex
+t_custom_column::get_num_computed() const
+{
+    return m_num_computed;
+}
+
 } // namespace perspective
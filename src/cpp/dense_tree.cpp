@@ -14,6 +14,7 @@
 #include <perspective/comparators.h>
 #include <perspective/sort_specification.h>
 #include <perspective/table.h>
+#include <perspective/time_bucket.h>
 
 namespace perspective
 {
@@ -28,9 +29,16 @@ t_dtree::t_dtree(t_dssptr ds, const t_pivotvec& pivots,
     , m_backing_store(BACKING_STORE_MEMORY)
     , m_init(false)
     , m_sortby_colvec(sortby_colvec)
+    , m_partition_order(PARTITION_SORTED)
 {
 }
 
+void
+t_dtree::set_partition_order(t_partition_order order)
+{
+    m_partition_order = order;
+}
+
 t_uindex
 t_dtree::size() const
 {
@@ -54,6 +62,7 @@ t_dtree::t_dtree(const t_str& dirname, t_dssptr ds, const t_pivotvec& pivots,
     , m_backing_store(backing_store)
     , m_init(false)
     , m_sortby_colvec(sortby_colvec)
+    , m_partition_order(PARTITION_SORTED)
 {
 }
 
@@ -220,6 +229,15 @@ t_dtree::pivot(const t_filter& filter, t_uindex level)
             pivcol = m_ds->get_const_column(pivot_colname).get();
             t_dtype piv_dtype = pivcol->get_dtype();
 
+            // Buckets are computed for the rows being pivoted, rather
+            // than stored with the table
+            t_col_sptr bucketed;
+            if (is_time_bucket(pivot.mode()))
+            {
+                bucketed = bucket_column(pivcol, pivot.mode());
+                pivcol = bucketed.get();
+            }
+
             t_uindex next_neidx = 0;
 
             switch (piv_dtype)
@@ -227,72 +245,82 @@ t_dtree::pivot(const t_filter& filter, t_uindex level)
                 case DTYPE_STR:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_STR>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_STR>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_INT64:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_INT64>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_INT64>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_INT32:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_INT32>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_INT32>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_INT16:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_INT16>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_INT16>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_INT8:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_INT8>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_INT8>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_FLOAT64:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_FLOAT64>()(pivcol, &m_nodes,
-                           m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_FLOAT64>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_FLOAT32:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_FLOAT32>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_FLOAT32>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_BOOL:
                 {
 
                     next_neidx
-                        = t_pivot_processor<DTYPE_BOOL>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_BOOL>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_TIME:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_INT64>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_INT64>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 case DTYPE_DATE:
                 {
                     next_neidx
-                        = t_pivot_processor<DTYPE_UINT32>()(pivcol, &m_nodes,
-                            m_values[pidx].get(), m_leaves.get(), nbidx, neidx, mask);
+                        = t_pivot_processor<DTYPE_UINT32>(m_partition_order)(
+                            pivcol, &m_nodes, m_values[pidx].get(),
+                            m_leaves.get(), nbidx, neidx, mask);
                 }
                 break;
                 default:
@@ -368,7 +396,9 @@ t_dtree::_get_value(const t_filter& filter, t_ptidx nidx, bool sort_value) const
     t_index dpth = spi.first;
     t_uindex scalar_idx = spi.second;
 
-    if (sort_value || nidx == 0)
+    // Pivots without a sort by column sort on their values, which
+    // for time buckets differ from those of the pivot column
+    if (sort_value || nidx == 0 || !m_has_sortby[dpth])
     {
         const t_column& col = *m_values[dpth];
         return col.get_scalar(scalar_idx);
@@ -0,0 +1,1184 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/expression.h>
+#include <perspective/table.h>
+#include <perspective/column.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <numeric>
+#include <sstream>
+
+namespace perspective
+{
+
+namespace
+{
+
+// Rows evaluated per pass over the program
+const t_uindex EXPR_BLOCK_SIZE = 1024;
+
+enum t_expr_token_type
+{
+    TOKEN_NUMBER,
+    TOKEN_STRING,
+    TOKEN_NAME,
+    TOKEN_QUOTED_NAME,
+    TOKEN_SYMBOL,
+    TOKEN_END
+};
+
+struct t_expr_token
+{
+    t_expr_token_type m_type;
+    t_str m_text;
+    t_float64 m_number;
+};
+
+struct t_expr_function
+{
+    const char* m_name;
+    t_expr_op m_op;
+    t_uindex m_nargs;
+};
+
+const t_expr_function EXPR_FUNCTIONS[] = {{"abs", EXPR_ABS, 1},
+    {"sqrt", EXPR_SQRT, 1}, {"log", EXPR_LOG, 1}, {"exp", EXPR_EXP, 1},
+    {"floor", EXPR_FLOOR, 1}, {"ceil", EXPR_CEIL, 1},
+    {"round", EXPR_ROUND, 1}, {"pow", EXPR_POW, 2}, {"min", EXPR_MIN, 2},
+    {"max", EXPR_MAX, 2}, {"isnull", EXPR_ISNULL, 1}, {"len", EXPR_LEN, 1},
+    {"upper", EXPR_UPPER, 1}, {"lower", EXPR_LOWER, 1},
+    {"if", EXPR_IF, 3}};
+
+t_bool
+is_numeric(t_expr_type type)
+{
+    return type == EXPR_TYPE_NUMBER || type == EXPR_TYPE_BOOL
+        || type == EXPR_TYPE_NULL;
+}
+
+} // end anonymous namespace
+
+// Recursive descent parser emitting the program of an expression as
+// it goes. Each parse method returns the register of its result.
+class t_expr_parser
+{
+public:
+    t_expr_parser(const t_str& expr, const t_schema& schema, t_expression& rv)
+        : m_expr(expr)
+        , m_pos(0)
+        , m_schema(schema)
+        , m_rv(rv)
+    {
+        next();
+    }
+
+    void
+    parse()
+    {
+        parse_or();
+        if (m_token.m_type != TOKEN_END)
+            fail("unexpected '" + m_token.m_text + "'");
+    }
+
+private:
+    void
+    fail(const t_str& msg) const
+    {
+        std::stringstream ss;
+        ss << "Invalid expression `" << m_expr << "`: " << msg;
+        PSP_COMPLAIN_AND_ABORT(ss.str().c_str());
+    }
+
+    void
+    next()
+    {
+        while (m_pos < m_expr.size() && std::isspace(m_expr[m_pos]))
+            ++m_pos;
+
+        m_token.m_text.clear();
+        m_token.m_number = 0;
+
+        if (m_pos == m_expr.size())
+        {
+            m_token.m_type = TOKEN_END;
+            m_token.m_text = "end of input";
+            return;
+        }
+
+        char c = m_expr[m_pos];
+        if (std::isdigit(c) || (c == '.' && m_pos + 1 < m_expr.size()
+                                   && std::isdigit(m_expr[m_pos + 1])))
+        {
+            const char* begin = m_expr.c_str() + m_pos;
+            char* end = nullptr;
+            m_token.m_type = TOKEN_NUMBER;
+            m_token.m_number = std::strtod(begin, &end);
+            m_token.m_text = t_str(begin, end - begin);
+            m_pos += end - begin;
+            return;
+        }
+
+        if (std::isalpha(c) || c == '_')
+        {
+            t_uindex begin = m_pos;
+            while (m_pos < m_expr.size()
+                && (std::isalnum(m_expr[m_pos]) || m_expr[m_pos] == '_'))
+                ++m_pos;
+            m_token.m_type = TOKEN_NAME;
+            m_token.m_text = m_expr.substr(begin, m_pos - begin);
+            return;
+        }
+
+        if (c == '\'' || c == '"')
+        {
+            ++m_pos;
+            while (m_pos < m_expr.size() && m_expr[m_pos] != c)
+            {
+                if (m_expr[m_pos] == '\\' && m_pos + 1 < m_expr.size())
+                    ++m_pos;
+                m_token.m_text.push_back(m_expr[m_pos++]);
+            }
+            if (m_pos == m_expr.size())
+                fail("unterminated quote");
+            ++m_pos;
+            m_token.m_type = c == '\'' ? TOKEN_STRING : TOKEN_QUOTED_NAME;
+            return;
+        }
+
+        static const char* symbols[] = {"==", "!=", "<=", ">=", "&&", "||",
+            "<", ">", "+", "-", "*", "/", "%", "!", "(", ")", ","};
+        for (const char* sym : symbols)
+        {
+            t_uindex len = std::strlen(sym);
+            if (m_expr.compare(m_pos, len, sym) == 0)
+            {
+                m_token.m_type = TOKEN_SYMBOL;
+                m_token.m_text = sym;
+                m_pos += len;
+                return;
+            }
+        }
+
+        fail(t_str("unexpected '") + c + "'");
+    }
+
+    t_bool
+    accept(const char* symbol)
+    {
+        if ((m_token.m_type == TOKEN_SYMBOL || m_token.m_type == TOKEN_NAME)
+            && m_token.m_text == symbol)
+        {
+            next();
+            return true;
+        }
+        return false;
+    }
+
+    void
+    expect(const char* symbol)
+    {
+        if (!accept(symbol))
+            fail(t_str("expected '") + symbol + "' before '" + m_token.m_text
+                + "'");
+    }
+
+    t_expr_type
+    type_of(t_uindex reg) const
+    {
+        return m_rv.m_program[reg].m_type;
+    }
+
+    t_uindex
+    emit(t_expr_op op, t_expr_type type, t_uindex a = 0, t_uindex b = 0,
+        t_uindex c = 0)
+    {
+        t_expr_instr instr;
+        instr.m_op = op;
+        instr.m_type = type;
+        instr.m_a = a;
+        instr.m_b = b;
+        instr.m_c = c;
+        instr.m_number = 0;
+        m_rv.m_program.push_back(instr);
+        return m_rv.m_program.size() - 1;
+    }
+
+    void
+    check_numeric(t_uindex reg, const char* what) const
+    {
+        if (!is_numeric(type_of(reg)))
+            fail(t_str(what) + " expects numbers");
+    }
+
+    void
+    check_string(t_uindex reg, const char* what) const
+    {
+        t_expr_type type = type_of(reg);
+        if (type != EXPR_TYPE_STRING && type != EXPR_TYPE_NULL)
+            fail(t_str(what) + " expects strings");
+    }
+
+    void
+    check_bool(t_uindex reg, const char* what) const
+    {
+        t_expr_type type = type_of(reg);
+        if (type != EXPR_TYPE_BOOL && type != EXPR_TYPE_NULL)
+            fail(t_str(what) + " expects a condition");
+    }
+
+    // Gives a null literal the type of the value it stands in for
+    void
+    unify(t_uindex& a, t_uindex& b)
+    {
+        if (type_of(a) == EXPR_TYPE_NULL)
+            m_rv.m_program[a].m_type = type_of(b);
+        if (type_of(b) == EXPR_TYPE_NULL)
+            m_rv.m_program[b].m_type = type_of(a);
+    }
+
+    t_uindex
+    parse_or()
+    {
+        t_uindex lhs = parse_and();
+        while (accept("or") || accept("||"))
+        {
+            t_uindex rhs = parse_and();
+            check_bool(lhs, "or");
+            check_bool(rhs, "or");
+            lhs = emit(EXPR_OR, EXPR_TYPE_BOOL, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    t_uindex
+    parse_and()
+    {
+        t_uindex lhs = parse_not();
+        while (accept("and") || accept("&&"))
+        {
+            t_uindex rhs = parse_not();
+            check_bool(lhs, "and");
+            check_bool(rhs, "and");
+            lhs = emit(EXPR_AND, EXPR_TYPE_BOOL, lhs, rhs);
+        }
+        return lhs;
+    }
+
+    t_uindex
+    parse_not()
+    {
+        if (accept("not") || accept("!"))
+        {
+            t_uindex arg = parse_not();
+            check_bool(arg, "not");
+            return emit(EXPR_NOT, EXPR_TYPE_BOOL, arg);
+        }
+        return parse_comparison();
+    }
+
+    t_uindex
+    parse_comparison()
+    {
+        static const std::pair<const char*, t_expr_op> ops[]
+            = {{"==", EXPR_EQ}, {"!=", EXPR_NE}, {"<=", EXPR_LE},
+                {">=", EXPR_GE}, {"<", EXPR_LT}, {">", EXPR_GT}};
+
+        t_uindex lhs = parse_additive();
+        for (const auto& op : ops)
+        {
+            if (!accept(op.first))
+                continue;
+
+            t_uindex rhs = parse_additive();
+            unify(lhs, rhs);
+            t_bool strings = type_of(lhs) == EXPR_TYPE_STRING;
+            if (strings != (type_of(rhs) == EXPR_TYPE_STRING))
+                fail(t_str("cannot compare a string with a number using ")
+                    + op.first);
+            return emit(op.second, EXPR_TYPE_BOOL, lhs, rhs, strings);
+        }
+        return lhs;
+    }
+
+    t_uindex
+    parse_additive()
+    {
+        t_uindex lhs = parse_multiplicative();
+        while (true)
+        {
+            t_expr_op op;
+            if (accept("+"))
+                op = EXPR_ADD;
+            else if (accept("-"))
+                op = EXPR_SUB;
+            else
+                return lhs;
+
+            t_uindex rhs = parse_multiplicative();
+            check_numeric(lhs, "+ and -");
+            check_numeric(rhs, "+ and -");
+            lhs = emit(op, EXPR_TYPE_NUMBER, lhs, rhs);
+        }
+    }
+
+    t_uindex
+    parse_multiplicative()
+    {
+        t_uindex lhs = parse_unary();
+        while (true)
+        {
+            t_expr_op op;
+            if (accept("*"))
+                op = EXPR_MUL;
+            else if (accept("/"))
+                op = EXPR_DIV;
+            else if (accept("%"))
+                op = EXPR_MOD;
+            else
+                return lhs;
+
+            t_uindex rhs = parse_unary();
+            check_numeric(lhs, "*, / and %");
+            check_numeric(rhs, "*, / and %");
+            lhs = emit(op, EXPR_TYPE_NUMBER, lhs, rhs);
+        }
+    }
+
+    t_uindex
+    parse_unary()
+    {
+        if (accept("-"))
+        {
+            t_uindex arg = parse_unary();
+            check_numeric(arg, "-");
+            return emit(EXPR_NEG, EXPR_TYPE_NUMBER, arg);
+        }
+        return parse_primary();
+    }
+
+    t_uindex
+    parse_primary()
+    {
+        t_expr_token token = m_token;
+
+        switch (token.m_type)
+        {
+            case TOKEN_NUMBER:
+            {
+                next();
+                t_uindex reg = emit(EXPR_NUMBER, EXPR_TYPE_NUMBER);
+                m_rv.m_program[reg].m_number = token.m_number;
+                return reg;
+            }
+            case TOKEN_STRING:
+            {
+                next();
+                t_uindex reg = emit(EXPR_STRING, EXPR_TYPE_STRING);
+                m_rv.m_program[reg].m_string = token.m_text;
+                return reg;
+            }
+            case TOKEN_QUOTED_NAME:
+            {
+                next();
+                return parse_column(token.m_text);
+            }
+            case TOKEN_NAME:
+            {
+                next();
+                if (token.m_text == "null")
+                    return emit(EXPR_NULL, EXPR_TYPE_NULL);
+                if (token.m_text == "true" || token.m_text == "false")
+                {
+                    t_uindex reg = emit(EXPR_NUMBER, EXPR_TYPE_BOOL);
+                    m_rv.m_program[reg].m_number = token.m_text == "true";
+                    return reg;
+                }
+                if (accept("("))
+                    return parse_call(token.m_text);
+                return parse_column(token.m_text);
+            }
+            case TOKEN_SYMBOL:
+            {
+                if (accept("("))
+                {
+                    t_uindex reg = parse_or();
+                    expect(")");
+                    return reg;
+                }
+            }
+            // fallthrough
+            default:
+            {
+                fail("unexpected '" + token.m_text + "'");
+            }
+        }
+        return 0;
+    }
+
+    t_uindex
+    parse_column(const t_str& name)
+    {
+        if (!m_schema.has_column(name))
+            fail("no column named " + name);
+
+        auto iter = std::find(m_rv.m_icols.begin(), m_rv.m_icols.end(), name);
+        t_uindex icol = iter - m_rv.m_icols.begin();
+        if (iter == m_rv.m_icols.end())
+            m_rv.m_icols.push_back(name);
+
+        t_expr_type type;
+        switch (m_schema.get_dtype(name))
+        {
+            case DTYPE_STR:
+                type = EXPR_TYPE_STRING;
+                break;
+            case DTYPE_BOOL:
+                type = EXPR_TYPE_BOOL;
+                break;
+            case DTYPE_INT64:
+            case DTYPE_INT32:
+            case DTYPE_INT16:
+            case DTYPE_INT8:
+            case DTYPE_UINT64:
+            case DTYPE_UINT32:
+            case DTYPE_UINT16:
+            case DTYPE_UINT8:
+            case DTYPE_FLOAT64:
+            case DTYPE_FLOAT32:
+            case DTYPE_TIME:
+                type = EXPR_TYPE_NUMBER;
+                break;
+            default:
+            {
+                fail("column " + name + " has an unsupported type");
+                type = EXPR_TYPE_NULL;
+            }
+        }
+        return emit(EXPR_COLUMN, type, icol);
+    }
+
+    t_uindex
+    parse_call(const t_str& name)
+    {
+        std::vector<t_uindex> args;
+        if (!accept(")"))
+        {
+            do
+            {
+                args.push_back(parse_or());
+            } while (accept(","));
+            expect(")");
+        }
+
+        if (name == "concat")
+        {
+            if (args.empty())
+                fail("concat expects arguments");
+            for (auto arg : args)
+            {
+                check_string(arg, "concat");
+                m_rv.m_program[arg].m_type = EXPR_TYPE_STRING;
+            }
+            t_uindex reg = args[0];
+            for (t_uindex idx = 1; idx < args.size(); ++idx)
+                reg = emit(EXPR_CONCAT, EXPR_TYPE_STRING, reg, args[idx]);
+            return reg;
+        }
+
+        for (const auto& fn : EXPR_FUNCTIONS)
+        {
+            if (name != fn.m_name)
+                continue;
+
+            if (args.size() != fn.m_nargs)
+            {
+                std::stringstream ss;
+                ss << name << " expects " << fn.m_nargs << " arguments";
+                fail(ss.str());
+            }
+
+            switch (fn.m_op)
+            {
+                case EXPR_IF:
+                {
+                    check_bool(args[0], "if");
+                    unify(args[1], args[2]);
+                    t_expr_type type = type_of(args[1]);
+                    if (type != type_of(args[2]))
+                        fail("if branches have different types");
+                    return emit(EXPR_IF, type, args[0], args[1], args[2]);
+                }
+                case EXPR_ISNULL:
+                {
+                    return emit(EXPR_ISNULL, EXPR_TYPE_BOOL, args[0]);
+                }
+                case EXPR_LEN:
+                {
+                    check_string(args[0], name.c_str());
+                    return emit(fn.m_op, EXPR_TYPE_NUMBER, args[0]);
+                }
+                case EXPR_UPPER:
+                case EXPR_LOWER:
+                {
+                    check_string(args[0], name.c_str());
+                    m_rv.m_program[args[0]].m_type = EXPR_TYPE_STRING;
+                    return emit(fn.m_op, EXPR_TYPE_STRING, args[0]);
+                }
+                default:
+                {
+                    for (auto arg : args)
+                        check_numeric(arg, name.c_str());
+                    return emit(fn.m_op, EXPR_TYPE_NUMBER, args[0],
+                        args.size() > 1 ? args[1] : 0);
+                }
+            }
+        }
+
+        fail("unknown function " + name);
+        return 0;
+    }
+
+    const t_str& m_expr;
+    t_uindex m_pos;
+    t_expr_token m_token;
+    const t_schema& m_schema;
+    t_expression& m_rv;
+};
+
+t_expression::t_expression(const t_str& expr, const t_schema& schema)
+{
+    t_expr_parser parser(expr, schema, *this);
+    parser.parse();
+}
+
+t_dtype
+t_expression::get_dtype() const
+{
+    switch (m_program.back().m_type)
+    {
+        case EXPR_TYPE_BOOL:
+            return DTYPE_BOOL;
+        case EXPR_TYPE_STRING:
+            return DTYPE_STR;
+        default:
+            return DTYPE_FLOAT64;
+    }
+}
+
+const std::vector<t_str>&
+t_expression::get_icols() const
+{
+    return m_icols;
+}
+
+t_bool
+t_expression::can_store_as(t_dtype dtype) const
+{
+    switch (dtype)
+    {
+        case DTYPE_STR:
+            return m_program.back().m_type != EXPR_TYPE_NUMBER
+                && m_program.back().m_type != EXPR_TYPE_BOOL;
+        case DTYPE_BOOL:
+        case DTYPE_INT64:
+        case DTYPE_INT32:
+        case DTYPE_INT16:
+        case DTYPE_INT8:
+        case DTYPE_UINT64:
+        case DTYPE_UINT32:
+        case DTYPE_UINT16:
+        case DTYPE_UINT8:
+        case DTYPE_FLOAT64:
+        case DTYPE_FLOAT32:
+        case DTYPE_TIME:
+            return is_numeric(m_program.back().m_type);
+        default:
+            return false;
+    }
+}
+
+namespace
+{
+
+// Registers of one block of rows
+struct t_expr_regs
+{
+    t_expr_regs(t_uindex nregs)
+        : m_numbers(nregs * EXPR_BLOCK_SIZE)
+        , m_valid(nregs * EXPR_BLOCK_SIZE)
+        , m_strings(nregs * EXPR_BLOCK_SIZE)
+    {
+    }
+
+    t_float64*
+    numbers(t_uindex reg)
+    {
+        return m_numbers.data() + reg * EXPR_BLOCK_SIZE;
+    }
+
+    t_uint8*
+    valid(t_uindex reg)
+    {
+        return m_valid.data() + reg * EXPR_BLOCK_SIZE;
+    }
+
+    t_str*
+    strings(t_uindex reg)
+    {
+        return m_strings.data() + reg * EXPR_BLOCK_SIZE;
+    }
+
+    std::vector<t_float64> m_numbers;
+    std::vector<t_uint8> m_valid;
+    std::vector<t_str> m_strings;
+};
+
+template <typename DATA_T>
+void
+load_numbers(const t_column* col, const t_uindex* rows, t_uindex n,
+    t_float64* out, t_uint8* valid)
+{
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        out[idx] = static_cast<t_float64>(*(col->get_nth<DATA_T>(rows[idx])));
+        valid[idx] = col->is_valid(rows[idx]);
+    }
+}
+
+template <typename DATA_T>
+void
+store_numbers(t_column* col, const t_uindex* rows, t_uindex n,
+    const t_float64* in, const t_uint8* valid)
+{
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        if (valid[idx])
+            col->set_nth<DATA_T>(rows[idx], static_cast<DATA_T>(in[idx]));
+        col->set_valid(rows[idx], valid[idx]);
+    }
+}
+
+template <typename FUNC_T>
+void
+eval_unary(t_expr_regs& regs, const t_expr_instr& instr, t_uindex dst,
+    t_uindex n, FUNC_T fn)
+{
+    const t_float64* a = regs.numbers(instr.m_a);
+    const t_uint8* va = regs.valid(instr.m_a);
+    t_float64* out = regs.numbers(dst);
+    t_uint8* vout = regs.valid(dst);
+
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        out[idx] = fn(a[idx]);
+        vout[idx] = va[idx];
+    }
+}
+
+template <typename FUNC_T>
+void
+eval_binary(t_expr_regs& regs, const t_expr_instr& instr, t_uindex dst,
+    t_uindex n, FUNC_T fn)
+{
+    const t_float64* a = regs.numbers(instr.m_a);
+    const t_float64* b = regs.numbers(instr.m_b);
+    const t_uint8* va = regs.valid(instr.m_a);
+    const t_uint8* vb = regs.valid(instr.m_b);
+    t_float64* out = regs.numbers(dst);
+    t_uint8* vout = regs.valid(dst);
+
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        out[idx] = fn(a[idx], b[idx]);
+        vout[idx] = va[idx] & vb[idx];
+    }
+}
+
+// Comparisons of string registers, as numbers holding the sign of
+// strcmp
+void
+eval_compare_strings(
+    t_expr_regs& regs, const t_expr_instr& instr, t_uindex dst, t_uindex n)
+{
+    const t_str* a = regs.strings(instr.m_a);
+    const t_str* b = regs.strings(instr.m_b);
+    t_float64* out = regs.numbers(dst);
+
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        out[idx] = a[idx].compare(b[idx]);
+    }
+}
+
+template <typename FUNC_T>
+void
+eval_strings(t_expr_regs& regs, const t_expr_instr& instr, t_uindex dst,
+    t_uindex n, FUNC_T fn)
+{
+    const t_str* a = regs.strings(instr.m_a);
+    const t_uint8* va = regs.valid(instr.m_a);
+    t_str* out = regs.strings(dst);
+    t_uint8* vout = regs.valid(dst);
+
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        vout[idx] = va[idx];
+        if (va[idx])
+        {
+            out[idx] = a[idx];
+            std::transform(out[idx].begin(), out[idx].end(), out[idx].begin(),
+                fn);
+        }
+    }
+}
+
+void
+load_column(const t_column* col, const t_uindex* rows, t_uindex n,
+    t_expr_regs& regs, t_uindex dst)
+{
+    t_float64* out = regs.numbers(dst);
+    t_uint8* valid = regs.valid(dst);
+
+    switch (col->get_dtype())
+    {
+        case DTYPE_INT64:
+        case DTYPE_TIME:
+            load_numbers<t_int64>(col, rows, n, out, valid);
+            break;
+        case DTYPE_INT32:
+            load_numbers<t_int32>(col, rows, n, out, valid);
+            break;
+        case DTYPE_INT16:
+            load_numbers<t_int16>(col, rows, n, out, valid);
+            break;
+        case DTYPE_INT8:
+            load_numbers<t_int8>(col, rows, n, out, valid);
+            break;
+        case DTYPE_UINT64:
+            load_numbers<t_uint64>(col, rows, n, out, valid);
+            break;
+        case DTYPE_UINT32:
+            load_numbers<t_uint32>(col, rows, n, out, valid);
+            break;
+        case DTYPE_UINT16:
+            load_numbers<t_uint16>(col, rows, n, out, valid);
+            break;
+        case DTYPE_UINT8:
+            load_numbers<t_uint8>(col, rows, n, out, valid);
+            break;
+        case DTYPE_FLOAT64:
+            load_numbers<t_float64>(col, rows, n, out, valid);
+            break;
+        case DTYPE_FLOAT32:
+            load_numbers<t_float32>(col, rows, n, out, valid);
+            break;
+        case DTYPE_BOOL:
+            load_numbers<t_bool>(col, rows, n, out, valid);
+            break;
+        case DTYPE_STR:
+        {
+            t_str* strings = regs.strings(dst);
+            for (t_uindex idx = 0; idx < n; ++idx)
+            {
+                valid[idx] = col->is_valid(rows[idx]);
+                if (valid[idx])
+                    strings[idx] = col->get_nth<const char>(rows[idx]);
+            }
+        }
+        break;
+        default:
+        {
+            PSP_COMPLAIN_AND_ABORT("Unsupported expression column type");
+        }
+    }
+}
+
+void
+store_column(t_column* col, const t_uindex* rows, t_uindex n,
+    t_expr_regs& regs, t_uindex src)
+{
+    const t_float64* in = regs.numbers(src);
+    const t_uint8* valid = regs.valid(src);
+
+    switch (col->get_dtype())
+    {
+        case DTYPE_INT64:
+        case DTYPE_TIME:
+            store_numbers<t_int64>(col, rows, n, in, valid);
+            break;
+        case DTYPE_INT32:
+            store_numbers<t_int32>(col, rows, n, in, valid);
+            break;
+        case DTYPE_INT16:
+            store_numbers<t_int16>(col, rows, n, in, valid);
+            break;
+        case DTYPE_INT8:
+            store_numbers<t_int8>(col, rows, n, in, valid);
+            break;
+        case DTYPE_UINT64:
+            store_numbers<t_uint64>(col, rows, n, in, valid);
+            break;
+        case DTYPE_UINT32:
+            store_numbers<t_uint32>(col, rows, n, in, valid);
+            break;
+        case DTYPE_UINT16:
+            store_numbers<t_uint16>(col, rows, n, in, valid);
+            break;
+        case DTYPE_UINT8:
+            store_numbers<t_uint8>(col, rows, n, in, valid);
+            break;
+        case DTYPE_FLOAT64:
+            store_numbers<t_float64>(col, rows, n, in, valid);
+            break;
+        case DTYPE_FLOAT32:
+            store_numbers<t_float32>(col, rows, n, in, valid);
+            break;
+        case DTYPE_BOOL:
+        {
+            for (t_uindex idx = 0; idx < n; ++idx)
+            {
+                if (valid[idx])
+                    col->set_nth<t_bool>(rows[idx], in[idx] != 0);
+                col->set_valid(rows[idx], valid[idx]);
+            }
+        }
+        break;
+        case DTYPE_STR:
+        {
+            const t_str* strings = regs.strings(src);
+            for (t_uindex idx = 0; idx < n; ++idx)
+            {
+                if (valid[idx])
+                    col->set_nth<const char*>(
+                        rows[idx], strings[idx].c_str());
+                col->set_valid(rows[idx], valid[idx]);
+            }
+        }
+        break;
+        default:
+        {
+            PSP_COMPLAIN_AND_ABORT("Unsupported expression column type");
+        }
+    }
+}
+
+} // end anonymous namespace
+
+void
+t_expression::compute(const t_table& tbl, t_column* out) const
+{
+    std::vector<t_uindex> rows(tbl.size());
+    std::iota(rows.begin(), rows.end(), 0);
+    compute(tbl, rows, out);
+}
+
+void
+t_expression::compute(const t_table& tbl, const std::vector<t_uindex>& rows,
+    t_column* out) const
+{
+    PSP_VERBOSE_ASSERT(can_store_as(out->get_dtype()),
+        "Expression results do not fit the output column");
+
+    t_colcptrvec icols(m_icols.size());
+    for (t_uindex idx = 0, loop_end = m_icols.size(); idx < loop_end; ++idx)
+    {
+        icols[idx] = tbl.get_const_column(m_icols[idx]).get();
+    }
+
+    t_uindex nregs = m_program.size();
+    t_expr_regs regs(nregs);
+
+    for (t_uindex begin = 0, nrows = rows.size(); begin < nrows;
+         begin += EXPR_BLOCK_SIZE)
+    {
+        t_uindex n = std::min(EXPR_BLOCK_SIZE, nrows - begin);
+        const t_uindex* block = rows.data() + begin;
+
+        for (t_uindex dst = 0; dst < nregs; ++dst)
+        {
+            const t_expr_instr& instr = m_program[dst];
+            t_float64* out = regs.numbers(dst);
+            t_uint8* vout = regs.valid(dst);
+
+            switch (instr.m_op)
+            {
+                case EXPR_COLUMN:
+                {
+                    load_column(icols[instr.m_a], block, n, regs, dst);
+                }
+                break;
+                case EXPR_NUMBER:
+                {
+                    std::fill(out, out + n, instr.m_number);
+                    std::fill(vout, vout + n, 1);
+                }
+                break;
+                case EXPR_STRING:
+                {
+                    std::fill(regs.strings(dst), regs.strings(dst) + n,
+                        instr.m_string);
+                    std::fill(vout, vout + n, 1);
+                }
+                break;
+                case EXPR_NULL:
+                {
+                    std::fill(vout, vout + n, 0);
+                }
+                break;
+                case EXPR_ADD:
+                {
+                    eval_binary(regs, instr, dst, n,
+                        [](t_float64 a, t_float64 b) { return a + b; });
+                }
+                break;
+                case EXPR_SUB:
+                {
+                    eval_binary(regs, instr, dst, n,
+                        [](t_float64 a, t_float64 b) { return a - b; });
+                }
+                break;
+                case EXPR_MUL:
+                {
+                    eval_binary(regs, instr, dst, n,
+                        [](t_float64 a, t_float64 b) { return a * b; });
+                }
+                break;
+                case EXPR_DIV:
+                {
+                    eval_binary(regs, instr, dst, n,
+                        [](t_float64 a, t_float64 b) { return a / b; });
+                }
+                break;
+                case EXPR_MOD:
+                {
+                    eval_binary(regs, instr, dst, n, [](t_float64 a,
+                                                         t_float64 b) {
+                        return std::fmod(a, b);
+                    });
+                }
+                break;
+                case EXPR_POW:
+                {
+                    eval_binary(regs, instr, dst, n, [](t_float64 a,
+                                                         t_float64 b) {
+                        return std::pow(a, b);
+                    });
+                }
+                break;
+                case EXPR_MIN:
+                {
+                    eval_binary(regs, instr, dst, n, [](t_float64 a,
+                                                         t_float64 b) {
+                        return std::min(a, b);
+                    });
+                }
+                break;
+                case EXPR_MAX:
+                {
+                    eval_binary(regs, instr, dst, n, [](t_float64 a,
+                                                         t_float64 b) {
+                        return std::max(a, b);
+                    });
+                }
+                break;
+                case EXPR_NEG:
+                {
+                    eval_unary(
+                        regs, instr, dst, n, [](t_float64 a) { return -a; });
+                }
+                break;
+                case EXPR_ABS:
+                {
+                    eval_unary(regs, instr, dst, n,
+                        [](t_float64 a) { return std::fabs(a); });
+                }
+                break;
+                case EXPR_SQRT:
+                {
+                    eval_unary(regs, instr, dst, n,
+                        [](t_float64 a) { return std::sqrt(a); });
+                }
+                break;
+                case EXPR_LOG:
+                {
+                    eval_unary(regs, instr, dst, n,
+                        [](t_float64 a) { return std::log(a); });
+                }
+                break;
+                case EXPR_EXP:
+                {
+                    eval_unary(regs, instr, dst, n,
+                        [](t_float64 a) { return std::exp(a); });
+                }
+                break;
+                case EXPR_FLOOR:
+                {
+                    eval_unary(regs, instr, dst, n,
+                        [](t_float64 a) { return std::floor(a); });
+                }
+                break;
+                case EXPR_CEIL:
+                {
+                    eval_unary(regs, instr, dst, n,
+                        [](t_float64 a) { return std::ceil(a); });
+                }
+                break;
+                case EXPR_ROUND:
+                {
+                    eval_unary(regs, instr, dst, n,
+                        [](t_float64 a) { return std::round(a); });
+                }
+                break;
+                case EXPR_EQ:
+                case EXPR_NE:
+                case EXPR_LT:
+                case EXPR_LE:
+                case EXPR_GT:
+                case EXPR_GE:
+                {
+                    // String comparisons compare the sign of strcmp
+                    // with 0
+                    t_expr_instr cmp = instr;
+                    if (instr.m_c)
+                    {
+                        eval_compare_strings(regs, instr, dst, n);
+                        cmp.m_a = dst;
+                        cmp.m_b = dst;
+                    }
+
+                    const t_float64* a = regs.numbers(cmp.m_a);
+                    const t_float64* b = regs.numbers(cmp.m_b);
+                    t_bool strings = instr.m_c;
+                    for (t_uindex idx = 0; idx < n; ++idx)
+                    {
+                        t_float64 lhs = a[idx];
+                        t_float64 rhs = strings ? 0 : b[idx];
+                        t_bool rv = false;
+                        switch (instr.m_op)
+                        {
+                            case EXPR_EQ:
+                                rv = lhs == rhs;
+                                break;
+                            case EXPR_NE:
+                                rv = lhs != rhs;
+                                break;
+                            case EXPR_LT:
+                                rv = lhs < rhs;
+                                break;
+                            case EXPR_LE:
+                                rv = lhs <= rhs;
+                                break;
+                            case EXPR_GT:
+                                rv = lhs > rhs;
+                                break;
+                            default:
+                                rv = lhs >= rhs;
+                                break;
+                        }
+                        out[idx] = rv;
+                        vout[idx] = regs.valid(instr.m_a)[idx]
+                            & regs.valid(instr.m_b)[idx];
+                    }
+                }
+                break;
+                case EXPR_AND:
+                {
+                    eval_binary(regs, instr, dst, n,
+                        [](t_float64 a, t_float64 b) { return a && b; });
+                }
+                break;
+                case EXPR_OR:
+                {
+                    eval_binary(regs, instr, dst, n,
+                        [](t_float64 a, t_float64 b) { return a || b; });
+                }
+                break;
+                case EXPR_NOT:
+                {
+                    eval_unary(
+                        regs, instr, dst, n, [](t_float64 a) { return !a; });
+                }
+                break;
+                case EXPR_IF:
+                {
+                    const t_float64* cond = regs.numbers(instr.m_a);
+                    const t_uint8* vcond = regs.valid(instr.m_a);
+                    t_bool strings = instr.m_type == EXPR_TYPE_STRING;
+                    for (t_uindex idx = 0; idx < n; ++idx)
+                    {
+                        t_uindex src = cond[idx] ? instr.m_b : instr.m_c;
+                        vout[idx] = vcond[idx] & regs.valid(src)[idx];
+                        if (strings)
+                            regs.strings(dst)[idx] = regs.strings(src)[idx];
+                        else
+                            out[idx] = regs.numbers(src)[idx];
+                    }
+                }
+                break;
+                case EXPR_ISNULL:
+                {
+                    const t_uint8* va = regs.valid(instr.m_a);
+                    for (t_uindex idx = 0; idx < n; ++idx)
+                    {
+                        out[idx] = !va[idx];
+                        vout[idx] = 1;
+                    }
+                }
+                break;
+                case EXPR_LEN:
+                {
+                    const t_str* a = regs.strings(instr.m_a);
+                    const t_uint8* va = regs.valid(instr.m_a);
+                    for (t_uindex idx = 0; idx < n; ++idx)
+                    {
+                        out[idx] = va[idx] ? a[idx].size() : 0;
+                        vout[idx] = va[idx];
+                    }
+                }
+                break;
+                case EXPR_UPPER:
+                {
+                    eval_strings(regs, instr, dst, n,
+                        [](char c) { return std::toupper(c); });
+                }
+                break;
+                case EXPR_LOWER:
+                {
+                    eval_strings(regs, instr, dst, n,
+                        [](char c) { return std::tolower(c); });
+                }
+                break;
+                case EXPR_CONCAT:
+                {
+                    const t_str* a = regs.strings(instr.m_a);
+                    const t_str* b = regs.strings(instr.m_b);
+                    const t_uint8* va = regs.valid(instr.m_a);
+                    const t_uint8* vb = regs.valid(instr.m_b);
+                    t_str* strings = regs.strings(dst);
+                    for (t_uindex idx = 0; idx < n; ++idx)
+                    {
+                        vout[idx] = va[idx] & vb[idx];
+                        if (vout[idx])
+                            strings[idx] = a[idx] + b[idx];
+                    }
+                }
+                break;
+            }
+        }
+
+        store_column(out, block, n, regs, nregs - 1);
+    }
+}
+
+} // end namespace perspective
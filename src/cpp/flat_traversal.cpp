@@ -16,6 +16,7 @@
 #ifdef PSP_PARALLEL_FOR
 #include <tbb/parallel_sort.h>
 #endif
+#include <iterator>
 
 namespace perspective
 {
@@ -24,6 +25,9 @@ t_ftrav::t_ftrav(t_bool handle_nan_sort)
     : m_step_deletes(0)
     , m_step_inserts(0)
     , m_handle_nan_sort(handle_nan_sort)
+    , m_topk(0)
+    , m_sorted_end(0)
+    , m_window_end(0)
 {
     m_index = std::make_shared<t_mselemvec>();
 }
@@ -32,19 +36,44 @@ void
 t_ftrav::init()
 {
     m_index = std::make_shared<t_mselemvec>();
+    m_sorted_end = 0;
+}
+
+void
+t_ftrav::set_state(t_gstate_csptr state)
+{
+    m_state = state;
 }
 
 t_tscalvec
 t_ftrav::get_all_pkeys(const std::vector<t_uidxpair>& cells) const
+{
+    std::vector<t_uindex> rows = get_all_rows(cells);
+    t_tscalvec rval(rows.size());
+    for (t_uindex idx = 0, loop_end = rows.size(); idx < loop_end; ++idx)
+    {
+        rval[idx] = m_state->get_pkey(rows[idx]);
+    }
+    return rval;
+}
+
+std::vector<t_uindex>
+t_ftrav::get_all_rows(const std::vector<t_uidxpair>& cells) const
 {
     // assumes the code calling this has already validated
     // cells
-    t_tscalvec rval;
+    std::vector<t_uindex> rval;
     rval.reserve(cells.size());
+    t_tvidx eidx = 0;
+    for (const auto& cell : cells)
+    {
+        eidx = std::max(eidx, t_tvidx(cell.first) + 1);
+    }
+    ensure_sorted(eidx);
     t_mselemvec* index = m_index.get();
     for (auto iter = cells.begin(); iter != cells.end(); ++iter)
     {
-        rval.push_back((*index)[iter->first].m_pkey);
+        rval.push_back((*index)[iter->first].m_ridx);
     }
     return rval;
 }
@@ -61,12 +90,15 @@ t_ftrav::get_pkeys(const std::vector<t_uidxpair>& cells) const
         all_rows.insert(cells[idx].first);
     }
 
+    if (!all_rows.empty())
+        ensure_sorted(*all_rows.rbegin() + 1);
+
     t_tscalvec rval(all_rows.size());
     std::set<t_tvidx>::iterator it;
     t_index count = 0;
     for (it = all_rows.begin(); it != all_rows.end(); ++it)
     {
-        rval[count] = (*m_index)[*it].m_pkey;
+        rval[count] = m_state->get_pkey((*m_index)[*it].m_ridx);
         ++count;
     }
     return rval;
@@ -74,13 +106,26 @@ t_ftrav::get_pkeys(const std::vector<t_uidxpair>& cells) const
 
 t_tscalvec
 t_ftrav::get_pkeys(t_tvidx begin_row, t_tvidx end_row) const
+{
+    std::vector<t_uindex> rows = get_rows(begin_row, end_row);
+    t_tscalvec rval(rows.size());
+    for (t_uindex idx = 0, loop_end = rows.size(); idx < loop_end; ++idx)
+    {
+        rval[idx] = m_state->get_pkey(rows[idx]);
+    }
+    return rval;
+}
+
+std::vector<t_uindex>
+t_ftrav::get_rows(t_tvidx begin_row, t_tvidx end_row) const
 {
     t_tvidx index_size = m_index->size();
     end_row = std::min(end_row, index_size);
-    t_tscalvec rval(end_row - begin_row);
+    ensure_sorted(end_row);
+    std::vector<t_uindex> rval(end_row - begin_row);
     for (t_tvidx ridx = begin_row; ridx < end_row; ++ridx)
     {
-        rval[ridx - begin_row] = (*m_index)[ridx].m_pkey;
+        rval[ridx - begin_row] = (*m_index)[ridx].m_ridx;
     }
     return rval;
 }
@@ -91,17 +136,29 @@ t_ftrav::get_pkeys() const
     return get_pkeys(0, size());
 }
 
+std::vector<t_uindex>
+t_ftrav::get_unordered_rows() const
+{
+    std::vector<t_uindex> rval(m_index->size());
+    for (t_index idx = 0, loop_end = rval.size(); idx < loop_end; ++idx)
+    {
+        rval[idx] = (*m_index)[idx].m_ridx;
+    }
+    return rval;
+}
+
 t_tscalar
 t_ftrav::get_pkey(t_tvidx idx) const
 {
-    return (*m_index)[idx].m_pkey;
+    ensure_sorted(idx + 1);
+    return m_state->get_pkey((*m_index)[idx].m_ridx);
 }
 
 void
 t_ftrav::fill_sort_elem(t_gstate_csptr state, const t_config& config,
-    t_tscalar pkey, t_mselem& out_elem)
+    t_uindex ridx, t_mselem& out_elem)
 {
-    out_elem.m_pkey = pkey;
+    out_elem.m_ridx = ridx;
     t_index sortby_size = m_sortby.size();
     out_elem.m_row.reserve(sortby_size);
     for (t_index idx = 0; idx < sortby_size; ++idx)
@@ -109,8 +166,8 @@ t_ftrav::fill_sort_elem(t_gstate_csptr state, const t_config& config,
         t_index sortby_idx = m_sortby[idx].m_agg_index;
         const t_str& colname = config.col_at(sortby_idx);
         const t_str sortby_colname = config.get_sort_by(colname);
-        out_elem.m_row.push_back(
-            m_symtable.get_interned_tscalar(state->get(pkey, sortby_colname)));
+        out_elem.m_row.push_back(m_symtable.get_interned_tscalar(
+            state->get_at(ridx, sortby_colname)));
     }
 }
 
@@ -118,7 +175,7 @@ void
 t_ftrav::fill_sort_elem(t_gstate_csptr state, const t_config& config,
     const t_tscalvec& row, t_mselem& out_elem) const
 {
-    out_elem.m_pkey = mknone();
+    out_elem.m_ridx = m_npos;
     t_index sortby_size = m_sortby.size();
     out_elem.m_row.reserve(sortby_size);
     for (t_index idx = 0; idx < sortby_size; ++idx)
@@ -137,25 +194,27 @@ t_ftrav::sort_by(
 {
     if (sortby.empty())
         return;
-    t_multisorter sorter(get_sort_orders(sortby), m_handle_nan_sort);
     t_index size = m_index->size();
     auto sort_elems = std::make_shared<t_mselemvec>(static_cast<size_t>(size));
     m_sortby = sortby;
+    t_sorter sorter(this);
 
     for (t_index idx = 0; idx < size; ++idx)
     {
         t_mselem& elem = (*sort_elems)[idx];
-        t_tscalar pkey = (*m_index)[idx].m_pkey;
-        fill_sort_elem(state, config, pkey, elem);
+        fill_sort_elem(state, config, (*m_index)[idx].m_ridx, elem);
     }
 
     std::swap(m_index, sort_elems);
-    std::sort(m_index->begin(), m_index->end(), sorter);
-    m_pkeyidx.clear();
-    for (t_index idx = 0, loop_end = m_index->size(); idx < loop_end; ++idx)
+    if (is_partial())
     {
-        m_pkeyidx[(*m_index)[idx].m_pkey] = idx;
+        m_sorted_end = 0;
+        sort_prefix(std::max<t_index>(m_topk, m_window_end));
+        return;
     }
+
+    std::sort(m_index->begin(), m_index->end(), sorter);
+    reindex(0, m_index->size());
 }
 
 t_index
@@ -167,9 +226,10 @@ t_ftrav::size() const
 void
 t_ftrav::get_row_indices(const t_tscalset& pkeys, t_tscaltvimap& out_map) const
 {
+    ensure_sorted(size());
     for (t_tvidx idx = 0, loop_end = size(); idx < loop_end; ++idx)
     {
-        const t_tscalar& pkey = (*m_index)[idx].m_pkey;
+        t_tscalar pkey = m_state->get_pkey((*m_index)[idx].m_ridx);
         if (pkeys.find(pkey) != pkeys.end())
         {
             out_map[pkey] = idx;
@@ -181,9 +241,11 @@ void
 t_ftrav::get_row_indices(t_tvidx bidx, t_tvidx eidx, const t_tscalset& pkeys,
     t_tscaltvimap& out_map) const
 {
+    eidx = std::min(eidx, t_tvidx(size()));
+    ensure_sorted(eidx);
     for (t_tvidx idx = bidx; idx < eidx; ++idx)
     {
-        const t_tscalar& pkey = (*m_index)[idx].m_pkey;
+        t_tscalar pkey = m_state->get_pkey((*m_index)[idx].m_ridx);
         if (pkeys.find(pkey) != pkeys.end())
         {
             out_map[pkey] = idx;
@@ -196,22 +258,25 @@ t_ftrav::reset()
 {
     if (m_index.get())
         m_index->clear();
+    m_rowidx.clear();
+    m_sorted_end = 0;
+    m_step_changed.clear();
 }
 
 void
 t_ftrav::check_size()
 {
-    t_tscalset pkey_set;
+    std::set<t_uindex> row_set;
     for (t_index idx = 0, loop_end = m_index->size(); idx < loop_end; ++idx)
     {
-        if (pkey_set.find((*m_index)[idx].m_pkey) != pkey_set.end())
+        t_uindex ridx = (*m_index)[idx].m_ridx;
+        if (row_set.find(ridx) != row_set.end())
         {
-            std::cout << "Duplicate entry for " << (*m_index)[idx].m_pkey
-                      << std::endl;
+            std::cout << "Duplicate entry for row " << ridx << std::endl;
             PSP_COMPLAIN_AND_ABORT("Exiting");
         }
 
-        pkey_set.insert((*m_index)[idx].m_pkey);
+        row_set.insert(ridx);
     }
 }
 
@@ -235,92 +300,137 @@ t_ftrav::step_begin()
     m_step_deletes = 0;
     m_step_inserts = 0;
     m_new_elems.clear();
+    m_step_changed.clear();
+
+    // Stop maintaining order past what was read since the last tick
+    if (is_partial())
+    {
+        t_index keep = std::max<t_index>(m_topk, m_window_end);
+        if (m_sorted_end > keep)
+        {
+            m_sorted_end = keep;
+            set_bound((*m_index)[keep - 1]);
+        }
+        m_window_end = 0;
+    }
 }
 
 void
 t_ftrav::step_end()
 {
+    if (is_partial() && m_sorted_end > 0)
+    {
+        step_end_partial();
+        return;
+    }
+
     t_index new_size = m_index->size() + m_step_inserts - m_step_deletes;
 
     auto new_index = std::make_shared<t_mselemvec>();
     new_index->reserve(new_size);
 
-    t_pkeyidx_map added;
-
+    std::fill(m_rowidx.begin(), m_rowidx.end(), -1);
     for (t_index idx = 0, loop_end = m_index->size(); idx < loop_end; ++idx)
     {
         t_mselem& elem = (*m_index)[idx];
         if (!elem.m_deleted)
         {
+            set_row(elem.m_ridx, new_index->size());
             new_index->push_back(elem);
-            added[elem.m_pkey] = idx;
         }
     }
 
-    for (t_pkmselem_map::const_iterator pkelem_iter = m_new_elems.begin();
-         pkelem_iter != m_new_elems.end(); ++pkelem_iter)
+    for (const auto& kv : m_new_elems)
     {
-
-        const t_mselem& elem = pkelem_iter->second;
-        t_pkeyidx_map::const_iterator iter = added.find(pkelem_iter->first);
-        if (iter == added.end())
+        t_index idx = find_row(kv.first);
+        if (idx < 0)
         {
-            new_index->push_back(elem);
+            new_index->push_back(kv.second);
         }
         else
         {
-            (*new_index)[iter->second] = elem;
+            (*new_index)[idx] = kv.second;
         }
     }
     std::swap(new_index, m_index);
-    t_multisorter sorter(get_sort_orders(m_sortby), m_handle_nan_sort);
-    std::sort(m_index->begin(), m_index->end(), sorter);
-
-    m_pkeyidx.clear();
-
     m_new_elems.clear();
+    m_step_changed.clear();
 
-    for (t_index idx = 0, loop_end = m_index->size(); idx < loop_end; ++idx)
+    if (is_partial())
     {
-        m_pkeyidx[(*m_index)[idx].m_pkey] = idx;
+        m_sorted_end = 0;
+        sort_prefix(m_topk);
+        return;
     }
+
+    t_sorter sorter(this);
+    std::sort(m_index->begin(), m_index->end(), sorter);
+    reindex(0, m_index->size());
 }
 
 void
-t_ftrav::add_row(t_gstate_csptr state, const t_config& config, t_tscalar pkey)
+t_ftrav::add_row(t_gstate_csptr state, const t_config& config, t_uindex ridx)
 {
     t_mselem mselem;
-    fill_sort_elem(state, config, pkey, mselem);
-    m_new_elems[pkey] = mselem;
+    fill_sort_elem(state, config, ridx, mselem);
+    m_new_elems[ridx] = mselem;
     ++m_step_inserts;
 }
 
 void
 t_ftrav::update_row(
-    t_gstate_csptr state, const t_config& config, t_tscalar pkey)
+    t_gstate_csptr state, const t_config& config, t_uindex ridx)
 {
     if (m_sortby.empty())
         return;
-    t_pkeyidx_map::iterator pkiter = m_pkeyidx.find(pkey);
-    if (pkiter == m_pkeyidx.end())
+    t_index idx = find_row(ridx);
+    if (idx < 0)
     {
-        add_row(state, config, pkey);
+        add_row(state, config, ridx);
         return;
     }
     t_mselem mselem;
-    fill_sort_elem(state, config, pkey, mselem);
-    (*m_index)[pkiter->second] = mselem;
+    fill_sort_elem(state, config, ridx, mselem);
+    (*m_index)[idx] = mselem;
+    if (is_partial())
+        m_step_changed.push_back(idx);
 }
 
 void
-t_ftrav::delete_row(t_tscalar pkey)
+t_ftrav::delete_row(t_uindex ridx)
 {
-    t_pkeyidx_map::iterator pkiter = m_pkeyidx.find(pkey);
-    if (pkiter == m_pkeyidx.end())
+    t_index idx = find_row(ridx);
+    if (idx < 0)
         return;
-    (*m_index)[pkiter->second].m_deleted = true;
-    m_new_elems.erase(pkey);
+    (*m_index)[idx].m_deleted = true;
+    m_new_elems.erase(ridx);
     ++m_step_deletes;
+    if (is_partial())
+        m_step_changed.push_back(idx);
+}
+
+void
+t_ftrav::remap_rows(const std::vector<t_uidxpair>& moves)
+{
+    for (const auto& move : moves)
+    {
+        t_index idx = find_row(move.first);
+        if (idx >= 0)
+        {
+            (*m_index)[idx].m_ridx = move.second;
+            m_rowidx[move.first] = -1;
+            set_row(move.second, idx);
+        }
+
+        auto iter = m_new_elems.find(move.first);
+        if (iter != m_new_elems.end())
+        {
+            t_mselem elem = iter->second;
+            elem.m_ridx = move.second;
+            m_new_elems.erase(iter);
+            m_new_elems[move.second] = elem;
+        }
+    }
 }
 
 t_sortsvec
@@ -347,7 +457,8 @@ t_uindex
 t_ftrav::lower_bound_row_idx(
     t_gstate_csptr state, const t_config& config, const t_tscalvec& row) const
 {
-    t_multisorter sorter(get_sort_orders(m_sortby), m_handle_nan_sort);
+    ensure_sorted(size());
+    t_sorter sorter(this);
     t_mselem target_val;
 
     fill_sort_elem(state, config, row, target_val);
@@ -359,12 +470,307 @@ t_ftrav::lower_bound_row_idx(
 }
 
 t_index
-t_ftrav::get_row_idx(t_tscalar pkey) const
+t_ftrav::get_row_idx(t_uindex ridx) const
+{
+    ensure_sorted(size());
+    return find_row(ridx);
+}
+
+t_mem_usage
+t_ftrav::get_memory_usage() const
+{
+    t_mem_usage rv("traversal");
+
+    // sort rows are heap allocated per element
+    t_mem_usage index = mem_usage_vector("index", *m_index);
+    for (const auto& e : *m_index)
+    {
+        index.m_size += e.m_row.size() * sizeof(t_tscalar);
+        index.m_capacity += e.m_row.capacity() * sizeof(t_tscalar);
+    }
+    rv.add(index);
+
+    rv.add(mem_usage_vector("rowidx", m_rowidx));
+
+    t_mem_usage new_elems = mem_usage_hashed("new_elems", m_new_elems);
+    for (const auto& kv : m_new_elems)
+    {
+        new_elems.m_size += kv.second.m_row.size() * sizeof(t_tscalar);
+        new_elems.m_capacity += kv.second.m_row.capacity() * sizeof(t_tscalar);
+    }
+    rv.add(new_elems);
+    rv.add(mem_usage_vector("step_changed", m_step_changed));
+    rv.add(m_symtable.get_memory_usage());
+    return rv;
+}
+
+void
+t_ftrav::set_topk(t_uindex nrows)
+{
+    if (m_topk == 0 && nrows > 0)
+    {
+        // Everything is sorted already
+        m_sorted_end = size();
+        if (m_sorted_end > 0)
+            set_bound(m_index->back());
+    }
+    else if (nrows == 0)
+    {
+        ensure_sorted(size());
+    }
+    m_topk = nrows;
+}
+
+t_uindex
+t_ftrav::get_topk() const
+{
+    return m_topk;
+}
+
+t_ftrav::t_sorter::t_sorter(const t_ftrav* trav)
+    : m_trav(trav)
+    , m_sort_order(get_sort_orders(trav->m_sortby))
+{
+}
+
+bool
+t_ftrav::t_sorter::operator()(const t_mselem& a, const t_mselem& b) const
+{
+    return cmp_mselem(a, b, m_sort_order, m_trav->m_handle_nan_sort,
+        [this](const t_mselem& elem) { return m_trav->get_elem_pkey(elem); });
+}
+
+t_tscalar
+t_ftrav::get_elem_pkey(const t_mselem& elem) const
+{
+    if (elem.m_ridx == m_bound_ridx)
+        return m_bound_pkey;
+    if (elem.m_ridx == m_npos)
+        return mknone();
+    return m_state->get_pkey(elem.m_ridx);
+}
+
+void
+t_ftrav::set_bound(const t_mselem& elem) const
+{
+    // step_begin runs after update_history erased this step's deletes
+    m_bound_pkey = elem.m_ridx == m_npos ? mknone()
+                                         : m_state->get_last_pkey(elem.m_ridx);
+    m_bound = elem;
+    m_bound.m_ridx = m_bound_ridx;
+}
+
+t_bool
+t_ftrav::is_partial() const
+{
+    return m_topk > 0 && !m_sortby.empty();
+}
+
+t_index
+t_ftrav::find_row(t_uindex ridx) const
+{
+    return ridx < m_rowidx.size() ? m_rowidx[ridx] : -1;
+}
+
+void
+t_ftrav::set_row(t_uindex ridx, t_index idx) const
+{
+    if (ridx >= m_rowidx.size())
+    {
+        m_rowidx.resize(
+            std::max<t_uindex>(ridx + 1, m_rowidx.size() * 2), -1);
+    }
+    m_rowidx[ridx] = idx;
+}
+
+void
+t_ftrav::ensure_sorted(t_index eidx) const
+{
+    if (!is_partial())
+        return;
+
+    m_window_end = std::max(m_window_end, eidx);
+    if (eidx > m_sorted_end)
+    {
+        // Sort a margin past the range read, so scrolling on does
+        // not partition again right away
+        sort_prefix(eidx + m_topk);
+    }
+}
+
+void
+t_ftrav::sort_prefix(t_index eidx) const
+{
+    t_mselemvec& index = *m_index;
+    t_index size = index.size();
+    eidx = std::min(eidx, size);
+    if (eidx <= m_sorted_end)
+        return;
+
+    t_sorter sorter(this);
+    auto bidx = index.begin() + m_sorted_end;
+    if (eidx < size)
+        std::nth_element(bidx, index.begin() + eidx, index.end(), sorter);
+    std::sort(bidx, index.begin() + eidx, sorter);
+
+    reindex(m_sorted_end, size);
+    m_sorted_end = eidx;
+    set_bound(index[eidx - 1]);
+}
+
+void
+t_ftrav::reindex(t_index bidx, t_index eidx) const
+{
+    for (t_index idx = bidx; idx < eidx; ++idx)
+    {
+        set_row((*m_index)[idx].m_ridx, idx);
+    }
+}
+
+void
+t_ftrav::step_end_partial()
 {
-    auto pkiter = m_pkeyidx.find(pkey);
-    if (pkiter == m_pkeyidx.end())
-        return -1;
-    return pkiter->second;
+    t_mselemvec& index = *m_index;
+    t_sorter sorter(this);
+    t_index sorted_end = m_sorted_end;
+
+    // Rows that now sort before m_bound, and rows to append
+    t_mselemvec incoming;
+    t_mselemvec additions;
+    // Positions past the prefix that were vacated
+    std::vector<t_index> holes;
+
+    for (auto& kv : m_new_elems)
+    {
+        t_index idx = find_row(kv.first);
+        if (idx >= 0 && !index[idx].m_deleted)
+        {
+            index[idx] = kv.second;
+            m_step_changed.push_back(idx);
+        }
+        else if (sorter(kv.second, m_bound))
+        {
+            incoming.push_back(kv.second);
+        }
+        else
+        {
+            additions.push_back(kv.second);
+        }
+    }
+
+    std::sort(m_step_changed.begin(), m_step_changed.end());
+    m_step_changed.erase(
+        std::unique(m_step_changed.begin(), m_step_changed.end()),
+        m_step_changed.end());
+
+    auto drop_row = [this](const t_mselem& elem, t_index idx) {
+        if (find_row(elem.m_ridx) == idx)
+            m_rowidx[elem.m_ridx] = -1;
+    };
+
+    // Changes past the prefix stay there unless they now sort before
+    // m_bound
+    auto changed_end = std::lower_bound(
+        m_step_changed.begin(), m_step_changed.end(), sorted_end);
+    for (auto iter = changed_end; iter != m_step_changed.end(); ++iter)
+    {
+        t_mselem& elem = index[*iter];
+        if (elem.m_deleted)
+        {
+            drop_row(elem, *iter);
+            holes.push_back(*iter);
+        }
+        else if (sorter(elem, m_bound))
+        {
+            incoming.push_back(std::move(elem));
+            holes.push_back(*iter);
+        }
+    }
+
+    t_index new_sorted_end = sorted_end;
+    if (changed_end != m_step_changed.begin() || !incoming.empty())
+    {
+        // Merge unchanged prefix rows with the sorted incoming ones
+        t_mselemvec kept;
+        kept.reserve(sorted_end);
+        auto citer = m_step_changed.begin();
+        for (t_index idx = 0; idx < sorted_end; ++idx)
+        {
+            t_mselem& elem = index[idx];
+            if (citer == changed_end || *citer != idx)
+            {
+                kept.push_back(std::move(elem));
+                continue;
+            }
+            ++citer;
+            if (elem.m_deleted)
+                drop_row(elem, idx);
+            else if (sorter(elem, m_bound))
+                incoming.push_back(std::move(elem));
+            else
+                additions.push_back(std::move(elem));
+        }
+
+        std::sort(incoming.begin(), incoming.end(), sorter);
+        t_mselemvec merged(kept.size() + incoming.size());
+        std::merge(kept.begin(), kept.end(), incoming.begin(), incoming.end(),
+            merged.begin(), sorter);
+
+        new_sorted_end = std::min<t_index>(merged.size(), sorted_end);
+        std::move(merged.begin(), merged.begin() + new_sorted_end,
+            index.begin());
+        std::move(merged.begin() + new_sorted_end, merged.end(),
+            std::back_inserter(additions));
+        for (t_index idx = new_sorted_end; idx < sorted_end; ++idx)
+        {
+            holes.push_back(idx);
+        }
+        reindex(0, new_sorted_end);
+    }
+
+    // Rows past the prefix are unordered, so fill holes from the
+    // additions, then from the back of the index
+    std::sort(holes.begin(), holes.end());
+    t_index hbidx = 0;
+    t_index heidx = holes.size();
+    while (hbidx < heidx && !additions.empty())
+    {
+        index[holes[hbidx]] = std::move(additions.back());
+        additions.pop_back();
+        set_row(index[holes[hbidx]].m_ridx, holes[hbidx]);
+        ++hbidx;
+    }
+
+    t_index size = index.size();
+    while (hbidx < heidx)
+    {
+        if (holes[heidx - 1] == size - 1)
+        {
+            --heidx;
+        }
+        else
+        {
+            index[holes[hbidx]] = std::move(index[size - 1]);
+            set_row(index[holes[hbidx]].m_ridx, holes[hbidx]);
+            ++hbidx;
+        }
+        --size;
+    }
+    index.resize(size);
+
+    for (auto& elem : additions)
+    {
+        set_row(elem.m_ridx, index.size());
+        index.push_back(std::move(elem));
+    }
+
+    m_sorted_end = new_sorted_end;
+    if (m_sorted_end > 0)
+        set_bound(index[m_sorted_end - 1]);
+    sort_prefix(m_topk);
+
+    m_new_elems.clear();
+    m_step_changed.clear();
 }
 
 } // end namespace perspective
@@ -22,13 +22,30 @@
 namespace perspective
 {
 
+t_gnode_options::t_gnode_options()
+    : m_gnode_type(GNODE_TYPE_PKEYED)
+    , m_backing_store(BACKING_STORE_MEMORY)
+    , m_compaction_threshold(0)
+    , m_compaction_budget(0)
+    , m_retention_rows(0)
+    , m_retention_age(0)
+    , m_ring_capacity(0)
+{
+}
+
 t_gnode::t_gnode(const t_gnode_recipe& recipe)
     : m_mode(recipe.m_mode)
     , m_gnode_type(recipe.m_gnode_type)
+    , m_backing_store(BACKING_STORE_MEMORY)
     , m_tblschema(recipe.m_tblschema)
     , m_init(false)
     , m_id(0)
     , m_pool_cleanup([]() {})
+    , m_compaction_threshold(0)
+    , m_compaction_budget(0)
+    , m_compacting(false)
+    , m_ring_capacity(0)
+    , m_implicit_pkey(0)
 {
     PSP_TRACE_SENTINEL();
     LOG_CONSTRUCTOR("t_gnode");
@@ -68,14 +85,27 @@ t_gnode::t_gnode(const t_gnode_recipe& recipe)
 t_gnode::t_gnode(const t_gnode_options& options)
     : m_mode(NODE_PROCESSING_SIMPLE_DATAFLOW)
     , m_gnode_type(options.m_gnode_type)
+    , m_backing_store(options.m_backing_store)
     , m_tblschema(options.m_port_schema.drop({"psp_op", "psp_pkey"}))
     , m_init(false)
     , m_id(0)
     , m_pool_cleanup([]() {})
+    , m_compaction_threshold(options.m_compaction_threshold)
+    , m_compaction_budget(options.m_compaction_budget)
+    , m_compacting(false)
+    , m_retention(options.m_retention_rows, options.m_retention_column,
+          options.m_retention_age)
+    , m_ring_capacity(options.m_ring_capacity)
+    , m_implicit_pkey(0)
 {
     PSP_TRACE_SENTINEL();
     LOG_CONSTRUCTOR("t_gnode");
 
+    for (const auto& cc : options.m_custom_columns)
+    {
+        m_custom_columns.push_back(t_custom_column(cc));
+    }
+
     std::vector<t_dtype> trans_types(m_tblschema.size());
     for (t_uindex idx = 0; idx < trans_types.size(); ++idx)
     {
@@ -96,6 +126,20 @@ t_gnode::t_gnode(const t_gnode_options& options)
         }
     }
 
+    if (m_ring_capacity > 0 && m_gnode_type != GNODE_TYPE_IMPLICIT_PKEYED)
+    {
+        PSP_COMPLAIN_AND_ABORT("Ring storage needs implicit pkeys");
+    }
+
+    if (!options.m_retention_column.empty()
+        && (!m_tblschema.has_column(options.m_retention_column)
+               || m_tblschema.get_dtype(options.m_retention_column)
+                   != DTYPE_TIME))
+    {
+        PSP_COMPLAIN_AND_ABORT(
+            "Retention column must be a DTYPE_TIME column of the schema");
+    }
+
     t_schema trans_schema(m_tblschema.columns(), trans_types);
     t_schema existed_schema(
         std::vector<t_str>{"psp_existed"}, std::vector<t_dtype>{DTYPE_BOOL});
@@ -114,11 +158,15 @@ t_gnode::build(const t_gnode_options& options)
     return rv;
 }
 
+t_gnode::t_gnode(t_gnode&& other) = default;
+
 t_gnode::~t_gnode()
 {
     PSP_TRACE_SENTINEL();
     LOG_DESTRUCTOR("t_gnode");
-    m_pool_cleanup();
+    // Empty once moved from
+    if (m_pool_cleanup)
+        m_pool_cleanup();
 }
 
 void
@@ -128,8 +176,32 @@ t_gnode::init()
     PSP_VERBOSE_ASSERT(
         m_ischemas.size() == 1, "Single input port supported currently");
 
-    m_state = std::make_shared<t_gstate>(m_tblschema, m_ischemas[0]);
+    m_state = std::make_shared<t_gstate>(
+        m_tblschema, m_ischemas[0], m_backing_store);
     m_state->init();
+    m_state->set_ring_capacity(m_ring_capacity);
+
+    // Expressions may read columns the recipe did not list. A custom
+    // column depends on the earlier ones whose output it reads.
+    m_custom_column_deps.clear();
+    for (t_uindex cidx = 0, loop_end = m_custom_columns.size();
+         cidx < loop_end; ++cidx)
+    {
+        auto& ccol = m_custom_columns[cidx];
+        ccol.init(m_tblschema);
+
+        std::vector<t_uindex> deps;
+        for (const auto& icol : ccol.get_expression_icols())
+        {
+            m_expr_icols.insert(icol);
+            for (t_uindex didx = 0; didx < cidx; ++didx)
+            {
+                if (m_custom_columns[didx].get_ocol() == icol)
+                    deps.push_back(didx);
+            }
+        }
+        m_custom_column_deps.push_back(deps);
+    }
 
     for (t_uindex idx = 0, loop_end = m_ischemas.size(); idx < loop_end; ++idx)
     {
@@ -182,49 +254,200 @@ t_gnode::_send(t_uindex portid, const t_table& fragments)
     iport->send(fragments);
 }
 
+namespace
+{
+
+// Copies the state values of the rows of ocol missing from the update
+template <typename DATA_T>
+void
+backfill_column(const t_column* icol, t_column* ocol,
+    const t_tick_vec<t_rlookup>& lkup, const std::vector<t_uindex>& rows)
+{
+    for (auto ridx : rows)
+    {
+        const auto& lk = lkup[ridx];
+        if (!ocol->is_valid(ridx) && lk.m_exists)
+        {
+            ocol->set_nth<DATA_T>(ridx, *(icol->get_nth<DATA_T>(lk.m_idx)),
+                *(icol->get_nth_status(lk.m_idx)));
+        }
+    }
+}
+
+template <>
 void
-t_gnode::populate_icols_in_flattened(
-    const std::vector<t_rlookup>& lkup, t_table_sptr& flat) const
+backfill_column<t_str>(const t_column* icol, t_column* ocol,
+    const t_tick_vec<t_rlookup>& lkup, const std::vector<t_uindex>& rows)
+{
+    for (auto ridx : rows)
+    {
+        const auto& lk = lkup[ridx];
+        if (!ocol->is_valid(ridx) && lk.m_exists)
+        {
+            ocol->set_nth<const char*>(ridx,
+                icol->get_nth<const char>(lk.m_idx),
+                *(icol->get_nth_status(lk.m_idx)));
+        }
+    }
+}
+
+void
+backfill_column(const t_column* icol, t_column* ocol,
+    const t_tick_vec<t_rlookup>& lkup, const std::vector<t_uindex>& rows)
+{
+    switch (icol->get_dtype())
+    {
+        case DTYPE_INT64:
+            backfill_column<t_int64>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_TIME:
+            backfill_column<t_time>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_DATE:
+            backfill_column<t_date>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_INT32:
+            backfill_column<t_int32>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_INT16:
+            backfill_column<t_int16>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_INT8:
+            backfill_column<t_int8>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_UINT64:
+            backfill_column<t_uint64>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_UINT32:
+            backfill_column<t_uint32>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_UINT16:
+            backfill_column<t_uint16>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_UINT8:
+            backfill_column<t_uint8>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_FLOAT64:
+            backfill_column<t_float64>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_FLOAT32:
+            backfill_column<t_float32>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_BOOL:
+            backfill_column<t_bool>(icol, ocol, lkup, rows);
+            break;
+        case DTYPE_STR:
+            backfill_column<t_str>(icol, ocol, lkup, rows);
+            break;
+        default:
+        {
+            PSP_COMPLAIN_AND_ABORT("Unexpected expression column type");
+        }
+    }
+}
+
+} // end anonymous namespace
+
+void
+t_gnode::get_custom_column_rows(const t_tick_vec<t_rlookup>& lkup,
+    const t_table& flat, std::vector<std::vector<t_uindex>>& rows) const
 {
     PSP_VERBOSE_ASSERT(
-        lkup.size() == flat->size(), "Mismatched sizes encountered");
+        lkup.size() == flat.size(), "Mismatched sizes encountered");
+
+    t_uindex nrows = flat.size();
+    t_uindex nccols = m_custom_columns.size();
+    const t_uint8* op_base
+        = flat.get_const_column("psp_op")->get_nth<t_uint8>(0);
 
-    t_uindex nrows = lkup.size();
-    t_uindex ncols = m_expr_icols.size();
+    rows.assign(nccols, std::vector<t_uindex>());
+    std::vector<std::vector<t_uint8>> recomputed(nccols);
 
+    for (t_uindex cidx = 0; cidx < nccols; ++cidx)
+    {
+        const auto& cnames = m_custom_columns[cidx].get_expression_icols();
+        t_colcptrvec icols(cnames.size());
+        for (t_uindex idx = 0, loop_end = cnames.size(); idx < loop_end; ++idx)
+        {
+            icols[idx] = flat.get_const_column(cnames[idx]).get();
+        }
+
+        const auto& deps = m_custom_column_deps[cidx];
+        auto& mask = recomputed[cidx];
+        mask.assign(nrows, 0);
+
+        for (t_uindex ridx = 0; ridx < nrows; ++ridx)
+        {
+            if (op_base[ridx] == OP_DELETE)
+                continue;
+
+            t_bool recompute = !lkup[ridx].m_exists;
+            for (t_uindex idx = 0; !recompute && idx < icols.size(); ++idx)
+            {
+                recompute = icols[idx]->is_valid(ridx);
+            }
+            for (t_uindex idx = 0; !recompute && idx < deps.size(); ++idx)
+            {
+                recompute = recomputed[deps[idx]][ridx];
+            }
+
+            if (recompute)
+            {
+                mask[ridx] = 1;
+                rows[cidx].push_back(ridx);
+            }
+        }
+    }
+}
+
+void
+t_gnode::populate_icols_in_flattened(const t_tick_vec<t_rlookup>& lkup,
+    const std::vector<std::vector<t_uindex>>& rows, t_table& flat) const
+{
+    // Rows of each input column read by a recomputed custom column
+    std::map<t_str, std::vector<t_uindex>> icol_rows;
+    for (t_uindex cidx = 0, loop_end = m_custom_columns.size();
+         cidx < loop_end; ++cidx)
+    {
+        if (rows[cidx].empty())
+            continue;
+
+        for (const auto& cname : m_custom_columns[cidx].get_expression_icols())
+        {
+            auto& crows = icol_rows[cname];
+            crows.insert(crows.end(), rows[cidx].begin(), rows[cidx].end());
+        }
+    }
+
+    t_uindex ncols = icol_rows.size();
     t_colcptrvec icols(ncols);
     t_colptrvec ocols(ncols);
-    std::vector<t_str> cnames(ncols);
+    std::vector<const std::vector<t_uindex>*> crows(ncols);
 
     t_uindex count = 0;
     const t_table* stable = get_table();
 
-    for (const auto& cname : m_expr_icols)
+    for (auto& kv : icol_rows)
     {
-        icols[count] = stable->get_const_column(cname).get();
-        ocols[count] = flat->get_column(cname).get();
-        cnames[count] = cname;
+        auto& r = kv.second;
+        std::sort(r.begin(), r.end());
+        r.erase(std::unique(r.begin(), r.end()), r.end());
+
+        icols[count] = stable->get_const_column(kv.first).get();
+        ocols[count] = flat.get_column(kv.first).get();
+        crows[count] = &r;
         ++count;
     }
 
 #ifdef PSP_PARALLEL_FOR
     PSP_PFOR(0, int(ncols), 1,
-        [&lkup, &icols, &ocols, nrows](int colidx)
+        [&lkup, &icols, &ocols, &crows](int colidx)
 #else
     for (t_uindex colidx = 0; colidx < ncols; ++colidx)
 #endif
         {
-            auto icol = icols[colidx];
-            auto ocol = ocols[colidx];
-
-            for (t_uindex ridx = 0; ridx < nrows; ++ridx)
-            {
-                const auto& lk = lkup[ridx];
-                if (!ocol->is_valid(ridx) && lk.m_exists)
-                {
-                    ocol->set_scalar(ridx, icol->get_scalar(lk.m_idx));
-                }
-            }
+            backfill_column(
+                icols[colidx], ocols[colidx], lkup, *(crows[colidx]));
         }
 
 #ifdef PSP_PARALLEL_FOR
@@ -232,6 +455,71 @@ t_gnode::populate_icols_in_flattened(
 #endif
 }
 
+void
+t_gnode::compute_custom_columns(t_table& flat) const
+{
+    // Rows computing to null keep their previous value, like any
+    // other null in an update
+    for (const auto& ccol : m_custom_columns)
+    {
+        ccol.compute(flat);
+    }
+}
+
+void
+t_gnode::compute_custom_columns(
+    const std::vector<std::vector<t_uindex>>& rows, t_table& flat) const
+{
+    for (t_uindex cidx = 0, loop_end = m_custom_columns.size();
+         cidx < loop_end; ++cidx)
+    {
+        if (!rows[cidx].empty())
+            m_custom_columns[cidx].compute(flat, rows[cidx]);
+    }
+}
+
+void
+t_gnode::apply_retention(t_table* tbl)
+{
+    m_retention.update(*tbl);
+
+    t_tscalvec expired;
+    m_retention.get_expired(expired);
+    append_deletes(tbl, expired);
+}
+
+void
+t_gnode::append_deletes(t_table* tbl, const t_tscalvec& pkeys)
+{
+    if (pkeys.empty())
+        return;
+
+    t_uindex offset = tbl->size();
+    tbl->extend(offset + pkeys.size());
+
+    const t_schema& schema = tbl->get_schema();
+    for (t_uindex cidx = 0, loop_end = schema.size(); cidx < loop_end; ++cidx)
+    {
+        const t_str& cname = schema.m_columns[cidx];
+        t_col_sptr col = tbl->get_column(cname);
+        for (t_uindex idx = 0, npkeys = pkeys.size(); idx < npkeys; ++idx)
+        {
+            if (cname == "psp_op")
+            {
+                col->set_nth<t_uint8>(offset + idx, OP_DELETE);
+            }
+            else if (cname == "psp_pkey")
+            {
+                col->set_scalar(offset + idx, pkeys[idx]);
+            }
+            else
+            {
+                col->set_valid(offset + idx, false);
+            }
+        }
+    }
+}
+
 void
 t_gnode::_process()
 {
@@ -251,6 +539,7 @@ t_gnode::_process()
     }
 
     m_was_updated = true;
+    t_tick_arena_scope tick_scope(m_tick_arena);
 
     if (m_gnode_type == GNODE_TYPE_IMPLICIT_PKEYED) {
         // Add implicit pkey
@@ -261,13 +550,31 @@ t_gnode::_process()
 
         auto key_col = tbl->get_column("psp_pkey");
 
-        // Get current table size as starting index
-        t_uindex start = get_table()->size();
-
         for (t_uindex ridx = 0; ridx < tbl->size(); ++ridx)
         {
-            key_col->set_nth<t_int64>(ridx, start + ridx);
+            key_col->set_nth<t_int64>(ridx, m_implicit_pkey++);
         }
+
+        // Evict the pkeys whose ring rows this batch takes over,
+        // including any of its own past the ring capacity
+        if (m_ring_capacity > 0 && m_implicit_pkey > m_ring_capacity)
+        {
+            t_uindex end = m_implicit_pkey - m_ring_capacity;
+            t_uindex begin = end - std::min(end, t_uindex(tbl->size()));
+            t_tscalvec evicted;
+            evicted.reserve(end - begin);
+            for (t_uindex pkey = begin; pkey < end; ++pkey)
+            {
+                evicted.push_back(mktscalar<t_int64>(pkey));
+            }
+            append_deletes(tbl.get(), evicted);
+        }
+    }
+
+    if (m_retention.is_enabled())
+    {
+        apply_retention(iport->get_table().get());
+        psp_log_time(repr() + " _process.post_retention");
     }
 
     t_table_sptr flattened(iport->get_table()->flatten());
@@ -290,6 +597,7 @@ t_gnode::_process()
 
     if (m_state->mapping_size() == 0)
     {
+        compute_custom_columns(*flattened);
         psp_log_time(repr() + " _process.init_path.post_fill_expr");
 
         m_state->update_history(flattened.get());
@@ -352,16 +660,17 @@ t_gnode::_process()
     PSP_GNODE_VERIFY_TABLE(stable);
     const t_schema& sschema = m_state->get_schema();
 
-    t_colcptrvec fcolumns(flattened->num_columns());
+    t_tick_allocator<t_column*> tick_alloc(&m_tick_arena);
+    t_tick_vec<const t_column*> fcolumns(flattened->num_columns(), tick_alloc);
     t_uindex ncols = sschema.get_num_columns();
 
-    t_colcptrvec scolumns(ncols);
-    t_colptrvec dcolumns(ncols);
-    t_colptrvec pcolumns(ncols);
-    t_colptrvec ccolumns(ncols);
-    t_colptrvec tcolumns(ncols);
+    t_tick_vec<const t_column*> scolumns(ncols, tick_alloc);
+    t_tick_vec<t_column*> dcolumns(ncols, tick_alloc);
+    t_tick_vec<t_column*> pcolumns(ncols, tick_alloc);
+    t_tick_vec<t_column*> ccolumns(ncols, tick_alloc);
+    t_tick_vec<t_column*> tcolumns(ncols, tick_alloc);
 
-    std::vector<t_uindex> col_translation(stable->num_columns());
+    t_tick_vec<t_uindex> col_translation(stable->num_columns(), tick_alloc);
     t_uindex count = 0;
 
     t_str opname("psp_op");
@@ -402,9 +711,9 @@ t_gnode::_process()
     t_uindex added_count = 0;
 
     auto op_base = op_col->get_nth<t_uint8>(0);
-    std::vector<t_uindex> added_offset(fnrows);
-    std::vector<t_rlookup> lkup(fnrows);
-    std::vector<t_bool> prev_pkey_eq_vec(fnrows);
+    t_tick_vec<t_uindex> added_offset(fnrows, tick_alloc);
+    t_tick_vec<t_rlookup> lkup(fnrows, tick_alloc);
+    t_tick_vec<t_bool> prev_pkey_eq_vec(fnrows, tick_alloc);
 
     for (t_uindex idx = 0; idx < fnrows; ++idx)
     {
@@ -462,9 +771,15 @@ t_gnode::_process()
     existed->set_size(mask_count);
 
     psp_log_time(repr() + " _process.noinit_path.post_rlkup_loop");
-    if (!m_expr_icols.empty())
+    if (!m_custom_columns.empty())
     {
-        populate_icols_in_flattened(lkup, flattened);
+        // Only rows whose inputs the batch sets are recomputed, and
+        // only their inputs are filled in from the state table
+        std::vector<std::vector<t_uindex>> ccol_rows;
+        get_custom_column_rows(lkup, *flattened, ccol_rows);
+        populate_icols_in_flattened(lkup, ccol_rows, *flattened);
+        compute_custom_columns(ccol_rows, *flattened);
+        psp_log_time(repr() + " _process.noinit_path.post_fill_expr");
     }
 
 #ifdef PSP_PARALLEL_FOR
@@ -671,6 +986,14 @@ t_gnode::_process()
 
         notify_contexts(*flattened_masked);
 
+        if (m_compacting
+            || (m_compaction_threshold > 0 && m_ring_capacity == 0
+                   && m_state->get_fragmentation() >= m_compaction_threshold))
+        {
+            m_compacting = !compact(m_compaction_budget);
+            psp_log_time(repr() + " _process.noinit_path.post_compact");
+        }
+
         psp_log_time(repr() + " _process.noinit_path.exit");
 }
 
@@ -690,6 +1013,72 @@ t_gnode::get_table() const
     return m_state->get_table().get();
 }
 
+t_mem_usage
+t_gnode::get_memory_usage() const
+{
+    PSP_TRACE_SENTINEL();
+    PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+
+    t_mem_usage rv("gnode");
+    rv.add(m_state->get_memory_usage());
+    if (m_retention.is_enabled())
+        rv.add(m_retention.get_memory_usage());
+
+    t_mem_usage ports("ports");
+    for (t_uindex idx = 0, loop_end = m_iports.size(); idx < loop_end; ++idx)
+    {
+        ports.add(m_iports[idx]->get_table()->get_memory_usage(
+            "input_" + std::to_string(idx)));
+    }
+    for (t_uindex idx = 0, loop_end = m_oports.size(); idx < loop_end; ++idx)
+    {
+        ports.add(m_oports[idx]->get_table()->get_memory_usage(
+            "output_" + std::to_string(idx)));
+    }
+    rv.add(ports);
+
+    t_mem_usage contexts("contexts");
+    for (const auto& kv : m_contexts)
+    {
+        auto& ctxh = kv.second;
+        t_mem_usage ctx;
+
+        switch (ctxh.m_ctx_type)
+        {
+            case TWO_SIDED_CONTEXT:
+            {
+                ctx = ctxh.get<t_ctx2>()->get_memory_usage();
+            }
+            break;
+            case ONE_SIDED_CONTEXT:
+            {
+                ctx = ctxh.get<t_ctx1>()->get_memory_usage();
+            }
+            break;
+            case ZERO_SIDED_CONTEXT:
+            {
+                ctx = ctxh.get<t_ctx0>()->get_memory_usage();
+            }
+            break;
+            case GROUPED_PKEY_CONTEXT:
+            {
+                ctx = ctxh.get<t_ctx_grouped_pkey>()->get_memory_usage();
+            }
+            break;
+            default:
+            {
+                PSP_COMPLAIN_AND_ABORT("Unexpected context type");
+            }
+            break;
+        }
+
+        ctx.m_name = kv.first;
+        contexts.add(ctx);
+    }
+    rv.add(contexts);
+    return rv;
+}
+
 void
 t_gnode::pprint() const
 {
@@ -888,7 +1277,7 @@ t_gnode::_register_context(const t_str& name, t_ctx_type type, t_int64 ptr)
         break;
         case GROUPED_PKEY_CONTEXT:
         {
-            set_ctx_state<t_ctx0>(ptr_);
+            set_ctx_state<t_ctx_grouped_pkey>(ptr_);
             auto ctx = static_cast<t_ctx_grouped_pkey*>(ptr_);
             if (t_env::log_progress())
             {
@@ -1146,6 +1535,98 @@ t_gnode::get_contexts_last_updated() const
     return rval;
 }
 
+t_bool
+t_gnode::compact(t_uindex max_moves)
+{
+    PSP_TRACE_SENTINEL();
+    PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+
+    std::vector<t_uidxpair> moves;
+    t_bool done = m_state->compact(max_moves, moves);
+
+    if (moves.empty())
+        return done;
+
+    // Tree contexts key rows by pkey, only flat traversals hold
+    // state rows
+    for (const auto& kv : m_contexts)
+    {
+        const t_ctx_handle& ctxh = kv.second;
+        if (ctxh.get_type() == ZERO_SIDED_CONTEXT)
+        {
+            reinterpret_cast<t_ctx0*>(ctxh.m_ctx)->remap_rows(moves);
+        }
+    }
+
+    return done;
+}
+
+std::vector<t_str>
+t_gnode::get_viewports_last_updated() const
+{
+    std::vector<t_str> rval;
+
+    for (const auto& kv : m_contexts)
+    {
+        auto ctxh = kv.second;
+        switch (ctxh.m_ctx_type)
+        {
+            case TWO_SIDED_CONTEXT:
+            {
+                auto ctx = reinterpret_cast<t_ctx2*>(ctxh.m_ctx);
+                if (ctx->get_viewport_changed())
+                {
+                    rval.push_back(kv.first);
+                }
+            }
+            break;
+            case ONE_SIDED_CONTEXT:
+            {
+                auto ctx = reinterpret_cast<t_ctx1*>(ctxh.m_ctx);
+                if (ctx->get_viewport_changed())
+                {
+                    rval.push_back(kv.first);
+                }
+            }
+            break;
+            case ZERO_SIDED_CONTEXT:
+            {
+                auto ctx = reinterpret_cast<t_ctx0*>(ctxh.m_ctx);
+                if (ctx->get_viewport_changed())
+                {
+                    rval.push_back(kv.first);
+                }
+            }
+            break;
+            case GROUPED_PKEY_CONTEXT:
+            {
+                auto ctx = reinterpret_cast<t_ctx_grouped_pkey*>(ctxh.m_ctx);
+                if (ctx->get_viewport_changed())
+                {
+                    rval.push_back(kv.first);
+                }
+            }
+            break;
+            default:
+            {
+                PSP_COMPLAIN_AND_ABORT("Unexpected context type");
+            }
+            break;
+        }
+    }
+
+    if (t_env::log_progress())
+    {
+        std::cout << "get_viewports_last_updated<" << std::endl;
+        for (const auto& s : rval)
+        {
+            std::cout << "\t" << s << std::endl;
+        }
+        std::cout << ">\n";
+    }
+    return rval;
+}
+
 t_tscalvec
 t_gnode::get_row_data_pkeys(const t_tscalvec& pkeys) const
 {
@@ -1207,6 +1688,9 @@ t_gnode::reset()
     }
 
     m_state->reset();
+    m_compacting = false;
+    m_retention.reset();
+    m_implicit_pkey = 0;
 }
 
 void
@@ -1232,8 +1716,8 @@ void
 t_gnode::_process_helper<t_str>(const t_column* fcolumn,
     const t_column* scolumn, t_column* dcolumn, t_column* pcolumn,
     t_column* ccolumn, t_column* tcolumn, const t_uint8* op_base,
-    std::vector<t_rlookup>& lkup, std::vector<t_bool>& prev_pkey_eq_vec,
-    std::vector<t_uindex>& added_vec)
+    t_tick_vec<t_rlookup>& lkup, t_tick_vec<t_bool>& prev_pkey_eq_vec,
+    t_tick_vec<t_uindex>& added_vec)
 {
     for (t_uindex idx = 0, loop_end = fcolumn->size(); idx < loop_end; ++idx)
     {
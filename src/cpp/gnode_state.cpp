@@ -22,10 +22,17 @@ namespace perspective
 {
 
 t_gstate::t_gstate(const t_schema& tblschema, const t_schema& pkeyed_schema)
+    : t_gstate(tblschema, pkeyed_schema, BACKING_STORE_MEMORY)
+{
+}
 
+t_gstate::t_gstate(const t_schema& tblschema, const t_schema& pkeyed_schema,
+    t_backing_store backing_store)
     : m_tblschema(tblschema)
     , m_pkeyed_schema(pkeyed_schema)
+    , m_backing_store(backing_store)
     , m_init(false)
+    , m_ring_capacity(0)
 {
     LOG_CONSTRUCTOR("t_gstate");
 }
@@ -36,7 +43,7 @@ void
 t_gstate::init()
 {
     m_table = std::make_shared<t_table>(
-        "", "", m_pkeyed_schema, DEFAULT_EMPTY_CAPACITY, BACKING_STORE_MEMORY);
+        "", "", m_pkeyed_schema, DEFAULT_EMPTY_CAPACITY, m_backing_store);
     m_table->init();
     m_pkcol = m_table->get_column("psp_pkey");
     m_opcol = m_table->get_column("psp_op");
@@ -48,6 +55,20 @@ t_gstate::lookup(t_tscalar pkey) const
 {
     t_rlookup rval(0, false);
 
+    if (m_ring_capacity > 0)
+    {
+        // The pkey column holds the pkey of each live row, the pkeys
+        // of erased rows are cleared by erase and release_erased
+        t_uindex idx = pkey.to_int64() % m_ring_capacity;
+        if (idx < m_table->size() && m_pkcol->is_valid(idx)
+            && *(m_pkcol->get_nth<t_int64>(idx)) == pkey.to_int64())
+        {
+            rval.m_idx = idx;
+            rval.m_exists = true;
+        }
+        return rval;
+    }
+
     t_mapping::const_iterator iter = m_mapping.find(pkey);
 
     if (iter == m_mapping.end())
@@ -58,6 +79,21 @@ t_gstate::lookup(t_tscalar pkey) const
     return rval;
 }
 
+t_rlookup
+t_gstate::lookup_erased(t_tscalar pkey) const
+{
+    t_rlookup rval(0, false);
+
+    t_mapping::const_iterator iter = m_erased.find(pkey);
+
+    if (iter == m_erased.end())
+        return rval;
+
+    rval.m_idx = iter->second;
+    rval.m_exists = true;
+    return rval;
+}
+
 void
 t_gstate::_mark_deleted(t_uindex idx)
 {
@@ -83,8 +119,52 @@ t_gstate::erase(const t_tscalar& pkey)
         c->clear(idx);
     }
 
+    m_erased[iter->first] = idx;
     m_mapping.erase(iter);
-    _mark_deleted(idx);
+}
+
+void
+t_gstate::release_erased()
+{
+    if (m_ring_capacity > 0)
+    {
+        // Rows are not freed, they stay put until their pkey comes
+        // round again. Drop erased pkeys still in the pkey column so
+        // lookup cannot find them.
+        for (const auto& kv : m_erased)
+        {
+            t_uindex idx = kv.second;
+            if (m_pkcol->is_valid(idx)
+                && *(m_pkcol->get_nth<t_int64>(idx)) == kv.first.to_int64())
+            {
+                m_pkcol->clear(idx);
+            }
+        }
+        m_erased.clear();
+        return;
+    }
+
+    for (const auto& kv : m_erased)
+    {
+        _mark_deleted(kv.second);
+    }
+    m_erased.clear();
+}
+
+void
+t_gstate::move_row(t_uindex from, t_uindex to)
+{
+    auto columns = m_table->get_columns();
+
+    for (auto c : columns)
+    {
+        c->set_scalar(to, c->get_scalar(from));
+    }
+
+    t_mapping::iterator iter = m_mapping.find(m_pkcol->get_scalar(to));
+    PSP_VERBOSE_ASSERT(
+        iter != m_mapping.end() && iter->second == from, "Moving a free row");
+    iter->second = to;
 }
 
 t_uindex
@@ -99,6 +179,31 @@ t_gstate::lookup_or_create(const t_tscalar& pkey)
         return iter->second;
     }
 
+    if (m_ring_capacity > 0)
+    {
+        t_uindex idx = pkey.to_int64() % m_ring_capacity;
+        t_uindex nrows = m_table->num_rows();
+        if (idx >= nrows)
+        {
+            m_table->reserve(m_ring_capacity);
+            m_table->set_size(idx + 1);
+
+            // Rows passed over by pkeys deleted in their own batch
+            auto columns = m_table->get_columns();
+            for (t_uindex ridx = nrows; ridx < idx; ++ridx)
+            {
+                for (auto c : columns)
+                {
+                    c->clear(ridx);
+                }
+            }
+        }
+        m_opcol->set_nth<t_uint8>(idx, OP_INSERT);
+        m_pkcol->set_scalar(idx, pkey);
+        m_mapping[pkey_] = idx;
+        return idx;
+    }
+
     if (!m_free.empty())
     {
         t_free_items::const_iterator iter = m_free.begin();
@@ -129,6 +234,8 @@ t_gstate::update_history(const t_table* tbl)
     const t_schema& fschema = tbl->get_schema();
     const t_schema& sschema = m_table->get_schema();
 
+    release_erased();
+
     auto pkey_col = tbl->get_const_column("psp_pkey").get();
     auto op_col = tbl->get_const_column("psp_op").get();
 
@@ -159,7 +266,7 @@ t_gstate::update_history(const t_table* tbl)
         scolumns[idx] = stable->get_column(cname).get();
     }
 
-    if (size() == 0)
+    if (size() == 0 && m_ring_capacity == 0)
     {
         m_free.clear();
         m_mapping.clear();
@@ -387,6 +494,86 @@ t_gstate::update_history(const t_table* tbl)
 #endif
 }
 
+t_float64
+t_gstate::get_fragmentation() const
+{
+    t_uindex nrows = size();
+    if (nrows == 0)
+        return 0;
+    return t_float64(m_free.size() + m_erased.size()) / nrows;
+}
+
+t_bool
+t_gstate::compact(t_uindex max_moves, std::vector<t_uidxpair>& moves)
+{
+    release_erased();
+    if (m_ring_capacity > 0)
+        return true;
+
+    t_uindex nrows = size();
+    t_uindex nmoves = 0;
+
+    while (!m_free.empty())
+    {
+        auto last = std::prev(m_free.end());
+        if (*last == nrows - 1)
+        {
+            m_free.erase(last);
+            --nrows;
+            continue;
+        }
+
+        if (max_moves > 0 && nmoves == max_moves)
+            break;
+
+        auto first = m_free.begin();
+        t_uindex to = *first;
+        m_free.erase(first);
+        move_row(nrows - 1, to);
+        moves.push_back(t_uidxpair(nrows - 1, to));
+        --nrows;
+        ++nmoves;
+    }
+
+    m_table->set_size(nrows);
+
+    if (!m_free.empty())
+        return false;
+
+    t_uindex capacity
+        = std::max<t_uindex>(nrows + 1, DEFAULT_EMPTY_CAPACITY);
+    if (m_table->get_capacity() > 2 * capacity)
+        m_table->shrink(capacity);
+    return true;
+}
+
+void
+t_gstate::set_ring_capacity(t_uindex capacity)
+{
+    PSP_VERBOSE_ASSERT(m_mapping.empty(), "Ring mode set on a filled state");
+    m_ring_capacity = capacity;
+    if (capacity > 0)
+        m_table->reserve(capacity);
+}
+
+t_uindex
+t_gstate::get_ring_capacity() const
+{
+    return m_ring_capacity;
+}
+
+t_mem_usage
+t_gstate::get_memory_usage() const
+{
+    t_mem_usage rv("gstate");
+    rv.add(m_table->get_memory_usage("table"));
+    rv.add(mem_usage_hashed("mapping", m_mapping));
+    rv.add(mem_usage_hashed("erased", m_erased));
+    rv.add(mem_usage_ordered("free", m_free));
+    rv.add(m_symtable.get_memory_usage());
+    return rv;
+}
+
 void
 t_gstate::pprint() const
 {
@@ -411,6 +598,9 @@ t_gstate::get_cpp_mask() const
     {
         msk.set(iter->second, true);
     }
+    // live rows are usually either a few long runs or, after heavy
+    // deletes, sparse
+    msk.optimize();
     return msk;
 }
 
@@ -447,6 +637,23 @@ t_gstate::read_column(
     std::swap(rval, out_data);
 }
 
+void
+t_gstate::read_column(const t_str& colname, const std::vector<t_uindex>& rows,
+    t_tscalvec& out_data) const
+{
+    t_index num = rows.size();
+    t_col_csptr col = m_table->get_const_column(colname);
+    const t_column* col_ = col.get();
+    t_tscalvec rval(num);
+
+    for (t_index idx = 0; idx < num; ++idx)
+    {
+        rval[idx].set(col_->get_scalar(rows[idx]));
+    }
+
+    std::swap(rval, out_data);
+}
+
 void
 t_gstate::read_column(const t_str& colname, const t_tscalvec& pkeys,
     std::vector<t_float64>& out_data) const
@@ -491,6 +698,32 @@ t_gstate::get(t_tscalar pkey, const t_str& colname) const
     return t_tscalar();
 }
 
+t_tscalar
+t_gstate::get_at(t_uindex idx, const t_str& colname) const
+{
+    return m_table->get_const_column(colname)->get_scalar(idx);
+}
+
+t_tscalar
+t_gstate::get_pkey(t_uindex idx) const
+{
+    return m_pkcol->get_scalar(idx);
+}
+
+t_tscalar
+t_gstate::get_last_pkey(t_uindex idx) const
+{
+    if (m_pkcol->is_valid(idx))
+        return m_pkcol->get_scalar(idx);
+
+    for (const auto& kv : m_erased)
+    {
+        if (kv.second == idx)
+            return kv.first;
+    }
+    return mknone();
+}
+
 t_tscalvec
 t_gstate::get_row(t_tscalar pkey) const
 {
@@ -674,12 +907,12 @@ t_gstate::_get_pkeyed_table(const t_schema& schema, const t_mask& mask) const
     mapping.resize(mask.size());
     {
         t_uindex mapped = 0;
-        for (t_uindex idx = 0; idx < mask.size(); ++idx)
-        {
-            mapping[idx] = mapped;
-            if (mask.get(idx))
-                ++mapped;
-        }
+        mask.for_each_run([&mapping, &mapped](t_uindex bidx, t_uindex eidx) {
+            for (t_uindex idx = bidx; idx < eidx; ++idx)
+            {
+                mapping[idx] = mapped++;
+            }
+        });
     }
 
     t_uindex oidx = 0;
@@ -868,6 +1101,7 @@ t_gstate::reset()
 {
     m_table->clear();
     m_mapping.clear();
+    m_erased.clear();
     m_free.clear();
 }
 
@@ -2,8 +2,81 @@
 
 namespace perspective
 {
+
+t_uindex
+t_kernel_batch::size() const
+{
+    return m_depths.size();
+}
+
 t_kernel_evaluator::t_kernel_evaluator() {}
 
+void
+t_kernel_evaluator::reduce(const t_kernel& fn, const t_kernel_batch& batch,
+    std::vector<t_float64>& out) const
+{
+    out.resize(batch.size());
+    if (batch.size() == 0)
+        return;
+
+#ifdef PSP_ENABLE_WASM
+    if (fn.isString())
+    {
+        reduce_native(fn.as<std::string>(), batch, out);
+        return;
+    }
+
+    auto values = em::val(
+        em::typed_memory_view(batch.m_values.size(), batch.m_values.data()));
+
+    if (fn["batch"].isUndefined())
+    {
+        for (t_uindex idx = 0, loop_end = batch.size(); idx < loop_end; ++idx)
+        {
+            auto node_values = values.call<em::val>("subarray",
+                batch.m_offsets[idx], batch.m_offsets[idx + 1]);
+            out[idx] = fn(node_values, em::val(batch.m_depths[idx]))
+                           .as<t_float64>();
+        }
+        return;
+    }
+
+    auto offsets = em::val(
+        em::typed_memory_view(batch.m_offsets.size(), batch.m_offsets.data()));
+    auto depths = em::val(
+        em::typed_memory_view(batch.m_depths.size(), batch.m_depths.data()));
+    auto results = em::val(em::typed_memory_view(out.size(), out.data()));
+    fn.call<void>("batch", values, offsets, depths, results);
+#else
+    reduce_native(fn, batch, out);
+#endif
+}
+
+void
+t_kernel_evaluator::register_kernel(
+    const t_str& name, const t_native_kernel& kernel)
+{
+    m_native_kernels[name] = kernel;
+}
+
+t_bool
+t_kernel_evaluator::has_kernel(const t_str& name) const
+{
+    return m_native_kernels.find(name) != m_native_kernels.end();
+}
+
+void
+t_kernel_evaluator::reduce_native(const t_str& name,
+    const t_kernel_batch& batch, std::vector<t_float64>& out) const
+{
+    auto iter = m_native_kernels.find(name);
+    if (iter == m_native_kernels.end())
+    {
+        PSP_COMPLAIN_AND_ABORT(("Unknown kernel " + name).c_str());
+    }
+    iter->second(batch, out.data());
+}
+
 t_kernel_evaluator*
 get_evaluator()
 {
@@ -21,6 +21,10 @@ PSP_THR_LOCAL perspective::t_uindex th_curtime_origin;
 PSP_THR_LOCAL perspective::t_uindex th_curmem;
 PSP_THR_LOCAL perspective::t_uindex th_curmem_origin;
 PSP_THR_LOCAL perspective::t_bool th_curtime_initialized;
+PSP_THR_LOCAL perspective::t_uindex th_nallocs;
+PSP_THR_LOCAL perspective::t_uindex th_nreuses;
+PSP_THR_LOCAL perspective::t_uindex th_logged_nallocs;
+PSP_THR_LOCAL perspective::t_uindex th_logged_nreuses;
 
 namespace perspective
 {
@@ -46,12 +50,41 @@ psp_log_time(const t_str& s)
     auto prev_curmem = static_cast<t_index>(th_curmem);
     th_curmem = curmem;
     th_curtime = ns_curtime;
+    auto nallocs = th_nallocs - th_logged_nallocs;
+    auto nreuses = th_nreuses - th_logged_nreuses;
+    th_logged_nallocs = th_nallocs;
+    th_logged_nreuses = th_nreuses;
     std::stringstream ss;
     ss << std::fixed << std::setprecision(3) << "stat tid "
        << std::this_thread::get_id() << " gt" << std::setw(10) << curtime
        << " dt " << std::setw(10) << curtime - prev_time << " gm "
        << std::setw(6) << curmem << " dm " << std::setw(6)
-       << curmem - prev_curmem << " msg: " << s;
+       << curmem - prev_curmem << " na " << std::setw(6) << nallocs
+       << " nr " << std::setw(6) << nreuses << " msg: " << s;
     std::cout << ss.str() << std::endl;
 }
+
+void
+psp_count_alloc()
+{
+    ++th_nallocs;
+}
+
+void
+psp_count_reuse()
+{
+    ++th_nreuses;
+}
+
+t_uindex
+psp_alloc_count()
+{
+    return th_nallocs;
+}
+
+t_uindex
+psp_reuse_count()
+{
+    return th_nreuses;
+}
 } // end namespace perspective
@@ -14,6 +14,7 @@
 #include <perspective/context_zero.h>
 #include <perspective/context_one.h>
 #include <perspective/context_two.h>
+#include <perspective/expression.h>
 #include <random>
 #include <cmath>
 #include <sstream>
@@ -1162,6 +1163,34 @@ table_add_computed_column(
     }
 }
 
+/**
+ * Adds a column computed natively from an expression over the other
+ * columns of table, see t_expression
+ *
+ * Params
+ * ------
+ * dtype - storage type of the new column
+ * expr - the expression
+ *
+ * Returns
+ * -------
+ *
+ */
+void
+table_add_computed_expression(
+    t_table_sptr table, t_str name, t_dtype dtype, t_str expr)
+{
+    t_expression expression(expr, table->get_schema());
+    if (!expression.can_store_as(dtype))
+    {
+        PSP_COMPLAIN_AND_ABORT(
+            ("Column " + name + " cannot hold " + expr).c_str());
+    }
+
+    t_column* out = table->add_column(name, dtype, true);
+    expression.compute(*table, out);
+}
+
 /**
  *
  *
@@ -1254,7 +1283,11 @@ EMSCRIPTEN_BINDINGS(perspective)
         .function("get_column_count", &t_ctx0::get_column_count)
         .function("get_data", &t_ctx0::get_data)
         .function("get_step_delta", &t_ctx0::get_step_delta)
+        .function("subscribe_viewport", &t_ctx0::subscribe_viewport)
+        .function("unsubscribe_viewport", &t_ctx0::unsubscribe_viewport)
+        .function("get_viewport_changed", &t_ctx0::get_viewport_changed)
         .function("get_cell_delta", &t_ctx0::get_cell_delta)
+        .function("set_topk", &t_ctx0::set_topk)
         .function(
             "get_column_names", &t_ctx0::get_column_names)
         .function("get_column_dtype", &t_ctx0::get_column_dtype)
@@ -1295,9 +1328,13 @@ EMSCRIPTEN_BINDINGS(perspective)
         .function("get_leaf_count", &t_ctx1::get_leaf_count)
         .function("get_leaf_data", &t_ctx1::get_leaf_data)
         .function("get_step_delta", &t_ctx1::get_step_delta)
+        .function("subscribe_viewport", &t_ctx1::subscribe_viewport)
+        .function("unsubscribe_viewport", &t_ctx1::unsubscribe_viewport)
+        .function("get_viewport_changed", &t_ctx1::get_viewport_changed)
         .function("get_cell_delta", &t_ctx1::get_cell_delta)
         .function("set_depth", &t_ctx1::set_depth)
         .function("get_depth", &t_ctx1::get_depth)
+        .function("set_lazy_expansion", &t_ctx1::set_lazy_expansion)
         .function("open", select_overload<t_index(t_tvidx)>(&t_ctx1::open))
         .function("close", select_overload<t_index(t_tvidx)>(&t_ctx1::close))
         .function("get_trav_depth", &t_ctx1::get_trav_depth)
@@ -1340,9 +1377,13 @@ EMSCRIPTEN_BINDINGS(perspective)
         .function("get_leaf_count", &t_ctx2::get_leaf_count)
         .function("get_leaf_data", &t_ctx2::get_leaf_data)
         .function("get_step_delta", &t_ctx2::get_step_delta)
+        .function("subscribe_viewport", &t_ctx2::subscribe_viewport)
+        .function("unsubscribe_viewport", &t_ctx2::unsubscribe_viewport)
+        .function("get_viewport_changed", &t_ctx2::get_viewport_changed)
         //.function("get_cell_delta", &t_ctx2::get_cell_delta)
         .function("set_depth", &t_ctx2::set_depth)
         .function("get_depth", &t_ctx2::get_depth)
+        .function("set_lazy_expansion", &t_ctx2::set_lazy_expansion)
         .function(
             "open", select_overload<t_index(t_header, t_tvidx)>(&t_ctx2::open))
         .function("close",
@@ -1395,10 +1436,13 @@ EMSCRIPTEN_BINDINGS(perspective)
         .function("unregister_context", &t_pool::unregister_context)
         .function(
             "get_contexts_last_updated", &t_pool::get_contexts_last_updated)
+        .function(
+            "get_viewports_last_updated", &t_pool::get_viewports_last_updated)
         .function(
             "get_gnodes_last_updated", &t_pool::get_gnodes_last_updated)
         .function(
-            "get_gnode", &t_pool::get_gnode, allow_raw_pointers());
+            "get_gnode", &t_pool::get_gnode, allow_raw_pointers())
+        .function("get_memory_usage", &t_pool::get_memory_usage);
 
     class_<t_aggspec>("t_aggspec")
         .function("name", &t_aggspec::name);
@@ -1409,6 +1453,12 @@ EMSCRIPTEN_BINDINGS(perspective)
         .field("gnode_id", &t_updctx::m_gnode_id)
         .field("ctx_name", &t_updctx::m_ctx);
 
+    value_object<t_mem_usage>("t_mem_usage")
+        .field("name", &t_mem_usage::m_name)
+        .field("size", &t_mem_usage::m_size)
+        .field("capacity", &t_mem_usage::m_capacity)
+        .field("children", &t_mem_usage::m_children);
+
     value_object<t_cellupd>("t_cellupd")
         .field("row", &t_cellupd::row)
         .field("column", &t_cellupd::column)
@@ -1420,6 +1470,12 @@ EMSCRIPTEN_BINDINGS(perspective)
         .field("columns_changed", &t_stepdelta::columns_changed)
         .field("cells", &t_stepdelta::cells);
 
+    value_object<t_viewport>("t_viewport")
+        .field("start_row", &t_viewport::m_bidx)
+        .field("end_row", &t_viewport::m_eidx)
+        .field("start_col", &t_viewport::m_bcol)
+        .field("end_col", &t_viewport::m_ecol);
+
     register_vector<t_dtype>("std::vector<t_dtype>");
     register_vector<t_cellupd>("t_cellupdvec");
     register_vector<t_aggspec>("t_aggspecvec");
@@ -1427,6 +1483,7 @@ EMSCRIPTEN_BINDINGS(perspective)
     register_vector<std::string>("std::vector<std::string>");
     register_vector<t_updctx>("t_updctx_vec");
     register_vector<t_uindex>("std::vector<t_uindex>");
+    register_vector<t_mem_usage>("t_mem_usage_vec");
 
     enum_<t_header>("t_header")
         .value("HEADER_ROW", HEADER_ROW)
@@ -1533,6 +1590,7 @@ EMSCRIPTEN_BINDINGS(perspective)
     function("scalar_to_val", &scalar_to_val);
     function("scalar_vec_to_val", &scalar_vec_to_val);
     function("table_add_computed_column", &table_add_computed_column);
+    function("table_add_computed_expression", &table_add_computed_expression);
     function("set_column_nth", &set_column_nth, allow_raw_pointers());
     function("get_data_zero", &get_data<t_ctx0_sptr>);
     function("get_data_one", &get_data<t_ctx1_sptr>);
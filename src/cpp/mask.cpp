@@ -15,18 +15,26 @@
 namespace perspective
 {
 
-t_mask::t_mask() { LOG_CONSTRUCTOR("t_mask"); }
+t_mask::t_mask()
+    : m_mode(MASK_MODE_DENSE)
+    , m_size(0)
+{
+    LOG_CONSTRUCTOR("t_mask");
+}
 
 t_mask::t_mask(t_uindex size)
-    : m_bitmap(t_msize(size))
+    : m_mode(MASK_MODE_DENSE)
+    , m_size(size)
+    , m_words(nwords_for(size), 0)
 {
     LOG_CONSTRUCTOR("t_mask");
 }
 
 t_mask::t_mask(const t_simple_bitmask& m)
+    : m_mode(MASK_MODE_DENSE)
+    , m_size(m.size())
+    , m_words(nwords_for(m.size()), 0)
 {
-    m_bitmap = boost::dynamic_bitset<>(static_cast<size_t>(m.size()));
-
     for (t_uindex idx = 0, loop_end = m.size(); idx < loop_end; ++idx)
     {
         set(idx, m.is_set(idx));
@@ -35,80 +43,450 @@ t_mask::t_mask(const t_simple_bitmask& m)
 
 t_mask::~t_mask() { LOG_DESTRUCTOR("t_mask"); }
 
+t_uindex
+t_mask::nwords_for(t_uindex nbits)
+{
+    return (nbits + 63) / 64;
+}
+
 void
 t_mask::clear()
 {
-    m_bitmap.clear();
+    m_mode = MASK_MODE_DENSE;
+    m_size = 0;
+    m_words.clear();
+    reset_compressed();
+}
+
+void
+t_mask::reset_compressed()
+{
+    std::vector<t_uindex>().swap(m_indices);
+    std::vector<t_uidxpair>().swap(m_runs);
 }
 
 t_uindex
 t_mask::count() const
 {
-    return m_bitmap.count();
+    switch (m_mode)
+    {
+        case MASK_MODE_DENSE:
+        {
+            const t_uint64* words = m_words.data();
+            t_uindex rv = 0;
+            for (t_uindex idx = 0, loop_end = m_words.size(); idx < loop_end;
+                 ++idx)
+            {
+                rv += psp_popcount64(words[idx]);
+            }
+            return rv;
+        }
+        case MASK_MODE_ARRAY:
+        {
+            return m_indices.size();
+        }
+        case MASK_MODE_RUNS:
+        {
+            t_uindex rv = 0;
+            for (const auto& r : m_runs)
+            {
+                rv += r.second - r.first;
+            }
+            return rv;
+        }
+    }
+    return 0;
 }
 
 t_uindex
 t_mask::size() const
 {
-    return m_bitmap.size();
+    return m_size;
+}
+
+t_mask_mode
+t_mask::get_mode() const
+{
+    return m_mode;
 }
 
 bool
 t_mask::get(t_uindex idx) const
 {
-    return m_bitmap.test(t_msize(idx));
+    switch (m_mode)
+    {
+        case MASK_MODE_DENSE:
+        {
+            return (m_words[idx >> 6] >> (idx & 63)) & 1;
+        }
+        case MASK_MODE_ARRAY:
+        {
+            return std::binary_search(m_indices.begin(), m_indices.end(), idx);
+        }
+        case MASK_MODE_RUNS:
+        {
+            auto iter = std::upper_bound(m_runs.begin(), m_runs.end(), idx,
+                [](t_uindex v, const t_uidxpair& r) { return v < r.first; });
+            if (iter == m_runs.begin())
+                return false;
+            --iter;
+            return idx < iter->second;
+        }
+    }
+    return false;
 }
 
 void
 t_mask::set(t_uindex idx, bool v)
 {
-    m_bitmap.set(t_msize(idx), v);
+    PSP_VERBOSE_ASSERT(idx < m_size, "Mask index out of range");
+
+    if (m_mode == MASK_MODE_ARRAY && v
+        && (m_indices.empty() || m_indices.back() < idx))
+    {
+        // in order appends keep sparse masks compressed
+        m_indices.push_back(idx);
+        return;
+    }
+
+    if (m_mode != MASK_MODE_DENSE && get(idx) == v)
+        return;
+
+    if (m_mode != MASK_MODE_DENSE)
+        densify();
+
+    t_uint64 bit = t_uint64(1) << (idx & 63);
+    if (v)
+        m_words[idx >> 6] |= bit;
+    else
+        m_words[idx >> 6] &= ~bit;
 }
 
 void
 t_mask::set(t_uindex idx)
 {
-    m_bitmap.set(t_msize(idx), true);
+    set(idx, true);
 }
 
+void
+t_mask::expand_into(t_mask_words& words) const
+{
+    words.assign(nwords_for(m_size), 0);
+
+    switch (m_mode)
+    {
+        case MASK_MODE_DENSE:
+        {
+            words = m_words;
+        }
+        break;
+        case MASK_MODE_ARRAY:
+        {
+            for (auto idx : m_indices)
+            {
+                words[idx >> 6] |= t_uint64(1) << (idx & 63);
+            }
+        }
+        break;
+        case MASK_MODE_RUNS:
+        {
+            for (const auto& r : m_runs)
+            {
+                for (t_uindex idx = r.first; idx < r.second; ++idx)
+                {
+                    if ((idx & 63) == 0 && idx + 64 <= r.second)
+                    {
+                        words[idx >> 6] = ~t_uint64(0);
+                        idx += 63;
+                        continue;
+                    }
+                    words[idx >> 6] |= t_uint64(1) << (idx & 63);
+                }
+            }
+        }
+        break;
+    }
+}
+
+void
+t_mask::densify()
+{
+    if (m_mode == MASK_MODE_DENSE)
+        return;
+    expand_into(m_words);
+    m_mode = MASK_MODE_DENSE;
+    reset_compressed();
+}
+
+void
+t_mask::optimize()
+{
+    t_uindex nset = 0;
+    t_uindex nruns = 0;
+    for_each_run([&nset, &nruns](t_uindex bidx, t_uindex eidx) {
+        nset += eidx - bidx;
+        ++nruns;
+    });
+
+    t_uindex dense_bytes = nwords_for(m_size) * sizeof(t_uint64);
+    t_uindex array_bytes = nset * sizeof(t_uindex);
+    t_uindex runs_bytes = nruns * sizeof(t_uidxpair);
+
+    t_mask_mode mode = MASK_MODE_DENSE;
+    if (array_bytes < dense_bytes && array_bytes <= runs_bytes)
+        mode = MASK_MODE_ARRAY;
+    else if (runs_bytes < dense_bytes)
+        mode = MASK_MODE_RUNS;
+
+    if (mode == m_mode)
+        return;
+
+    std::vector<t_uindex> indices;
+    std::vector<t_uidxpair> runs;
+
+    switch (mode)
+    {
+        case MASK_MODE_ARRAY:
+        {
+            indices.reserve(nset);
+            get_indices(indices);
+        }
+        break;
+        case MASK_MODE_RUNS:
+        {
+            runs.reserve(nruns);
+            for_each_run([&runs](t_uindex bidx, t_uindex eidx) {
+                runs.push_back(t_uidxpair(bidx, eidx));
+            });
+        }
+        break;
+        case MASK_MODE_DENSE:
+        {
+            densify();
+            return;
+        }
+    }
+
+    t_mask_words().swap(m_words);
+    m_indices.swap(indices);
+    m_runs.swap(runs);
+    m_mode = mode;
+}
+
+void
+t_mask::get_indices(std::vector<t_uindex>& out) const
+{
+    if (m_mode == MASK_MODE_ARRAY)
+    {
+        out.insert(out.end(), m_indices.begin(), m_indices.end());
+        return;
+    }
+
+    if (m_mode == MASK_MODE_DENSE)
+    {
+        const t_uint64* words = m_words.data();
+        for (t_uindex widx = 0, loop_end = m_words.size(); widx < loop_end;
+             ++widx)
+        {
+            t_uint64 w = words[widx];
+            while (w)
+            {
+                out.push_back(widx * 64 + psp_ctz64(w));
+                w &= w - 1;
+            }
+        }
+        return;
+    }
+
+    for_each_run([&out](t_uindex bidx, t_uindex eidx) {
+        for (t_uindex idx = bidx; idx < eidx; ++idx)
+        {
+            out.push_back(idx);
+        }
+    });
+}
+
+const t_uint64*
+t_mask::get_words() const
+{
+    PSP_VERBOSE_ASSERT(m_mode == MASK_MODE_DENSE, "Mask is not dense");
+    return m_words.data();
+}
+
+t_uindex
+t_mask::get_nwords() const
+{
+    return m_words.size();
+}
+
+t_uindex
+t_mask::nbytes() const
+{
+    return m_words.capacity() * sizeof(t_uint64)
+        + m_indices.capacity() * sizeof(t_uindex)
+        + m_runs.capacity() * sizeof(t_uidxpair);
+}
+
+// The boolean ops below run over whole words so the compiler
+// can vectorize them. Sparse left hand sides are filtered in
+// place for AND and difference.
+
 t_mask&
 t_mask::operator&=(const t_mask& b)
 {
-    m_bitmap &= b.m_bitmap;
+    PSP_VERBOSE_ASSERT(m_size == b.m_size, "Mismatched mask sizes");
+
+    if (m_mode == MASK_MODE_ARRAY)
+    {
+        m_indices.erase(std::remove_if(m_indices.begin(), m_indices.end(),
+                            [&b](t_uindex idx) { return !b.get(idx); }),
+            m_indices.end());
+        return *this;
+    }
+
+    densify();
+    t_mask_words tmp;
+    const t_uint64* bwords;
+    if (b.m_mode == MASK_MODE_DENSE)
+    {
+        bwords = b.m_words.data();
+    }
+    else
+    {
+        b.expand_into(tmp);
+        bwords = tmp.data();
+    }
+
+    t_uint64* words = m_words.data();
+    for (t_uindex idx = 0, loop_end = m_words.size(); idx < loop_end; ++idx)
+    {
+        words[idx] &= bwords[idx];
+    }
     return *this;
 }
 
 t_mask&
 t_mask::operator|=(const t_mask& b)
 {
-    m_bitmap |= b.m_bitmap;
+    PSP_VERBOSE_ASSERT(m_size == b.m_size, "Mismatched mask sizes");
+    densify();
+
+    if (b.m_mode != MASK_MODE_DENSE)
+    {
+        b.for_each_run([this](t_uindex bidx, t_uindex eidx) {
+            for (t_uindex idx = bidx; idx < eidx; ++idx)
+            {
+                m_words[idx >> 6] |= t_uint64(1) << (idx & 63);
+            }
+        });
+        return *this;
+    }
+
+    t_uint64* words = m_words.data();
+    const t_uint64* bwords = b.m_words.data();
+    for (t_uindex idx = 0, loop_end = m_words.size(); idx < loop_end; ++idx)
+    {
+        words[idx] |= bwords[idx];
+    }
     return *this;
 }
 
 t_mask&
 t_mask::operator^=(const t_mask& b)
 {
-    m_bitmap ^= b.m_bitmap;
+    PSP_VERBOSE_ASSERT(m_size == b.m_size, "Mismatched mask sizes");
+    densify();
+
+    if (b.m_mode != MASK_MODE_DENSE)
+    {
+        b.for_each_run([this](t_uindex bidx, t_uindex eidx) {
+            for (t_uindex idx = bidx; idx < eidx; ++idx)
+            {
+                m_words[idx >> 6] ^= t_uint64(1) << (idx & 63);
+            }
+        });
+        return *this;
+    }
+
+    t_uint64* words = m_words.data();
+    const t_uint64* bwords = b.m_words.data();
+    for (t_uindex idx = 0, loop_end = m_words.size(); idx < loop_end; ++idx)
+    {
+        words[idx] ^= bwords[idx];
+    }
     return *this;
 }
 
 t_mask&
 t_mask::operator-=(const t_mask& b)
 {
-    m_bitmap -= b.m_bitmap;
+    PSP_VERBOSE_ASSERT(m_size == b.m_size, "Mismatched mask sizes");
+
+    if (m_mode == MASK_MODE_ARRAY)
+    {
+        m_indices.erase(std::remove_if(m_indices.begin(), m_indices.end(),
+                            [&b](t_uindex idx) { return b.get(idx); }),
+            m_indices.end());
+        return *this;
+    }
+
+    densify();
+
+    if (b.m_mode != MASK_MODE_DENSE)
+    {
+        b.for_each_run([this](t_uindex bidx, t_uindex eidx) {
+            for (t_uindex idx = bidx; idx < eidx; ++idx)
+            {
+                m_words[idx >> 6] &= ~(t_uint64(1) << (idx & 63));
+            }
+        });
+        return *this;
+    }
+
+    t_uint64* words = m_words.data();
+    const t_uint64* bwords = b.m_words.data();
+    for (t_uindex idx = 0, loop_end = m_words.size(); idx < loop_end; ++idx)
+    {
+        words[idx] &= ~bwords[idx];
+    }
     return *this;
 }
 
+t_uindex
+t_mask::find_from(t_uindex pos) const
+{
+    switch (m_mode)
+    {
+        case MASK_MODE_DENSE:
+        {
+            return next_set(pos);
+        }
+        case MASK_MODE_ARRAY:
+        {
+            auto iter
+                = std::lower_bound(m_indices.begin(), m_indices.end(), pos);
+            return iter == m_indices.end() ? m_npos : *iter;
+        }
+        case MASK_MODE_RUNS:
+        {
+            auto iter = std::upper_bound(m_runs.begin(), m_runs.end(), pos,
+                [](t_uindex v, const t_uidxpair& r) { return v < r.second; });
+            return iter == m_runs.end() ? m_npos : std::max(iter->first, pos);
+        }
+    }
+    return m_npos;
+}
+
 t_uindex
 t_mask::find_first() const
 {
-    return m_bitmap.find_first();
+    return find_from(0);
 }
 
 t_uindex
 t_mask::find_next(t_uindex pos) const
 {
-    return m_bitmap.find_next(t_msize(pos));
+    return find_from(pos + 1);
 }
 
 void
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/memory_usage.h>
+#include <sstream>
+
+namespace perspective
+{
+
+t_mem_usage::t_mem_usage()
+    : m_size(0)
+    , m_capacity(0)
+{
+}
+
+t_mem_usage::t_mem_usage(const t_str& name)
+    : m_name(name)
+    , m_size(0)
+    , m_capacity(0)
+{
+}
+
+t_mem_usage::t_mem_usage(const t_str& name, t_uindex size, t_uindex capacity)
+    : m_name(name)
+    , m_size(size)
+    , m_capacity(capacity)
+{
+}
+
+t_mem_usage&
+t_mem_usage::add(const t_mem_usage& child)
+{
+    m_size += child.m_size;
+    m_capacity += child.m_capacity;
+    m_children.push_back(child);
+    return *this;
+}
+
+t_mem_usage&
+t_mem_usage::add(const t_str& name, t_uindex size, t_uindex capacity)
+{
+    return add(t_mem_usage(name, size, capacity));
+}
+
+const t_mem_usage*
+t_mem_usage::find(const t_str& name) const
+{
+    for (const auto& c : m_children)
+    {
+        if (c.m_name == name)
+            return &c;
+    }
+    return nullptr;
+}
+
+namespace
+{
+
+void
+repr_helper(const t_mem_usage& u, t_uindex depth, std::stringstream& ss)
+{
+    ss << t_str(2 * depth, ' ') << u.m_name << " size => " << u.m_size
+       << " capacity => " << u.m_capacity << "\n";
+    for (const auto& c : u.m_children)
+    {
+        repr_helper(c, depth + 1, ss);
+    }
+}
+
+} // end anonymous namespace
+
+t_str
+t_mem_usage::repr() const
+{
+    std::stringstream ss;
+    repr_helper(*this, 0, ss);
+    return ss.str();
+}
+
+} // end namespace perspective
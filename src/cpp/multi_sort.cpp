@@ -18,69 +18,61 @@ namespace perspective
 {
 
 t_mselem::t_mselem()
-    : m_pkey(mknone())
-    , m_order(0)
+    : m_order(0)
+    , m_ridx(0)
     , m_deleted(false)
 {
 }
 
 t_mselem::t_mselem(const t_tscalvec& row)
     : m_row(row)
-    , m_pkey(mknone())
     , m_order(0)
+    , m_ridx(0)
     , m_deleted(false)
 {
 }
 
 t_mselem::t_mselem(const t_tscalvec& row, t_uindex order)
     : m_row(row)
-    , m_pkey(mknone())
     , m_order(order)
-    , m_deleted(false)
-{
-}
-
-t_mselem::t_mselem(const t_tscalar& pkey, const t_tscalvec& row)
-    : m_row(row)
-    , m_pkey(pkey)
-    , m_order(0)
+    , m_ridx(0)
     , m_deleted(false)
 {
 }
 
 t_mselem::t_mselem(const t_mselem& other)
 {
-    m_pkey = other.m_pkey;
     m_row = other.m_row;
     m_deleted = other.m_deleted;
     m_order = other.m_order;
+    m_ridx = other.m_ridx;
 }
 
 t_mselem::t_mselem(t_mselem&& other)
 {
-    m_pkey = other.m_pkey;
     m_row = std::move(other.m_row);
     m_deleted = other.m_deleted;
     m_order = other.m_order;
+    m_ridx = other.m_ridx;
 }
 
 t_mselem&
 t_mselem::operator=(const t_mselem& other)
 {
-    m_pkey = other.m_pkey;
     m_row = other.m_row;
     m_deleted = other.m_deleted;
     m_order = other.m_order;
+    m_ridx = other.m_ridx;
     return *this;
 }
 
 t_mselem&
 t_mselem::operator=(t_mselem&& other)
 {
-    m_pkey = other.m_pkey;
     m_row = std::move(other.m_row);
     m_deleted = other.m_deleted;
     m_order = other.m_order;
+    m_ridx = other.m_ridx;
     return *this;
 }
 
@@ -302,6 +302,34 @@ t_pool::get_contexts_last_updated()
     return rval;
 }
 
+t_updctx_vec
+t_pool::get_viewports_last_updated()
+{
+    std::lock_guard<std::mutex> lg(m_mtx);
+    t_updctx_vec rval;
+
+    for (t_uindex idx = 0, loop_end = m_gnodes.size(); idx < loop_end; ++idx)
+    {
+        if (!m_gnodes[idx])
+            continue;
+
+        auto updated_viewports = m_gnodes[idx]->get_viewports_last_updated();
+        auto gnode_id = m_gnodes[idx]->get_id();
+
+        for (const auto& ctx_name : updated_viewports)
+        {
+            if (t_env::log_progress())
+            {
+                std::cout << "t_pool.get_viewports_last_updated: "
+                          << " gnode_id => " << gnode_id << " ctx_name => "
+                          << ctx_name << std::endl;
+            }
+            rval.push_back(t_updctx(gnode_id, ctx_name));
+        }
+    }
+    return rval;
+}
+
 t_bool
 t_pool::validate_gnode_id(t_uindex gnode_id) const
 {
@@ -408,6 +436,22 @@ t_pool::get_gnodes_last_updated()
     return rv;
 }
 
+t_mem_usage
+t_pool::get_memory_usage()
+{
+    std::lock_guard<std::mutex> lg(m_mtx);
+    t_mem_usage rv("pool");
+    for (t_uindex idx = 0, loop_end = m_gnodes.size(); idx < loop_end; ++idx)
+    {
+        if (!m_gnodes[idx])
+            continue;
+        auto gnode = m_gnodes[idx]->get_memory_usage();
+        gnode.m_name = "gnode_" + std::to_string(idx);
+        rv.add(gnode);
+    }
+    return rv;
+}
+
 t_gnode*
 t_pool::get_gnode(t_uindex idx)
 {
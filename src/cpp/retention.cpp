@@ -0,0 +1,174 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/retention.h>
+#include <perspective/table.h>
+#include <cstring>
+#include <limits>
+
+namespace perspective
+{
+
+t_retention::t_retention()
+    : t_retention(0, "", 0)
+{
+}
+
+t_retention::t_retention(
+    t_uindex max_rows, const t_str& colname, t_int64 max_age)
+    : m_max_rows(max_rows)
+    , m_colname(colname)
+    , m_max_age(colname.empty() ? 0 : max_age)
+    , m_newest(std::numeric_limits<t_int64>::min())
+    , m_seq(0)
+    , m_str_bytes(0)
+{
+}
+
+t_bool
+t_retention::is_enabled() const
+{
+    return m_max_rows > 0 || m_max_age > 0;
+}
+
+const t_str&
+t_retention::get_column() const
+{
+    return m_colname;
+}
+
+void
+t_retention::update(const t_table& tbl)
+{
+    m_expired.clear();
+
+    const t_column* pkey_col = tbl.get_const_column("psp_pkey").get();
+    const t_column* op_col = tbl.get_const_column("psp_op").get();
+    const t_column* age_col = m_colname.empty()
+        ? nullptr
+        : tbl.get_const_column(m_colname).get();
+
+    for (t_uindex idx = 0, loop_end = tbl.size(); idx < loop_end; ++idx)
+    {
+        t_tscalar pkey = pkey_col->get_scalar(idx);
+        t_op op = static_cast<t_op>(*(op_col->get_nth<t_uint8>(idx)));
+
+        if (op == OP_DELETE)
+        {
+            erase(pkey);
+            continue;
+        }
+
+        // Without a valid time, known rows keep their age and new
+        // rows count as arriving at the newest time seen
+        t_bool has_age = age_col && age_col->is_valid(idx);
+        auto iter = m_ages.find(pkey);
+        if (iter != m_ages.end() && !has_age)
+            continue;
+
+        t_int64 age = m_newest;
+        if (has_age)
+        {
+            age = *(age_col->get_nth<t_int64>(idx));
+            m_newest = std::max(m_newest, age);
+        }
+
+        t_ageidx key(age, m_seq++);
+        if (iter != m_ages.end())
+        {
+            m_index.erase(iter->second.m_age);
+            iter->second.m_age = key;
+            m_index[key] = iter->first;
+            continue;
+        }
+
+        // The pkey points into the input table, keep a copy
+        t_tracked tracked;
+        tracked.m_age = key;
+        if (pkey.is_str() && !pkey.is_inplace())
+        {
+            const t_char* str = pkey.get_char_ptr();
+            t_uindex len = strlen(str) + 1;
+            tracked.m_str.reset(new t_char[len]);
+            memcpy(tracked.m_str.get(), str, len);
+            pkey.set(tracked.m_str.get());
+            m_str_bytes += len;
+        }
+        m_index[key] = pkey;
+        m_ages.emplace(pkey, std::move(tracked));
+    }
+}
+
+void
+t_retention::get_expired(t_tscalvec& out)
+{
+    m_expired.clear();
+    while (!m_index.empty())
+    {
+        auto iter = m_index.begin();
+        t_bool too_old = m_max_age > 0
+            && m_newest != std::numeric_limits<t_int64>::min()
+            && iter->first.first < m_newest - m_max_age;
+        t_bool too_many = m_max_rows > 0 && m_index.size() > m_max_rows;
+        if (!too_old && !too_many)
+            break;
+
+        auto aiter = m_ages.find(iter->second);
+        if (aiter->second.m_str)
+        {
+            m_str_bytes -= strlen(aiter->second.m_str.get()) + 1;
+            m_expired.push_back(std::move(aiter->second.m_str));
+        }
+        out.push_back(iter->second);
+        m_ages.erase(aiter);
+        m_index.erase(iter);
+    }
+}
+
+t_uindex
+t_retention::size() const
+{
+    return m_index.size();
+}
+
+void
+t_retention::reset()
+{
+    m_index.clear();
+    m_ages.clear();
+    m_expired.clear();
+    m_str_bytes = 0;
+    m_newest = std::numeric_limits<t_int64>::min();
+    m_seq = 0;
+}
+
+t_mem_usage
+t_retention::get_memory_usage() const
+{
+    t_mem_usage rv("retention");
+    rv.add(mem_usage_ordered("index", m_index));
+    rv.add(mem_usage_hashed("ages", m_ages));
+    rv.add("strings", m_str_bytes, m_str_bytes);
+    return rv;
+}
+
+void
+t_retention::erase(const t_tscalar& pkey)
+{
+    auto iter = m_ages.find(pkey);
+    if (iter == m_ages.end())
+        return;
+    if (iter->second.m_str)
+        m_str_bytes -= strlen(iter->second.m_str.get()) + 1;
+    m_index.erase(iter->second.m_age);
+    m_ages.erase(iter);
+}
+
+} // end namespace perspective
@@ -84,6 +84,24 @@ typedef t_idxpkey::index<by_idx_pkey>::type::iterator iter_by_idx_pkey;
 
 typedef std::pair<iter_by_idx_pkey, iter_by_idx_pkey> t_by_idx_pkey_ipair;
 
+// Valid values of an aggregate at one depth, with the number of nodes
+// holding each
+typedef std::map<t_tscalar, t_uindex> t_value_counts;
+
+// Depth and values an aggregate row is counted under
+struct t_minmax_row
+{
+    t_minmax_row()
+        : m_indexed(false)
+        , m_depth(0)
+    {
+    }
+
+    t_bool m_indexed;
+    t_depth m_depth;
+    t_tscalvec m_values;
+};
+
 struct t_stree::t_stree_p
 {
     t_stree_p(const t_pivotvec& pivots, const t_aggspecvec& aggspecs,
@@ -99,6 +117,12 @@ struct t_stree::t_stree_p
     void add_leaf(t_uindex nidx, t_uindex lfidx);
     void remove_leaf(t_uindex nidx, t_uindex lfidx);
 
+    // Per (aggregate, depth) min/max, kept while CTX_FEAT_MINMAX is on
+    t_bool minmax_enabled() const;
+    void index_minmax(const t_tnode& node);
+    void unindex_minmax(t_uindex aggidx);
+    void reindex_minmax();
+
     t_pivotvec m_pivots;
     t_bool m_init;
     t_sptr_treenodes m_nodes;
@@ -115,13 +139,17 @@ struct t_stree::t_stree_p
     t_sidxmap m_smap;
     t_colcptrvec m_aggcols;
     t_uindex m_dotcount;
-    t_sptr_tcdeltas m_deltas;
+    t_cell_deltas m_deltas;
     t_minmaxvec m_minmax;
     t_tree_unify_rec_vec m_tree_unification_records;
     std::vector<t_bool> m_features;
     t_symtable m_symtable;
     t_bool m_has_delta;
     t_str m_grand_agg_str;
+    t_stree_csptr m_pkey_src;
+    t_depth m_nrow_pivots;
+    std::vector<std::vector<t_value_counts>> m_minmax_values;
+    std::vector<t_minmax_row> m_minmax_rows;
 };
 
 t_stree::t_stree_p::t_stree_p(const t_pivotvec& pivots,
@@ -135,6 +163,7 @@ t_stree::t_stree_p::t_stree_p(const t_pivotvec& pivots,
     , m_dotcount(0)
     , m_minmax(aggspecs.size())
     , m_has_delta(false)
+    , m_nrow_pivots(0)
 {
     const auto& g_agg_str = cfg.get_grand_agg_str();
     m_grand_agg_str = g_agg_str.empty() ? "Grand Aggregate" : g_agg_str;
@@ -262,7 +291,7 @@ t_stree::t_stree_p::init()
         m_aggcols[idx] = m_aggregates->get_const_column(columns[idx]).get();
     }
 
-    m_deltas = std::make_shared<t_tcdeltas>();
+    m_deltas.init(columns.size());
     m_features = std::vector<t_bool>(CTX_FEAT_LAST_FEATURE);
     m_init = true;
 }
@@ -834,8 +863,9 @@ t_stree::update_shape_from_static(const t_dtree_ctx& ctx)
 
         if (dptidx == 0)
         {
-            m_p->populate_pkey_idx(
-                ctx, dtree, dptidx, sptidx, ndepth, new_idx_pkey);
+            if (!m_p->m_pkey_src)
+                m_p->populate_pkey_idx(
+                    ctx, dtree, dptidx, sptidx, ndepth, new_idx_pkey);
             continue;
         }
 
@@ -919,8 +949,9 @@ t_stree::update_shape_from_static(const t_dtree_ctx& ctx)
             PSP_VERBOSE_ASSERT(replaced, "Failed to replace");
         }
 
-        m_p->populate_pkey_idx(
-            ctx, dtree, dptidx, sptidx, ndepth, new_idx_pkey);
+        if (!m_p->m_pkey_src)
+            m_p->populate_pkey_idx(
+                ctx, dtree, dptidx, sptidx, ndepth, new_idx_pkey);
         nmap[dptidx] = sptidx;
     }
 
@@ -1032,6 +1063,8 @@ t_stree::update_aggs_from_static(const t_dtree_ctx& ctx, const t_gstate& gstate)
         }
     }
 
+    agg_update_info.m_reduce_nodes.resize(col_cnt);
+
     for (const auto& r : m_p->m_tree_unification_records)
     {
         if (!node_exists(r.m_sptidx))
@@ -1041,6 +1074,82 @@ t_stree::update_aggs_from_static(const t_dtree_ctx& ctx, const t_gstate& gstate)
 
         update_agg_table(r.m_sptidx, agg_update_info, r.m_daggidx, r.m_saggidx,
             r.m_nstrands, gstate);
+
+        if (m_p->minmax_enabled())
+            m_p->index_minmax(get_node(r.m_sptidx));
+    }
+
+    reduce_batches(agg_update_info, gstate);
+}
+
+void
+t_stree::reduce_batches(t_agg_update_info& info, const t_gstate& gstate)
+{
+    std::set<t_uindex> reduced;
+    std::vector<t_float64> values;
+    std::vector<t_float64> results;
+
+    for (t_uindex idx = 0, loop_end = info.m_reduce_nodes.size();
+         idx < loop_end; ++idx)
+    {
+        auto& nodes = info.m_reduce_nodes[idx];
+        if (nodes.empty())
+            continue;
+
+        t_column* dst = info.m_dst[idx];
+        const t_aggspec& spec = info.m_aggspecs[idx];
+        const t_str& depname = spec.get_dependencies()[0].name();
+
+        t_kernel_batch batch;
+        batch.m_offsets.reserve(nodes.size() + 1);
+        batch.m_depths.reserve(nodes.size());
+        batch.m_offsets.push_back(0);
+
+        for (const auto& node : nodes)
+        {
+            gstate.read_column(depname, get_pkeys(node.first), values, false);
+            batch.m_values.insert(
+                batch.m_values.end(), values.begin(), values.end());
+            batch.m_offsets.push_back(batch.m_values.size());
+            batch.m_depths.push_back(get_depth(node.first));
+        }
+
+        get_evaluator()->reduce(spec.get_kernel(), batch, results);
+
+        for (t_uindex nidx = 0, nnodes = nodes.size(); nidx < nnodes; ++nidx)
+        {
+            t_uindex dst_ridx = nodes[nidx].second;
+            t_tscalar old_value = mknone();
+            old_value.set(dst->get_scalar(dst_ridx));
+            t_tscalar new_value = mktscalar<t_float64>(results[nidx]);
+            dst->set_scalar(dst_ridx, new_value);
+            record_delta(nodes[nidx].first, idx, old_value, new_value);
+            reduced.insert(nodes[nidx].first);
+        }
+
+        nodes.clear();
+    }
+
+    if (m_p->minmax_enabled())
+    {
+        for (auto nidx : reduced)
+        {
+            m_p->index_minmax(get_node(nidx));
+        }
+    }
+}
+
+void
+t_stree::record_delta(t_uindex nidx, t_uindex aggidx,
+    const t_tscalar& old_value, const t_tscalar& new_value)
+{
+    t_bool val_neq = old_value != new_value;
+
+    m_p->m_has_delta = m_p->m_has_delta || val_neq;
+    t_bool deltas_enabled = m_p->m_features.at(CTX_FEAT_DELTA);
+    if (deltas_enabled && val_neq)
+    {
+        m_p->m_deltas.insert(nidx, aggidx, old_value, new_value);
     }
 }
 
@@ -1155,18 +1264,11 @@ t_stree::update_agg_table(t_uindex nidx, t_agg_update_info& info,
             break;
             case AGGTYPE_UDF_JS_REDUCE_FLOAT64:
             {
-                t_tscalar dst_scalar = dst->get_scalar(dst_ridx);
-                old_value.set(dst_scalar);
-                auto pkeys = get_pkeys(nidx);
-                std::vector<t_float64> values;
-                gstate.read_column(
-                    spec.get_dependencies()[0].name(), pkeys, values, false);
-                t_float64 result = get_evaluator()->reduce<t_float64>(
-                    spec.get_kernel(), get_depth(nidx), values);
-                dst->set_scalar(dst_ridx, mktscalar(result));
-                new_value.set(mktscalar<t_float64>(result));
+                // Reduced with the rest of the batch in reduce_batches
+                info.m_reduce_nodes[idx].push_back(
+                    t_uidxpair(nidx, dst_ridx));
+                continue;
             }
-            break;
             case AGGTYPE_COUNT:
             {
                 if (nidx == 0)
@@ -1648,15 +1750,7 @@ t_stree::update_agg_table(t_uindex nidx, t_agg_update_info& info,
             }
         } // end switch
 
-        t_bool val_neq = old_value != new_value;
-
-        m_p->m_has_delta = m_p->m_has_delta || val_neq;
-        t_bool deltas_enabled = m_p->m_features.at(CTX_FEAT_DELTA);
-        if (deltas_enabled && val_neq)
-        {
-            m_p->m_deltas->insert(t_tcdelta(nidx, idx, old_value, new_value));
-        }
-
+        record_delta(nidx, idx, old_value, new_value);
     } // end for
 }
 
@@ -1815,6 +1909,11 @@ t_stree::resolve_child(t_uindex root, const t_tscalar& datum) const
 void
 t_stree::clear_aggregates(const std::vector<t_uindex>& indices)
 {
+    for (auto aggidx : indices)
+    {
+        m_p->unindex_minmax(aggidx);
+    }
+
     auto cols = m_p->m_aggregates->get_columns();
     for (auto c : cols)
     {
@@ -1896,6 +1995,64 @@ t_stree::add_pkey(t_uindex idx, t_tscalar pkey)
     m_p->add_pkey(idx, pkey);
 }
 
+void
+t_stree::update_node(const t_tnode& node)
+{
+    auto iter = m_p->m_nodes->get<by_idx>().find(node.m_idx);
+    PSP_VERBOSE_ASSERT(
+        iter != m_p->m_nodes->get<by_idx>().end(), "Did not find node");
+    t_bool replaced = m_p->m_nodes->get<by_idx>().replace(iter, node);
+    PSP_UNUSED(replaced);
+    PSP_VERBOSE_ASSERT(replaced, "Failed to replace");
+
+    if (m_p->minmax_enabled())
+        m_p->index_minmax(node);
+}
+
+void
+t_stree::remove_node(t_uindex idx)
+{
+    PSP_VERBOSE_ASSERT(get_num_children(idx) == 0, "Node has children");
+
+    auto pkeys = m_p->m_idxpkey->get<by_idx_pkey>().equal_range(idx);
+    m_p->m_idxpkey->get<by_idx_pkey>().erase(pkeys.first, pkeys.second);
+
+    auto leaves = m_p->m_idxleaf->get<by_idx_lfidx>().equal_range(idx);
+    m_p->m_idxleaf->get<by_idx_lfidx>().erase(leaves.first, leaves.second);
+
+    m_p->unindex_minmax(get_aggidx(idx));
+    m_p->m_nodes->get<by_idx>().erase(idx);
+}
+
+void
+t_stree::set_aggregates(t_uindex idx, const std::vector<t_uindex>& aggnums,
+    const t_tscalvec& values)
+{
+    t_uindex aggidx = get_aggidx(idx);
+    t_colptrvec columns = m_p->m_aggregates->get_columns();
+    t_bool deltas_enabled = m_p->m_features.at(CTX_FEAT_DELTA);
+
+    for (t_uindex vidx = 0, loop_end = aggnums.size(); vidx < loop_end; ++vidx)
+    {
+        t_uindex aggnum = aggnums[vidx];
+        t_column* dst = columns[aggnum];
+        t_tscalar old_value = dst->get_scalar(aggidx);
+        const t_tscalar& new_value = values[vidx];
+
+        if (old_value == new_value
+            && old_value.is_valid() == new_value.is_valid())
+            continue;
+
+        dst->set_scalar(aggidx, new_value);
+        m_p->m_has_delta = true;
+        if (deltas_enabled)
+            m_p->m_deltas.insert(idx, aggnum, old_value, new_value);
+    }
+
+    if (m_p->minmax_enabled())
+        m_p->index_minmax(get_node(idx));
+}
+
 void
 t_stree::t_stree_p::add_pkey(t_uindex idx, t_tscalar pkey)
 {
@@ -1934,6 +2091,89 @@ t_stree::t_stree_p::remove_leaf(t_uindex nidx, t_uindex lfidx)
     m_idxleaf->get<by_idx_lfidx>().erase(iter);
 }
 
+t_bool
+t_stree::t_stree_p::minmax_enabled() const
+{
+    return m_features[CTX_FEAT_MINMAX];
+}
+
+void
+t_stree::t_stree_p::index_minmax(const t_tnode& node)
+{
+    if (node.m_idx == 0)
+        return;
+
+    unindex_minmax(node.m_aggidx);
+
+    if (node.m_aggidx >= m_minmax_rows.size())
+    {
+        m_minmax_rows.resize(
+            std::max<t_uindex>(node.m_aggidx + 1, m_aggregates->size()));
+    }
+
+    t_minmax_row& row = m_minmax_rows[node.m_aggidx];
+    row.m_indexed = true;
+    row.m_depth = node.m_depth;
+    row.m_values.resize(m_minmax_values.size());
+
+    for (t_uindex aggnum = 0, loop_end = m_minmax_values.size();
+         aggnum < loop_end; ++aggnum)
+    {
+        // Grouped pkey trees run deeper than their pivots
+        auto& depths = m_minmax_values[aggnum];
+        if (node.m_depth >= depths.size())
+            depths.resize(node.m_depth + 1);
+
+        t_tscalar v = m_aggcols[aggnum]->get_scalar(node.m_aggidx);
+        if (v.is_valid())
+        {
+            v = m_symtable.get_interned_tscalar(v);
+            ++depths[node.m_depth][v];
+        }
+        row.m_values[aggnum] = v;
+    }
+}
+
+void
+t_stree::t_stree_p::unindex_minmax(t_uindex aggidx)
+{
+    if (aggidx >= m_minmax_rows.size() || !m_minmax_rows[aggidx].m_indexed)
+        return;
+
+    t_minmax_row& row = m_minmax_rows[aggidx];
+    for (t_uindex aggnum = 0, loop_end = row.m_values.size();
+         aggnum < loop_end; ++aggnum)
+    {
+        const t_tscalar& v = row.m_values[aggnum];
+        if (!v.is_valid())
+            continue;
+
+        t_value_counts& counts = m_minmax_values[aggnum][row.m_depth];
+        auto iter = counts.find(v);
+        if (--iter->second == 0)
+            counts.erase(iter);
+    }
+    row.m_indexed = false;
+}
+
+void
+t_stree::t_stree_p::reindex_minmax()
+{
+    m_minmax_rows.clear();
+    m_minmax_values.clear();
+
+    if (!minmax_enabled())
+        return;
+
+    m_minmax_values.assign(
+        m_aggspecs.size(), std::vector<t_value_counts>(m_pivots.size() + 1));
+
+    for (const auto& node : m_nodes->get<by_idx>())
+    {
+        index_minmax(node);
+    }
+}
+
 t_by_idx_pkey_ipair
 t_stree::t_stree_p::get_pkeys_for_leaf(t_uindex idx) const
 {
@@ -1943,6 +2183,9 @@ t_stree::t_stree_p::get_pkeys_for_leaf(t_uindex idx) const
 t_tscalvec
 t_stree::get_pkeys(t_uindex idx) const
 {
+    if (m_p->m_pkey_src)
+        return get_source_pkeys(idx);
+
     t_tscalvec rval;
     std::vector<t_uindex> leaves = get_leaves(idx);
 
@@ -1957,6 +2200,44 @@ t_stree::get_pkeys(t_uindex idx) const
     return rval;
 }
 
+t_tscalvec
+t_stree::get_source_pkeys(t_uindex idx) const
+{
+    const t_stree& src = *(m_p->m_pkey_src);
+    t_tscalvec path;
+    get_path(idx, path);
+
+    // Paths run leaf first, so the row pivots are at the back
+    t_uindex ncpath = path.size() > t_uindex(m_p->m_nrow_pivots)
+        ? path.size() - m_p->m_nrow_pivots
+        : 0;
+    t_tscalvec r_path(path.begin() + ncpath, path.end());
+    t_ptidx r_ptidx = src.resolve_path(0, r_path);
+    if (r_ptidx == INVALID_INDEX)
+        return t_tscalvec();
+
+    if (ncpath == 0)
+        return src.get_pkeys(r_ptidx);
+
+    // Column nodes gather the matching column node under every row
+    // leaf of the source
+    t_tscalvec c_path(path.begin(), path.begin() + ncpath);
+    t_depth rel_depth = src.last_level() - last_level();
+    std::vector<t_uindex> r_leaves;
+    src.get_drd_indices(r_ptidx, rel_depth, r_leaves);
+
+    t_tscalvec rval;
+    for (auto r_leaf : r_leaves)
+    {
+        t_ptidx c_ptidx = src.resolve_path(r_leaf, c_path);
+        if (c_ptidx == INVALID_INDEX)
+            continue;
+        auto pkeys = src.get_pkeys(c_ptidx);
+        rval.insert(rval.end(), pkeys.begin(), pkeys.end());
+    }
+    return rval;
+}
+
 std::vector<t_uindex>
 t_stree::get_leaves(t_uindex idx) const
 {
@@ -2056,6 +2337,9 @@ t_stree::get_child_idx_depth(t_uindex idx) const
 void
 t_stree::populate_leaf_index(const std::set<t_uindex>& leaves)
 {
+    if (m_p->m_pkey_src)
+        return;
+
     for (auto nidx : leaves)
     {
         std::vector<t_uindex> ancestry = get_ancestry(nidx);
@@ -2238,7 +2522,7 @@ t_stree::get_child_indices(t_ptidx idx, std::vector<t_ptidx>& out_data) const
 void
 t_stree::clear_deltas()
 {
-    m_p->m_deltas->clear();
+    m_p->m_deltas.clear();
     m_p->m_has_delta = false;
 }
 
@@ -2246,6 +2530,7 @@ void
 t_stree::clear()
 {
     m_p->m_nodes->clear();
+    m_p->reindex_minmax();
     clear_deltas();
 }
 
@@ -2265,11 +2550,26 @@ void
 t_stree::set_minmax_enabled(bool enabled_state)
 {
     m_p->m_features[CTX_FEAT_MINMAX] = enabled_state;
+    m_p->reindex_minmax();
+}
+
+void
+t_stree::set_pkey_source(t_stree_csptr src, t_depth nrow_pivots)
+{
+    PSP_VERBOSE_ASSERT(
+        m_p->m_idxpkey->empty(), "Tree already has a pkey index");
+    m_p->m_pkey_src = src;
+    m_p->m_nrow_pivots = nrow_pivots;
 }
 
 void
 t_stree::set_feature_state(t_ctx_feature feature, t_bool state)
 {
+    if (feature == CTX_FEAT_MINMAX)
+    {
+        set_minmax_enabled(state);
+        return;
+    }
     m_p->m_features[feature] = state;
 }
 
@@ -2287,6 +2587,8 @@ t_stree::get_agg_min_max(ITER_T biter, ITER_T eiter, t_uindex aggidx) const
             continue;
         t_uindex aggidx = iter->m_aggidx;
         t_tscalar v = col->get_scalar(aggidx);
+        if (!v.is_valid())
+            continue;
 
         if (minmax.m_min.is_none())
         {
@@ -2312,6 +2614,24 @@ t_stree::get_agg_min_max(ITER_T biter, ITER_T eiter, t_uindex aggidx) const
 t_minmax
 t_stree::get_agg_min_max(t_uindex aggidx, t_depth depth) const
 {
+    if (m_p->minmax_enabled())
+    {
+        t_minmax rval;
+        const auto& depths = m_p->m_minmax_values[aggidx];
+        if (depth > 0 && t_uindex(depth) < depths.size())
+        {
+            const auto& counts = depths[depth];
+            if (!counts.empty())
+            {
+                rval.m_min = counts.begin()->first;
+                rval.m_min_count = counts.begin()->second;
+                rval.m_max = counts.rbegin()->first;
+                rval.m_max_count = counts.rbegin()->second;
+            }
+        }
+        return rval;
+    }
+
     auto iterators = m_p->m_nodes->get<by_depth>().equal_range(depth);
     return get_agg_min_max(iterators.first, iterators.second, aggidx);
 }
@@ -2321,9 +2641,42 @@ t_stree::get_min_max() const
 {
     t_uindex naggs = m_p->m_aggspecs.size();
     t_minmaxvec rval(naggs);
-    for (t_uindex cidx = 0; cidx < naggs; ++cidx)
+
+    if (m_p->minmax_enabled())
     {
+        for (t_uindex cidx = 0; cidx < naggs; ++cidx)
+        {
+            t_minmax& mm = rval[cidx];
+            for (t_uindex depth = 1,
+                          loop_end = m_p->m_minmax_values[cidx].size();
+                 depth < loop_end; ++depth)
+            {
+                auto dmm = get_agg_min_max(cidx, depth);
+                if (dmm.m_min.is_none())
+                    continue;
+
+                if (mm.m_min.is_none() || dmm.m_min < mm.m_min)
+                {
+                    mm.m_min = dmm.m_min;
+                    mm.m_min_count = 0;
+                }
+                if (dmm.m_min == mm.m_min)
+                    mm.m_min_count += dmm.m_min_count;
+
+                if (mm.m_max.is_none() || mm.m_max < dmm.m_max)
+                {
+                    mm.m_max = dmm.m_max;
+                    mm.m_max_count = 0;
+                }
+                if (dmm.m_max == mm.m_max)
+                    mm.m_max_count += dmm.m_max_count;
+            }
+        }
+        return rval;
+    }
 
+    for (t_uindex cidx = 0; cidx < naggs; ++cidx)
+    {
         auto biter = m_p->m_nodes->get<by_idx>().begin();
         auto eiter = m_p->m_nodes->get<by_idx>().end();
         rval[cidx] = get_agg_min_max(biter, eiter, cidx);
@@ -2331,12 +2684,18 @@ t_stree::get_min_max() const
     return rval;
 }
 
-const t_sptr_tcdeltas&
+const t_cell_deltas&
 t_stree::get_deltas() const
 {
     return m_p->m_deltas;
 }
 
+t_cell_deltas&
+t_stree::get_deltas()
+{
+    return m_p->m_deltas;
+}
+
 t_tscalar
 t_stree::first_last_helper(
     t_uindex nidx, const t_aggspec& spec, const t_gstate& gstate) const
@@ -2499,6 +2858,36 @@ t_stree::dfs() const
     return t_dfs_iter<t_stree>(this);
 }
 
+t_mem_usage
+t_stree::get_memory_usage() const
+{
+    t_mem_usage rv("tree");
+    if (!m_p->m_init)
+        return rv;
+
+    // three ordered and two hashed indices per node
+    const t_treenodes& nodes = *m_p->m_nodes;
+    t_uindex node_bytes = nodes.size()
+        * (sizeof(t_stnode) + 3 * PSP_MEM_ORDERED_NODE_BYTES
+              + 2 * PSP_MEM_HASHED_NODE_BYTES);
+    t_uindex bucket_bytes = (nodes.get<by_depth>().bucket_count()
+                                + nodes.get<by_nstrands>().bucket_count())
+        * sizeof(void*);
+    rv.add("nodes", node_bytes, node_bytes + bucket_bytes);
+
+    rv.add(mem_usage_ordered("idxpkey", *m_p->m_idxpkey));
+    rv.add(mem_usage_ordered("idxleaf", *m_p->m_idxleaf));
+    rv.add(m_p->m_aggregates->get_memory_usage("aggregates"));
+    rv.add(m_p->m_deltas.get_memory_usage());
+    rv.add(mem_usage_vector("agg_freelist", m_p->m_agg_freelist));
+    rv.add(mem_usage_ordered("newids", m_p->m_newids));
+    rv.add(mem_usage_ordered("newleaves", m_p->m_newleaves));
+    rv.add(mem_usage_ordered("smap", m_p->m_smap));
+    rv.add(mem_usage_vector("minmax", m_p->m_minmax));
+    rv.add(m_p->m_symtable.get_memory_usage());
+    return rv;
+}
+
 void
 t_stree::pprint() const
 {
@@ -9,28 +9,209 @@
 
 #include <perspective/first.h>
 #include <perspective/step_delta.h>
+#include <algorithm>
 
 namespace perspective
 {
 
 // Deltas for various contexts
 
-t_zcdelta::t_zcdelta(
-    t_tscalar pkey, t_index colidx, t_tscalar old_value, t_tscalar new_value)
-    : m_pkey(pkey)
-    , m_colidx(colidx)
-    , m_old_value(old_value)
-    , m_new_value(new_value)
+const t_uindex t_cell_deltas::m_npos;
+
+t_cell_deltas::t_cell_deltas()
+    : m_ncols(0)
+    , m_nwords(0)
+    , m_ncells(0)
+    , m_nuncaptured(0)
+    , m_filtered(false)
+{
+}
+
+void
+t_cell_deltas::init(t_uindex ncols)
+{
+    m_ncols = ncols;
+    m_nwords = (ncols + 63) / 64;
+    m_row_slots.clear();
+    m_rows.clear();
+    m_masks.clear();
+    m_old_values = std::vector<t_tscalvec>(ncols);
+    m_new_values = std::vector<t_tscalvec>(ncols);
+    m_ncells = 0;
+    clear_filter();
+    m_nuncaptured = 0;
+}
+
+void
+t_cell_deltas::clear()
+{
+    for (auto ridx : m_rows)
+    {
+        m_row_slots[ridx] = m_npos;
+    }
+    m_rows.clear();
+    m_masks.clear();
+    for (t_uindex cidx = 0; cidx < m_ncols; ++cidx)
+    {
+        m_old_values[cidx].clear();
+        m_new_values[cidx].clear();
+    }
+    m_ncells = 0;
+    m_nuncaptured = 0;
+}
+
+t_bool
+t_cell_deltas::empty() const
+{
+    return m_ncells == 0 && m_nuncaptured == 0;
+}
+
+t_uindex
+t_cell_deltas::size() const
+{
+    return m_ncells;
+}
+
+void
+t_cell_deltas::insert(t_uindex ridx, t_uindex colidx,
+    const t_tscalar& old_value, const t_tscalar& new_value)
+{
+    PSP_VERBOSE_ASSERT(colidx < m_ncols, "Column out of bounds");
+
+    if (m_filtered
+        && (ridx >= m_filter_rows.size() || !m_filter_rows[ridx]
+               || (!m_filter_columns.empty() && !m_filter_columns[colidx])))
+    {
+        ++m_nuncaptured;
+        return;
+    }
+
+    if (ridx >= m_row_slots.size())
+    {
+        m_row_slots.resize(
+            std::max<t_uindex>(ridx + 1, m_row_slots.size() * 2), m_npos);
+    }
+
+    t_uindex slot = m_row_slots[ridx];
+    if (slot == m_npos)
+    {
+        slot = m_rows.size();
+        m_row_slots[ridx] = slot;
+        m_rows.push_back(ridx);
+        m_masks.resize(m_masks.size() + m_nwords, 0);
+    }
+
+    t_uint64& word = m_masks[slot * m_nwords + colidx / 64];
+    t_uint64 bit = t_uint64(1) << (colidx % 64);
+    if (word & bit)
+        return;
+
+    word |= bit;
+    // Only the buffers of columns that changed grow, up to the last
+    // slot that changed them
+    if (slot >= m_old_values[colidx].size())
+    {
+        m_old_values[colidx].resize(slot + 1);
+        m_new_values[colidx].resize(slot + 1);
+    }
+    m_old_values[colidx][slot] = old_value;
+    m_new_values[colidx][slot] = new_value;
+    ++m_ncells;
+}
+
+t_bool
+t_cell_deltas::has_row(t_uindex ridx) const
 {
+    return get_slot(ridx) != m_npos;
 }
 
-t_tcdelta::t_tcdelta(
-    t_uindex nidx, t_uindex aggidx, t_tscalar old_value, t_tscalar new_value)
-    : m_nidx(nidx)
-    , m_aggidx(aggidx)
-    , m_old_value(old_value)
-    , m_new_value(new_value)
+void
+t_cell_deltas::set_filter(
+    const std::vector<t_uindex>& rows, const std::vector<t_bool>& columns)
 {
+    clear_filter();
+    m_filtered = true;
+    for (auto ridx : rows)
+    {
+        if (ridx >= m_filter_rows.size())
+        {
+            m_filter_rows.resize(
+                std::max<t_uindex>(ridx + 1, m_filter_rows.size() * 2), 0);
+        }
+        if (!m_filter_rows[ridx])
+        {
+            m_filter_rows[ridx] = 1;
+            m_filter_list.push_back(ridx);
+        }
+    }
+    m_filter_columns = columns;
+}
+
+void
+t_cell_deltas::clear_filter()
+{
+    for (auto ridx : m_filter_list)
+    {
+        m_filter_rows[ridx] = 0;
+    }
+    m_filter_list.clear();
+    m_filter_columns.clear();
+    m_filtered = false;
+}
+
+t_bool
+t_cell_deltas::is_filtered() const
+{
+    return m_filtered;
+}
+
+const std::vector<t_uindex>&
+t_cell_deltas::get_rows() const
+{
+    return m_rows;
+}
+
+void
+t_cell_deltas::remap_rows(const std::vector<t_uidxpair>& moves)
+{
+    for (const auto& move : moves)
+    {
+        t_uindex from_slot = get_slot(move.first);
+        t_uindex to_slot = get_slot(move.second);
+        if (from_slot == m_npos && to_slot == m_npos)
+            continue;
+
+        t_uindex nslots = std::max(move.first, move.second) + 1;
+        if (nslots > m_row_slots.size())
+            m_row_slots.resize(nslots, m_npos);
+
+        m_row_slots[move.first] = to_slot;
+        m_row_slots[move.second] = from_slot;
+        if (from_slot != m_npos)
+            m_rows[from_slot] = move.second;
+        if (to_slot != m_npos)
+            m_rows[to_slot] = move.first;
+    }
+}
+
+t_mem_usage
+t_cell_deltas::get_memory_usage() const
+{
+    t_mem_usage rv("deltas");
+    rv.add(mem_usage_vector("row_slots", m_row_slots));
+    rv.add(mem_usage_vector("rows", m_rows));
+    rv.add(mem_usage_vector("masks", m_masks));
+    t_uindex size = 0;
+    t_uindex capacity = 0;
+    for (t_uindex cidx = 0; cidx < m_ncols; ++cidx)
+    {
+        size += m_old_values[cidx].size() + m_new_values[cidx].size();
+        capacity
+            += m_old_values[cidx].capacity() + m_new_values[cidx].capacity();
+    }
+    rv.add("values", size * sizeof(t_tscalar), capacity * sizeof(t_tscalar));
+    rv.add(mem_usage_vector("filter_rows", m_filter_rows));
+    return rv;
 }
 
 t_cellupd::t_cellupd(t_index row, t_index column, const t_tscalar& old_value,
@@ -44,6 +225,22 @@ t_cellupd::t_cellupd(t_index row, t_index column, const t_tscalar& old_value,
 
 t_cellupd::t_cellupd() {}
 
+t_viewport::t_viewport()
+    : m_bidx(0)
+    , m_eidx(0)
+    , m_bcol(0)
+    , m_ecol(0)
+{
+}
+
+t_viewport::t_viewport(t_tvidx bidx, t_tvidx eidx, t_tvidx bcol, t_tvidx ecol)
+    : m_bidx(bidx)
+    , m_eidx(eidx)
+    , m_bcol(bcol)
+    , m_ecol(ecol)
+{
+}
+
 t_stepdelta::t_stepdelta() {}
 
 t_stepdelta::t_stepdelta(
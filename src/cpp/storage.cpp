@@ -25,6 +25,8 @@ SUPPRESS_WARNINGS_VC(4505)
 #include <perspective/storage.h>
 #include <perspective/utils.h>
 #include <perspective/env_vars.h>
+#include <perspective/logtime.h>
+#include <mutex>
 #include <sstream>
 #include <vector>
 #include <fstream>
@@ -210,6 +212,8 @@ t_lstore::copy_helper_(const t_lstore& other)
     m_resize_factor = other.m_resize_factor;
     m_version = other.m_version;
     m_from_recipe = other.m_from_recipe;
+    m_chunks.clear();
+    m_allocs.clear();
     PSP_CHECK_CAPACITY();
 }
 
@@ -233,6 +237,134 @@ t_lstore::operator=(t_lstore&& other)
     return *this;
 }
 
+namespace
+{
+
+const t_uindex LSTORE_POOL_MIN_SHIFT = 6;
+const t_uindex LSTORE_POOL_MAX_SHIFT = 22;
+const t_uindex LSTORE_POOL_MAX_BYTES = t_uindex(256) << 20;
+
+// Buffers of in-memory stores are kept when a store is destroyed and
+// handed to the next store that needs one of similar size. The
+// flattened table and other per-tick tables are rebuilt every tick
+// at much the same sizes, so after the first few ticks they stop
+// hitting the system allocator. Buffers are binned by power of two
+// size, and the pool holds a bounded number of bytes. Buffers over
+// 4MB are left to realloc, which can grow them without copying.
+class t_lstore_pool
+{
+public:
+    t_lstore_pool()
+        : m_held(0)
+        , m_free(LSTORE_POOL_MAX_SHIFT + 1)
+    {
+    }
+
+    // Returns a zeroed buffer of at least nbytes, and sets nbytes to
+    // its usable size
+    void*
+    acquire(t_uindex& nbytes)
+    {
+        t_uindex shift = LSTORE_POOL_MIN_SHIFT;
+        while ((t_uindex(1) << shift) < nbytes)
+            ++shift;
+
+        if (shift > LSTORE_POOL_MAX_SHIFT)
+        {
+            psp_count_alloc();
+            return calloc(size_t(nbytes), 1);
+        }
+
+        t_uindex cbytes = t_uindex(1) << shift;
+        void* rv = 0;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            auto& bin = m_free[shift];
+            if (!bin.empty())
+            {
+                rv = bin.back();
+                bin.pop_back();
+                m_held -= cbytes;
+            }
+        }
+
+        if (rv)
+        {
+            memset(rv, 0, size_t(cbytes));
+            psp_count_reuse();
+        }
+        else
+        {
+            rv = calloc(size_t(cbytes), 1);
+            psp_count_alloc();
+        }
+
+        nbytes = cbytes;
+        return rv;
+    }
+
+    // Moves the first obytes of ptr to a zeroed buffer of at least
+    // nbytes, and sets nbytes to its usable size
+    void*
+    grow(void* ptr, t_uindex obytes, t_uindex& nbytes)
+    {
+        if (nbytes > (t_uindex(1) << LSTORE_POOL_MAX_SHIFT))
+        {
+            psp_count_alloc();
+            void* rv = realloc(ptr, size_t(nbytes));
+            if (rv)
+                memset(static_cast<t_uchar*>(rv) + obytes, 0,
+                    size_t(nbytes - obytes));
+            return rv;
+        }
+
+        void* rv = acquire(nbytes);
+        memcpy(rv, ptr, size_t(obytes));
+        release(ptr, obytes);
+        return rv;
+    }
+
+    // Takes a buffer of at least nbytes, freeing it if it is too
+    // small or too large to pool or the pool is full
+    void
+    release(void* ptr, t_uindex nbytes)
+    {
+        t_uindex shift = 0;
+        while ((t_uindex(2) << shift) <= nbytes)
+            ++shift;
+
+        if (shift >= LSTORE_POOL_MIN_SHIFT && shift <= LSTORE_POOL_MAX_SHIFT)
+        {
+            t_uindex cbytes = t_uindex(1) << shift;
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (m_held + cbytes <= LSTORE_POOL_MAX_BYTES)
+            {
+                m_free[shift].push_back(ptr);
+                m_held += cbytes;
+                return;
+            }
+        }
+
+        free(ptr);
+    }
+
+private:
+    std::mutex m_mutex;
+    t_uindex m_held;
+    std::vector<std::vector<void*>> m_free;
+};
+
+t_lstore_pool&
+get_lstore_pool()
+{
+    // Leaked deliberately so stores destroyed during static teardown
+    // can still release into it
+    static t_lstore_pool* pool = new t_lstore_pool;
+    return *pool;
+}
+
+} // end anonymous namespace
+
 t_lstore::~t_lstore()
 {
     PSP_TRACE_SENTINEL();
@@ -263,6 +395,11 @@ t_lstore::~t_lstore()
             }
             else
 #endif // _MSC_VER
+            if (m_alignment < 2)
+            {
+                get_lstore_pool().release(m_base, m_capacity);
+            }
+            else
             {
                 free(m_base);
             }
@@ -272,6 +409,11 @@ t_lstore::~t_lstore()
 #endif
         }
         break;
+        case BACKING_STORE_CHUNKED:
+        {
+            free_chunks();
+        }
+        break;
         default:
         {
             PSP_VERBOSE_ASSERT(false, "Unknown backing store");
@@ -317,7 +459,9 @@ t_lstore::init()
 
             if (m_alignment < 2)
             {
-                m_base = calloc(alloc_size, 1);
+                t_uindex nbytes = alloc_size;
+                m_base = get_lstore_pool().acquire(nbytes);
+                m_capacity = nbytes;
             }
             else
             {
@@ -333,6 +477,7 @@ t_lstore::init()
                 if (result != 0)
                     m_base = nullptr;
 #endif
+                psp_count_alloc();
 
                 PSP_VERBOSE_ASSERT(m_base,
                     "MALLOC_FAILED"); // ensure we check before trying to
@@ -343,6 +488,13 @@ t_lstore::init()
             PSP_VERBOSE_ASSERT(m_base, "MALLOC_FAILED");
         }
         break;
+        case BACKING_STORE_CHUNKED:
+        {
+            t_uindex capacity = m_capacity;
+            m_capacity = 0;
+            reserve_chunks(capacity, false);
+        }
+        break;
         default:
         {
             PSP_VERBOSE_ASSERT(false, "Unknown backing store");
@@ -377,6 +529,12 @@ t_lstore::reserve_impl(t_uindex capacity, bool allow_shrink)
         capacity >= m_size, "reduce size before reducing capacity!");
     capacity = std::max(capacity, m_size);
 
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+    {
+        reserve_chunks(capacity, allow_shrink);
+        return;
+    }
+
     capacity = 4 * t_uint64(ceil(t_float64(capacity * m_resize_factor) / 4));
     capacity = std::max(capacity, static_cast<t_uindex>(8));
     if (m_alignment > 1)
@@ -395,9 +553,14 @@ t_lstore::reserve_impl(t_uindex capacity, bool allow_shrink)
         {
             void* base = 0;
 
-            if (m_alignment < 2)
+            if (m_alignment < 2 && capacity > ocapacity)
+            {
+                base = get_lstore_pool().grow(m_base, ocapacity, capacity);
+            }
+            else if (m_alignment < 2)
             {
                 base = realloc(m_base, size_t(capacity));
+                psp_count_alloc();
             }
             else
             {
@@ -421,11 +584,13 @@ t_lstore::reserve_impl(t_uindex capacity, bool allow_shrink)
                         size_t(capacity));
                     PSP_VERBOSE_ASSERT(result == 0, "posix_memalign failed");
                     PSP_UNUSED(result);
-                    memcpy(aligned_base, base, ocapacity);
+                    memcpy(aligned_base, base,
+                        std::min(ocapacity, capacity));
                     free(base);
                     base = aligned_base;
                 }
 #endif
+                psp_count_alloc();
             }
 
             PSP_VERBOSE_ASSERT(base != 0, "realloc failed");
@@ -459,6 +624,152 @@ t_lstore::reserve_impl(t_uindex capacity, bool allow_shrink)
     }
 }
 
+void*
+t_lstore::alloc_chunk(t_uindex nbytes)
+{
+    void* rv = 0;
+    psp_count_alloc();
+    if (m_alignment < 2)
+    {
+        rv = calloc(size_t(nbytes), 1);
+    }
+    else
+    {
+        PSP_VERBOSE_ASSERT(!(m_alignment & (m_alignment - 1)),
+            "store alignment must be a power of two!");
+#ifdef _MSC_VER
+        rv = _aligned_malloc(size_t(nbytes), size_t(m_alignment));
+#else
+        if (posix_memalign(&rv, std::max(sizeof(void*), size_t(m_alignment)),
+                size_t(nbytes))
+            != 0)
+            rv = 0;
+#endif
+        if (rv)
+            memset(rv, 0, size_t(nbytes));
+    }
+    PSP_VERBOSE_ASSERT(rv, "MALLOC_FAILED");
+    return rv;
+}
+
+void
+t_lstore::free_chunk(void* ptr)
+{
+#ifdef _MSC_VER
+    if (m_alignment >= 2)
+    {
+        _aligned_free(ptr);
+        return;
+    }
+#endif
+    free(ptr);
+}
+
+void
+t_lstore::free_chunks()
+{
+    for (auto ptr : m_allocs)
+    {
+        free_chunk(ptr);
+    }
+    m_allocs.clear();
+    m_chunks.clear();
+    m_base = 0;
+}
+
+// Grows by allocating only the missing chunks, as one allocation so
+// that data larger than a chunk placed there stays contiguous.
+// Existing chunks are never moved or copied.
+void
+t_lstore::reserve_chunks(t_uindex capacity, bool allow_shrink)
+{
+    t_uindex nchunks = std::max(t_uindex(1),
+        (capacity + PSP_LSTORE_CHUNK_MASK) >> PSP_LSTORE_CHUNK_SHIFT);
+    t_uindex ochunks = m_chunks.size();
+
+    if (t_env::log_storage_resize())
+    {
+        std::cout << repr() << " ochunks => " << ochunks << " nchunks => "
+                  << nchunks << std::endl;
+    }
+
+    if (nchunks > ochunks)
+    {
+        auto base = static_cast<t_uchar*>(
+            alloc_chunk((nchunks - ochunks) << PSP_LSTORE_CHUNK_SHIFT));
+        m_allocs.push_back(base);
+        for (t_uindex idx = ochunks; idx < nchunks; ++idx)
+        {
+            m_chunks.push_back(
+                base + ((idx - ochunks) << PSP_LSTORE_CHUNK_SHIFT));
+        }
+    }
+    else if (allow_shrink)
+    {
+        // Release trailing allocations lying wholly past nchunks
+        while (m_allocs.size() > 1)
+        {
+            t_uindex first = m_chunks.size() - 1;
+            while (m_chunks[first] != m_allocs.back())
+                --first;
+            if (first < nchunks)
+                break;
+            free_chunk(m_allocs.back());
+            m_allocs.pop_back();
+            m_chunks.resize(first);
+        }
+    }
+
+    t_unlock_store tmp(this);
+    m_base = m_chunks.front();
+    m_capacity = m_chunks.size() << PSP_LSTORE_CHUNK_SHIFT;
+    if (m_chunks.size() != ochunks)
+        ++m_version;
+}
+
+t_bool
+t_lstore::is_chunked() const
+{
+    return m_backing_store == BACKING_STORE_CHUNKED;
+}
+
+t_bool
+t_lstore::is_contiguous() const
+{
+    return !is_chunked() || m_chunks.size() <= 1;
+}
+
+t_uindex
+t_lstore::get_nchunks() const
+{
+    return is_chunked() ? m_chunks.size() : 1;
+}
+
+t_uindex
+t_lstore::contiguous_bytes(t_uindex offset) const
+{
+    if (is_chunked())
+        return PSP_LSTORE_CHUNK_SIZE - (offset & PSP_LSTORE_CHUNK_MASK);
+    return offset < m_capacity ? m_capacity - offset : 0;
+}
+
+void
+t_lstore::copy_bytes(t_uindex dst_offset, const t_lstore& src,
+    t_uindex src_offset, t_uindex len)
+{
+    while (len > 0)
+    {
+        t_uindex n = std::min(len,
+            std::min(contiguous_bytes(dst_offset),
+                src.contiguous_bytes(src_offset)));
+        PSP_VERBOSE_ASSERT(n > 0, "Copy out of bounds");
+        memcpy(get_ptr(dst_offset), src.get_ptr(src_offset), size_t(n));
+        dst_offset += n;
+        src_offset += n;
+        len -= n;
+    }
+}
+
 void
 t_lstore::copy(t_lstore& out)
 {
@@ -501,6 +812,32 @@ void
 t_lstore::push_back(const void* ptr, t_uindex len)
 {
     PSP_TRACE_SENTINEL();
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+    {
+        // Keep the bytes contiguous. Data that does not fit in the
+        // current chunk starts the next one, and data larger than a
+        // chunk starts a fresh allocation past the reserved chunks.
+        t_uindex room
+            = PSP_LSTORE_CHUNK_SIZE - (m_size & PSP_LSTORE_CHUNK_MASK);
+        t_uindex size = m_size;
+        if (len > PSP_LSTORE_CHUNK_SIZE)
+            size = std::max(m_size, m_capacity);
+        else if (len > room)
+            size = m_size + room;
+
+        if (size + len > m_capacity)
+            reserve(size + len);
+
+        memcpy(chunk_ptr(size), ptr, size_t(len));
+
+        {
+            t_unlock_store tmp(this);
+            m_size = size + len;
+        }
+        PSP_CHECK_CAPACITY();
+        return;
+    }
+
     if (m_size + len >= m_capacity)
     {
         reserve(static_cast<t_uindex>(m_size
@@ -522,6 +859,8 @@ void*
 t_lstore::get_ptr(t_uindex offset)
 {
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+        return chunk_ptr(offset);
     return static_cast<void*>(static_cast<t_uchar*>(m_base) + offset);
 }
 
@@ -529,6 +868,8 @@ const void*
 t_lstore::get_ptr(t_uindex offset) const
 {
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+        return chunk_ptr(offset);
     return static_cast<void*>(static_cast<t_uchar*>(m_base) + offset);
 }
 
@@ -553,7 +894,16 @@ t_lstore::append(const t_lstore& other)
 {
     PSP_TRACE_SENTINEL();
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
-    push_back(other.m_base, other.size());
+    if (!is_chunked() && other.is_contiguous())
+    {
+        push_back(other.m_base, other.size());
+        return;
+    }
+
+    t_uindex size = m_size;
+    reserve(size + other.size());
+    copy_bytes(size, other, 0, other.size());
+    set_size(size + other.size());
 }
 
 void
@@ -561,7 +911,17 @@ t_lstore::clear()
 {
     PSP_TRACE_SENTINEL();
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
-    memset(m_base, 0, size_t(capacity()));
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+    {
+        for (auto chunk : m_chunks)
+        {
+            memset(chunk, 0, size_t(PSP_LSTORE_CHUNK_SIZE));
+        }
+    }
+    else
+    {
+        memset(m_base, 0, size_t(capacity()));
+    }
     {
         t_unlock_store tmp(this);
         m_size = 0;
@@ -588,12 +948,152 @@ t_lstore::fill(const t_lstore& other)
     PSP_TRACE_SENTINEL();
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
     reserve(other.size());
-    memcpy(m_base, const_cast<void*>(other.m_base), size_t(other.size()));
+    copy_bytes(0, other, 0, other.size());
     set_size(other.size());
 }
 
+namespace
+{
+
+struct t_elem16
+{
+    t_uint64 m_lo;
+    t_uint64 m_hi;
+};
+
+// Runs shorter than this are copied element by element rather
+// than through memcpy
+static const t_uindex PSP_MASK_COPY_MEMCPY_THRESHOLD = 16;
+
+// Partial mask words with at least this many set bits and a few
+// gaps are compacted branch free; nearly full words have few runs
+// and are cheaper to copy run by run.
+static const t_uindex PSP_MASK_COPY_BRANCHLESS_THRESHOLD = 12;
+static const t_uindex PSP_MASK_COPY_BRANCHLESS_MIN_UNSET = 4;
+
+template <typename T>
+inline void
+copy_span(T* dst, const T* src, t_uindex n)
+{
+    if (n >= PSP_MASK_COPY_MEMCPY_THRESHOLD)
+    {
+        memcpy(dst, src, size_t(n * sizeof(T)));
+        return;
+    }
+
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        dst[idx] = src[idx];
+    }
+}
+
+// Compacts the elements of src selected by mask into dst, and the
+// status bytes of src_status into dst_status when non null. Dense
+// masks are processed a word at a time: all set words are copied
+// as a 64 element span, empty words are skipped and partial words
+// are either compacted branch free or split into runs. Returns the
+// number of elements written.
+template <typename T>
+t_uindex
+mask_compact(const T* src, T* dst, const t_status* src_status,
+    t_status* dst_status, const t_mask& mask)
+{
+    t_uindex offset = 0;
+
+    if (mask.get_mode() != MASK_MODE_DENSE)
+    {
+        mask.for_each_run([&](t_uindex bidx, t_uindex eidx) {
+            t_uindex n = eidx - bidx;
+            copy_span(dst + offset, src + bidx, n);
+            if (dst_status)
+                copy_span(dst_status + offset, src_status + bidx, n);
+            offset += n;
+        });
+        return offset;
+    }
+
+    const t_uint64* words = mask.get_words();
+
+    for (t_uindex widx = 0, loop_end = mask.get_nwords(); widx < loop_end;
+         ++widx)
+    {
+        t_uint64 w = words[widx];
+        if (!w)
+            continue;
+
+        t_uindex base = widx * 64;
+
+        if (w == ~t_uint64(0))
+        {
+            copy_span(dst + offset, src + base, 64);
+            if (dst_status)
+                copy_span(dst_status + offset, src_status + base, 64);
+            offset += 64;
+            continue;
+        }
+
+        t_uindex nset = psp_popcount64(w);
+        if (nset >= PSP_MASK_COPY_BRANCHLESS_THRESHOLD
+            && 64 - nset >= PSP_MASK_COPY_BRANCHLESS_MIN_UNSET)
+        {
+            // Many short runs; copy every element unconditionally and
+            // advance the output only past selected ones. dst has room
+            // for mask.size() elements so the overwrite is in bounds.
+            const T* wsrc = src + base;
+            T* wdst = dst + offset;
+            t_uindex nbits = std::min(t_uindex(64), mask.size() - base);
+            t_uindex n = 0;
+            for (t_uindex bit = 0; bit < nbits; ++bit)
+            {
+                wdst[n] = wsrc[bit];
+                n += (w >> bit) & 1;
+            }
+
+            if (dst_status)
+            {
+                const t_status* ssrc = src_status + base;
+                t_status* sdst = dst_status + offset;
+                t_uindex sn = 0;
+                for (t_uindex bit = 0; bit < nbits; ++bit)
+                {
+                    sdst[sn] = ssrc[bit];
+                    sn += (w >> bit) & 1;
+                }
+            }
+
+            offset += n;
+            continue;
+        }
+
+        while (w)
+        {
+            t_uindex bit = psp_ctz64(w);
+            t_uint64 shifted = ~(w >> bit);
+            t_uindex len = shifted ? psp_ctz64(shifted) : 64 - bit;
+
+            copy_span(dst + offset, src + base + bit, len);
+            if (dst_status)
+                copy_span(dst_status + offset, src_status + base + bit, len);
+            offset += len;
+
+            w = bit + len == 64 ? 0 : w & (~t_uint64(0) << (bit + len));
+        }
+    }
+
+    return offset;
+}
+
+} // end anonymous namespace
+
 void
 t_lstore::fill(const t_lstore& other, const t_mask& mask, t_uindex elem_size)
+{
+    fill(other, mask, elem_size, nullptr, nullptr);
+}
+
+void
+t_lstore::fill(const t_lstore& other, const t_mask& mask, t_uindex elem_size,
+    t_lstore* status, const t_lstore* other_status)
 {
     PSP_TRACE_SENTINEL();
     PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
@@ -602,22 +1102,100 @@ t_lstore::fill(const t_lstore& other, const t_mask& mask, t_uindex elem_size)
     PSP_VERBOSE_ASSERT(
         mask.size() * elem_size <= m_size, "Not enough space to fill");
 
-    t_uindex offset = 0;
+    if (status)
+    {
+        PSP_VERBOSE_ASSERT(other_status, "Expected source status");
+        status->reserve(mask.size() * sizeof(t_status));
+    }
+
+    if (!is_contiguous() || !other.is_contiguous()
+        || (status
+               && (!status->is_contiguous() || !other_status->is_contiguous())))
+    {
+        // Chunked stores, copy runs split at chunk boundaries
+        t_uindex count = 0;
+        mask.for_each_run([&](t_uindex bidx, t_uindex eidx) {
+            t_uindex n = eidx - bidx;
+            copy_bytes(count * elem_size, other, bidx * elem_size,
+                n * elem_size);
+            if (status)
+                status->copy_bytes(count * sizeof(t_status), *other_status,
+                    bidx * sizeof(t_status), n * sizeof(t_status));
+            count += n;
+        });
+        set_size(count * elem_size);
+        if (status)
+            status->set_size(count * sizeof(t_status));
+        return;
+    }
+
+    const void* src = other.get_ptr(0);
+    void* dst = m_base;
+
+    const t_status* src_status = nullptr;
+    t_status* dst_status = nullptr;
+
+    if (status)
+    {
+        src_status = static_cast<const t_status*>(other_status->get_ptr(0));
+        dst_status = static_cast<t_status*>(status->get_ptr(0));
+    }
 
-    auto src_base = reinterpret_cast<const t_char*>(other.get_ptr(0));
-    auto dst_base = reinterpret_cast<t_char*>(m_base);
+    t_uindex count = 0;
 
-    for (t_uindex idx = 0, loop_end = mask.size(); idx < loop_end; ++idx)
+    switch (elem_size)
     {
-        if (mask.get(idx))
+        case 1:
+        {
+            count = mask_compact(static_cast<const t_uint8*>(src),
+                static_cast<t_uint8*>(dst), src_status, dst_status, mask);
+        }
+        break;
+        case 2:
+        {
+            count = mask_compact(static_cast<const t_uint16*>(src),
+                static_cast<t_uint16*>(dst), src_status, dst_status, mask);
+        }
+        break;
+        case 4:
         {
-            memcpy(dst_base + offset, src_base + idx * elem_size,
-                size_t(elem_size));
-            offset += elem_size;
+            count = mask_compact(static_cast<const t_uint32*>(src),
+                static_cast<t_uint32*>(dst), src_status, dst_status, mask);
         }
+        break;
+        case 8:
+        {
+            count = mask_compact(static_cast<const t_uint64*>(src),
+                static_cast<t_uint64*>(dst), src_status, dst_status, mask);
+        }
+        break;
+        case 16:
+        {
+            count = mask_compact(static_cast<const t_elem16*>(src),
+                static_cast<t_elem16*>(dst), src_status, dst_status, mask);
+        }
+        break;
+        default:
+        {
+            auto src_base = static_cast<const t_char*>(src);
+            auto dst_base = static_cast<t_char*>(dst);
+
+            // Copy maximal runs of selected rows with one memcpy each
+            mask.for_each_run([&](t_uindex bidx, t_uindex eidx) {
+                t_uindex n = eidx - bidx;
+                memcpy(dst_base + count * elem_size,
+                    src_base + bidx * elem_size, size_t(n * elem_size));
+                if (dst_status)
+                    memcpy(dst_status + count, src_status + bidx, size_t(n));
+                count += n;
+            });
+        }
+        break;
     }
 
-    set_size(mask.count() * elem_size);
+    set_size(count * elem_size);
+    if (status)
+        status->set_size(count * sizeof(t_status));
 }
 
 void
@@ -635,6 +1213,12 @@ t_lstore::pprint() const
     }
 }
 
+t_mem_usage
+t_lstore::get_memory_usage(const t_str& name) const
+{
+    return t_mem_usage(name, m_size, m_init ? m_capacity : 0);
+}
+
 t_lstore_sptr
 t_lstore::clone() const
 {
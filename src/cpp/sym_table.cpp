@@ -11,25 +11,114 @@
 #include <perspective/base.h>
 #include <perspective/sym_table.h>
 #include <perspective/column.h>
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
 
 namespace perspective
 {
 
-std::mutex sym_table_mutex;
+static const t_uindex STRING_ARENA_BLOCK_SIZE = 64 * 1024;
 
-t_symtable::t_symtable() {}
+t_string_arena::t_string_arena()
+    : m_used(0)
+    , m_avail(0)
+    , m_size(0)
+    , m_capacity(0)
+{
+}
+
+t_string_arena::t_string_arena(t_string_arena&& other)
+    : m_blocks(std::move(other.m_blocks))
+    , m_used(other.m_used)
+    , m_avail(other.m_avail)
+    , m_size(other.m_size)
+    , m_capacity(other.m_capacity)
+{
+    other.m_blocks.clear();
+    other.m_used = 0;
+    other.m_avail = 0;
+    other.m_size = 0;
+    other.m_capacity = 0;
+}
+
+t_string_arena::~t_string_arena()
+{
+    clear();
+}
 
-t_symtable::~t_symtable()
+void
+t_string_arena::clear()
 {
-    for (auto& kv : m_mapping)
+    for (auto b : m_blocks)
     {
-        free(const_cast<char*>(kv.second));
+        free(b);
     }
+    m_blocks.clear();
+    m_used = 0;
+    m_avail = 0;
+    m_size = 0;
+    m_capacity = 0;
+}
+
+t_char*
+t_string_arena::copy(const t_char* s, t_uindex len, t_uindex prefix)
+{
+    t_uindex start = m_used;
+    if (prefix)
+        start = (start + prefix - 1) / prefix * prefix;
+
+    t_uindex needed = prefix + len + 1;
+    if (m_blocks.empty() || start + needed > m_avail)
+    {
+        t_uindex bsize = std::max(STRING_ARENA_BLOCK_SIZE, needed);
+        auto block = static_cast<t_char*>(malloc(bsize));
+        PSP_VERBOSE_ASSERT(block != 0, "Failed to allocate string arena");
+        m_blocks.push_back(block);
+        m_used = 0;
+        m_avail = bsize;
+        m_capacity += bsize;
+        start = 0;
+    }
+
+    t_char* rv = m_blocks.back() + start + prefix;
+    memcpy(rv, s, len);
+    rv[len] = 0;
+    m_used = start + needed;
+    m_size += len + 1;
+    return rv;
+}
+
+t_uindex
+t_string_arena::size() const
+{
+    return m_size;
 }
 
+t_uindex
+t_string_arena::capacity() const
+{
+    return m_capacity;
+}
+
+t_symtable::t_symtable() {}
+
+t_symtable::t_symtable(t_symtable&& other)
+    : m_mapping(std::move(other.m_mapping))
+    , m_arena(std::move(other.m_arena))
+{
+    other.m_mapping.clear();
+}
+
+t_symtable::~t_symtable() {}
+
 const t_char*
 t_symtable::get_interned_cstr(const t_char* s)
 {
@@ -40,7 +129,7 @@ t_symtable::get_interned_cstr(const t_char* s)
         return iter->second;
     }
 
-    auto scopy = strdup(s);
+    auto scopy = m_arena.copy(s, strlen(s));
     m_mapping[scopy] = scopy;
     return scopy;
 }
@@ -77,24 +166,456 @@ t_symtable::size() const
     return m_mapping.size();
 }
 
-static t_symtable*
-get_symtable()
+void
+t_symtable::clear()
+{
+    m_mapping.clear();
+    m_arena.clear();
+}
+
+t_mem_usage
+t_symtable::get_memory_usage() const
+{
+    t_mem_usage rv = mem_usage_hashed("symtable", m_mapping);
+    rv.m_size += m_arena.size();
+    rv.m_capacity += m_arena.capacity();
+    return rv;
+}
+
+namespace
+{
+
+const t_uindex INTERN_SHARD_BITS = 6;
+const t_uindex INTERN_NSHARDS = 1 << INTERN_SHARD_BITS;
+const t_uindex INTERN_INITIAL_SLOTS = 256;
+const t_uindex INTERN_BLOCK_SIZE = 4 * 1024;
+// Reference count of pinned strings, which are never released
+const t_uindex INTERN_PINNED = t_uindex(-1);
+
+// Marks the slot of a dropped string, so probes carry on past it
+const t_char g_intern_tombstone = 0;
+const t_char* const INTERN_TOMBSTONE = &g_intern_tombstone;
+
+// Storage of referenced strings, freed once none of them are left
+struct t_intern_block
+{
+    t_char* m_data;
+    t_uindex m_used;
+    t_uindex m_size;
+    t_uindex m_live;
+};
+
+// Stored just before each interned string
+struct t_intern_header
+{
+    // Null for strings pinned when interned, which live in the arena
+    t_intern_block* m_block;
+    std::atomic<t_uindex> m_refs;
+    t_uindex m_hash;
+};
+
+inline t_intern_header*
+intern_header(const t_char* s)
+{
+    return reinterpret_cast<t_intern_header*>(
+        const_cast<t_char*>(s) - sizeof(t_intern_header));
+}
+
+// Takes a reference on s, or pins it. Fails once s has lost its last
+// reference, it is then on its way out of the table.
+inline t_bool
+intern_ref(const t_char* s, t_bool pin)
+{
+    auto& refs = intern_header(s)->m_refs;
+    t_uindex r = refs.load();
+    while (true)
+    {
+        if (r == 0)
+            return false;
+        if (r == INTERN_PINNED)
+            return true;
+        if (refs.compare_exchange_weak(r, pin ? INTERN_PINNED : r + 1))
+            return true;
+    }
+}
+
+// Drops a reference on s. True if it was the last one.
+inline t_bool
+intern_unref(const t_char* s)
 {
-    static t_symtable* sym = 0;
+    auto& refs = intern_header(s)->m_refs;
+    t_uindex r = refs.load();
+    while (true)
+    {
+        if (r == INTERN_PINNED)
+            return false;
+        PSP_VERBOSE_ASSERT(r > 0, "Released an unreferenced string");
+        if (refs.compare_exchange_weak(r, r - 1))
+            return r == 1;
+    }
+}
+
+// Open addressed table of interned strings. Slots are written under
+// the shard lock and read without it.
+struct t_intern_table
+{
+    explicit t_intern_table(t_uindex nslots)
+        : m_mask(nslots - 1)
+        , m_slots(new std::atomic<const t_char*>[nslots])
+    {
+        for (t_uindex idx = 0; idx < nslots; ++idx)
+        {
+            m_slots[idx].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    t_uindex m_mask;
+    std::unique_ptr<std::atomic<const t_char*>[]> m_slots;
+};
+
+// Returns the slot holding s, or the empty slot it would go in
+inline t_uindex
+intern_probe(const t_intern_table* table, const t_char* s, t_uindex hash,
+    const t_char*& found)
+{
+    t_uindex idx = (hash >> INTERN_SHARD_BITS) & table->m_mask;
+    while (true)
+    {
+        const t_char* p =
+            table->m_slots[idx].load(std::memory_order_acquire);
+        if (!p)
+        {
+            found = 0;
+            return idx;
+        }
+        if (p != INTERN_TOMBSTONE && intern_header(p)->m_hash == hash
+            && strcmp(p, s) == 0)
+        {
+            found = p;
+            return idx;
+        }
+        idx = (idx + 1) & table->m_mask;
+    }
+}
+
+// Strings dropped from the table, and tables replaced by a rebuild,
+// may still be read by lookups that started before. They are retired
+// in the current epoch and freed once no lookup of that epoch is left.
+// Lookups count themselves in the reader count of their epoch's
+// parity, so the epoch only moves on once the readers of the one
+// before it are gone.
+class t_intern_shard
+{
+public:
+    t_intern_shard()
+        : m_table(new t_intern_table(INTERN_INITIAL_SLOTS))
+        , m_epoch(0)
+        , m_used(0)
+        , m_live(0)
+        , m_bytes(0)
+        , m_block(0)
+        , m_block_capacity(0)
+    {
+        m_readers[0].store(0);
+        m_readers[1].store(0);
+    }
+
+    // Looks s up and references or pins it, without locking
+    const t_char*
+    find(const t_char* s, t_uindex hash, t_bool pin)
+    {
+        t_uindex parity = enter();
+        const t_char* found;
+        intern_probe(m_table.load(std::memory_order_acquire), s, hash, found);
+        if (found && !intern_ref(found, pin))
+            found = 0;
+        leave(parity);
+        return found;
+    }
+
+    const t_char*
+    insert(const t_char* s, t_uindex hash, t_bool pin)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto table = m_table.load(std::memory_order_relaxed);
+        const t_char* found;
+        t_uindex idx = intern_probe(table, s, hash, found);
+        if (found)
+        {
+            // Its last reference may be gone, it is only dropped from
+            // the table under the lock
+            if (!intern_ref(found, pin))
+                intern_header(found)->m_refs.store(pin ? INTERN_PINNED : 1);
+            return found;
+        }
+
+        if ((m_used + 1) * 2 > table->m_mask + 1)
+        {
+            table = rebuild(table);
+            idx = intern_probe(table, s, hash, found);
+        }
+
+        t_uindex len = strlen(s);
+        t_char* scopy = pin ? m_arena.copy(s, len, sizeof(t_intern_header))
+                            : alloc(s, len);
+        auto header = new (scopy - sizeof(t_intern_header)) t_intern_header;
+        header->m_block = pin ? 0 : m_block;
+        header->m_refs.store(pin ? INTERN_PINNED : 1);
+        header->m_hash = hash;
+        table->m_slots[idx].store(scopy, std::memory_order_release);
+        ++m_used;
+        ++m_live;
+        m_bytes += len + 1;
+        return scopy;
+    }
+
+    void
+    release(const t_char* s)
+    {
+        // Keeps s from being freed by a release racing this one
+        t_uindex parity = enter();
+        if (intern_unref(s))
+            retire(s);
+        leave(parity);
+    }
+
+    void
+    add_memory_usage(t_uindex& size, t_uindex& capacity, t_uindex& tables)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        size += m_bytes;
+        capacity += m_arena.capacity() + m_block_capacity;
+        tables += (m_table.load()->m_mask + 1) * sizeof(const t_char*);
+    }
+
+private:
+    t_uindex
+    enter()
+    {
+        while (true)
+        {
+            t_uindex epoch = m_epoch.load();
+            m_readers[epoch & 1].fetch_add(1);
+            if (m_epoch.load() == epoch)
+                return epoch & 1;
+            m_readers[epoch & 1].fetch_sub(1);
+        }
+    }
+
+    void
+    leave(t_uindex parity)
+    {
+        m_readers[parity].fetch_sub(1);
+    }
+
+    // Drops s from the table unless it was referenced again
+    void
+    retire(const t_char* s)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto header = intern_header(s);
+        if (header->m_refs.load() != 0)
+            return;
+
+        auto table = m_table.load(std::memory_order_relaxed);
+        t_uindex idx = (header->m_hash >> INTERN_SHARD_BITS) & table->m_mask;
+        while (true)
+        {
+            const t_char* p =
+                table->m_slots[idx].load(std::memory_order_relaxed);
+            if (!p)
+                return;
+            if (p == s)
+                break;
+            idx = (idx + 1) & table->m_mask;
+        }
+
+        table->m_slots[idx].store(INTERN_TOMBSTONE, std::memory_order_release);
+        --m_live;
+        m_bytes -= strlen(s) + 1;
+        m_retired[m_epoch.load() & 1].push_back(s);
+        reclaim();
+    }
+
+    // Frees what was retired in the previous epoch once its lookups
+    // are done, and moves on to the next epoch
+    void
+    reclaim()
+    {
+        t_uindex epoch = m_epoch.load();
+        t_uindex prev = (epoch + 1) & 1;
+        if (m_readers[prev].load() != 0)
+            return;
+
+        for (auto s : m_retired[prev])
+        {
+            free_string(s);
+        }
+        m_retired[prev].clear();
+        for (auto table : m_retired_tables[prev])
+        {
+            delete table;
+        }
+        m_retired_tables[prev].clear();
+        m_epoch.store(epoch + 1);
+    }
+
+    // Rehashes the live strings, dropping tombstones, into a table at
+    // most a quarter full
+    t_intern_table*
+    rebuild(t_intern_table* old)
+    {
+        t_uindex nslots = INTERN_INITIAL_SLOTS;
+        while ((m_live + 1) * 4 > nslots)
+        {
+            nslots *= 2;
+        }
+
+        auto table = new t_intern_table(nslots);
+        for (t_uindex idx = 0; idx <= old->m_mask; ++idx)
+        {
+            const t_char* p =
+                old->m_slots[idx].load(std::memory_order_relaxed);
+            if (!p || p == INTERN_TOMBSTONE)
+                continue;
+            const t_char* found;
+            t_uindex nidx
+                = intern_probe(table, p, intern_header(p)->m_hash, found);
+            table->m_slots[nidx].store(p, std::memory_order_relaxed);
+        }
+        m_used = m_live;
+        m_retired_tables[m_epoch.load() & 1].push_back(old);
+        m_table.store(table, std::memory_order_release);
+        return table;
+    }
+
+    // Copies s into the current block, after room for its header
+    t_char*
+    alloc(const t_char* s, t_uindex len)
+    {
+        const t_uindex align = alignof(t_intern_header);
+        t_uindex needed = sizeof(t_intern_header) + len + 1;
+        needed = (needed + align - 1) / align * align;
+        if (!m_block || m_block->m_used + needed > m_block->m_size)
+        {
+            if (m_block && m_block->m_live == 0)
+                free_block(m_block);
+            t_uindex bsize = std::max(INTERN_BLOCK_SIZE, needed);
+            m_block = new t_intern_block;
+            m_block->m_data = static_cast<t_char*>(malloc(bsize));
+            PSP_VERBOSE_ASSERT(
+                m_block->m_data != 0, "Failed to allocate string block");
+            m_block->m_used = 0;
+            m_block->m_size = bsize;
+            m_block->m_live = 0;
+            m_block_capacity += bsize;
+        }
+
+        t_char* rv
+            = m_block->m_data + m_block->m_used + sizeof(t_intern_header);
+        memcpy(rv, s, len);
+        rv[len] = 0;
+        m_block->m_used += needed;
+        ++m_block->m_live;
+        return rv;
+    }
 
-    if (!sym)
+    void
+    free_string(const t_char* s)
     {
-        sym = new t_symtable;
+        auto block = intern_header(s)->m_block;
+        if (--block->m_live > 0)
+            return;
+        if (block == m_block)
+            block->m_used = 0;
+        else
+            free_block(block);
     }
-    return sym;
+
+    void
+    free_block(t_intern_block* block)
+    {
+        m_block_capacity -= block->m_size;
+        free(block->m_data);
+        delete block;
+    }
+
+    std::atomic<t_intern_table*> m_table;
+    std::atomic<t_uindex> m_epoch;
+    std::atomic<t_uindex> m_readers[2];
+    std::mutex m_mutex;
+    // Slots holding a string or a tombstone
+    t_uindex m_used;
+    t_uindex m_live;
+    t_uindex m_bytes;
+    // Strings pinned when interned
+    t_string_arena m_arena;
+    // Block referenced strings are copied into
+    t_intern_block* m_block;
+    t_uindex m_block_capacity;
+    std::vector<const t_char*> m_retired[2];
+    std::vector<t_intern_table*> m_retired_tables[2];
+};
+
+t_intern_shard*
+get_intern_shards()
+{
+    // Leaked deliberately so interned strings outlive static teardown
+    static t_intern_shard* shards = new t_intern_shard[INTERN_NSHARDS];
+    return shards;
 }
 
+inline t_intern_shard&
+get_intern_shard(t_uindex hash)
+{
+    return get_intern_shards()[hash & (INTERN_NSHARDS - 1)];
+}
+
+} // end anonymous namespace
+
 const t_char*
 get_interned_cstr(const t_char* s)
 {
-    std::lock_guard<std::mutex> guard(sym_table_mutex);
-    auto sym = get_symtable();
-    return sym->get_interned_cstr(s);
+    t_uindex hash = t_cchar_umap_hash()(s);
+    auto& shard = get_intern_shard(hash);
+    const t_char* rv = shard.find(s, hash, true);
+    if (rv)
+        return rv;
+    return shard.insert(s, hash, true);
+}
+
+const t_char*
+acquire_interned_cstr(const t_char* s)
+{
+    t_uindex hash = t_cchar_umap_hash()(s);
+    auto& shard = get_intern_shard(hash);
+    const t_char* rv = shard.find(s, hash, false);
+    if (rv)
+        return rv;
+    return shard.insert(s, hash, false);
+}
+
+void
+release_interned_cstr(const t_char* s)
+{
+    get_intern_shard(intern_header(s)->m_hash).release(s);
+}
+
+t_mem_usage
+get_interned_memory_usage()
+{
+    t_uindex size = 0;
+    t_uindex capacity = 0;
+    t_uindex tables = 0;
+    for (t_uindex idx = 0; idx < INTERN_NSHARDS; ++idx)
+    {
+        get_intern_shards()[idx].add_memory_usage(size, capacity, tables);
+    }
+
+    t_mem_usage rv("interned");
+    rv.add("strings", size, capacity);
+    rv.add("tables", tables, tables);
+    return rv;
 }
 
 t_tscalar
@@ -122,4 +643,75 @@ get_interned_tscalar(const t_tscalar& s)
     return rval;
 }
 
+t_intern_lease::t_intern_lease()
+    : m_bytes(0)
+{
+}
+
+t_intern_lease::~t_intern_lease()
+{
+    clear();
+}
+
+const t_char*
+t_intern_lease::get_interned_cstr(const t_char* s)
+{
+    auto iter = m_held.find(s);
+    if (iter != m_held.end())
+        return *iter;
+
+    const t_char* rv = acquire_interned_cstr(s);
+    m_held.insert(rv);
+    m_bytes += strlen(rv) + 1;
+    return rv;
+}
+
+t_tscalar
+t_intern_lease::get_interned_tscalar(const t_char* s)
+{
+    t_tscalar rval;
+    if (t_tscalar::can_store_inplace(s))
+        rval.set(s);
+    else
+        rval.set(get_interned_cstr(s));
+    return rval;
+}
+
+t_tscalar
+t_intern_lease::get_interned_tscalar(const t_tscalar& s)
+{
+    if (!s.is_str() || s.is_inplace())
+        return s;
+
+    t_tscalar rval;
+    rval.set(get_interned_cstr(s.get_char_ptr()));
+    return rval;
+}
+
+t_uindex
+t_intern_lease::size() const
+{
+    return m_held.size();
+}
+
+void
+t_intern_lease::clear()
+{
+    for (auto s : m_held)
+    {
+        release_interned_cstr(s);
+    }
+    m_held.clear();
+    m_bytes = 0;
+}
+
+t_mem_usage
+t_intern_lease::get_memory_usage() const
+{
+    t_mem_usage rv = mem_usage_hashed("intern_lease", m_held);
+    rv.m_size += m_bytes;
+    rv.m_capacity += m_bytes;
+    return rv;
+}
+
 } // end namespace perspective
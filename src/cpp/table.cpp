@@ -16,6 +16,7 @@
 #include <perspective/scalar.h>
 #include <perspective/utils.h>
 #include <perspective/logtime.h>
+#include <perspective/vocab.h>
 #include <sstream>
 #include <fstream>
 
@@ -298,6 +299,21 @@ t_table::reserve(t_uindex capacity)
     set_capacity(std::max(capacity, m_capacity));
 }
 
+void
+t_table::shrink(t_uindex capacity)
+{
+    PSP_TRACE_SENTINEL();
+    PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+    capacity = std::max(capacity, m_size);
+    if (capacity >= m_capacity)
+        return;
+    for (t_uindex idx = 0, loop_end = m_schema.size(); idx < loop_end; ++idx)
+    {
+        m_columns[idx]->shrink(capacity);
+    }
+    set_capacity(capacity);
+}
+
 t_column*
 t_table::_get_column(const t_str& colname)
 {
@@ -345,6 +361,19 @@ t_table::is_same_shape(t_table& tbl) const
     return m_schema == tbl.m_schema;
 }
 
+t_mem_usage
+t_table::get_memory_usage(const t_str& name) const
+{
+    PSP_TRACE_SENTINEL();
+    PSP_VERBOSE_ASSERT(m_init, "touching uninited object");
+    t_mem_usage rv(name);
+    for (t_uindex idx = 0, loop_end = m_columns.size(); idx < loop_end; ++idx)
+    {
+        rv.add(m_columns[idx]->get_memory_usage(m_schema.m_columns[idx]));
+    }
+    return rv;
+}
+
 void
 t_table::pprint() const
 {
@@ -516,6 +545,12 @@ t_table::filter_cpp(t_filter_op combiner, const t_ftermvec& fterms_) const
     std::vector<t_uindex> indices(fterm_size);
     t_colcptrvec columns(fterm_size);
 
+    // String predicates are evaluated once per distinct string
+    // and looked up by string id per row.
+    // The bits are shared, so later terms evicting a predicate from
+    // the vocab's cache do not free them.
+    std::vector<t_vocab_bitset_csptr> vocab_bits(fterm_size);
+
     for (t_uindex idx = 0; idx < fterm_size; ++idx)
     {
         indices[idx] = m_schema.get_colidx(fterms[idx].m_colname);
@@ -528,8 +563,25 @@ t_table::filter_cpp(t_filter_op combiner, const t_ftermvec& fterms_) const
             auto interned = col->get_interned(thr.get_char_ptr());
             thr.set(interned);
         }
+        else if (fterms[idx].uses_vocab_predicate()
+            && columns[idx]->get_dtype() == DTYPE_STR)
+        {
+            auto col = self->get_column(fterms[idx].m_colname);
+            vocab_bits[idx] = col->_get_vocab()->get_predicate_bits(
+                fterms[idx].m_op, fterms[idx].m_threshold.to_string());
+        }
     }
 
+    // Mirrors t_fterm::operator() on the scalar for string
+    // predicates: invalid cells never match before negation.
+    auto vocab_eval = [&](t_uindex cidx, t_uindex ridx, t_bool& valid) {
+        const t_column* col = columns[cidx];
+        valid = !col->is_status_enabled() || col->is_valid(ridx);
+        t_bool rv = valid
+            && vocab_bits[cidx]->test(*(col->get_nth<t_stridx>(ridx)));
+        return fterms[cidx].m_negated ? !rv : rv;
+    };
+
     switch (combiner)
     {
         case FILTER_OP_AND:
@@ -549,6 +601,18 @@ t_table::filter_cpp(t_filter_op combiner, const t_ftermvec& fterms_) const
                     const auto& ft = fterms[cidx];
                     t_bool tval;
 
+                    if (vocab_bits[cidx])
+                    {
+                        t_bool valid;
+                        tval = vocab_eval(cidx, ridx, valid);
+                        if (!valid || !tval)
+                        {
+                            pass = false;
+                            break;
+                        }
+                        continue;
+                    }
+
                     if (ft.m_use_interned)
                     {
                         cell_val.set(*(columns[cidx]->get_nth<t_stridx>(ridx)));
@@ -579,6 +643,17 @@ t_table::filter_cpp(t_filter_op combiner, const t_ftermvec& fterms_) const
                 t_bool pass = false;
                 for (t_uindex cidx = 0; cidx < fterm_size; ++cidx)
                 {
+                    if (vocab_bits[cidx])
+                    {
+                        t_bool valid;
+                        if (vocab_eval(cidx, ridx, valid))
+                        {
+                            pass = true;
+                            break;
+                        }
+                        continue;
+                    }
+
                     t_tscalar cell_val = columns[cidx]->get_scalar(ridx);
                     if (fterms[cidx](cell_val))
                     {
@@ -0,0 +1,138 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/tick_arena.h>
+#include <perspective/logtime.h>
+#include <algorithm>
+#include <cstdlib>
+
+namespace perspective
+{
+
+static const t_uindex TICK_ARENA_MIN_BLOCK = 64 * 1024;
+
+t_tick_arena::t_tick_arena()
+    : m_block(0)
+    , m_used(0)
+    , m_prev_used(0)
+{
+}
+
+t_tick_arena::t_tick_arena(const t_tick_arena&)
+    : m_block(0)
+    , m_used(0)
+    , m_prev_used(0)
+{
+}
+
+t_tick_arena&
+t_tick_arena::operator=(const t_tick_arena&)
+{
+    return *this;
+}
+
+t_tick_arena::~t_tick_arena()
+{
+    free_blocks();
+}
+
+void*
+t_tick_arena::allocate(t_uindex nbytes, t_uindex alignment)
+{
+    if (!m_blocks.empty())
+    {
+        t_uindex start = (m_used + alignment - 1) & ~(alignment - 1);
+        if (start + nbytes <= m_block_sizes[m_block])
+        {
+            m_used = start + nbytes;
+            return m_blocks[m_block] + start;
+        }
+        m_prev_used += m_used;
+    }
+
+    t_uindex needed = nbytes + alignment;
+    if (m_blocks.empty() || m_block + 1 == m_blocks.size()
+        || m_block_sizes[m_block + 1] < needed)
+    {
+        t_uindex last = m_blocks.empty() ? 0 : m_block_sizes.back();
+        add_block(std::max(std::max(TICK_ARENA_MIN_BLOCK, 2 * last), needed));
+        m_block = m_blocks.size() - 1;
+    }
+    else
+    {
+        ++m_block;
+        psp_count_reuse();
+    }
+
+    // Blocks come from malloc, which aligns for any fundamental type
+    m_used = nbytes;
+    return m_blocks[m_block];
+}
+
+void
+t_tick_arena::reset()
+{
+    if (m_blocks.size() > 1)
+    {
+        t_uindex total = m_prev_used + m_used;
+        free_blocks();
+        t_uindex nbytes = TICK_ARENA_MIN_BLOCK;
+        while (nbytes < total)
+            nbytes *= 2;
+        add_block(nbytes);
+    }
+    m_block = 0;
+    m_used = 0;
+    m_prev_used = 0;
+}
+
+t_uindex
+t_tick_arena::capacity() const
+{
+    t_uindex rv = 0;
+    for (auto s : m_block_sizes)
+    {
+        rv += s;
+    }
+    return rv;
+}
+
+void
+t_tick_arena::add_block(t_uindex nbytes)
+{
+    auto block = static_cast<t_uchar*>(malloc(size_t(nbytes)));
+    PSP_VERBOSE_ASSERT(block != 0, "Failed to allocate tick arena block");
+    psp_count_alloc();
+    m_blocks.push_back(block);
+    m_block_sizes.push_back(nbytes);
+}
+
+void
+t_tick_arena::free_blocks()
+{
+    for (auto b : m_blocks)
+    {
+        free(b);
+    }
+    m_blocks.clear();
+    m_block_sizes.clear();
+}
+
+t_tick_arena_scope::t_tick_arena_scope(t_tick_arena& arena)
+    : m_arena(arena)
+{
+}
+
+t_tick_arena_scope::~t_tick_arena_scope()
+{
+    m_arena.reset();
+}
+
+} // end namespace perspective
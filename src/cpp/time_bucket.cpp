@@ -0,0 +1,259 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/time_bucket.h>
+#include <perspective/date.h>
+
+namespace perspective
+{
+
+namespace
+{
+
+const t_int64 MICROS_PER_MIN = 60LL * 1000000LL;
+const t_int64 MICROS_PER_HOUR = 60LL * MICROS_PER_MIN;
+const t_int64 MICROS_PER_DAY = 24LL * MICROS_PER_HOUR;
+
+// Division rounding towards negative infinity
+inline t_int64
+floor_div(t_int64 a, t_int64 b)
+{
+    t_int64 q = a / b;
+    return q - ((a % b != 0) & ((a ^ b) < 0));
+}
+
+inline t_int64
+floor_mod(t_int64 a, t_int64 b)
+{
+    return a - floor_div(a, b) * b;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date, and back. See
+// Howard Hinnant's "chrono-Compatible Low-Level Date Algorithms".
+inline t_int64
+days_from_civil(t_int64 y, t_int64 m, t_int64 d)
+{
+    y -= m <= 2;
+    t_int64 era = floor_div(y, 400);
+    t_int64 yoe = y - era * 400;
+    t_int64 doy = (153 * (m + 12 * (m <= 2) - 3) + 2) / 5 + d - 1;
+    t_int64 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+inline void
+civil_from_days(t_int64 z, t_int64& y, t_int64& m, t_int64& d)
+{
+    z += 719468;
+    t_int64 era = floor_div(z, 146097);
+    t_int64 doe = z - era * 146097;
+    t_int64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    t_int64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    t_int64 mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp + 3 - 12 * (mp >= 10);
+    y = yoe + era * 400 + (m <= 2);
+}
+
+// Days since the epoch of the Monday starting the week of day z,
+// 1970-01-01 being a Thursday
+inline t_int64
+week_start(t_int64 z)
+{
+    return z - floor_mod(z + 3, 7);
+}
+
+inline t_int64
+minute_start(t_int64 v)
+{
+    return v - floor_mod(v, MICROS_PER_MIN);
+}
+
+inline t_int64
+hour_start(t_int64 v)
+{
+    return v - floor_mod(v, MICROS_PER_HOUR);
+}
+
+inline t_int64
+day_start(t_int64 v)
+{
+    return v - floor_mod(v, MICROS_PER_DAY);
+}
+
+inline t_int64
+monday_start(t_int64 v)
+{
+    return week_start(floor_div(v, MICROS_PER_DAY)) * MICROS_PER_DAY;
+}
+
+inline t_int64
+month_start(t_int64 v)
+{
+    t_int64 y, m, d;
+    civil_from_days(floor_div(v, MICROS_PER_DAY), y, m, d);
+    return days_from_civil(y, m, 1) * MICROS_PER_DAY;
+}
+
+inline t_int64
+year_start(t_int64 v)
+{
+    t_int64 y, m, d;
+    civil_from_days(floor_div(v, MICROS_PER_DAY), y, m, d);
+    return days_from_civil(y, 1, 1) * MICROS_PER_DAY;
+}
+
+template <typename FUNC_T>
+void
+bucket_values(t_int64* data, t_uindex n, FUNC_T fn)
+{
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        data[idx] = fn(data[idx]);
+    }
+}
+
+} // end anonymous namespace
+
+t_bool
+is_time_bucket(t_pivot_mode mode)
+{
+    switch (mode)
+    {
+        case PIVOT_MODE_TIME_BUCKET_MIN:
+        case PIVOT_MODE_TIME_BUCKET_HOUR:
+        case PIVOT_MODE_TIME_BUCKET_DAY:
+        case PIVOT_MODE_TIME_BUCKET_WEEK:
+        case PIVOT_MODE_TIME_BUCKET_MONTH:
+        case PIVOT_MODE_TIME_BUCKET_YEAR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+t_int64
+bucket_time(t_int64 v, t_pivot_mode mode)
+{
+    switch (mode)
+    {
+        case PIVOT_MODE_TIME_BUCKET_MIN:
+            return minute_start(v);
+        case PIVOT_MODE_TIME_BUCKET_HOUR:
+            return hour_start(v);
+        case PIVOT_MODE_TIME_BUCKET_DAY:
+            return day_start(v);
+        case PIVOT_MODE_TIME_BUCKET_WEEK:
+            return monday_start(v);
+        case PIVOT_MODE_TIME_BUCKET_MONTH:
+            return month_start(v);
+        case PIVOT_MODE_TIME_BUCKET_YEAR:
+            return year_start(v);
+        default:
+        {
+            PSP_COMPLAIN_AND_ABORT("Not a time bucket pivot mode");
+        }
+    }
+    return v;
+}
+
+t_uint32
+bucket_date(t_uint32 v, t_pivot_mode mode)
+{
+    switch (mode)
+    {
+        case PIVOT_MODE_TIME_BUCKET_MIN:
+        case PIVOT_MODE_TIME_BUCKET_HOUR:
+        case PIVOT_MODE_TIME_BUCKET_DAY:
+            return v;
+        case PIVOT_MODE_TIME_BUCKET_WEEK:
+        {
+            t_date date(v);
+            t_int64 y, m, d;
+            t_int64 z = days_from_civil(date.year(), date.month(), date.day());
+            civil_from_days(week_start(z), y, m, d);
+            return t_date(y, m, d).raw_value();
+        }
+        case PIVOT_MODE_TIME_BUCKET_MONTH:
+            return (v & ~t_date::DAY_MASK) | (1 << t_date::DAY_SHIFT);
+        case PIVOT_MODE_TIME_BUCKET_YEAR:
+            return (v & t_date::YEAR_MASK) | (1 << t_date::MONTH_SHIFT)
+                | (1 << t_date::DAY_SHIFT);
+        default:
+        {
+            PSP_COMPLAIN_AND_ABORT("Not a time bucket pivot mode");
+        }
+    }
+    return v;
+}
+
+t_col_sptr
+bucket_column(const t_column* col, t_pivot_mode mode)
+{
+    auto rv = col->clone();
+    t_uindex n = rv->size();
+    if (n == 0)
+        return rv;
+
+    switch (col->get_dtype())
+    {
+        case DTYPE_TIME:
+        {
+            t_int64* data = rv->get_nth<t_int64>(0);
+
+            // One loop per mode, keeping the mode switch out of the
+            // per-row work
+            switch (mode)
+            {
+                case PIVOT_MODE_TIME_BUCKET_MIN:
+                    bucket_values(data, n, minute_start);
+                    break;
+                case PIVOT_MODE_TIME_BUCKET_HOUR:
+                    bucket_values(data, n, hour_start);
+                    break;
+                case PIVOT_MODE_TIME_BUCKET_DAY:
+                    bucket_values(data, n, day_start);
+                    break;
+                case PIVOT_MODE_TIME_BUCKET_WEEK:
+                    bucket_values(data, n, monday_start);
+                    break;
+                case PIVOT_MODE_TIME_BUCKET_MONTH:
+                    bucket_values(data, n, month_start);
+                    break;
+                case PIVOT_MODE_TIME_BUCKET_YEAR:
+                    bucket_values(data, n, year_start);
+                    break;
+                default:
+                {
+                    PSP_COMPLAIN_AND_ABORT("Not a time bucket pivot mode");
+                }
+            }
+        }
+        break;
+        case DTYPE_DATE:
+        {
+            t_uint32* data = rv->get_nth<t_uint32>(0);
+            for (t_uindex idx = 0; idx < n; ++idx)
+            {
+                data[idx] = bucket_date(data[idx], mode);
+            }
+        }
+        break;
+        default:
+        {
+            PSP_COMPLAIN_AND_ABORT(
+                "Time bucket pivots need DTYPE_TIME or DTYPE_DATE columns");
+        }
+    }
+
+    return rv;
+}
+
+} // end namespace perspective
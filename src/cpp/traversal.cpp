@@ -43,6 +43,9 @@ t_vdnode::t_vdnode(t_bool expanded, t_bool has_children)
 t_traversal::t_traversal(t_stree_csptr tree, t_bool handle_nan_sort)
     : m_tree(tree)
     , m_handle_nan_sort(handle_nan_sort)
+    , m_lazy(false)
+    , m_lazy_depth(0)
+    , m_lazy_ctx2(nullptr)
 {
     t_stnode_vec rchildren;
     tree->get_child_nodes(0, rchildren);
@@ -52,30 +55,33 @@ t_traversal::t_traversal(t_stree_csptr tree, t_bool handle_nan_sort)
 void
 t_traversal::populate_root_children(const t_stnode_vec& rchildren)
 {
-    m_nodes = std::make_shared<std::vector<t_tvnode>>(rchildren.size() + 1);
+    m_nodes.clear();
+    m_pslots.clear();
+    m_free_slots.clear();
+    m_seq.clear();
+    m_tnid_slots.clear();
+    m_pending.clear();
+    m_dirty.clear();
 
     // Initialize root
-    (*m_nodes)[0].m_expanded = true;
-    (*m_nodes)[0].m_depth = 0;
-    (*m_nodes)[0].m_rel_pidx = INVALID_INDEX;
-    (*m_nodes)[0].m_tnid = 0;
-    (*m_nodes)[0].m_ndesc = rchildren.size();
-    (*m_nodes)[0].m_nchild = rchildren.size();
+    t_tvnode root;
+    fill_travnode(&root, true, 0, INVALID_INDEX, rchildren.size(), 0);
+    root.m_nchild = rchildren.size();
+    t_uindex rslot = alloc_slot(root, t_tvseq::m_npos);
 
-    t_index count = 1;
+    std::vector<t_uindex> slots;
+    slots.reserve(rchildren.size() + 1);
+    slots.push_back(rslot);
 
     for (t_stnode_vec::const_iterator iter = rchildren.begin();
          iter != rchildren.end(); ++iter)
     {
-        t_tvnode& cnode = (*m_nodes)[count];
-        cnode.m_expanded = false;
-        cnode.m_depth = 1;
-        cnode.m_rel_pidx = count;
-        cnode.m_tnid = iter->m_idx;
-        cnode.m_ndesc = 0;
-        cnode.m_nchild = 0;
-        count += 1;
+        t_tvnode cnode;
+        fill_travnode(&cnode, false, 1, 0, 0, iter->m_idx);
+        slots.push_back(alloc_slot(cnode, rslot));
     }
+
+    m_seq.assign(slots);
 }
 
 void
@@ -86,65 +92,211 @@ t_traversal::populate_root_children(t_stree_csptr tree)
     populate_root_children(rchildren);
 }
 
-t_index
-t_traversal::expand_node(t_tvidx exp_idx)
+void
+t_traversal::set_lazy(t_bool lazy)
 {
-    t_tvnode& exp_tvnode = (*m_nodes)[exp_idx];
+    if (m_lazy && !lazy)
+        materialize(0, size());
+    m_lazy = lazy;
+}
 
-    if (exp_tvnode.m_expanded)
+t_bool
+t_traversal::is_lazy() const
+{
+    return m_lazy;
+}
+
+void
+t_traversal::materialize(t_tvidx bidx, t_tvidx eidx) const
+{
+    for (t_tvidx idx = bidx; idx < eidx && idx < t_tvidx(size()); ++idx)
     {
-        return 0;
+        get_slot(idx);
     }
+}
 
-    t_stnode_vec tchildren;
-    m_tree->get_child_nodes(exp_tvnode.m_tnid, tchildren);
-    t_index n_changed = tchildren.size();
-    std::vector<t_tvnode> children = std::vector<t_tvnode>(n_changed);
+t_uindex
+t_traversal::get_slot(t_tvidx idx) const
+{
+    if (!m_dirty.empty())
+        flush_pending(std::unordered_set<t_ptidx>());
 
-    t_index count = 0;
-    for (t_stnode_vec::const_iterator iter = tchildren.begin();
-         iter != tchildren.end(); ++iter)
+    t_uindex offset;
+    t_uindex slot = m_seq.locate(idx, offset);
+    while (offset > 0)
     {
-        t_tvnode& tv_node = children[count];
-        tv_node.m_expanded = false;
-        tv_node.m_depth = exp_tvnode.m_depth + 1;
-        tv_node.m_rel_pidx = count + 1;
-        tv_node.m_tnid = iter->m_idx;
-        tv_node.m_ndesc = 0;
-        tv_node.m_nchild = 0;
-        count += 1;
+        materialize_slot(slot);
+        slot = m_seq.locate(idx, offset);
+    }
+    return slot;
+}
+
+t_bool
+t_traversal::find_slot(t_ptidx tnid, t_uindex& slot) const
+{
+    if (!m_dirty.empty())
+        flush_pending(std::unordered_set<t_ptidx>());
+
+    auto iter = m_tnid_slots.find(tnid);
+    if (iter != m_tnid_slots.end())
+    {
+        slot = iter->second;
+        return true;
+    }
+    if (!m_lazy)
+        return false;
+
+    // Materialize the pending ancestors of tnid, top down
+    for (auto atnid : m_tree->get_ancestry(tnid))
+    {
+        iter = m_tnid_slots.find(atnid);
+        if (iter == m_tnid_slots.end())
+            return false;
+        if (t_ptidx(atnid) == tnid)
+        {
+            slot = iter->second;
+            return true;
+        }
+        if (m_pending[iter->second])
+            materialize_slot(iter->second);
+    }
+    return false;
+}
+
+t_tvnode&
+t_traversal::node_at(t_tvidx idx)
+{
+    return m_nodes[get_slot(idx)];
+}
+
+const t_tvnode&
+t_traversal::node_at(t_tvidx idx) const
+{
+    return m_nodes[get_slot(idx)];
+}
+
+t_uindex
+t_traversal::alloc_slot(const t_tvnode& node, t_uindex pslot) const
+{
+    t_uindex slot;
+    if (m_free_slots.empty())
+    {
+        slot = m_nodes.size();
+        m_nodes.push_back(node);
+        m_pslots.push_back(pslot);
+        m_pending.push_back(0);
+    }
+    else
+    {
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+        m_nodes[slot] = node;
+        m_pslots[slot] = pslot;
+        m_pending[slot] = 0;
+    }
+    m_tnid_slots[node.m_tnid] = slot;
+    return slot;
+}
+
+void
+t_traversal::free_slots(const std::vector<t_uindex>& slots)
+{
+    for (auto slot : slots)
+    {
+        auto iter = m_tnid_slots.find(m_nodes[slot].m_tnid);
+        if (iter != m_tnid_slots.end() && iter->second == slot)
+            m_tnid_slots.erase(iter);
+        m_free_slots.push_back(slot);
+    }
+}
+
+void
+t_traversal::add_ancestor_desc(t_uindex slot, t_index n_changed) const
+{
+    for (t_uindex pslot = m_pslots[slot]; pslot != t_tvseq::m_npos;
+         pslot = m_pslots[pslot])
+    {
+        m_nodes[pslot].m_ndesc += n_changed;
+    }
+}
+
+t_index
+t_traversal::insert_children(
+    t_tvidx exp_idx, const std::vector<t_ptidx>& tnids)
+{
+    t_uindex exp_slot = get_slot(exp_idx);
+    t_index n_changed = tnids.size();
+    std::vector<t_uindex> slots(n_changed);
+
+    t_depth depth = m_nodes[exp_slot].m_depth + 1;
+    for (t_index idx = 0; idx < n_changed; ++idx)
+    {
+        t_tvnode tv_node;
+        fill_travnode(&tv_node, false, depth, idx + 1, 0, tnids[idx]);
+        slots[idx] = alloc_slot(tv_node, exp_slot);
     }
 
     // Update node being expanded
-    exp_tvnode.m_expanded = !tchildren.empty();
-    ;
+    t_tvnode& exp_tvnode = m_nodes[exp_slot];
+    exp_tvnode.m_expanded = !tnids.empty();
     exp_tvnode.m_ndesc += n_changed;
     exp_tvnode.m_nchild = n_changed;
 
     // insert children of node into the traversal
-    m_nodes->insert(
-        m_nodes->begin() + exp_idx + 1, children.begin(), children.end());
+    m_seq.insert(exp_idx + 1, slots);
 
     // update ancestors about their new descendents
     update_ancestors(exp_idx, n_changed);
-    update_sucessors(exp_idx, n_changed);
 
     return n_changed;
 }
 
+t_index
+t_traversal::expand_node(t_tvidx exp_idx)
+{
+    const t_tvnode& exp_tvnode = node_at(exp_idx);
+
+    if (exp_tvnode.m_expanded)
+    {
+        return 0;
+    }
+
+    t_stnode_vec tchildren;
+    m_tree->get_child_nodes(exp_tvnode.m_tnid, tchildren);
+
+    std::vector<t_ptidx> tnids;
+    tnids.reserve(tchildren.size());
+    for (t_stnode_vec::const_iterator iter = tchildren.begin();
+         iter != tchildren.end(); ++iter)
+    {
+        tnids.push_back(iter->m_idx);
+    }
+
+    return insert_children(exp_idx, tnids);
+}
+
 t_index
 t_traversal::expand_node(
     const t_sortsvec& sortby, t_tvidx exp_idx, t_ctx2* ctx2)
 {
-    t_tvnode& exp_tvnode = (*m_nodes)[exp_idx];
+    const t_tvnode& exp_tvnode = node_at(exp_idx);
 
     if (exp_tvnode.m_expanded)
     {
         return 0;
     }
 
+    std::vector<t_ptidx> tnids;
+    get_sorted_children(exp_tvnode.m_tnid, sortby, ctx2, tnids);
+    return insert_children(exp_idx, tnids);
+}
+
+void
+t_traversal::get_sorted_children(t_ptidx tnid, const t_sortsvec& sortby,
+    t_ctx2* ctx2, std::vector<t_ptidx>& out_tnids) const
+{
     t_stnode_vec tchildren;
-    m_tree->get_child_nodes(exp_tvnode.m_tnid, tchildren);
+    m_tree->get_child_nodes(tnid, tchildren);
     t_index n_changed = tchildren.size();
     t_index count = 0;
     std::vector<t_index> sorted_idx(n_changed);
@@ -185,40 +337,23 @@ t_traversal::expand_node(
             sorted_idx[i] = i;
     }
 
-    std::vector<t_tvnode> children = std::vector<t_tvnode>(n_changed);
-    count = 0;
+    out_tnids.resize(n_changed);
     for (t_index idx = 0, loop_end = sorted_idx.size(); idx < loop_end; ++idx)
     {
-        t_tvnode& tv_node = children[count];
-        tv_node.m_expanded = false;
-        tv_node.m_depth = exp_tvnode.m_depth + 1;
-        tv_node.m_rel_pidx = count + 1;
-        tv_node.m_tnid = tchildren[sorted_idx[idx]].m_idx;
-        tv_node.m_ndesc = 0;
-        tv_node.m_nchild = 0;
-        count += 1;
+        out_tnids[idx] = tchildren[sorted_idx[idx]].m_idx;
     }
-
-    // Update node being expanded
-    exp_tvnode.m_expanded = !sorted_idx.empty();
-    exp_tvnode.m_ndesc += n_changed;
-    exp_tvnode.m_nchild = n_changed;
-
-    // insert children of node into the traversal
-    m_nodes->insert(
-        m_nodes->begin() + exp_idx + 1, children.begin(), children.end());
-
-    // update ancestors about their new descendents
-    update_ancestors(exp_idx, n_changed);
-    update_sucessors(exp_idx, n_changed);
-
-    return n_changed;
 }
 
 t_index
 t_traversal::collapse_node(t_tvidx idx)
 {
-    t_tvnode& node = (*m_nodes)[idx];
+    return collapse_slot(get_slot(idx));
+}
+
+t_index
+t_traversal::collapse_slot(t_uindex slot)
+{
+    t_tvnode& node = m_nodes[slot];
 
     if (!node.m_expanded)
     {
@@ -228,21 +363,29 @@ t_traversal::collapse_node(t_tvidx idx)
     // Calculate span of descendents
     t_index n_changed = node.m_ndesc;
 
-    t_tvidx bidx = idx + 1;
-    t_tvidx eidx = bidx + n_changed;
-
-    // remove entries from traversal
-    m_nodes->erase(m_nodes->begin() + bidx, m_nodes->begin() + eidx);
-
     // Update node being collapsed
     node.m_expanded = false;
     node.m_ndesc -= n_changed;
     node.m_nchild = 0;
 
+    if (m_pending[slot])
+    {
+        m_pending[slot] = 0;
+        m_seq.set_weight(slot, 1);
+    }
+    else
+    {
+        // remove entries from traversal
+        t_tvidx bidx = m_seq.index_of(slot) + 1;
+        t_tvidx eidx = bidx + n_changed;
+        std::vector<t_uindex> removed;
+        m_seq.erase(bidx, eidx, removed);
+        free_slots(removed);
+    }
+
     // update ancestors about removal of their
     // descendents
-    update_ancestors(idx, -n_changed);
-    update_sucessors(idx, -n_changed);
+    add_ancestor_desc(slot, -n_changed);
 
     return n_changed;
 }
@@ -252,147 +395,116 @@ t_traversal::add_node(const t_sortsvec& sortby,
     const std::vector<t_uindex>& indices, t_index insert_level_idx,
     t_ctx2* ctx2)
 {
-    t_sortsvec dummy = sortby;
-    std::vector<t_tvidx> tv_indices;
-    t_tvidx collapsed_ancestor = INVALID_INDEX;
-
-    get_expanded_span(
-        indices, tv_indices, collapsed_ancestor, insert_level_idx);
+    if (insert_level_idx <= 0
+        || insert_level_idx >= static_cast<t_index>(indices.size()))
+        return;
 
-    if (static_cast<t_index>(tv_indices.size()) == insert_level_idx)
+    // The new node shows up only if all of its ancestors are expanded,
+    // i.e. its parent is visible and expanded. Positions here stay on
+    // slot boundaries, so nothing is materialized.
+    auto iter = m_tnid_slots.find(indices[insert_level_idx - 1]);
+    if (iter == m_tnid_slots.end())
     {
-        t_tvidx p_tvidx = tv_indices.back();
-        const t_tvnode& p_tvnode = (*m_nodes)[p_tvidx];
-        t_index p_ptidx = p_tvnode.m_tnid;
-        t_index p_nchild = p_tvnode.m_nchild + 1;
-        t_ptidx c_ptidx = indices[insert_level_idx];
-        t_uindex cidx = m_tree->get_sibling_idx(p_ptidx, p_nchild, c_ptidx);
-        cidx = std::min(p_tvnode.m_nchild, cidx);
-        t_tvidx cur_cidx = p_tvidx + 1;
-        for (t_uindex idx = 0; idx < cidx; ++idx)
+        // Rows of a pending ancestor change
+        for (t_index lidx = insert_level_idx - 2; m_lazy && lidx >= 0; --lidx)
         {
-            cur_cidx += (1 + (*m_nodes)[cur_cidx].m_ndesc);
+            auto aiter = m_tnid_slots.find(indices[lidx]);
+            if (aiter == m_tnid_slots.end())
+                continue;
+            if (m_pending[aiter->second])
+                m_dirty.push_back(indices[lidx]);
+            break;
         }
-
-        (*m_nodes)[p_tvidx].m_nchild += 1;
-
-        t_depth depth = get_depth(p_tvidx) + 1;
-        t_tvnode new_node;
-        fill_travnode(&new_node, false, depth, cur_cidx - p_tvidx, 0, c_ptidx);
-        auto insert_iter = m_nodes->begin() + cur_cidx;
-        m_nodes->insert(insert_iter, new_node);
-        update_ancestors(cur_cidx, 1);
-        update_sucessors(cur_cidx, 1);
+        return;
     }
-}
 
-t_rcode
-t_traversal::update_ancestors(t_tvidx nidx, t_index n_changed)
-{
-    if (nidx == 0)
-        return 0;
+    t_uindex p_slot = iter->second;
+    const t_tvnode& p_tvnode = m_nodes[p_slot];
+    if (!p_tvnode.m_expanded)
+        return;
 
-    t_tvidx pidx = nidx - (*m_nodes)[nidx].m_rel_pidx;
-    while (pidx > INVALID_INDEX)
+    if (m_pending[p_slot])
     {
-        t_tvnode& node = (*m_nodes)[pidx];
-        node.m_ndesc += n_changed;
-        if (pidx == 0)
-        {
-            pidx = INVALID_INDEX;
-        }
-        else
-        {
-            pidx = pidx - node.m_rel_pidx;
-        }
+        m_dirty.push_back(p_tvnode.m_tnid);
+        return;
     }
-    return 0;
-}
 
-t_rcode
-t_traversal::update_sucessors(t_tvidx nidx, t_index n_changed)
-{
-    t_tvnode* c_node = &((*m_nodes)[nidx]);
-
-    while (c_node->m_depth > 0)
+    t_tvidx p_tvidx = m_seq.index_of(p_slot);
+    t_index p_ptidx = p_tvnode.m_tnid;
+    t_index p_nchild = p_tvnode.m_nchild + 1;
+    t_ptidx c_ptidx = indices[insert_level_idx];
+    t_uindex cidx = m_tree->get_sibling_idx(p_ptidx, p_nchild, c_ptidx);
+    cidx = std::min(p_tvnode.m_nchild, cidx);
+    t_tvidx cur_cidx = p_tvidx + 1;
+    for (t_uindex idx = 0; idx < cidx; ++idx)
     {
-        t_tvidx pidx = nidx - c_node->m_rel_pidx;
+        cur_cidx += (1 + m_nodes[m_seq.at(cur_cidx)].m_ndesc);
+    }
 
-        const t_tvnode& p_node = (*m_nodes)[pidx];
+    m_nodes[p_slot].m_nchild += 1;
 
-        t_index p_nchild = p_node.m_nchild;
-        t_index coffset = 1;
+    t_depth depth = p_tvnode.m_depth + 1;
+    t_tvnode new_node;
+    fill_travnode(&new_node, false, depth, cur_cidx - p_tvidx, 0, c_ptidx);
+    t_uindex c_slot = alloc_slot(new_node, p_slot);
+    m_seq.insert(cur_cidx, c_slot);
+    add_ancestor_desc(c_slot, 1);
+}
 
-        for (int i = 0; i < p_nchild; i++)
-        {
-            t_tvidx curr_cidx = pidx + coffset;
-            t_tvnode& child_node = (*m_nodes)[curr_cidx];
-            if (curr_cidx > nidx)
-            {
-                child_node.m_rel_pidx += n_changed;
-            }
-            if (child_node.m_expanded)
-            {
-                coffset = coffset + child_node.m_ndesc + 1;
-            }
-            else
-            {
-                coffset += 1;
-            }
-        }
+t_rcode
+t_traversal::update_ancestors(t_tvidx nidx, t_index n_changed)
+{
+    if (nidx == 0)
+        return 0;
 
-        nidx = pidx;
-        c_node = &((*m_nodes)[nidx]);
-    }
+    add_ancestor_desc(get_slot(nidx), n_changed);
     return 0;
 }
 
 t_ptidx
 t_traversal::get_tree_index(t_tvidx idx) const
 {
-    return (*m_nodes)[idx].m_tnid;
+    return node_at(idx).m_tnid;
 }
 
 t_uindex
 t_traversal::size() const
 {
-    return m_nodes->size();
+    if (!m_dirty.empty())
+    {
+        flush_pending(std::unordered_set<t_ptidx>());
+    }
+    return m_seq.size();
 }
 
 t_depth
 t_traversal::get_depth(t_tvidx idx) const
 {
-    return (*m_nodes)[idx].m_depth;
+    return node_at(idx).m_depth;
 }
 
 t_tvidx
 t_traversal::get_traversal_index(t_ptidx idx)
 {
-    t_tvidx rval = INVALID_INDEX;
-
-    for (t_index i = 0, loop_end = m_nodes->size(); i < loop_end; ++i)
-    {
-        if ((*m_nodes)[i].m_tnid == idx)
-        {
-            rval = i;
-            break;
-        }
-    }
-    return rval;
+    t_uindex slot;
+    if (!find_slot(idx, slot))
+        return INVALID_INDEX;
+    return m_seq.index_of(slot);
 }
 
 std::vector<t_vdnode>
 t_traversal::get_view_nodes(t_tvidx bidx, t_tvidx eidx) const
 {
+    materialize(bidx, eidx);
+    std::vector<t_uindex> slots;
+    m_seq.get_slots(bidx, eidx, slots);
     std::vector<t_vdnode> vec(eidx - bidx);
-    for (t_tvidx i = bidx; i < eidx; i++)
+    for (t_uindex idx = 0, loop_end = slots.size(); idx < loop_end; ++idx)
     {
-        t_tvidx idx = i - bidx;
-        const t_tvnode& tv_node = (*m_nodes)[i];
+        const t_tvnode& tv_node = m_nodes[slots[idx]];
         vec[idx].m_expanded = tv_node.m_expanded;
         vec[idx].m_depth = tv_node.m_depth;
-        t_ptidx tree_idx = get_tree_index(i);
-        vec[idx].m_has_children = m_tree->get_num_children(tree_idx) > 0;
+        vec[idx].m_has_children = m_tree->get_num_children(tv_node.m_tnid) > 0;
     }
     return vec;
 }
@@ -412,7 +524,7 @@ t_traversal::get_expanded_span(const std::vector<t_uindex>& in_ptidxes,
     {
         bool level_node_found = false;
         t_tvidx level_idx = INVALID_INDEX;
-        t_index p_nchild = (*m_nodes)[pidx].m_nchild;
+        t_index p_nchild = node_at(pidx).m_nchild;
 
         if (counter >= insert_level_idx)
         {
@@ -421,7 +533,7 @@ t_traversal::get_expanded_span(const std::vector<t_uindex>& in_ptidxes,
 
         for (t_index cidx = 0; cidx < p_nchild; ++cidx)
         {
-            t_tvnode& cnode = (*m_nodes)[pidx + coffset];
+            const t_tvnode& cnode = node_at(pidx + coffset);
 
             if (static_cast<t_uindex>(cnode.m_tnid) == in_ptidxes[counter])
             {
@@ -432,7 +544,7 @@ t_traversal::get_expanded_span(const std::vector<t_uindex>& in_ptidxes,
                 {
                     pidx = pidx + coffset;
                     coffset = 1;
-                    p_nchild = (*m_nodes)[pidx].m_nchild;
+                    p_nchild = node_at(pidx).m_nchild;
                     out_tvidxes.push_back(pidx);
                     break;
                 }
@@ -444,7 +556,7 @@ t_traversal::get_expanded_span(const std::vector<t_uindex>& in_ptidxes,
             }
         }
 
-        if (level_node_found && (!((*m_nodes)[level_idx].m_expanded)))
+        if (level_node_found && (!(node_at(level_idx).m_expanded)))
         {
             out_collpsed_ancestor = level_idx;
             break;
@@ -474,35 +586,49 @@ t_traversal::validate_cells(const std::vector<t_uidxpair>& cells) const
 t_index
 t_traversal::remove_subtree(t_tvidx idx)
 {
-    t_tvnode& node = (*m_nodes)[idx];
+    t_uindex slot = get_slot(idx);
 
     // Calculate span of descendents
-    t_index n_changed = node.m_ndesc + 1;
+    t_index n_changed = m_nodes[slot].m_ndesc + 1;
 
     t_tvidx bidx = idx;
     t_tvidx eidx = bidx + n_changed;
 
-    update_sucessors(idx, -n_changed);
-
     // update ancestors about removal of their
     // descendents
-    update_ancestors(idx, -n_changed);
+    add_ancestor_desc(slot, -n_changed);
 
-    t_tvidx pidx = idx - node.m_rel_pidx;
-    (*m_nodes)[pidx].m_nchild -= 1;
+    m_nodes[m_pslots[slot]].m_nchild -= 1;
 
     // remove entries from traversal
-    m_nodes->erase(m_nodes->begin() + bidx, m_nodes->begin() + eidx);
+    std::vector<t_uindex> removed;
+    m_seq.erase(bidx, eidx, removed);
+    free_slots(removed);
 
     return n_changed;
 }
 
+t_mem_usage
+t_traversal::get_memory_usage() const
+{
+    t_mem_usage rv("traversal");
+    rv.add(mem_usage_vector("nodes", m_nodes));
+    rv.add(mem_usage_vector("pslots", m_pslots));
+    rv.add(mem_usage_vector("free_slots", m_free_slots));
+    rv.add(m_seq.get_memory_usage());
+    rv.add(mem_usage_hashed("tnid_slots", m_tnid_slots));
+    rv.add(mem_usage_vector("pending", m_pending));
+    rv.add(mem_usage_vector("dirty", m_dirty));
+    return rv;
+}
+
 void
 t_traversal::pprint() const
 {
-    for (t_index idx = 0, loop_end = m_nodes->size(); idx < loop_end; ++idx)
+    materialize(0, size());
+    for (t_index idx = 0, loop_end = size(); idx < loop_end; ++idx)
     {
-        const t_tvnode& node = (*m_nodes)[idx];
+        const t_tvnode node = get_node(idx);
         const t_stnode tnode = m_tree->get_node(node.m_tnid);
         for (t_uindex didx = 0; didx < node.m_depth; didx++)
         {
@@ -519,16 +645,25 @@ t_traversal::pprint() const
 t_tvnode
 t_traversal::get_node(t_tvidx idx) const
 {
-    return (*m_nodes)[idx];
+    t_uindex slot = get_slot(idx);
+    t_tvnode rval = m_nodes[slot];
+    t_uindex pslot = m_pslots[slot];
+    rval.m_rel_pidx = pslot == t_tvseq::m_npos
+        ? INVALID_INDEX
+        : idx - static_cast<t_tvidx>(m_seq.index_of(pslot));
+    return rval;
 }
 
 void
 t_traversal::get_leaves(std::vector<t_tvidx>& out_data) const
 {
-    for (t_tvidx curidx = 0, loop_end = m_nodes->size(); curidx < loop_end;
+    materialize(0, size());
+    std::vector<t_uindex> slots;
+    m_seq.get_slots(0, size(), slots);
+    for (t_tvidx curidx = 0, loop_end = slots.size(); curidx < loop_end;
          ++curidx)
     {
-        if (!(*m_nodes)[curidx].m_expanded)
+        if (!m_nodes[slots[curidx]].m_expanded)
         {
             out_data.push_back(curidx);
         }
@@ -539,37 +674,62 @@ void
 t_traversal::get_child_indices(
     t_tvidx nidx, std::vector<std::pair<t_tvidx, t_ptidx>>& out_data) const
 {
-    const t_tvnode& tvnode = (*m_nodes)[nidx];
+    const t_tvnode& tvnode = node_at(nidx);
     t_index nchild = tvnode.m_nchild;
     t_index coffset = 1;
 
     for (int i = 0; i < nchild; i++)
     {
         t_tvidx curr_cidx = nidx + coffset;
-        const t_tvnode& child_node = (*m_nodes)[curr_cidx];
+        const t_tvnode& child_node = node_at(curr_cidx);
         out_data.push_back(
             std::pair<t_tvidx, t_ptidx>(curr_cidx, child_node.m_tnid));
         coffset = coffset + child_node.m_ndesc + 1;
     }
 }
 
+void
+t_traversal::get_child_indices(const std::vector<t_uindex>& slots,
+    const std::vector<t_index>& cdesc, t_tvidx nidx,
+    std::vector<std::pair<t_tvidx, t_ptidx>>& out_data) const
+{
+    if (m_pending[slots[nidx]])
+        return;
+
+    const t_tvnode& tvnode = m_nodes[slots[nidx]];
+    t_index nchild = tvnode.m_nchild;
+    t_index coffset = 1;
+
+    for (int i = 0; i < nchild; i++)
+    {
+        t_tvidx curr_cidx = nidx + coffset;
+        const t_tvnode& child_node = m_nodes[slots[curr_cidx]];
+        out_data.push_back(
+            std::pair<t_tvidx, t_ptidx>(curr_cidx, child_node.m_tnid));
+        coffset = coffset + cdesc[curr_cidx] + 1;
+    }
+}
+
 void
 t_traversal::print_stats()
 {
-    std::cout << "Traversal size => " << m_nodes->size() << std::endl;
+    std::cout << "Traversal size => " << size() << std::endl;
 }
 
 t_index
 t_traversal::get_num_tree_leaves(t_tvidx idx) const
 {
-    const t_tvnode& node = (*m_nodes)[idx];
+    t_index ndesc = node_at(idx).m_ndesc;
+    materialize(idx + 1, idx + ndesc + 1);
+
+    std::vector<t_uindex> slots;
+    m_seq.get_slots(idx + 1, idx + ndesc + 1, slots);
 
     t_index rval = 0;
 
-    for (t_tvidx curidx = idx + 1, loop_end = idx + node.m_ndesc + 1;
-         curidx < loop_end; ++curidx)
+    for (auto slot : slots)
     {
-        if (!(*m_nodes)[curidx].m_expanded)
+        if (!m_nodes[slot].m_expanded)
         {
             ++rval;
         }
@@ -596,6 +756,57 @@ t_traversal::post_order(t_tvidx nidx, std::vector<t_tvidx>& out_vec)
 t_index
 t_traversal::set_depth(const t_sortsvec& sortby, t_depth depth, t_ctx2* ctx2)
 {
+    if (m_lazy)
+    {
+        std::unordered_set<t_ptidx> excluded;
+        flush_pending(excluded);
+
+        t_index n_changed = 0;
+        t_bool recount = m_lazy_depth != depth + 1;
+        m_lazy_depth = depth + 1;
+        m_lazy_sortby = sortby;
+        m_lazy_ctx2 = ctx2;
+
+        // Walk the materialized nodes only, leaving anything that is
+        // to be expanded pending
+        std::vector<t_uindex> queue{m_seq.at(0)};
+        std::vector<t_uindex> children;
+        while (!queue.empty())
+        {
+            t_uindex slot = queue.back();
+            queue.pop_back();
+            const t_tvnode& node = m_nodes[slot];
+
+            if (node.m_depth >= m_lazy_depth)
+            {
+                n_changed += collapse_slot(slot);
+            }
+            else if (m_pending[slot])
+            {
+                if (recount)
+                    n_changed += std::abs(set_pending(slot, excluded));
+            }
+            else if (node.m_expanded)
+            {
+                children.clear();
+                t_tvidx cidx = m_seq.index_of(slot) + 1;
+                for (t_uindex i = 0; i < node.m_nchild; ++i)
+                {
+                    t_uindex cslot = m_seq.at(cidx);
+                    children.push_back(cslot);
+                    cidx += m_nodes[cslot].m_ndesc + 1;
+                }
+                queue.insert(queue.end(), children.begin(), children.end());
+            }
+            else if (m_tree->get_num_children(node.m_tnid) > 0)
+            {
+                n_changed += set_pending(slot, excluded);
+            }
+        }
+
+        return n_changed;
+    }
+
     std::vector<t_ptidx> pending;
     depth = depth + 1;
     pending.push_back(0);
@@ -611,7 +822,7 @@ t_traversal::set_depth(const t_sortsvec& sortby, t_depth depth, t_ctx2* ctx2)
         for (t_index idx = 0, loop_end = children.size(); idx < loop_end; ++idx)
         {
             const std::pair<t_tvidx, t_ptidx>& child = children[idx];
-            const t_tvnode& tv_node = (*m_nodes)[child.first];
+            const t_tvnode& tv_node = node_at(child.first);
 
             if (tv_node.m_depth < depth)
             {
@@ -645,7 +856,7 @@ t_traversal::get_flattened_tree(t_tvidx idx, t_depth stop_depth) const
     {
         t_index hidx = queue.front();
         queue.pop();
-        const t_tvnode& c_node = (*m_nodes)[hidx];
+        const t_tvnode& c_node = node_at(hidx);
         t_depth curdepth = c_node.m_depth;
         t_ftreenode rnode;
         rnode.m_idx = c_node.m_tnid;
@@ -659,7 +870,7 @@ t_traversal::get_flattened_tree(t_tvidx idx, t_depth stop_depth) const
             // std::vector<t_tvidx> children(nchild);
             for (int cidx = 0; cidx < nchild; cidx++)
             {
-                const t_tvnode& child_node = (*m_nodes)[curr_cidx];
+                const t_tvnode& child_node = node_at(curr_cidx);
                 queue.push(curr_cidx);
                 // children[cidx] = curr_cidx;
                 if (child_node.m_expanded)
@@ -690,16 +901,11 @@ t_traversal::get_flattened_tree(t_tvidx idx, t_depth stop_depth) const
 t_tvidx
 t_traversal::tree_index_lookup(t_ptidx idx, t_tvidx bidx) const
 {
-    t_tvidx tvidx = INVALID_INDEX;
-    for (t_index i = bidx, loop_end = m_nodes->size(); i < loop_end; ++i)
-    {
-        if ((*m_nodes)[i].m_tnid == idx)
-        {
-            tvidx = i;
-            break;
-        }
-    }
-    return tvidx;
+    t_uindex slot;
+    if (!find_slot(idx, slot))
+        return INVALID_INDEX;
+    t_tvidx tvidx = m_seq.index_of(slot);
+    return tvidx < bidx ? INVALID_INDEX : tvidx;
 }
 
 void
@@ -709,19 +915,11 @@ t_traversal::get_node_ancestors(
     if (nidx == 0)
         return;
 
-    t_tvidx pidx = nidx - (*m_nodes)[nidx].m_rel_pidx;
-    while (pidx > INVALID_INDEX)
+    t_uindex pslot = m_pslots[get_slot(nidx)];
+    while (pslot != t_tvseq::m_npos)
     {
-        ancestors.push_back(pidx);
-        const t_tvnode& node = (*m_nodes)[pidx];
-        if (pidx == 0)
-        {
-            pidx = INVALID_INDEX;
-        }
-        else
-        {
-            pidx = pidx - node.m_rel_pidx;
-        }
+        ancestors.push_back(m_seq.index_of(pslot));
+        pslot = m_pslots[pslot];
     }
 }
 
@@ -729,22 +927,29 @@ void
 t_traversal::get_expanded(std::vector<t_ptidx>& expanded_tidx) const
 {
     // Ancestors of expanded nodes
-    std::set<t_tvidx> ancestors;
-    std::vector<t_tvidx> expanded;
+    std::set<t_uindex> ancestors;
+    std::vector<t_uindex> expanded;
 
-    if (m_nodes->size() == 0)
+    if (size() == 0)
         return;
 
-    for (t_index i = m_nodes->size() - 1; i > -1; i--)
+    materialize(0, size());
+    std::vector<t_uindex> slots;
+    m_seq.get_slots(0, size(), slots);
+
+    for (t_index i = slots.size() - 1; i > -1; i--)
     {
-        const t_tvnode& node = (*m_nodes)[i];
+        t_uindex slot = slots[i];
+        const t_tvnode& node = m_nodes[slot];
 
-        if (node.m_expanded && ancestors.find(i) == ancestors.end())
+        if (node.m_expanded && ancestors.find(slot) == ancestors.end())
         {
-            expanded.push_back(i);
-            std::vector<t_tvidx> node_ancestors;
-            get_node_ancestors(i, node_ancestors);
-            ancestors.insert(node_ancestors.begin(), node_ancestors.end());
+            expanded.push_back(slot);
+            for (t_uindex pslot = m_pslots[slot]; pslot != t_tvseq::m_npos;
+                 pslot = m_pslots[pslot])
+            {
+                ancestors.insert(pslot);
+            }
         }
     }
 
@@ -752,8 +957,7 @@ t_traversal::get_expanded(std::vector<t_ptidx>& expanded_tidx) const
 
     for (t_index i = 0, loop_end = rval.size(); i < loop_end; i++)
     {
-        const t_tvnode& node = (*m_nodes)[expanded[i]];
-        rval[i] = node.m_tnid;
+        rval[i] = m_nodes[expanded[i]].m_tnid;
     }
 
     std::swap(rval, expanded_tidx);
@@ -762,15 +966,143 @@ t_traversal::get_expanded(std::vector<t_ptidx>& expanded_tidx) const
 void
 t_traversal::drop_tree_indices(const std::vector<t_uindex>& indices)
 {
+    // The tree still holds the dropped nodes at this point, so pending
+    // nodes are recounted without them
+    std::unordered_set<t_ptidx> excluded;
+    if (m_lazy)
+    {
+        excluded.insert(indices.begin(), indices.end());
+        flush_pending(excluded);
+    }
+
+    std::vector<t_uindex> recount;
     for (auto idx : indices)
     {
-        t_tvidx tvidx = tree_index_lookup(idx, 0);
-        if (tvidx == INVALID_INDEX)
+        auto iter = m_tnid_slots.find(idx);
+        if (iter != m_tnid_slots.end())
         {
+            remove_subtree(m_seq.index_of(iter->second));
+            continue;
+        }
+
+        if (!m_lazy)
             continue;
+
+        auto ancestry = m_tree->get_ancestry(idx);
+        for (t_index aidx = ancestry.size() - 1; aidx >= 0; --aidx)
+        {
+            auto aiter = m_tnid_slots.find(ancestry[aidx]);
+            if (aiter == m_tnid_slots.end())
+                continue;
+            if (m_pending[aiter->second])
+                recount.push_back(aiter->second);
+            break;
         }
+    }
+
+    for (auto slot : recount)
+    {
+        if (m_pending[slot])
+            set_pending(slot, excluded);
+    }
+}
 
-        remove_subtree(tvidx);
+t_index
+t_traversal::count_visible(t_ptidx tnid, t_depth depth,
+    const std::unordered_set<t_ptidx>& excluded) const
+{
+    if (depth >= m_lazy_depth)
+        return 0;
+
+    if (depth + 1 >= m_lazy_depth && excluded.empty())
+        return m_tree->get_num_children(tnid);
+
+    t_index rval = 0;
+    for (auto cidx : m_tree->get_child_idx(tnid))
+    {
+        if (excluded.find(cidx) != excluded.end())
+            continue;
+        rval += 1 + count_visible(cidx, depth + 1, excluded);
+    }
+    return rval;
+}
+
+t_index
+t_traversal::set_pending(
+    t_uindex slot, const std::unordered_set<t_ptidx>& excluded) const
+{
+    t_tvnode& node = m_nodes[slot];
+    t_index ndesc = count_visible(node.m_tnid, node.m_depth, excluded);
+    t_index nchild = 0;
+    for (auto cidx : m_tree->get_child_idx(node.m_tnid))
+    {
+        if (excluded.find(cidx) == excluded.end())
+            ++nchild;
+    }
+
+    t_index n_changed = ndesc - node.m_ndesc;
+    node.m_ndesc = ndesc;
+    node.m_nchild = nchild;
+    node.m_expanded = true;
+    m_pending[slot] = 1;
+    m_seq.set_weight(slot, ndesc + 1);
+    add_ancestor_desc(slot, n_changed);
+    return n_changed;
+}
+
+void
+t_traversal::materialize_slot(t_uindex slot) const
+{
+    t_tvnode& node = m_nodes[slot];
+    std::vector<t_ptidx> tnids;
+    get_sorted_children(node.m_tnid, m_lazy_sortby, m_lazy_ctx2, tnids);
+
+    t_depth depth = node.m_depth + 1;
+    t_index nchild = tnids.size();
+    std::vector<t_uindex> slots(nchild);
+    std::vector<t_uindex> weights(nchild);
+    std::unordered_set<t_ptidx> excluded;
+    t_index ndesc = 0;
+
+    for (t_index idx = 0; idx < nchild; ++idx)
+    {
+        t_index cdesc = count_visible(tnids[idx], depth, excluded);
+        t_bool expanded = depth < m_lazy_depth
+            && m_tree->get_num_children(tnids[idx]) > 0;
+
+        t_tvnode tv_node;
+        fill_travnode(&tv_node, expanded, depth, idx + 1, cdesc, tnids[idx]);
+        tv_node.m_nchild
+            = expanded ? m_tree->get_num_children(tnids[idx]) : 0;
+        slots[idx] = alloc_slot(tv_node, slot);
+        m_pending[slots[idx]] = expanded;
+        weights[idx] = cdesc + 1;
+        ndesc += cdesc + 1;
+    }
+
+    // Rows were counted against the current tree, so this only moves
+    // if an update was missed
+    t_index n_changed = ndesc - m_nodes[slot].m_ndesc;
+    m_nodes[slot].m_ndesc = ndesc;
+    m_nodes[slot].m_nchild = nchild;
+    m_pending[slot] = 0;
+    add_ancestor_desc(slot, n_changed);
+
+    m_seq.set_weight(slot, 1);
+    m_seq.insert(m_seq.index_of(slot) + 1, slots, weights);
+}
+
+void
+t_traversal::flush_pending(
+    const std::unordered_set<t_ptidx>& excluded) const
+{
+    std::vector<t_ptidx> dirty;
+    std::swap(dirty, m_dirty);
+    for (auto tnid : dirty)
+    {
+        auto iter = m_tnid_slots.find(tnid);
+        if (iter != m_tnid_slots.end() && m_pending[iter->second])
+            set_pending(iter->second, excluded);
     }
 }
 
@@ -789,8 +1121,8 @@ t_traversal::get_tree() const
 t_bool
 t_traversal::get_node_expanded(t_tvidx idx) const
 {
-    if (idx < 0 || static_cast<t_uindex>(idx) > m_nodes->size())
+    if (idx < 0 || static_cast<t_uindex>(idx) >= size())
         return false;
-    return m_nodes->at(idx).m_expanded;
+    return node_at(idx).m_expanded;
 }
 } // end namespace perspective
@@ -0,0 +1,351 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#include <perspective/first.h>
+#include <perspective/traversal_seq.h>
+#include <algorithm>
+
+namespace perspective
+{
+
+const t_uindex t_tvseq::m_npos;
+
+t_tvseq::t_tvseq()
+    : m_root(m_npos)
+    , m_seed(2463534242u)
+{
+}
+
+void
+t_tvseq::clear()
+{
+    m_root = m_npos;
+    m_left.clear();
+    m_right.clear();
+    m_parent.clear();
+    m_size.clear();
+    m_weight.clear();
+    m_priority.clear();
+}
+
+t_uindex
+t_tvseq::size() const
+{
+    return subtree_size(m_root);
+}
+
+t_uindex
+t_tvseq::at(t_uindex idx) const
+{
+    t_uindex offset;
+    return locate(idx, offset);
+}
+
+t_uindex
+t_tvseq::locate(t_uindex idx, t_uindex& offset) const
+{
+    PSP_VERBOSE_ASSERT(idx < size(), "Position out of bounds");
+    t_uindex t = m_root;
+    while (true)
+    {
+        t_uindex lsize = subtree_size(m_left[t]);
+        if (idx < lsize)
+        {
+            t = m_left[t];
+        }
+        else if (idx < lsize + m_weight[t])
+        {
+            offset = idx - lsize;
+            return t;
+        }
+        else
+        {
+            idx -= lsize + m_weight[t];
+            t = m_right[t];
+        }
+    }
+}
+
+t_uindex
+t_tvseq::index_of(t_uindex slot) const
+{
+    t_uindex idx = subtree_size(m_left[slot]);
+    t_uindex t = slot;
+    while (m_parent[t] != m_npos)
+    {
+        t_uindex p = m_parent[t];
+        if (m_right[p] == t)
+            idx += subtree_size(m_left[p]) + m_weight[p];
+        t = p;
+    }
+    PSP_VERBOSE_ASSERT(t == m_root, "Slot not in sequence");
+    return idx;
+}
+
+t_uindex
+t_tvseq::get_weight(t_uindex slot) const
+{
+    return m_weight[slot];
+}
+
+void
+t_tvseq::set_weight(t_uindex slot, t_uindex weight)
+{
+    m_weight[slot] = weight;
+    for (t_uindex t = slot; t != m_npos; t = m_parent[t])
+    {
+        m_size[t] = m_weight[t] + subtree_size(m_left[t])
+            + subtree_size(m_right[t]);
+    }
+}
+
+void
+t_tvseq::insert(t_uindex idx, const std::vector<t_uindex>& slots)
+{
+    insert(idx, slots, std::vector<t_uindex>());
+}
+
+void
+t_tvseq::insert(t_uindex idx, const std::vector<t_uindex>& slots,
+    const std::vector<t_uindex>& weights)
+{
+    if (slots.empty())
+        return;
+
+    PSP_VERBOSE_ASSERT(idx <= size(), "Position out of bounds");
+
+    for (t_uindex sidx = 0, loop_end = slots.size(); sidx < loop_end; ++sidx)
+    {
+        reserve_slot(slots[sidx]);
+        m_weight[slots[sidx]] = weights.empty() ? 1 : weights[sidx];
+    }
+
+    t_uindex mid = build(slots, 0, slots.size());
+    t_uindex l, r;
+    split(m_root, idx, l, r);
+    set_root(merge(merge(l, mid), r));
+}
+
+void
+t_tvseq::insert(t_uindex idx, t_uindex slot)
+{
+    insert(idx, std::vector<t_uindex>{slot});
+}
+
+void
+t_tvseq::erase(t_uindex bidx, t_uindex eidx, std::vector<t_uindex>& out)
+{
+    if (bidx >= eidx)
+        return;
+
+    PSP_VERBOSE_ASSERT(eidx <= size(), "Position out of bounds");
+
+    t_uindex l, mid, r;
+    split(m_root, eidx, mid, r);
+    split(mid, bidx, l, mid);
+    collect(mid, out);
+    set_root(merge(l, r));
+}
+
+void
+t_tvseq::assign(const std::vector<t_uindex>& slots)
+{
+    for (auto slot : slots)
+    {
+        reserve_slot(slot);
+    }
+    set_root(build(slots, 0, slots.size()));
+}
+
+void
+t_tvseq::get_slots(
+    t_uindex bidx, t_uindex eidx, std::vector<t_uindex>& out) const
+{
+    eidx = std::min(eidx, size());
+    if (bidx >= eidx)
+        return;
+
+    t_uindex offset;
+    t_uindex t = locate(bidx, offset);
+    t_uindex idx = bidx - offset;
+    while (idx < eidx)
+    {
+        out.push_back(t);
+        idx += m_weight[t];
+
+        // in order successor
+        if (m_right[t] != m_npos)
+        {
+            t = m_right[t];
+            while (m_left[t] != m_npos)
+                t = m_left[t];
+        }
+        else
+        {
+            t_uindex p = m_parent[t];
+            while (p != m_npos && m_right[p] == t)
+            {
+                t = p;
+                p = m_parent[t];
+            }
+            t = p;
+        }
+    }
+}
+
+t_mem_usage
+t_tvseq::get_memory_usage() const
+{
+    t_mem_usage rv("seq");
+    rv.add(mem_usage_vector("left", m_left));
+    rv.add(mem_usage_vector("right", m_right));
+    rv.add(mem_usage_vector("parent", m_parent));
+    rv.add(mem_usage_vector("size", m_size));
+    rv.add(mem_usage_vector("weight", m_weight));
+    rv.add(mem_usage_vector("priority", m_priority));
+    return rv;
+}
+
+void
+t_tvseq::reserve_slot(t_uindex slot)
+{
+    if (slot < m_size.size())
+        return;
+
+    t_uindex nslots = std::max<t_uindex>(slot + 1, m_size.size() * 2);
+    m_left.resize(nslots, m_npos);
+    m_right.resize(nslots, m_npos);
+    m_parent.resize(nslots, m_npos);
+    m_size.resize(nslots, 0);
+    m_weight.resize(nslots, 1);
+    m_priority.resize(nslots, 0);
+}
+
+t_uindex
+t_tvseq::subtree_size(t_uindex t) const
+{
+    return t == m_npos ? 0 : m_size[t];
+}
+
+void
+t_tvseq::pull(t_uindex t)
+{
+    t_uindex l = m_left[t];
+    t_uindex r = m_right[t];
+    m_size[t] = m_weight[t] + subtree_size(l) + subtree_size(r);
+    if (l != m_npos)
+        m_parent[l] = t;
+    if (r != m_npos)
+        m_parent[r] = t;
+}
+
+t_uint32
+t_tvseq::next_priority()
+{
+    // xorshift32
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+void
+t_tvseq::split(t_uindex t, t_uindex k, t_uindex& l, t_uindex& r)
+{
+    if (t == m_npos)
+    {
+        l = r = m_npos;
+        return;
+    }
+
+    t_uindex lsize = subtree_size(m_left[t]);
+    if (k <= lsize)
+    {
+        split(m_left[t], k, l, m_left[t]);
+        pull(t);
+        r = t;
+        if (l != m_npos)
+            m_parent[l] = m_npos;
+    }
+    else
+    {
+        PSP_VERBOSE_ASSERT(
+            k >= lsize + m_weight[t], "Split inside a weighted slot");
+        split(m_right[t], k - lsize - m_weight[t], m_right[t], r);
+        pull(t);
+        l = t;
+        if (r != m_npos)
+            m_parent[r] = m_npos;
+    }
+    m_parent[t] = m_npos;
+}
+
+t_uindex
+t_tvseq::merge(t_uindex l, t_uindex r)
+{
+    if (l == m_npos)
+        return r;
+    if (r == m_npos)
+        return l;
+
+    if (m_priority[l] >= m_priority[r])
+    {
+        m_right[l] = merge(m_right[l], r);
+        pull(l);
+        return l;
+    }
+
+    m_left[r] = merge(l, m_left[r]);
+    pull(r);
+    return r;
+}
+
+t_uindex
+t_tvseq::build(
+    const std::vector<t_uindex>& slots, t_uindex bidx, t_uindex eidx)
+{
+    if (bidx >= eidx)
+        return m_npos;
+
+    t_uindex mid = bidx + (eidx - bidx) / 2;
+    t_uindex t = slots[mid];
+    m_left[t] = build(slots, bidx, mid);
+    m_right[t] = build(slots, mid + 1, eidx);
+    m_parent[t] = m_npos;
+    pull(t);
+
+    // Keep the heap order on priorities
+    t_uint32 priority = next_priority();
+    if (m_left[t] != m_npos)
+        priority = std::max(priority, m_priority[m_left[t]]);
+    if (m_right[t] != m_npos)
+        priority = std::max(priority, m_priority[m_right[t]]);
+    m_priority[t] = priority;
+    return t;
+}
+
+void
+t_tvseq::collect(t_uindex t, std::vector<t_uindex>& out) const
+{
+    if (t == m_npos)
+        return;
+    collect(m_left[t], out);
+    out.push_back(t);
+    collect(m_right[t], out);
+}
+
+void
+t_tvseq::set_root(t_uindex t)
+{
+    m_root = t;
+    if (t != m_npos)
+        m_parent[t] = m_npos;
+}
+
+} // end namespace perspective
@@ -44,6 +44,8 @@ notify_sparse_tree_common(t_table_sptr strands, t_table_sptr strand_deltas,
     auto pivots = tree->get_pivots();
 
     t_dtree dtree(strands, pivots, tree_sortby);
+    // t_stree orders children on (sort value, value) itself
+    dtree.set_partition_order(PARTITION_HASHED);
     dtree.init();
 
     dtree.check_pivot(fltr, pivots.size() + 1);
@@ -9,6 +9,9 @@
 
 #include <perspective/first.h>
 #include <perspective/vocab.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <unordered_set>
 #include <sstream>
 #include <iostream>
@@ -16,8 +19,96 @@
 namespace perspective
 {
 
+// Bound on the number of distinct predicates cached per vocab
+static const t_uindex PSP_VOCAB_PREDICATE_CACHE_SIZE = 64;
+
+namespace
+{
+
+inline t_char
+lower_char(t_char c)
+{
+    return static_cast<t_char>(std::tolower(static_cast<t_uchar>(c)));
+}
+
+// strcmp on lowercased characters
+inline t_int32
+icmp(const char* a, const char* b)
+{
+    for (;; ++a, ++b)
+    {
+        t_char ca = lower_char(*a);
+        t_char cb = lower_char(*b);
+        if (ca != cb || ca == 0)
+            return static_cast<t_uchar>(ca) - static_cast<t_uchar>(cb);
+    }
+}
+
+// operand is expected to be lowercased already
+inline t_bool
+ibegins_with(const char* s, const t_str& operand)
+{
+    for (t_uindex idx = 0, loop_end = operand.size(); idx < loop_end; ++idx)
+    {
+        if (s[idx] == 0 || lower_char(s[idx]) != operand[idx])
+            return false;
+    }
+    return true;
+}
+
+inline t_bool
+iends_with(const char* s, const t_str& operand)
+{
+    t_uindex slen = strlen(s);
+    t_uindex olen = operand.size();
+    if (slen < olen)
+        return false;
+    return ibegins_with(s + slen - olen, operand);
+}
+
+inline t_bool
+icontains(const char* s, const t_str& operand)
+{
+    if (operand.empty())
+        return true;
+    for (; *s; ++s)
+    {
+        if (ibegins_with(s, operand))
+            return true;
+    }
+    return false;
+}
+
+inline t_bool
+eval_predicate(t_filter_op op, const char* s, const t_str& operand)
+{
+    switch (op)
+    {
+        case FILTER_OP_BEGINS_WITH:
+            return ibegins_with(s, operand);
+        case FILTER_OP_ENDS_WITH:
+            return iends_with(s, operand);
+        case FILTER_OP_CONTAINS:
+            return icontains(s, operand);
+        default:
+        {
+            PSP_COMPLAIN_AND_ABORT("Unsupported vocab predicate");
+        }
+    }
+    return false;
+}
+
+} // end anonymous namespace
+
+t_vocab_predicate::t_vocab_predicate()
+    : m_op(FILTER_OP_CONTAINS)
+    , m_upto(0)
+{
+}
+
 t_vocab::t_vocab()
     : m_vlenidx(0)
+    , m_sorted_upto(0)
 {
     m_vlendata.reset(new t_lstore);
     m_extents.reset(new t_lstore);
@@ -25,6 +116,7 @@ t_vocab::t_vocab()
 
 t_vocab::t_vocab(const t_column_recipe& r)
     : m_vlenidx(r.m_vlenidx)
+    , m_sorted_upto(0)
 {
     if (is_vlen_dtype(r.m_dtype))
     {
@@ -41,6 +133,7 @@ t_vocab::t_vocab(const t_column_recipe& r)
 t_vocab::t_vocab(const t_lstore_recipe& vlendata_recipe,
     const t_lstore_recipe& extents_recipe)
     : m_vlenidx(0)
+    , m_sorted_upto(0)
 {
     m_vlendata.reset(new t_lstore(vlendata_recipe));
     m_extents.reset(new t_lstore(extents_recipe));
@@ -60,9 +153,11 @@ t_vocab::rebuild_map()
 void
 t_vocab::reserve(size_t total_string_size, size_t string_count)
 {
+    const void* obase = m_vlendata->get_ptr(0);
     m_vlendata->reserve(total_string_size);
     m_extents->reserve(sizeof(t_uidxpair) * string_count);
-    rebuild_map();
+    if (m_vlendata->get_ptr(0) != obase || !m_vlendata->is_chunked())
+        rebuild_map();
 }
 
 t_bool
@@ -93,15 +188,14 @@ t_vocab::get_interned(const char* s)
     {
         idx = genidx();
 
-        bidx = m_vlendata->size();
-        eidx = bidx + len;
         const void* obase = m_vlendata->get_nth<const char>(0);
-        const void* oebase = m_extents->get_nth<t_uidxpair>(0);
         m_vlendata->push_back(static_cast<const void*>(s), len);
+        // chunked stores may skip to the next chunk to keep s contiguous
+        eidx = m_vlendata->size();
+        bidx = eidx - len;
         m_extents->push_back(t_uidxpair(bidx, eidx));
         const void* nbase = m_vlendata->get_nth<const char>(0);
-        const void* nebase = m_extents->get_nth<t_uidxpair>(0);
-        if ((obase == nbase) && (oebase == nebase))
+        if (obase == nbase)
         {
             m_map[unintern_c(idx)] = idx;
         }
@@ -171,13 +265,52 @@ t_vocab::nbytes() const
     return rv;
 }
 
+t_mem_usage
+t_vocab::get_memory_usage() const
+{
+    t_mem_usage rv("vocab");
+    rv.add(m_vlendata->get_memory_usage("vlendata"));
+    rv.add(m_extents->get_memory_usage("extents"));
+    rv.add(mem_usage_hashed("map", m_map));
+    rv.add(mem_usage_vector("sorted_ids", m_sorted_ids));
+
+    t_mem_usage predicates = mem_usage_ordered("predicates", m_predicates);
+    for (const auto& kv : m_predicates)
+    {
+        t_uindex bits = kv.second.m_bits->num_blocks()
+            * sizeof(t_vocab_bitset::block_type);
+        predicates.m_size += bits;
+        predicates.m_capacity += bits;
+    }
+    rv.add(predicates);
+    return rv;
+}
+
 void
 t_vocab::fill(
     const t_lstore& o_vlen, const t_lstore& o_extents, t_uindex vlenidx)
 {
-    m_vlendata->fill(o_vlen);
-    m_extents->fill(o_extents);
-    m_vlenidx = vlenidx;
+    if (m_vlendata->is_chunked() && !o_vlen.is_chunked())
+    {
+        // Offsets from a contiguous store may straddle chunks here,
+        // intern the strings again in order instead
+        m_vlendata->clear();
+        m_extents->clear();
+        m_map.clear();
+        m_vlenidx = 0;
+        for (t_uindex idx = 0; idx < vlenidx; ++idx)
+        {
+            const t_uidxpair* p = o_extents.get_nth<t_uidxpair>(idx);
+            get_interned(static_cast<const char*>(o_vlen.get_ptr(p->first)));
+        }
+    }
+    else
+    {
+        m_vlendata->fill(o_vlen);
+        m_extents->fill(o_extents);
+        m_vlenidx = vlenidx;
+    }
+    clear_predicate_cache();
 }
 
 void
@@ -187,6 +320,7 @@ t_vocab::copy_vocabulary(const t_vocab& other)
     m_vlendata = other.m_vlendata->clone();
     m_extents = other.m_extents->clone();
     rebuild_map();
+    clear_predicate_cache();
 }
 
 void
@@ -216,12 +350,14 @@ t_vocab::clone(const t_vocab& v)
     m_extents->fill(*(v.m_extents));
     m_vlenidx = v.m_vlenidx;
     rebuild_map();
+    clear_predicate_cache();
 }
 
 void
 t_vocab::set_vlenidx(t_uindex idx)
 {
     m_vlenidx = idx;
+    clear_predicate_cache();
 }
 
 t_lstore_sptr
@@ -242,4 +378,123 @@ t_vocab::get_vlenidx() const
     return m_vlenidx;
 }
 
+void
+t_vocab::clear_predicate_cache()
+{
+    m_sorted_ids.clear();
+    m_sorted_upto = 0;
+    m_predicates.clear();
+}
+
+void
+t_vocab::update_sorted_ids()
+{
+    if (m_sorted_upto == m_vlenidx)
+        return;
+
+    auto cmp = [this](t_stridx a, t_stridx b) {
+        return icmp(unintern_c(a), unintern_c(b)) < 0;
+    };
+
+    // Sort only the newly interned ids and merge them in
+    t_uindex osize = m_sorted_ids.size();
+    m_sorted_ids.reserve(m_vlenidx);
+    for (t_uindex idx = m_sorted_upto; idx < m_vlenidx; ++idx)
+    {
+        m_sorted_ids.push_back(idx);
+    }
+
+    auto mid = m_sorted_ids.begin() + osize;
+    std::sort(mid, m_sorted_ids.end(), cmp);
+    std::inplace_merge(m_sorted_ids.begin(), mid, m_sorted_ids.end(), cmp);
+    m_sorted_upto = m_vlenidx;
+}
+
+const std::vector<t_stridx>&
+t_vocab::get_sorted_ids()
+{
+    update_sorted_ids();
+    return m_sorted_ids;
+}
+
+t_uidxpair
+t_vocab::get_prefix_range(const t_str& prefix)
+{
+    update_sorted_ids();
+
+    t_str lprefix(prefix);
+    std::transform(lprefix.begin(), lprefix.end(), lprefix.begin(), lower_char);
+
+    auto biter = std::lower_bound(m_sorted_ids.begin(), m_sorted_ids.end(),
+        lprefix, [this](t_stridx a, const t_str& p) {
+            return icmp(unintern_c(a), p.c_str()) < 0;
+        });
+
+    // ids beginning with prefix are contiguous from biter
+    auto eiter = std::partition_point(biter, m_sorted_ids.end(),
+        [this, &lprefix](
+            t_stridx a) { return ibegins_with(unintern_c(a), lprefix); });
+
+    return t_uidxpair(
+        biter - m_sorted_ids.begin(), eiter - m_sorted_ids.begin());
+}
+
+t_vocab_bitset_csptr
+t_vocab::get_predicate_bits(t_filter_op op, const t_str& operand)
+{
+    t_str loperand(operand);
+    std::transform(
+        loperand.begin(), loperand.end(), loperand.begin(), lower_char);
+
+    auto key = std::make_pair(op, loperand);
+    auto iter = m_predicates.find(key);
+
+    if (iter == m_predicates.end())
+    {
+        if (m_predicates.size() >= PSP_VOCAB_PREDICATE_CACHE_SIZE)
+            m_predicates.clear();
+
+        t_vocab_predicate& pred = m_predicates[key];
+        pred.m_op = op;
+        pred.m_operand = loperand;
+        pred.m_bits = std::make_shared<t_vocab_bitset>(m_vlenidx);
+
+        if (op == FILTER_OP_BEGINS_WITH)
+        {
+            // prefix matches are a contiguous range of the sorted ids
+            t_uidxpair range = get_prefix_range(loperand);
+            for (t_uindex idx = range.first; idx < range.second; ++idx)
+            {
+                pred.m_bits->set(m_sorted_ids[idx]);
+            }
+        }
+        else
+        {
+            for (t_uindex idx = 0; idx < m_vlenidx; ++idx)
+            {
+                if (eval_predicate(op, unintern_c(idx), loperand))
+                    pred.m_bits->set(idx);
+            }
+        }
+
+        pred.m_upto = m_vlenidx;
+        return pred.m_bits;
+    }
+
+    t_vocab_predicate& pred = iter->second;
+
+    if (pred.m_upto < m_vlenidx)
+    {
+        pred.m_bits->resize(m_vlenidx);
+        for (t_uindex idx = pred.m_upto; idx < m_vlenidx; ++idx)
+        {
+            if (eval_predicate(op, unintern_c(idx), loperand))
+                pred.m_bits->set(idx);
+        }
+        pred.m_upto = m_vlenidx;
+    }
+
+    return pred.m_bits;
+}
+
 } // end namespace perspective
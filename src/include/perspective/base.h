@@ -139,7 +139,8 @@ enum t_select_mode
 enum t_backing_store
 {
     BACKING_STORE_MEMORY,
-    BACKING_STORE_DISK
+    BACKING_STORE_DISK,
+    BACKING_STORE_CHUNKED // fixed size heap chunks, addresses never move
 };
 
 enum t_filter_op
@@ -306,6 +307,7 @@ enum t_ctx_feature
     CTX_FEAT_DELTA,
     CTX_FEAT_ALERT,
     CTX_FEAT_ENABLED,
+    CTX_FEAT_LAZY_EXPANSION,
     CTX_FEAT_LAST_FEATURE
 };
 
@@ -145,6 +145,9 @@ public:
 
     void reserve(t_uindex idx);
 
+    // Releases capacity past nelems, which must not be below size
+    void shrink(t_uindex nelems);
+
     const t_lstore& data_lstore() const;
 
     t_uindex size() const;
@@ -179,6 +182,8 @@ public:
 
     void pprint() const;
 
+    t_mem_usage get_memory_usage(const t_str& name) const;
+
     void set_nth_body(t_uindex idx, const char* elem, t_status status);
 
     t_column_recipe get_recipe() const;
@@ -413,12 +418,23 @@ t_column::copy_helper(const t_column* other,
         = std::min(other->size(), static_cast<t_uindex>(indices.size()));
     reserve(eidx + offset);
 
-    const DATA_T* o_base = other->get_nth<DATA_T>(0);
-    DATA_T* base = get_nth<DATA_T>(0);
+    if (m_data->is_contiguous() && other->m_data->is_contiguous())
+    {
+        const DATA_T* o_base = other->get_nth<DATA_T>(0);
+        DATA_T* base = get_nth<DATA_T>(0);
 
-    for (t_uindex idx = 0; idx < eidx; ++idx)
+        for (t_uindex idx = 0; idx < eidx; ++idx)
+        {
+            base[idx + offset] = o_base[indices[idx]];
+        }
+    }
+    else
     {
-        base[idx + offset] = o_base[indices[idx]];
+        for (t_uindex idx = 0; idx < eidx; ++idx)
+        {
+            *get_nth<DATA_T>(idx + offset)
+                = *other->get_nth<DATA_T>(indices[idx]);
+        }
     }
 
     if (is_status_enabled() && other->is_status_enabled())
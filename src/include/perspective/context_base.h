@@ -19,6 +19,7 @@
 #include <perspective/step_delta.h>
 #include <perspective/slice.h>
 #include <perspective/range.h>
+#include <map>
 
 namespace perspective
 {
@@ -71,6 +72,17 @@ public:
 
     t_bool failed() const;
 
+    // While any viewport is subscribed, step deltas only carry values
+    // for cells inside a subscribed window
+    t_uindex subscribe_viewport(const t_viewport& viewport);
+    void unsubscribe_viewport(t_uindex id);
+    t_bool has_viewports() const;
+    t_viewportvec get_viewports() const;
+
+    // Whether a subscribed window changed in the last step, or any
+    // delta at all when nothing is subscribed
+    t_bool get_viewport_changed() const;
+
     t_ctx_common<t_ctxbase>
     common()
     {
@@ -86,6 +98,11 @@ public:
         const t_range& rng, const std::vector<t_fetch>& fvec) const;
 
 protected:
+    // Scopes delta capture to the subscribed windows, at step begin
+    void set_viewport_filter();
+    // Sets m_viewport_changed once the step is applied
+    void update_viewport_changed();
+
     t_schema m_schema;
     t_config m_config;
     t_bool m_rows_changed;
@@ -95,6 +112,12 @@ protected:
     t_bool m_init;
     std::vector<t_bool> m_features;
     t_minmaxvec m_minmax;
+    std::map<t_uindex, t_viewport> m_viewports;
+    t_uindex m_next_viewport;
+    t_bool m_viewport_changed;
+    // Cells of each viewport at step begin, in the layout of
+    // get_viewport_rows
+    std::vector<std::vector<t_uindex>> m_viewport_rows;
 };
 
 template <typename DERIVED_T>
@@ -111,6 +134,8 @@ t_ctxbase<DERIVED_T>::t_ctxbase()
     : m_rows_changed(true)
     , m_columns_changed(true)
     , m_init(false)
+    , m_next_viewport(0)
+    , m_viewport_changed(false)
 {
     m_features = std::vector<t_bool>(CTX_FEAT_LAST_FEATURE);
     m_features[CTX_FEAT_ENABLED] = true;
@@ -124,6 +149,8 @@ t_ctxbase<DERIVED_T>::t_ctxbase(const t_schema& schema, const t_config& config)
     , m_rows_changed(true)
     , m_columns_changed(true)
     , m_init(false)
+    , m_next_viewport(0)
+    , m_viewport_changed(false)
 {
     m_features = std::vector<t_bool>(CTX_FEAT_LAST_FEATURE);
     m_features[CTX_FEAT_ENABLED] = true;
@@ -206,6 +233,137 @@ t_ctxbase<DERIVED_T>::failed() const
     return false;
 }
 
+template <typename DERIVED_T>
+t_uindex
+t_ctxbase<DERIVED_T>::subscribe_viewport(const t_viewport& viewport)
+{
+    t_uindex id = m_next_viewport++;
+    m_viewports[id] = viewport;
+    return id;
+}
+
+template <typename DERIVED_T>
+void
+t_ctxbase<DERIVED_T>::unsubscribe_viewport(t_uindex id)
+{
+    m_viewports.erase(id);
+}
+
+template <typename DERIVED_T>
+t_bool
+t_ctxbase<DERIVED_T>::has_viewports() const
+{
+    return !m_viewports.empty();
+}
+
+template <typename DERIVED_T>
+t_viewportvec
+t_ctxbase<DERIVED_T>::get_viewports() const
+{
+    t_viewportvec rval;
+    rval.reserve(m_viewports.size());
+    for (const auto& kv : m_viewports)
+    {
+        rval.push_back(kv.second);
+    }
+    return rval;
+}
+
+template <typename DERIVED_T>
+t_bool
+t_ctxbase<DERIVED_T>::get_viewport_changed() const
+{
+    if (m_viewports.empty())
+        return reinterpret_cast<const DERIVED_T*>(this)->has_deltas();
+    return m_viewport_changed;
+}
+
+// DERIVED_T supplies the delta sets it captures cells into with
+// get_viewport_deltas, and the cells of a viewport with
+// get_viewport_rows, as flattened (delta set, row) pairs. The latter
+// also flags the delta columns the viewport covers, leaving columns
+// empty to keep them all. Rows not in any delta set are m_npos.
+template <typename DERIVED_T>
+void
+t_ctxbase<DERIVED_T>::set_viewport_filter()
+{
+    auto derived = static_cast<DERIVED_T*>(this);
+    std::vector<t_cell_deltas*> deltas = derived->get_viewport_deltas();
+    m_viewport_rows.clear();
+    if (m_viewports.empty())
+    {
+        for (auto d : deltas)
+        {
+            d->clear_filter();
+        }
+        return;
+    }
+
+    std::vector<std::vector<t_uindex>> rows(deltas.size());
+    std::vector<t_bool> columns;
+    for (const auto& kv : m_viewports)
+    {
+        m_viewport_rows.push_back(std::vector<t_uindex>());
+        const auto& cells = m_viewport_rows.back();
+        derived->get_viewport_rows(kv.second, m_viewport_rows.back(), columns);
+        for (t_uindex idx = 0, loop_end = cells.size(); idx < loop_end;
+             idx += 2)
+        {
+            if (cells[idx + 1] != t_cell_deltas::m_npos)
+                rows[cells[idx]].push_back(cells[idx + 1]);
+        }
+    }
+
+    for (t_uindex didx = 0, loop_end = deltas.size(); didx < loop_end;
+         ++didx)
+    {
+        deltas[didx]->set_filter(rows[didx], columns);
+    }
+}
+
+template <typename DERIVED_T>
+void
+t_ctxbase<DERIVED_T>::update_viewport_changed()
+{
+    if (m_viewports.empty())
+        return;
+
+    auto derived = static_cast<DERIVED_T*>(this);
+
+    // Without deltas there is nothing to narrow the check down with
+    if (!get_feature_state(CTX_FEAT_DELTA))
+    {
+        m_viewport_changed = derived->has_deltas();
+        return;
+    }
+
+    std::vector<t_cell_deltas*> deltas = derived->get_viewport_deltas();
+    t_uindex vidx = 0;
+    std::vector<t_uindex> cells;
+    std::vector<t_bool> columns;
+    for (const auto& kv : m_viewports)
+    {
+        cells.clear();
+        derived->get_viewport_rows(kv.second, cells, columns);
+
+        // Rows that moved into the window have no old values to
+        // report, so the client has to refetch it
+        if (vidx >= m_viewport_rows.size() || cells != m_viewport_rows[vidx])
+        {
+            m_rows_changed = true;
+            m_viewport_changed = true;
+        }
+
+        for (t_uindex idx = 0, loop_end = cells.size(); idx < loop_end;
+             idx += 2)
+        {
+            if (deltas[cells[idx]]->has_row(cells[idx + 1]))
+                m_viewport_changed = true;
+        }
+        ++vidx;
+    }
+}
+
 template <typename DERIVED_T>
 t_bool
 t_ctxbase<DERIVED_T>::get_feature_state(t_ctx_feature feature) const
@@ -72,6 +72,8 @@ t_dtype get_column_dtype(t_uindex idx) const;
 
 t_table_sptr get_table() const;
 
+t_mem_usage get_memory_usage() const;
+
 // Unity api
 t_tscalvec unity_get_row_data(t_uindex idx) const;
 t_tscalvec unity_get_column_data(t_uindex idx) const;
@@ -13,6 +13,8 @@
 #include <perspective/path.h>
 #include <perspective/traversal_nodes.h>
 #include <perspective/sort_specification.h>
+#include <perspective/sparse_tree_node.h>
+#include <unordered_map>
 
 namespace perspective
 {
@@ -56,8 +58,46 @@ public:
         void*) const;
 
 private:
+    friend class t_ctxbase<t_ctx_grouped_pkey>;
+
     void rebuild();
 
+    // Applies a batch to the tree in place. Returns false when the
+    // batch needs a rebuild instead, e.g. it closes a cycle.
+    t_bool update_tree(const t_table& flattened, const t_table& current);
+    t_bool add_tree_node(const t_tscalar& pkey, const t_tscalar& child,
+        const t_tscalar& parent, const t_tscalar& sortby_value,
+        const std::vector<t_uindex>& aggnums, const t_tscalvec& aggvalues);
+    t_bool update_tree_node(t_uindex nidx, const t_tscalar& child,
+        const t_tscalar& parent, const t_tscalar& sortby_value,
+        const std::vector<t_uindex>& aggnums, const t_tscalvec& aggvalues);
+    void remove_tree_node(t_uindex nidx);
+
+    // Tree node parent should be under, 0 for root children. Sets
+    // orphan when the parent is missing.
+    t_uindex resolve_parent(const t_tscalar& child, const t_tscalar& parent,
+        t_bool& orphan) const;
+
+    // Moves the children of nidx under the root until a node with
+    // the child value of nidx shows up again
+    void release_children(t_uindex nidx);
+
+    // Moves nodes waiting on child under nidx
+    t_bool adopt_orphans(const t_tscalar& child, t_uindex nidx);
+    void add_orphan(const t_tscalar& parent, t_uindex nidx);
+    void remove_orphan(t_uindex nidx);
+
+    // Replaces a tree node, fixing up depths below it and its place
+    // in the traversal. Expanded nodes under it stay expanded.
+    void relink_node(const t_stnode& node);
+    t_bool is_ancestor(t_uindex nidx, t_uindex desc) const;
+
+    // Tree nodes of the rows in viewport, in view order, each after
+    // its delta set, 0
+    void get_viewport_rows(const t_viewport& viewport,
+        std::vector<t_uindex>& out, std::vector<t_bool>& columns) const;
+    std::vector<t_cell_deltas*> get_viewport_deltas();
+
     t_trav_sptr m_traversal;
     t_stree_sptr m_tree;
     t_sortsvec m_sortby;
@@ -65,6 +105,16 @@ private:
     t_bool m_has_label;
     t_depth m_depth;
     t_bool m_depth_set;
+
+    // Set while the tree holds every row, so batches can be applied
+    // in place
+    t_bool m_incremental;
+    std::unordered_map<t_tscalar, t_uindex> m_pkey_nidx;
+    std::unordered_map<t_tscalar, t_uindex> m_child_nidx;
+    std::unordered_multimap<t_tscalar, t_uindex> m_orphans;
+    std::unordered_map<t_uindex, t_tscalar> m_orphan_parents;
+    std::vector<t_uindex> m_free_nidx;
+    t_uindex m_next_nidx;
 };
 
 typedef std::shared_ptr<t_ctx_grouped_pkey> t_ctx_grouped_pkey_sptr;
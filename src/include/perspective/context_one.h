@@ -41,6 +41,10 @@ public:
     void set_depth(t_depth depth);
     t_depth get_depth() const;
 
+    // Defer sorting and materializing rows expanded by set_depth
+    // until they are read
+    void set_lazy_expansion(bool enabled_state);
+
     t_minmax get_agg_min_max(t_uindex aggidx, t_depth depth) const;
 
     t_index get_row_idx(const t_tscalvec& path) const;
@@ -52,6 +56,14 @@ public:
         t_uindex start_col, t_uindex end_col) const;
 
 private:
+    friend class t_ctxbase<t_ctx1>;
+
+    // Tree nodes of the rows in viewport, in view order, each after
+    // its delta set, 0
+    void get_viewport_rows(const t_viewport& viewport,
+        std::vector<t_uindex>& out, std::vector<t_bool>& columns) const;
+    std::vector<t_cell_deltas*> get_viewport_deltas();
+
     t_trav_sptr m_traversal;
     t_stree_sptr m_tree;
     t_sortsvec m_sortby;
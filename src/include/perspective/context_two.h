@@ -47,11 +47,17 @@ public:
     void set_depth(t_header header, t_depth depth);
     t_depth get_depth(t_header header) const;
 
+    // Defer sorting and materializing rows expanded by set_depth
+    // until they are read
+    void set_lazy_expansion(bool enabled_state);
+
     t_uindex get_leaf_count(t_header header) const;
     t_tscalvec get_leaf_data(t_uindex start_row, t_uindex end_row,
         t_uindex start_col, t_uindex end_col) const;
 
 protected:
+    friend class t_ctxbase<t_ctx2>;
+
     t_cinfovec resolve_cells(const std::vector<t_uidxpair>& cells) const;
 
     t_stree_sptr rtree();
@@ -69,6 +75,15 @@ protected:
 
     t_uindex calc_translated_colidx(t_uindex n_aggs, t_uindex cidx) const;
 
+    void init_trees();
+    void notify_tree(
+        t_uindex tree_idx, t_table_sptr strands, t_table_sptr strand_deltas);
+
+    // Tree and node of each cell in viewport, as flattened pairs
+    void get_viewport_rows(const t_viewport& viewport,
+        std::vector<t_uindex>& out, std::vector<t_bool>& columns) const;
+    std::vector<t_cell_deltas*> get_viewport_deltas();
+
 private:
     t_trav_sptr m_rtraversal;
     t_trav_sptr m_ctraversal;
@@ -81,6 +96,10 @@ private:
     t_bool m_row_depth_set;
     t_depth m_column_depth;
     t_bool m_column_depth_set;
+
+    // Set when the coarser trees can be rolled up from the strands of
+    // rtree, see init_trees
+    t_bool m_rollup;
 };
 
 typedef std::shared_ptr<t_ctx2> t_ctx2_sptr;
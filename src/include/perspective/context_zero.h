@@ -12,6 +12,7 @@
 #include <perspective/context_base.h>
 #include <perspective/sort_specification.h>
 #include <perspective/shared_ptrs.h>
+#include <perspective/sym_table.h>
 
 namespace perspective
 {
@@ -30,23 +31,52 @@ public:
 
     t_tscalar get_column_name(t_index idx);
 
+    // Also hands the gstate to the traversal, which reads pkeys from it
+    void set_state(t_gstate_sptr state);
+
     std::vector<t_str> get_column_names() const;
 
     void sort_by();
     t_sortsvec get_sort_by() const;
 
+    // Keep only the first nrows rows, plus the range last read, in
+    // sort order. 0 sorts every row.
+    void set_topk(t_uindex nrows);
+
+    // Follows gstate rows moved by compaction, pairs are (from, to)
+    void remap_rows(const std::vector<t_uidxpair>& moves);
+
 protected:
+    friend class t_ctxbase<t_ctx0>;
+
     t_tscalvec get_all_pkeys(const std::vector<t_uidxpair>& cells) const;
 
-    void calc_step_delta(const t_table& flattened, const t_table& prev,
-        const t_table& curr, const t_table& transitions);
+    // row_ids holds the gstate row of each flattened row, m_npos for
+    // deleted ones
+    void calc_step_delta(const std::vector<t_uindex>& row_ids,
+        const t_table& prev, const t_table& curr, const t_table& transitions);
+
+    // gstate rows of the cells in viewport, in view order, each after
+    // its delta set, 0
+    void get_viewport_rows(const t_viewport& viewport,
+        std::vector<t_uindex>& out, std::vector<t_bool>& columns) const;
+    std::vector<t_cell_deltas*> get_viewport_deltas();
+
+    // Clears the cell deltas and retires the strings of the step
+    // before the one being cleared
+    void clear_cell_deltas();
 
 private:
     t_ftrav_sptr m_traversal;
-    t_sptr_zcdeltas m_deltas;
+    t_cell_deltas m_deltas;
     t_minmaxvec m_minmax;
     t_symtable_sptr m_symtable;
+    // Strings of the values in m_deltas at m_delta_gen, and of the
+    // values returned before its last clear at the other slot
+    t_intern_lease m_delta_strings[2];
+    t_uindex m_delta_gen;
     t_bool m_has_delta;
+    t_uindex m_topk;
 };
 
 typedef std::shared_ptr<t_ctx0> t_ctx0_sptr;
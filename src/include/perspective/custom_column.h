@@ -11,7 +11,9 @@
 #include <perspective/first.h>
 #include <perspective/base.h>
 #include <perspective/exports.h>
+#include <perspective/expression.h>
 
+#include <memory>
 #include <vector>
 
 namespace perspective
@@ -30,6 +32,9 @@ struct PERSPECTIVE_EXPORT t_custom_column_recipe
 
 typedef std::vector<t_custom_column_recipe> t_custom_column_recipevec;
 
+// Column m_ocol computed from m_expr, see t_expression. With where
+// keys, m_ocol is the where value of the first key equal to m_expr,
+// or m_base_case when none is (null if it is empty).
 class PERSPECTIVE_EXPORT t_custom_column
 {
 public:
@@ -46,6 +51,19 @@ public:
     const std::vector<t_str>& get_where_values() const;
     const t_str& get_base_case() const;
 
+    // Compiles the expression against schema, which holds m_ocol
+    void init(const t_schema& schema);
+
+    // Columns the compiled expression reads
+    const std::vector<t_str>& get_expression_icols() const;
+
+    // Fills m_ocol for every row of tbl
+    void compute(t_table& tbl) const;
+    void compute(t_table& tbl, const std::vector<t_uindex>& rows) const;
+
+    // Rows computed so far, for tests
+    t_uindex get_num_computed() const;
+
 private:
     std::vector<t_str> m_icols;
     t_str m_ocol;
@@ -53,6 +71,8 @@ private:
     std::vector<t_str> m_where_keys;
     std::vector<t_str> m_where_values;
     t_str m_base_case;
+    std::shared_ptr<const t_expression> m_expression;
+    mutable t_uindex m_num_computed;
 };
 
 typedef std::vector<t_custom_column> t_ccol_vec;
@@ -16,6 +16,7 @@
 #include <perspective/shared_ptrs.h>
 #include <perspective/tree_iterator.h>
 #include <perspective/column.h>
+#include <perspective/partition.h>
 #include <map>
 
 // Pass filter in and store the filter on the tree
@@ -40,6 +41,12 @@ public:
         const std::vector<t_sspair>& sortby_columns);
 
     void init();
+
+    // Order of children within a node. Defaults to sorted,
+    // hashed grouping is cheaper for wide keys when the consumer
+    // does not depend on child order.
+    void set_partition_order(t_partition_order order);
+
     t_str repr() const;
     t_str leaves_colname() const;
     t_str nodes_colname() const;
@@ -85,6 +92,7 @@ private:
     std::vector<t_sspair> m_sortby_colvec;
     std::map<t_str, t_str> m_sortby_columns;
     std::vector<t_bool> m_has_sortby;
+    t_partition_order m_partition_order;
 };
 
 typedef std::shared_ptr<t_dtree> t_dtree_sptr;
@@ -0,0 +1,122 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <perspective/schema.h>
+#include <vector>
+
+namespace perspective
+{
+
+class t_table;
+class t_column;
+
+enum t_expr_op
+{
+    EXPR_COLUMN,
+    EXPR_NUMBER,
+    EXPR_STRING,
+    EXPR_NULL,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_MOD,
+    EXPR_POW,
+    EXPR_MIN,
+    EXPR_MAX,
+    EXPR_NEG,
+    EXPR_ABS,
+    EXPR_SQRT,
+    EXPR_LOG,
+    EXPR_EXP,
+    EXPR_FLOOR,
+    EXPR_CEIL,
+    EXPR_ROUND,
+    EXPR_EQ,
+    EXPR_NE,
+    EXPR_LT,
+    EXPR_LE,
+    EXPR_GT,
+    EXPR_GE,
+    EXPR_AND,
+    EXPR_OR,
+    EXPR_NOT,
+    EXPR_IF,
+    EXPR_ISNULL,
+    EXPR_LEN,
+    EXPR_UPPER,
+    EXPR_LOWER,
+    EXPR_CONCAT
+};
+
+enum t_expr_type
+{
+    EXPR_TYPE_NUMBER,
+    EXPR_TYPE_BOOL,
+    EXPR_TYPE_STRING,
+    EXPR_TYPE_NULL
+};
+
+// One step of a compiled expression. Step i writes register i from
+// the registers m_a, m_b and m_c of earlier steps.
+struct PERSPECTIVE_EXPORT t_expr_instr
+{
+    t_expr_op m_op;
+    t_expr_type m_type;
+    t_uindex m_a;
+    t_uindex m_b;
+    t_uindex m_c;
+    t_float64 m_number;
+    t_str m_string;
+};
+
+// Computed column expression, compiled to a typed program that runs
+// over blocks of rows. The language has numbers, 'strings', null,
+// true, false, column names (bare, or "quoted" when they are not
+// identifiers), + - * / % and unary -, == != < <= > >=, and, or, not
+// (also && || !), and the functions
+//
+//     if(cond, a, b) isnull(x) abs sqrt log exp floor ceil round
+//     pow(x, y) min(x, y) max(x, y) len(s) upper(s) lower(s)
+//     concat(a, b, ...)
+//
+// Numbers evaluate as float64. A result is null wherever an input it
+// depends on is null, isnull and the untaken branch of if aside.
+// Syntax and type errors abort.
+class PERSPECTIVE_EXPORT t_expression
+{
+public:
+    t_expression(const t_str& expr, const t_schema& schema);
+
+    // DTYPE_FLOAT64, DTYPE_BOOL or DTYPE_STR
+    t_dtype get_dtype() const;
+    const std::vector<t_str>& get_icols() const;
+
+    // Whether results can be stored in a column of dtype
+    t_bool can_store_as(t_dtype dtype) const;
+
+    // Evaluates every row of tbl into out
+    void compute(const t_table& tbl, t_column* out) const;
+
+    // Evaluates rows of tbl into the same rows of out
+    void compute(const t_table& tbl, const std::vector<t_uindex>& rows,
+        t_column* out) const;
+
+private:
+    friend class t_expr_parser;
+
+    std::vector<t_str> m_icols;
+    std::vector<t_expr_instr> m_program;
+};
+
+} // end namespace perspective
@@ -194,6 +194,16 @@ struct PERSPECTIVE_EXPORT t_fterm
         return m_negated ? (!rv) : rv;
     }
 
+    // True for string predicates which can be evaluated once
+    // per distinct string via t_vocab::get_predicate_bits
+    inline bool
+    uses_vocab_predicate() const
+    {
+        return (m_op == FILTER_OP_BEGINS_WITH || m_op == FILTER_OP_ENDS_WITH
+                   || m_op == FILTER_OP_CONTAINS)
+            && m_threshold.m_type == DTYPE_STR;
+    }
+
     t_str get_expr() const;
 
     void coerce_numeric(t_dtype dtype);
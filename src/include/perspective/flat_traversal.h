@@ -27,16 +27,28 @@
 namespace perspective
 {
 
+// Sorted rows of a flat context.
+//
+// With a top-K set, only a prefix of the index is kept in order: the
+// first K rows plus whatever range was last read. Rows past the prefix
+// are unordered, but none of them sorts before the last prefix row, so
+// reads past it extend the prefix with a partition and a sort of the
+// range read. On ticks, changed rows that stay past the prefix cost a
+// single comparison.
+//
+// Rows are identified by their gstate row. Pkeys are read from the
+// gstate, for output and to break ties.
 class PERSPECTIVE_EXPORT t_ftrav
 {
-    typedef std::unordered_map<t_tscalar, t_index> t_pkeyidx_map;
-    typedef std::unordered_map<t_tscalar, t_mselem> t_pkmselem_map;
+    typedef std::unordered_map<t_uindex, t_mselem> t_ridxmselem_map;
 
 public:
     t_ftrav(t_bool handle_nan_sort);
 
     void init();
 
+    void set_state(t_gstate_csptr state);
+
     t_tscalvec get_all_pkeys(const std::vector<t_uidxpair>& cells) const;
 
     t_tscalvec get_pkeys(const std::vector<t_uidxpair>& cells) const;
@@ -44,13 +56,21 @@ public:
     t_tscalvec get_pkeys() const;
     t_tscalvec get_pkeys(t_tvidx begin_row, t_tvidx end_row) const;
 
+    // gstate rows, in the order of cells or of the index
+    std::vector<t_uindex> get_all_rows(
+        const std::vector<t_uidxpair>& cells) const;
+    std::vector<t_uindex> get_rows(t_tvidx begin_row, t_tvidx end_row) const;
+
+    // All gstate rows, in no particular order
+    std::vector<t_uindex> get_unordered_rows() const;
+
     t_tscalar get_pkey(t_tvidx idx) const;
 
     void fill_sort_elem(t_gstate_csptr state, const t_config& config,
         const t_tscalvec& row, t_mselem& out_elem) const;
 
     void fill_sort_elem(t_gstate_csptr state, const t_config& config,
-        t_tscalar pkey, t_mselem& out_elem);
+        t_uindex ridx, t_mselem& out_elem);
 
     void sort_by(
         t_gstate_csptr state, const t_config& config, const t_sortsvec& sortby);
@@ -72,12 +92,15 @@ public:
 
     void step_end();
 
-    void add_row(t_gstate_csptr state, const t_config& config, t_tscalar pkey);
+    void add_row(t_gstate_csptr state, const t_config& config, t_uindex ridx);
 
     void update_row(
-        t_gstate_csptr state, const t_config& config, t_tscalar pkey);
+        t_gstate_csptr state, const t_config& config, t_uindex ridx);
+
+    void delete_row(t_uindex ridx);
 
-    void delete_row(t_tscalar pkey);
+    // Follows gstate rows moved by compaction, pairs are (from, to)
+    void remap_rows(const std::vector<t_uidxpair>& moves);
 
     t_sortsvec get_sort_by() const;
     t_bool empty_sort_by() const;
@@ -87,17 +110,70 @@ public:
     t_uindex lower_bound_row_idx(t_gstate_csptr state, const t_config& config,
         const t_tscalvec& row) const;
 
-    t_index get_row_idx(t_tscalar pkey) const;
+    t_index get_row_idx(t_uindex ridx) const;
+
+    t_mem_usage get_memory_usage() const;
+
+    // Keep only the first nrows rows, plus the range last read, in
+    // order. 0 keeps the whole index sorted.
+    void set_topk(t_uindex nrows);
+    t_uindex get_topk() const;
 
 private:
+    // Orders elements by their sort values, then by pkey
+    struct t_sorter
+    {
+        t_sorter(const t_ftrav* trav);
+
+        bool operator()(const t_mselem& a, const t_mselem& b) const;
+
+        const t_ftrav* m_trav;
+        std::vector<t_sorttype> m_sort_order;
+    };
+
+    // m_ridx of elements without a row, and of m_bound
+    static const t_uindex m_npos = static_cast<t_uindex>(-1);
+    static const t_uindex m_bound_ridx = static_cast<t_uindex>(-2);
+
+    t_tscalar get_elem_pkey(const t_mselem& elem) const;
+
+    // The row of m_bound may be erased during a step, so its pkey is
+    // kept aside
+    void set_bound(const t_mselem& elem) const;
+
+    t_bool is_partial() const;
+
+    // Index position of gstate row ridx, -1 if absent
+    t_index find_row(t_uindex ridx) const;
+    void set_row(t_uindex ridx, t_index idx) const;
+
+    // Makes rows [0, eidx) final, const as it only reorders rows
+    // that were not read yet
+    void ensure_sorted(t_index eidx) const;
+    void sort_prefix(t_index eidx) const;
+    void step_end_partial();
+    void reindex(t_index bidx, t_index eidx) const;
+
     t_index m_step_deletes;
     t_index m_step_inserts;
-    t_pkeyidx_map m_pkeyidx;
-    t_pkmselem_map m_new_elems;
+    mutable std::vector<t_index> m_rowidx;
+    t_ridxmselem_map m_new_elems;
     t_sortsvec m_sortby;
     t_mselemvec_sptr m_index;
+    t_gstate_csptr m_state;
     t_bool m_handle_nan_sort;
     t_symtable m_symtable;
+
+    t_uindex m_topk;
+    // Rows [0, m_sorted_end) are sorted and no later row sorts
+    // before m_bound, the last of them
+    mutable t_index m_sorted_end;
+    mutable t_mselem m_bound;
+    mutable t_tscalar m_bound_pkey;
+    // End of the furthest range read since the last tick
+    mutable t_index m_window_end;
+    // Index positions updated or deleted during this step
+    std::vector<t_index> m_step_changed;
 };
 
 typedef std::shared_ptr<t_ftrav> t_ftrav_sptr;
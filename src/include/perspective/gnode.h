@@ -15,8 +15,10 @@
 #include <perspective/context_handle.h>
 #include <perspective/env_vars.h>
 #include <perspective/custom_column.h>
+#include <perspective/retention.h>
 #include <perspective/shared_ptrs.h>
 #include <perspective/rlookup.h>
+#include <perspective/tick_arena.h>
 #ifdef PSP_PARALLEL_FOR
 #include <tbb/parallel_sort.h>
 #include <tbb/tbb.h>
@@ -28,8 +30,32 @@ namespace perspective
 
 struct PERSPECTIVE_EXPORT t_gnode_options
 {
+    t_gnode_options();
     t_gnode_type m_gnode_type;
     t_schema m_port_schema;
+    // storage of the gnode state table, BACKING_STORE_CHUNKED avoids
+    // reallocating existing rows as the table grows
+    t_backing_store m_backing_store;
+    // Compact the state table once this fraction of its rows is
+    // free, 0 never compacts
+    t_float64 m_compaction_threshold;
+    // Rows moved per step while compacting, 0 compacts in one go
+    t_uindex m_compaction_budget;
+    // Retention policy, enforced by deleting rows during _process.
+    // Keeps at most m_retention_rows rows, 0 keeping all of them.
+    // With m_retention_column naming a DTYPE_TIME column, rows older
+    // than its newest value minus m_retention_age are deleted too,
+    // and the row bound drops the oldest rows by that column.
+    t_uindex m_retention_rows;
+    t_str m_retention_column;
+    t_int64 m_retention_age;
+    // Implicit pkey gnodes only: keep the last m_ring_capacity rows in
+    // a fixed size state table, evicting older rows as deletes.
+    // 0 lets the table grow.
+    t_uindex m_ring_capacity;
+    // Columns of m_port_schema computed from expressions over the
+    // other columns, see t_custom_column
+    t_custom_column_recipevec m_custom_columns;
 };
 
 struct PERSPECTIVE_EXPORT t_gnode_recipe
@@ -68,6 +94,7 @@ public:
     static t_gnode_sptr build(const t_gnode_options& options);
     t_gnode(const t_gnode_recipe& recipe);
     t_gnode(const t_gnode_options& options);
+    t_gnode(t_gnode&& other);
     ~t_gnode();
     void init();
 
@@ -87,6 +114,8 @@ public:
         t_bool cur_valid, t_bool prev_cur_eq, t_bool prev_pkey_eq);
 
     void pprint() const;
+
+    t_mem_usage get_memory_usage() const;
     std::vector<t_str> get_registered_contexts() const;
 
     t_streeptr_vec get_trees();
@@ -98,6 +127,14 @@ public:
     void release_outputs();
     std::vector<t_str> get_contexts_last_updated() const;
 
+    // Contexts whose subscribed viewports changed in the last step
+    std::vector<t_str> get_viewports_last_updated() const;
+
+    // Moves up to max_moves live state rows into free rows, 0 moving
+    // all of them, and remaps contexts. Returns true when no free
+    // rows are left.
+    t_bool compact(t_uindex max_moves);
+
     void reset();
     t_str repr() const;
     void clear_input_ports();
@@ -149,19 +186,35 @@ protected:
     template <typename DATA_T>
     void _process_helper(const t_column* fcolumn, const t_column* scolumn,
         t_column* dcolumn, t_column* pcolumn, t_column* ccolumn,
-        t_column* tcolumn, const t_uint8* op_base, std::vector<t_rlookup>& lkup,
-        std::vector<t_bool>& prev_pkey_eq_vec,
-        std::vector<t_uindex>& added_vec);
+        t_column* tcolumn, const t_uint8* op_base,
+        t_tick_vec<t_rlookup>& lkup, t_tick_vec<t_bool>& prev_pkey_eq_vec,
+        t_tick_vec<t_uindex>& added_vec);
 
     void _update_contexts_from_state(const t_table& tbl);
     void _update_contexts_from_state();
 
 private:
-    void populate_icols_in_flattened(
-        const std::vector<t_rlookup>& lkup, t_table_sptr& flat) const;
+    // Rows of flat each custom column recomputes: new rows, and rows
+    // setting one of its inputs directly or through a custom column
+    // it depends on
+    void get_custom_column_rows(const t_tick_vec<t_rlookup>& lkup,
+        const t_table& flat, std::vector<std::vector<t_uindex>>& rows) const;
+    void populate_icols_in_flattened(const t_tick_vec<t_rlookup>& lkup,
+        const std::vector<std::vector<t_uindex>>& rows, t_table& flat) const;
+    void compute_custom_columns(t_table& flat) const;
+    void compute_custom_columns(
+        const std::vector<std::vector<t_uindex>>& rows, t_table& flat) const;
+
+    // Appends deletes for rows expired by the retention policy to
+    // the input table
+    void apply_retention(t_table* tbl);
+
+    // Appends deletes for pkeys to the input table
+    void append_deletes(t_table* tbl, const t_tscalvec& pkeys);
 
     t_gnode_processing_mode m_mode;
     t_gnode_type m_gnode_type;
+    t_backing_store m_backing_store;
     t_schema m_tblschema;
     t_schemavec m_ischemas;
     t_schemavec m_oschemas;
@@ -174,16 +227,27 @@ private:
     std::chrono::high_resolution_clock::time_point m_epoch;
     t_ccol_vec m_custom_columns;
     std::set<t_str> m_expr_icols;
+    std::vector<std::vector<t_uindex>> m_custom_column_deps;
     std::function<void()> m_pool_cleanup;
     t_bool m_was_updated;
+    t_float64 m_compaction_threshold;
+    t_uindex m_compaction_budget;
+    // Set while a compaction is spread over several steps
+    t_bool m_compacting;
+    t_retention m_retention;
+    t_uindex m_ring_capacity;
+    // Next implicit pkey, pkeys are not reused once rows are deleted
+    t_uindex m_implicit_pkey;
+    // Temporaries of _process, reset at the end of every tick
+    t_tick_arena m_tick_arena;
 };
 
 template <>
 void t_gnode::_process_helper<t_str>(const t_column* fcolumn,
     const t_column* scolumn, t_column* dcolumn, t_column* pcolumn,
     t_column* ccolumn, t_column* tcolumn, const t_uint8* op_base,
-    std::vector<t_rlookup>& lkup, std::vector<t_bool>& prev_pkey_eq_vec,
-    std::vector<t_uindex>& added_vec);
+    t_tick_vec<t_rlookup>& lkup, t_tick_vec<t_bool>& prev_pkey_eq_vec,
+    t_tick_vec<t_uindex>& added_vec);
 
 template <typename CTX_T>
 void
@@ -242,8 +306,8 @@ template <typename DATA_T>
 void
 t_gnode::_process_helper(const t_column* fcolumn, const t_column* scolumn,
     t_column* dcolumn, t_column* pcolumn, t_column* ccolumn, t_column* tcolumn,
-    const t_uint8* op_base, std::vector<t_rlookup>& lkup,
-    std::vector<t_bool>& prev_pkey_eq_vec, std::vector<t_uindex>& added_vec)
+    const t_uint8* op_base, t_tick_vec<t_rlookup>& lkup,
+    t_tick_vec<t_bool>& prev_pkey_eq_vec, t_tick_vec<t_uindex>& added_vec)
 {
     for (t_uindex idx = 0, loop_end = fcolumn->size(); idx < loop_end; ++idx)
     {
@@ -13,10 +13,10 @@
 #include <perspective/base.h>
 #include <perspective/table.h>
 #include <boost/unordered_map.hpp>
-#include <boost/unordered_set.hpp>
 #include <perspective/mask.h>
 #include <perspective/sym_table.h>
 #include <perspective/rlookup.h>
+#include <set>
 
 namespace perspective
 {
@@ -27,26 +27,55 @@ class PERSPECTIVE_EXPORT t_gstate
 {
     typedef boost::unordered_map<t_tscalar, t_uindex> t_mapping;
 
-    typedef boost::unordered_set<t_uindex> t_free_items;
+    // Ordered, so the lowest holes are filled first and the table
+    // stays dense at the front
+    typedef std::set<t_uindex> t_free_items;
 
 public:
     t_gstate(const t_schema& tblschema, const t_schema& pkeyed_schema);
+    t_gstate(const t_schema& tblschema, const t_schema& pkeyed_schema,
+        t_backing_store backing_store);
     ~t_gstate();
     void init();
 
     t_rlookup lookup(t_tscalar pkey) const;
     t_uindex lookup_or_create(const t_tscalar& pkey);
 
+    // Row pkey held until the last update_history erased it. Erased
+    // rows are only reused from the next update_history on, so
+    // contexts can still resolve deletes by row.
+    t_rlookup lookup_erased(t_tscalar pkey) const;
+
     void _mark_deleted(t_uindex idx);
     void erase(const t_tscalar& pkey);
 
     void update_history(const t_table* tbl);
+
+    // Fraction of table rows that hold no pkey
+    t_float64 get_fragmentation() const;
+
+    // Moves up to max_moves live rows off the end of the table into
+    // the lowest free rows, 0 moving as many as needed, and trims the
+    // free rows left at the end. Each move is appended to moves as
+    // (old row, new row). Once no free rows remain the table
+    // capacity is shrunk to fit. Returns true when fully compacted.
+    t_bool compact(t_uindex max_moves, std::vector<t_uidxpair>& moves);
+
+    // Ring mode for implicit pkeys: pkey p lives in row p % capacity
+    // of a table reserved up front, so appends never reallocate and
+    // rows are neither freed nor compacted. The caller deletes a pkey
+    // in the same batch its row is taken over. 0 turns it off.
+    void set_ring_capacity(t_uindex capacity);
+    t_uindex get_ring_capacity() const;
     t_mask get_cpp_mask() const;
 
     t_tscalar get_value(const t_tscalar& pkey, const t_str& colname) const;
 
     void read_column(const t_str& colname, const t_tscalvec& pkeys,
         t_tscalvec& out_data) const;
+    // By row, for callers that already hold rows
+    void read_column(const t_str& colname, const std::vector<t_uindex>& rows,
+        t_tscalvec& out_data) const;
     void read_column(const t_str& colname, const t_tscalvec& pkeys,
         std::vector<t_float64>& out_data) const;
     void read_column(const t_str& colname, const t_tscalvec& pkeys,
@@ -68,7 +97,13 @@ public:
 
     void pprint() const;
 
+    t_mem_usage get_memory_usage() const;
+
     t_tscalar get(t_tscalar pkey, const t_str& colname) const;
+    t_tscalar get_at(t_uindex idx, const t_str& colname) const;
+    t_tscalar get_pkey(t_uindex idx) const;
+    // Also resolves rows erased by the last update_history
+    t_tscalar get_last_pkey(t_uindex idx) const;
     t_tscalvec get_row(t_tscalar pkey) const;
 
     t_bool is_unique(
@@ -83,6 +118,9 @@ public:
     template <typename FN_T>
     typename FN_T::result_type reduce(
         const t_tscalvec& pkeys, const t_str& colname, FN_T fn) const;
+    template <typename FN_T>
+    typename FN_T::result_type reduce(const std::vector<t_uindex>& rows,
+        const t_str& colname, FN_T fn) const;
 
     const t_schema& get_schema() const;
 
@@ -100,16 +138,24 @@ public:
 protected:
     t_dtype get_pkey_dtype() const;
 
+    // Hands rows erased by the last update_history to the free list
+    void release_erased();
+
+    void move_row(t_uindex from, t_uindex to);
+
 private:
     t_schema m_tblschema;
     t_schema m_pkeyed_schema;
+    t_backing_store m_backing_store;
     t_bool m_init;
     t_table_sptr m_table;
     t_mapping m_mapping;
+    t_mapping m_erased;
     t_free_items m_free;
     t_symtable m_symtable;
     t_col_sptr m_pkcol;
     t_col_sptr m_opcol;
+    t_uindex m_ring_capacity;
 };
 
 template <typename FN_T>
@@ -121,6 +167,16 @@ t_gstate::reduce(const t_tscalvec& pkeys, const t_str& colname, FN_T fn) const
     return fn(data);
 }
 
+template <typename FN_T>
+typename FN_T::result_type
+t_gstate::reduce(
+    const std::vector<t_uindex>& rows, const t_str& colname, FN_T fn) const
+{
+    t_tscalvec data;
+    read_column(colname, rows, data);
+    return fn(data);
+}
+
 typedef std::shared_ptr<t_gstate> t_gstate_sptr;
 typedef std::shared_ptr<const t_gstate> t_gstate_csptr;
 
@@ -3,6 +3,8 @@
 #include <perspective/base.h>
 #include <perspective/raw_types.h>
 #include <perspective/schema.h>
+#include <functional>
+#include <map>
 
 #ifdef PSP_ENABLE_WASM
 #include <emscripten.h>
@@ -16,38 +18,44 @@ typedef perspective::t_str t_kernel;
 namespace perspective
 {
 
+// Inputs of one reduction over many tree nodes. Node i reduces
+// m_values[m_offsets[i]] up to m_values[m_offsets[i + 1]], and sits
+// at depth m_depths[i].
+struct t_kernel_batch
+{
+    std::vector<t_float64> m_values;
+    std::vector<t_uindex> m_offsets;
+    std::vector<t_uindex> m_depths;
+
+    t_uindex size() const;
+};
+
+// Reducer run in C++, writing the result of node i to out[i]
+typedef std::function<void(const t_kernel_batch& batch, t_float64* out)>
+    t_native_kernel;
+
+// Kernels are either the name of a registered native kernel or, in
+// wasm builds, a JS function. A JS kernel with a batch method is
+// called once per batch as batch(values, offsets, depths, out),
+// others once per node as kernel(values, depth).
 class t_kernel_evaluator
 {
 public:
     t_kernel_evaluator();
-    template <typename T>
-    T reduce(const t_kernel& fn, t_uindex lvl_depth, std::vector<T> data);
 
-private:
-    std::vector<t_uint8> m_kernels;
-};
+    void reduce(const t_kernel& fn, const t_kernel_batch& batch,
+        std::vector<t_float64>& out) const;
 
-#ifdef PSP_ENABLE_WASM
-template <typename T>
-T
-t_kernel_evaluator::reduce(
-    const t_kernel& fn, t_uindex lvl_depth, std::vector<T> data)
-{
-    auto arr = em::val(em::typed_memory_view(data.size(), data.data()));
-    return fn(arr, em::val(lvl_depth)).as<T>();
-}
+    void register_kernel(const t_str& name, const t_native_kernel& kernel);
+    t_bool has_kernel(const t_str& name) const;
 
-#else
-template <typename T>
-T
-t_kernel_evaluator::reduce(
-    const t_kernel& fn, t_uindex lvl_depth, std::vector<T> data)
-{
-    PSP_COMPLAIN_AND_ABORT("Not implemented");
-    return T();
-}
-#endif
+private:
+    void reduce_native(const t_str& name, const t_kernel_batch& batch,
+        std::vector<t_float64>& out) const;
+
+    std::map<t_str, t_native_kernel> m_native_kernels;
+};
 
 t_kernel_evaluator* get_evaluator();
 
-} // namespace perspective
\ No newline at end of file
+} // namespace perspective
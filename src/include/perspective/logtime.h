@@ -18,4 +18,12 @@ namespace perspective
 
 PERSPECTIVE_EXPORT void psp_log_time(const t_str& s);
 
+// Per thread counts of system allocations made by the engine's own
+// allocators, and of requests they served by reusing memory instead.
+// psp_log_time reports both as deltas since its previous message.
+PERSPECTIVE_EXPORT void psp_count_alloc();
+PERSPECTIVE_EXPORT void psp_count_reuse();
+PERSPECTIVE_EXPORT t_uindex psp_alloc_count();
+PERSPECTIVE_EXPORT t_uindex psp_reuse_count();
+
 } // end namespace perspective
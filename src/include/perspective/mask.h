@@ -11,19 +11,90 @@
 #include <perspective/first.h>
 #include <perspective/base.h>
 #include <perspective/exports.h>
-#include <boost/dynamic_bitset.hpp>
-#include <boost/shared_ptr.hpp>
 #include <perspective/simple_bitmask.h>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <vector>
 
 namespace perspective
 {
 
+// Alignment in bytes of dense mask words. Large enough for the
+// widest vector registers so boolean ops over word arrays can be
+// vectorized by the compiler.
+#define PSP_MASK_ALIGNMENT 64
+
+template <typename T>
+struct t_mask_allocator
+{
+    typedef T value_type;
+
+    t_mask_allocator() {}
+
+    template <typename U>
+    t_mask_allocator(const t_mask_allocator<U>&)
+    {
+    }
+
+    T*
+    allocate(size_t n)
+    {
+        void* ptr = 0;
+#ifdef _MSC_VER
+        ptr = _aligned_malloc(n * sizeof(T), PSP_MASK_ALIGNMENT);
+#else
+        if (posix_memalign(&ptr, PSP_MASK_ALIGNMENT, n * sizeof(T)) != 0)
+            ptr = 0;
+#endif
+        if (!ptr)
+            throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+
+    void
+    deallocate(T* ptr, size_t)
+    {
+#ifdef _MSC_VER
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+
+    template <typename U>
+    bool
+    operator==(const t_mask_allocator<U>&) const
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool
+    operator!=(const t_mask_allocator<U>&) const
+    {
+        return false;
+    }
+};
+
+typedef std::vector<t_uint64, t_mask_allocator<t_uint64>> t_mask_words;
+
+// Representation of a t_mask.
+// DENSE - one bit per row in 64 bit words
+// ARRAY - sorted indices of set rows, for sparse masks
+// RUNS - sorted half open [begin, end) ranges of set rows
+enum t_mask_mode
+{
+    MASK_MODE_DENSE,
+    MASK_MODE_ARRAY,
+    MASK_MODE_RUNS
+};
+
 class t_mask_iterator;
 
 class PERSPECTIVE_EXPORT t_mask
 {
-    typedef boost::dynamic_bitset<>::size_type t_msize;
-
 public:
     t_mask();
     t_mask(t_uindex size);
@@ -45,17 +116,164 @@ public:
 
     t_uindex find_first() const;
     t_uindex find_next(t_uindex pos) const;
-    static const t_uindex m_npos = boost::dynamic_bitset<>::npos;
+    static const t_uindex m_npos = static_cast<t_uindex>(-1);
     t_uindex size() const;
     void pprint() const;
 
+    t_mask_mode get_mode() const;
+
+    // Switches to the smallest of the dense, array and run
+    // representations for the current contents. Compressed masks
+    // are expanded back to dense on the first random write.
+    void optimize();
+
+    // Forces the dense representation
+    void densify();
+
+    // Appends the indices of all set rows to out
+    void get_indices(std::vector<t_uindex>& out) const;
+
+    // Invokes f(bidx, eidx) for every maximal half open range
+    // of set rows, in order.
+    template <typename FUNC_T>
+    void for_each_run(FUNC_T f) const;
+
+    // Dense words, valid only in MASK_MODE_DENSE. Bits beyond
+    // size() in the last word are always zero.
+    const t_uint64* get_words() const;
+    t_uindex get_nwords() const;
+
+    t_uindex nbytes() const;
+
 private:
-    boost::dynamic_bitset<> m_bitmap;
+    static t_uindex nwords_for(t_uindex nbits);
+
+    // Dense mode scans, skipping whole words at a time.
+    // First set bit at or after pos, or m_npos.
+    t_uindex next_set(t_uindex pos) const;
+    // First unset bit at or after pos, or m_size.
+    t_uindex next_unset(t_uindex pos) const;
+
+    // First set bit at or after pos in any mode, or m_npos.
+    t_uindex find_from(t_uindex pos) const;
+
+    void expand_into(t_mask_words& words) const;
+    void reset_compressed();
+
+    t_mask_mode m_mode;
+    t_uindex m_size;
+    t_mask_words m_words;
+    std::vector<t_uindex> m_indices;
+    std::vector<t_uidxpair> m_runs;
 };
 
 typedef std::shared_ptr<t_mask> t_masksptr;
 typedef std::shared_ptr<const t_mask> t_maskcsptr;
 
+inline t_uindex
+psp_popcount64(t_uint64 v)
+{
+#ifdef _MSC_VER
+    return static_cast<t_uindex>(__popcnt64(v));
+#else
+    return static_cast<t_uindex>(__builtin_popcountll(v));
+#endif
+}
+
+inline t_uindex
+psp_ctz64(t_uint64 v)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return static_cast<t_uindex>(idx);
+#else
+    return static_cast<t_uindex>(__builtin_ctzll(v));
+#endif
+}
+
+inline t_uindex
+t_mask::next_set(t_uindex pos) const
+{
+    t_uindex nwords = m_words.size();
+    t_uindex widx = pos >> 6;
+    if (pos >= m_size || widx >= nwords)
+        return m_npos;
+
+    t_uint64 w = m_words[widx] & (~t_uint64(0) << (pos & 63));
+    while (!w)
+    {
+        if (++widx == nwords)
+            return m_npos;
+        w = m_words[widx];
+    }
+    return widx * 64 + psp_ctz64(w);
+}
+
+inline t_uindex
+t_mask::next_unset(t_uindex pos) const
+{
+    t_uindex nwords = m_words.size();
+    t_uindex widx = pos >> 6;
+    if (pos >= m_size || widx >= nwords)
+        return m_size;
+
+    t_uint64 w = ~m_words[widx] & (~t_uint64(0) << (pos & 63));
+    while (!w)
+    {
+        if (++widx == nwords)
+            return m_size;
+        w = ~m_words[widx];
+    }
+    return std::min(widx * 64 + psp_ctz64(w), m_size);
+}
+
+template <typename FUNC_T>
+void
+t_mask::for_each_run(FUNC_T f) const
+{
+    switch (m_mode)
+    {
+        case MASK_MODE_DENSE:
+        {
+            t_uindex bidx = next_set(0);
+            while (bidx != m_npos)
+            {
+                t_uindex eidx = next_unset(bidx);
+                f(bidx, eidx);
+                bidx = next_set(eidx);
+            }
+        }
+        break;
+        case MASK_MODE_ARRAY:
+        {
+            t_uindex nidx = m_indices.size();
+            t_uindex idx = 0;
+            while (idx < nidx)
+            {
+                t_uindex bidx = m_indices[idx];
+                t_uindex eidx = bidx + 1;
+                ++idx;
+                while (idx < nidx && m_indices[idx] == eidx)
+                {
+                    ++eidx;
+                    ++idx;
+                }
+                f(bidx, eidx);
+            }
+        }
+        break;
+        case MASK_MODE_RUNS:
+        {
+            for (const auto& r : m_runs)
+            {
+                f(r.first, r.second);
+            }
+        }
+        break;
+    }
+}
+
 class PERSPECTIVE_EXPORT t_mask_iterator
 {
 public:
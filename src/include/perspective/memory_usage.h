@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <vector>
+
+namespace perspective
+{
+
+// Approximate bookkeeping bytes per element of node based containers,
+// on top of the element itself.
+// ordered - parent, left, right and color (std::map/set, ordered indices)
+// hashed - next pointer and cached hash (unordered containers, hashed
+// indices), buckets are accounted separately
+#define PSP_MEM_ORDERED_NODE_BYTES (4 * sizeof(void*))
+#define PSP_MEM_HASHED_NODE_BYTES (2 * sizeof(void*))
+
+// Node in a hierarchical memory report. m_size counts bytes holding
+// live data, m_capacity bytes allocated; a node's totals include
+// those of its children.
+struct PERSPECTIVE_EXPORT t_mem_usage
+{
+    t_mem_usage();
+    t_mem_usage(const t_str& name);
+    t_mem_usage(const t_str& name, t_uindex size, t_uindex capacity);
+
+    // Appends child and folds its totals into this node
+    t_mem_usage& add(const t_mem_usage& child);
+    t_mem_usage& add(const t_str& name, t_uindex size, t_uindex capacity);
+
+    // First direct child named name, or null
+    const t_mem_usage* find(const t_str& name) const;
+
+    t_str repr() const;
+
+    t_str m_name;
+    t_uindex m_size;
+    t_uindex m_capacity;
+    std::vector<t_mem_usage> m_children;
+};
+
+typedef std::vector<t_mem_usage> t_mem_usage_vec;
+
+template <typename T>
+t_mem_usage
+mem_usage_vector(const t_str& name, const std::vector<T>& v)
+{
+    return t_mem_usage(name, v.size() * sizeof(T), v.capacity() * sizeof(T));
+}
+
+// std/boost unordered containers
+template <typename CONTAINER_T>
+t_mem_usage
+mem_usage_hashed(const t_str& name, const CONTAINER_T& c)
+{
+    t_uindex nodes = c.size()
+        * (sizeof(typename CONTAINER_T::value_type)
+              + PSP_MEM_HASHED_NODE_BYTES);
+    return t_mem_usage(
+        name, nodes, nodes + c.bucket_count() * sizeof(void*));
+}
+
+// std::map/set and single index ordered multi_index containers
+template <typename CONTAINER_T>
+t_mem_usage
+mem_usage_ordered(const t_str& name, const CONTAINER_T& c)
+{
+    t_uindex nodes = c.size()
+        * (sizeof(typename CONTAINER_T::value_type)
+              + PSP_MEM_ORDERED_NODE_BYTES);
+    return t_mem_usage(name, nodes, nodes);
+}
+
+} // end namespace perspective
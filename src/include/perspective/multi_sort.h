@@ -24,15 +24,15 @@ struct PERSPECTIVE_EXPORT t_mselem
     t_mselem();
     t_mselem(const t_tscalvec& row);
     t_mselem(const t_tscalvec& row, t_uindex order);
-    t_mselem(const t_tscalar& pkey, const t_tscalvec& row);
     t_mselem(const t_mselem& other);
     t_mselem(t_mselem&& other);
     t_mselem& operator=(const t_mselem& other);
     t_mselem& operator=(t_mselem&& other);
 
     t_tscalvec m_row;
-    t_tscalar m_pkey;
     t_uindex m_order;
+    // gstate row of flat traversal elements
+    t_uindex m_ridx;
     bool m_deleted;
 };
 
@@ -44,7 +44,7 @@ namespace std
 inline std::ostream&
 operator<<(std::ostream& os, const perspective::t_mselem& t)
 {
-    os << "mse<pkey => " << t.m_pkey << " row => " << t.m_row << " deleted => "
+    os << "mse<ridx => " << t.m_ridx << " row => " << t.m_row << " deleted => "
        << t.m_deleted << " order => " << t.m_order << ">";
     return os;
 }
@@ -92,9 +92,13 @@ struct PERSPECTIVE_EXPORT t_nancmp
 PERSPECTIVE_EXPORT t_nancmp nan_compare(
     t_sorttype order, const t_tscalar& a, const t_tscalar& b);
 
-inline PERSPECTIVE_EXPORT t_bool
+// Orders by the sort values, then by m_order, then by pkey. pkey maps
+// an element to its pkey, and is only called to break ties.
+template <typename PKEY_FN>
+inline t_bool
 cmp_mselem(const t_mselem& a, const t_mselem& b,
-    const std::vector<t_sorttype>& sort_order, t_bool handle_nans)
+    const std::vector<t_sorttype>& sort_order, t_bool handle_nans,
+    PKEY_FN pkey)
 {
     typedef std::pair<t_float64, t_tscalar> dpair;
 
@@ -104,9 +108,6 @@ cmp_mselem(const t_mselem& a, const t_mselem& b,
         return false;
     }
 
-    t_tscalar first_pkey = a.m_pkey;
-    t_tscalar second_pkey = b.m_pkey;
-
     for (int idx = 0, loop_end = sort_order.size(); idx < loop_end; ++idx)
     {
         const t_tscalar& first = a.m_row[idx];
@@ -157,21 +158,21 @@ cmp_mselem(const t_mselem& a, const t_mselem& b,
             {
                 t_float64 val_a = first.to_double();
                 t_float64 val_b = second.to_double();
-                return dpair(std::abs(val_a), first_pkey)
-                    < dpair(std::abs(val_b), second_pkey);
+                return dpair(std::abs(val_a), pkey(a))
+                    < dpair(std::abs(val_b), pkey(b));
             }
             break;
             case SORTTYPE_DESCENDING_ABS:
             {
                 t_float64 val_a = first.to_double();
                 t_float64 val_b = second.to_double();
-                return dpair(std::abs(val_a), first_pkey)
-                    > dpair(std::abs(val_b), second_pkey);
+                return dpair(std::abs(val_a), pkey(a))
+                    > dpair(std::abs(val_b), pkey(b));
             }
             break;
             case SORTTYPE_NONE:
             {
-                return first_pkey < second_pkey;
+                return pkey(a) < pkey(b);
             }
         }
     }
@@ -181,7 +182,16 @@ cmp_mselem(const t_mselem& a, const t_mselem& b,
         return a.m_order < b.m_order;
     }
 
-    return first_pkey < second_pkey;
+    return pkey(a) < pkey(b);
+}
+
+// Elements without pkeys, ties are broken by m_order alone
+inline PERSPECTIVE_EXPORT t_bool
+cmp_mselem(const t_mselem& a, const t_mselem& b,
+    const std::vector<t_sorttype>& sort_order, t_bool handle_nans)
+{
+    return cmp_mselem(a, b, sort_order, handle_nans,
+        [](const t_mselem&) { return mknone(); });
 }
 
 inline PERSPECTIVE_EXPORT t_bool
@@ -21,6 +21,7 @@
 #include <csignal>
 #include <cmath>
 #include <map>
+#include <type_traits>
 
 namespace perspective
 {
@@ -34,19 +35,115 @@ struct t_pivot_processor
     typedef std::map<t_tscalar, t_uindex, t_comparator<t_tscalar, DTYPE_T>>
         t_map;
 
+    t_pivot_processor(t_partition_order order = PARTITION_SORTED);
+
     // For now we dont do any inter node
     // parallelism. this should be trivial
     // to fix in the future.
     t_uindex operator()(const t_column* data, std::vector<t_dense_tnode>* nodes,
         t_column* values, t_column* leaves, t_uindex nbidx, t_uindex neidx,
         const t_mask* mask);
+
+private:
+    // Typed kernels from partition.h
+    t_uindex pivot(const t_column* data, std::vector<t_dense_tnode>* nodes,
+        t_column* values, t_column* leaves, t_uindex nbidx, t_uindex neidx,
+        std::true_type);
+
+    // t_tscalar comparator, for dtypes without a partition key
+    t_uindex pivot(const t_column* data, std::vector<t_dense_tnode>* nodes,
+        t_column* values, t_column* leaves, t_uindex nbidx, t_uindex neidx,
+        std::false_type);
+
+    t_partition_order m_order;
 };
 
+template <int DTYPE_T>
+t_pivot_processor<DTYPE_T>::t_pivot_processor(t_partition_order order)
+    : m_order(order)
+{
+}
+
 template <int DTYPE_T>
 t_uindex
 t_pivot_processor<DTYPE_T>::operator()(const t_column* data,
-    std::vector<t_dense_tnode>* nodes, t_column* values,
-    t_column* leaves, t_uindex nbidx, t_uindex neidx, const t_mask* mask)
+    std::vector<t_dense_tnode>* nodes, t_column* values, t_column* leaves,
+    t_uindex nbidx, t_uindex neidx, const t_mask* mask)
+{
+    return pivot(data, nodes, values, leaves, nbidx, neidx,
+        std::integral_constant<bool, t_partition_key<DTYPE_T>::m_enabled>());
+}
+
+template <int DTYPE_T>
+t_uindex
+t_pivot_processor<DTYPE_T>::pivot(const t_column* data,
+    std::vector<t_dense_tnode>* nodes, t_column* values, t_column* leaves,
+    t_uindex nbidx, t_uindex neidx, std::true_type)
+{
+    t_uindex* leaves_ptr = leaves->get_nth<t_uindex>(0);
+    t_uindex lvl_nidx = neidx;
+
+    if (nbidx == neidx)
+        return lvl_nidx;
+
+    // Nodes of a level cover a contiguous range of leaves
+    const t_dense_tnode& lnode = nodes->at(neidx - 1);
+    t_uindex lbidx = nodes->at(nbidx).m_flidx;
+    t_uindex leidx = lnode.m_flidx + lnode.m_nleaves;
+
+    t_partition_keygen<DTYPE_T> keygen(
+        data, leaves_ptr + lbidx, leidx - lbidx);
+    t_bool has_status = data->is_status_enabled();
+
+    t_partition_buf buf;
+    std::vector<t_uindex> ends;
+
+    for (t_uindex nidx = nbidx; nidx < neidx; ++nidx)
+    {
+        t_dense_tnode* pnode = &nodes->at(nidx);
+        t_uindex cbidx = pnode->m_flidx;
+        t_uindex nleaves = pnode->m_nleaves;
+        t_uindex parent_idx = pnode->m_idx;
+        t_uindex* cleaves = leaves_ptr + cbidx;
+
+        buf.m_keys.resize(nleaves);
+        if (nleaves > 0)
+            keygen.fill(cleaves, nleaves, &buf.m_keys[0]);
+
+        if (has_status)
+        {
+            buf.m_status.resize(nleaves);
+            for (t_uindex idx = 0; idx < nleaves; ++idx)
+            {
+                buf.m_status[idx] = *(data->get_nth_status(cleaves[idx]));
+            }
+        }
+
+        ends.clear();
+        partition_keys(cleaves, nleaves, has_status, m_order, buf, ends);
+
+        pnode->m_fcidx = lvl_nidx;
+        pnode->m_nchild = ends.size();
+
+        t_uindex gbidx = 0;
+        for (auto geidx : ends)
+        {
+            nodes->push_back({lvl_nidx, parent_idx, 0, 0, cbidx + gbidx,
+                geidx - gbidx});
+            lvl_nidx += 1;
+            values->push_back<t_tscalar>(data->get_scalar(cleaves[gbidx]));
+            gbidx = geidx;
+        }
+    }
+
+    return lvl_nidx;
+}
+
+template <int DTYPE_T>
+t_uindex
+t_pivot_processor<DTYPE_T>::pivot(const t_column* data,
+    std::vector<t_dense_tnode>* nodes, t_column* values, t_column* leaves,
+    t_uindex nbidx, t_uindex neidx, std::false_type)
 {
 
     t_lstore lcopy(leaves->data_lstore(), t_lstore_tmp_init_tag());
@@ -15,6 +15,8 @@
 #include <perspective/node_processor_types.h>
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <unordered_map>
 
 /*
 TODO improvements
@@ -150,4 +152,353 @@ partition(const t_column* PSP_RESTRICT data_, t_column* PSP_RESTRICT leaves_,
     }
 }
 
+// Typed partition kernels. Instead of argsorting t_tscalars, leaves
+// are grouped on an unsigned key extracted from the raw column data
+// whose unsigned order matches t_tscalar ordering for the dtype.
+// Status is treated as a more significant key than the value, as in
+// t_tscalar::compare_common.
+
+// SORTED - groups are emitted in t_tscalar order
+// HASHED - groups are emitted in order of first appearance, used
+// when the consumer orders children itself
+enum t_partition_order
+{
+    PARTITION_SORTED,
+    PARTITION_HASHED
+};
+
+// Key ranges up to this many buckets use a single counting sort pass
+#define PSP_PARTITION_COUNTING_MAX 65536
+
+template <int DTYPE_T>
+struct t_partition_key
+{
+    static const bool m_enabled = false;
+};
+
+#define PSP_SIGNED_PARTITION_KEY(DTYPE, T, UT)                                 \
+    template <>                                                                \
+    struct t_partition_key<DTYPE>                                              \
+    {                                                                          \
+        static const bool m_enabled = true;                                    \
+        typedef T t_rawtype;                                                   \
+        static inline t_uint64                                                 \
+        get(T v)                                                               \
+        {                                                                      \
+            return static_cast<t_uint64>(static_cast<UT>(v)                    \
+                ^ (UT(1) << (sizeof(UT) * 8 - 1)));                            \
+        }                                                                      \
+    };
+
+#define PSP_UNSIGNED_PARTITION_KEY(DTYPE, T)                                   \
+    template <>                                                                \
+    struct t_partition_key<DTYPE>                                              \
+    {                                                                          \
+        static const bool m_enabled = true;                                    \
+        typedef T t_rawtype;                                                   \
+        static inline t_uint64                                                 \
+        get(T v)                                                               \
+        {                                                                      \
+            return static_cast<t_uint64>(v);                                   \
+        }                                                                      \
+    };
+
+// IEEE bits with the sign bit flipped for positives and all bits
+// flipped for negatives sort numerically. -0 is folded onto +0 as
+// they compare equal.
+#define PSP_FLOAT_PARTITION_KEY(DTYPE, T, UT)                                  \
+    template <>                                                                \
+    struct t_partition_key<DTYPE>                                              \
+    {                                                                          \
+        static const bool m_enabled = true;                                    \
+        typedef T t_rawtype;                                                   \
+        static inline t_uint64                                                 \
+        get(T v)                                                               \
+        {                                                                      \
+            if (v == 0)                                                        \
+                v = 0;                                                         \
+            UT bits;                                                           \
+            memcpy(&bits, &v, sizeof(UT));                                     \
+            const UT sign = UT(1) << (sizeof(UT) * 8 - 1);                     \
+            return static_cast<t_uint64>(                                      \
+                (bits & sign) ? static_cast<UT>(~bits) : (bits | sign));       \
+        }                                                                      \
+    };
+
+PSP_SIGNED_PARTITION_KEY(DTYPE_INT64, t_int64, t_uint64)
+PSP_SIGNED_PARTITION_KEY(DTYPE_INT32, t_int32, t_uint32)
+PSP_SIGNED_PARTITION_KEY(DTYPE_INT16, t_int16, t_uint16)
+PSP_SIGNED_PARTITION_KEY(DTYPE_INT8, t_int8, t_uint8)
+PSP_UNSIGNED_PARTITION_KEY(DTYPE_UINT64, t_uint64)
+PSP_UNSIGNED_PARTITION_KEY(DTYPE_UINT32, t_uint32)
+PSP_UNSIGNED_PARTITION_KEY(DTYPE_UINT16, t_uint16)
+PSP_UNSIGNED_PARTITION_KEY(DTYPE_UINT8, t_uint8)
+PSP_UNSIGNED_PARTITION_KEY(DTYPE_BOOL, t_bool)
+PSP_FLOAT_PARTITION_KEY(DTYPE_FLOAT64, t_float64, t_uint64)
+PSP_FLOAT_PARTITION_KEY(DTYPE_FLOAT32, t_float32, t_uint32)
+
+#undef PSP_SIGNED_PARTITION_KEY
+#undef PSP_UNSIGNED_PARTITION_KEY
+#undef PSP_FLOAT_PARTITION_KEY
+
+// Interned strings are keyed on the strcmp rank of their vocab id.
+// Ranks are computed once for the ids present in the leaves.
+template <>
+struct t_partition_key<DTYPE_STR>
+{
+    static const bool m_enabled = true;
+    typedef t_uindex t_rawtype;
+};
+
+struct t_str_rank_cmp
+{
+    t_str_rank_cmp(const t_column* data)
+        : m_data(data)
+    {
+    }
+
+    inline bool
+    operator()(t_uindex a, t_uindex b) const
+    {
+        return strcmp(m_data->unintern_c(a), m_data->unintern_c(b)) < 0;
+    }
+
+    const t_column* m_data;
+};
+
+// Fills ranks, indexed by vocab id, for the ids referenced by
+// leaves[0, nleaves). Equal strings share a rank.
+inline void
+str_ranks(const t_column* data, const t_uindex* leaves, t_uindex nleaves,
+    std::vector<t_uindex>& ranks)
+{
+    static const t_uindex unset = static_cast<t_uindex>(-1);
+    ranks.assign(data->get_vlenidx(), unset);
+    std::vector<t_uindex> ids;
+    for (t_uindex idx = 0; idx < nleaves; ++idx)
+    {
+        t_uindex sidx = *(data->get_nth<t_uindex>(leaves[idx]));
+        if (ranks[sidx] == unset)
+        {
+            ranks[sidx] = 0;
+            ids.push_back(sidx);
+        }
+    }
+
+    std::sort(ids.begin(), ids.end(), t_str_rank_cmp(data));
+
+    t_uindex rank = 0;
+    for (t_uindex idx = 0, loop_end = ids.size(); idx < loop_end; ++idx)
+    {
+        if (idx > 0
+            && strcmp(data->unintern_c(ids[idx - 1]),
+                   data->unintern_c(ids[idx]))
+                != 0)
+        {
+            ++rank;
+        }
+        ranks[ids[idx]] = rank;
+    }
+}
+
+// Extracts partition keys for leaves of a column
+template <int DTYPE_T>
+struct t_partition_keygen
+{
+    typedef t_partition_key<DTYPE_T> t_key;
+    typedef typename t_key::t_rawtype t_rawtype;
+
+    t_partition_keygen(const t_column* data, const t_uindex*, t_uindex)
+        : m_data(data)
+    {
+    }
+
+    inline void
+    fill(const t_uindex* leaves, t_uindex n, t_uint64* keys) const
+    {
+        for (t_uindex idx = 0; idx < n; ++idx)
+        {
+            keys[idx] = t_key::get(*(m_data->get_nth<t_rawtype>(leaves[idx])));
+        }
+    }
+
+    const t_column* m_data;
+};
+
+template <>
+struct t_partition_keygen<DTYPE_STR>
+{
+    t_partition_keygen(
+        const t_column* data, const t_uindex* leaves, t_uindex nleaves)
+        : m_data(data)
+    {
+        str_ranks(data, leaves, nleaves, m_ranks);
+    }
+
+    inline void
+    fill(const t_uindex* leaves, t_uindex n, t_uint64* keys) const
+    {
+        for (t_uindex idx = 0; idx < n; ++idx)
+        {
+            keys[idx] = m_ranks[*(m_data->get_nth<t_uindex>(leaves[idx]))];
+        }
+    }
+
+    const t_column* m_data;
+    std::vector<t_uindex> m_ranks;
+};
+
+// Scratch buffers reused across the nodes of a level
+struct t_partition_buf
+{
+    std::vector<t_uint64> m_keys;
+    std::vector<t_uint64> m_keys_tmp;
+    std::vector<t_uint8> m_status;
+    std::vector<t_uint8> m_status_tmp;
+    std::vector<t_uindex> m_leaves_tmp;
+    std::vector<t_uindex> m_counts;
+    std::vector<t_uindex> m_gids;
+    std::unordered_map<t_uint64, t_uindex> m_groups[3];
+};
+
+// Stable counting sort of leaves (and keys, status) on bucket(idx)
+// in [0, nbuckets).
+template <typename BUCKET_T>
+inline void
+partition_scatter(t_uindex* PSP_RESTRICT leaves, t_uindex n,
+    t_uindex nbuckets, t_partition_buf& buf, bool has_status, BUCKET_T bucket)
+{
+    std::vector<t_uindex>& counts = buf.m_counts;
+    counts.assign(nbuckets + 1, 0);
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        ++counts[bucket(idx) + 1];
+    }
+
+    for (t_uindex idx = 1; idx <= nbuckets; ++idx)
+    {
+        counts[idx] += counts[idx - 1];
+    }
+
+    t_uint64* keys = &buf.m_keys[0];
+    t_uint64* keys_tmp = &buf.m_keys_tmp[0];
+    t_uindex* leaves_tmp = &buf.m_leaves_tmp[0];
+    t_uint8* status = has_status ? &buf.m_status[0] : 0;
+    t_uint8* status_tmp = has_status ? &buf.m_status_tmp[0] : 0;
+
+    for (t_uindex idx = 0; idx < n; ++idx)
+    {
+        t_uindex dst = counts[bucket(idx)]++;
+        keys_tmp[dst] = keys[idx];
+        leaves_tmp[dst] = leaves[idx];
+        if (has_status)
+            status_tmp[dst] = status[idx];
+    }
+
+    buf.m_keys.swap(buf.m_keys_tmp);
+    if (has_status)
+        buf.m_status.swap(buf.m_status_tmp);
+    memcpy(leaves, leaves_tmp, sizeof(t_uindex) * n);
+}
+
+// Groups leaves[0, n) on (buf.m_status, buf.m_keys), which must hold
+// n entries (m_status only if has_status), reordering leaves in
+// place. The end offset of every group is appended to out_ends.
+inline void
+partition_keys(t_uindex* PSP_RESTRICT leaves, t_uindex n, bool has_status,
+    t_partition_order order, t_partition_buf& buf,
+    std::vector<t_uindex>& out_ends)
+{
+    if (n == 0)
+        return;
+
+    buf.m_keys_tmp.resize(n);
+    buf.m_leaves_tmp.resize(n);
+    if (has_status)
+        buf.m_status_tmp.resize(n);
+
+    t_uint64 kmin = buf.m_keys[0];
+    t_uint64 kmax = kmin;
+    for (t_uindex idx = 1; idx < n; ++idx)
+    {
+        kmin = std::min(kmin, buf.m_keys[idx]);
+        kmax = std::max(kmax, buf.m_keys[idx]);
+    }
+
+    bool status_varies = false;
+    if (has_status)
+    {
+        for (t_uindex idx = 1; idx < n && !status_varies; ++idx)
+            status_varies = buf.m_status[idx] != buf.m_status[0];
+    }
+
+    if (kmin == kmax && !status_varies)
+    {
+        out_ends.push_back(n);
+        return;
+    }
+
+    t_uint64 range = kmax - kmin;
+
+    if (range < PSP_PARTITION_COUNTING_MAX && range <= 4 * n)
+    {
+        partition_scatter(leaves, n, range + 1, buf, has_status,
+            [&buf, kmin](t_uindex idx) { return buf.m_keys[idx] - kmin; });
+    }
+    else if (order == PARTITION_HASHED)
+    {
+        // Number groups by first appearance, then scatter by group.
+        // After the scatter counts holds the end offset of each group.
+        t_uindex ngroups = 0;
+        std::vector<t_uindex>& gids = buf.m_gids;
+        gids.resize(n);
+        for (t_uindex idx = 0; idx < n; ++idx)
+        {
+            auto& groups = buf.m_groups[has_status ? buf.m_status[idx] : 0];
+            auto iter = groups.insert(std::make_pair(buf.m_keys[idx], ngroups));
+            if (iter.second)
+                ++ngroups;
+            gids[idx] = iter.first->second;
+        }
+
+        for (auto& groups : buf.m_groups)
+            groups.clear();
+
+        partition_scatter(leaves, n, ngroups, buf, has_status,
+            [&gids](t_uindex idx) { return gids[idx]; });
+
+        out_ends.insert(out_ends.end(), buf.m_counts.begin(),
+            buf.m_counts.begin() + ngroups);
+        return;
+    }
+    else
+    {
+        // LSD radix over the bytes in which keys differ
+        t_uint64 diff = range;
+        for (t_uindex shift = 0; shift < 64 && (diff >> shift); shift += 8)
+        {
+            partition_scatter(leaves, n, 256, buf, has_status,
+                [&buf, kmin, shift](t_uindex idx) {
+                    return ((buf.m_keys[idx] - kmin) >> shift) & 0xFF;
+                });
+        }
+    }
+
+    if (status_varies)
+    {
+        partition_scatter(leaves, n, 3, buf, has_status,
+            [&buf](t_uindex idx) { return buf.m_status[idx]; });
+    }
+
+    for (t_uindex idx = 1; idx < n; ++idx)
+    {
+        if (buf.m_keys[idx] != buf.m_keys[idx - 1]
+            || (has_status && buf.m_status[idx] != buf.m_status[idx - 1]))
+        {
+            out_ends.push_back(idx);
+        }
+    }
+    out_ends.push_back(n);
+}
+
 } // end namespace perspective
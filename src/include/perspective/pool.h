@@ -78,6 +78,10 @@ public:
 
     t_tscalvec get_row_data_pkeys(t_uindex gnode_id, const t_tscalvec& pkeys);
     t_updctx_vec get_contexts_last_updated();
+
+    // Contexts whose subscribed viewports changed, so clients can skip
+    // fetching data for the rest
+    t_updctx_vec get_viewports_last_updated();
     t_str repr() const;
 
     void pprint_registered() const;
@@ -90,6 +94,9 @@ public:
     std::vector<t_uindex> get_gnodes_last_updated();
     t_gnode* get_gnode(t_uindex gnode_id);
 
+    // Memory held by every registered gnode and its contexts
+    t_mem_usage get_memory_usage();
+
 protected:
     // Following three functions
     // use the python api
@@ -0,0 +1,76 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/scalar.h>
+#include <perspective/exports.h>
+#include <perspective/memory_usage.h>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+namespace perspective
+{
+
+class t_table;
+
+// Retention policy of a gnode. Rows are aged by a DTYPE_TIME column
+// when one is given, by arrival order otherwise. Rows older than the
+// newest time seen minus max_age are expired, as are the oldest rows
+// past max_rows. Either bound is off when 0.
+class PERSPECTIVE_EXPORT t_retention
+{
+    // (age, arrival sequence)
+    typedef std::pair<t_int64, t_uint64> t_ageidx;
+    typedef std::unique_ptr<t_char[]> t_strptr;
+
+    // String pkeys point into m_str, which is freed with the entry
+    struct t_tracked
+    {
+        t_ageidx m_age;
+        t_strptr m_str;
+    };
+
+public:
+    t_retention();
+    t_retention(t_uindex max_rows, const t_str& colname, t_int64 max_age);
+
+    t_bool is_enabled() const;
+    const t_str& get_column() const;
+
+    // Tracks the inserts and deletes of an input table, in row order
+    void update(const t_table& tbl);
+
+    // Appends the pkeys to expire and stops tracking them. The
+    // pkeys stay valid until the next call to update or get_expired.
+    void get_expired(t_tscalvec& out);
+
+    t_uindex size() const;
+    void reset();
+
+    t_mem_usage get_memory_usage() const;
+
+private:
+    void erase(const t_tscalar& pkey);
+
+    t_uindex m_max_rows;
+    t_str m_colname;
+    t_int64 m_max_age;
+    t_int64 m_newest;
+    t_uint64 m_seq;
+    std::map<t_ageidx, t_tscalar> m_index;
+    std::unordered_map<t_tscalar, t_tracked> m_ages;
+    // Strings of the pkeys last returned by get_expired
+    std::vector<t_strptr> m_expired;
+    t_uindex m_str_bytes;
+};
+
+} // end namespace perspective
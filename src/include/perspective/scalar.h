@@ -41,7 +41,10 @@ struct PERSPECTIVE_EXPORT t_const_char_comparator
     }
 };
 
-const int SCALAR_INPLACE_LEN = 13;
+// Strings shorter than this are stored in the scalar itself, longer
+// ones as a pointer to interned or column vocab storage. It is the
+// size of the payload, so a scalar packs into 16 bytes.
+const int SCALAR_INPLACE_LEN = 8;
 
 union t_scalar_u {
     t_int64 m_int64;
@@ -146,6 +149,9 @@ struct PERSPECTIVE_EXPORT t_tscalar
     t_bool m_inplace;
 };
 
+static_assert(sizeof(t_scalar_u) == 8, "Scalar payload is not 8 bytes");
+static_assert(sizeof(t_tscalar) == 16, "Scalar is not 16 bytes");
+
 inline t_tscalar operator"" _ts(long double v)
 {
     t_tscalar rv;
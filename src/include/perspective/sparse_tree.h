@@ -20,6 +20,12 @@ SUPPRESS_WARNINGS_VC(4503)
 #include <perspective/min_max.h>
 #include <perspective/shared_ptrs.h>
 #include <perspective/tree_iterator.h>
+#include <perspective/memory_usage.h>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
 
 namespace perspective
 {
@@ -82,6 +88,10 @@ struct PERSPECTIVE_EXPORT t_agg_update_info
     t_aggspecvec m_aggspecs;
 
     std::vector<t_uindex> m_dst_topo_sorted;
+
+    // Per column, (node, aggregate row) pairs waiting on a batched
+    // reduce kernel
+    std::vector<std::vector<t_uidxpair>> m_reduce_nodes;
 };
 
 struct t_tree_unify_rec
@@ -214,6 +224,11 @@ public:
 
     void set_minmax_enabled(bool enabled_state);
 
+    // Resolves pkeys through src instead of keeping a pkey index. src
+    // pivots the first nrow_pivots pivots of this tree followed by more
+    // row pivots, then the rest of the pivots of this tree.
+    void set_pkey_source(t_stree_csptr src, t_depth nrow_pivots);
+
     void set_feature_state(t_ctx_feature feature, t_bool state);
 
     template <typename ITER_T>
@@ -223,7 +238,9 @@ public:
 
     void clear_deltas();
 
-    const t_sptr_tcdeltas& get_deltas() const;
+    // Deltas by node and aggregate
+    const t_cell_deltas& get_deltas() const;
+    t_cell_deltas& get_deltas();
 
     void clear();
 
@@ -246,11 +263,23 @@ public:
     t_bfs_iter<t_stree> bfs() const;
     t_dfs_iter<t_stree> dfs() const;
     void pprint() const;
+    t_mem_usage get_memory_usage() const;
     t_tscalvec get_pkeys_for_leaf(t_uindex idx) const;
     t_tscalar get_pkey_for_leaf(t_uindex idx) const;
     bool insert_node(const t_tnode& node);
     void add_pkey(t_uindex idx, t_tscalar pkey);
 
+    // Replaces the node with the same index
+    void update_node(const t_tnode& node);
+
+    // Drops a node without children along with its pkeys
+    void remove_node(t_uindex idx);
+
+    // Sets the aggregates aggnums of a node to values, recording
+    // deltas for the ones that changed
+    void set_aggregates(t_uindex idx, const std::vector<t_uindex>& aggnums,
+        const t_tscalvec& values);
+
 protected:
     void mark_zero_desc();
     t_uindex get_num_aggcols() const;
@@ -265,7 +294,14 @@ protected:
         t_uindex src_ridx, t_uindex dst_ridx, t_index nstrands,
         const t_gstate& gstate);
 
+    // Runs the reduce kernels queued by update_agg_table, one batch
+    // per aggregate
+    void reduce_batches(t_agg_update_info& info, const t_gstate& gstate);
+    void record_delta(t_uindex nidx, t_uindex aggidx,
+        const t_tscalar& old_value, const t_tscalar& new_value);
+
     t_bool is_leaf(t_uindex nidx) const;
+    t_tscalvec get_source_pkeys(t_uindex idx) const;
 
     t_build_strand_table_common_rval build_strand_table_common(
         const t_table& flattened, const t_aggspecvec& aggspecs,
@@ -12,80 +12,111 @@
 #include <perspective/base.h>
 #include <perspective/scalar.h>
 #include <perspective/exports.h>
+#include <perspective/memory_usage.h>
+#include <perspective/mask.h>
 #include <vector>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/composite_key.hpp>
 #include <boost/variant/apply_visitor.hpp>
 
 namespace perspective
 {
 
-using boost::multi_index_container;
-using namespace boost::multi_index;
-
-// Deltas for various contexts
-
-struct t_zcdelta
+// Old and new values of the cells that changed in a step, keyed by a
+// dense row id (tree node index, gstate row index) and column index.
+// Each changed row gets a slot holding a bitset of its changed columns;
+// values live in one buffer per column, indexed by slot and grown only
+// when that column changes. The first insert for a cell wins. clear()
+// truncates, keeping capacity.
+//
+// A filter limits value capture to the rows and columns a client is
+// watching. Changes elsewhere are only counted.
+class PERSPECTIVE_EXPORT t_cell_deltas
 {
-    t_zcdelta(t_tscalar pkey, t_index colidx, t_tscalar old_value,
-        t_tscalar new_value);
-
-    t_tscalar m_pkey;
-    t_index m_colidx;
-    t_tscalar m_old_value;
-    t_tscalar m_new_value;
-};
+public:
+    t_cell_deltas();
 
-struct by_zc_pkey_colidx
-{
-};
+    void init(t_uindex ncols);
+    void clear();
 
-typedef multi_index_container<t_zcdelta,
-    indexed_by<ordered_unique<tag<by_zc_pkey_colidx>,
-        composite_key<t_zcdelta,
-            BOOST_MULTI_INDEX_MEMBER(t_zcdelta, t_tscalar, m_pkey),
-            BOOST_MULTI_INDEX_MEMBER(t_zcdelta, t_index, m_colidx)>>>>
-    t_zcdeltas;
+    // True if nothing changed, captured or not
+    t_bool empty() const;
 
-typedef t_zcdeltas::index<by_zc_pkey_colidx>::type::iterator
-    iter_by_zc_pkey_colidx;
+    // Number of changed cells
+    t_uindex size() const;
 
-typedef std::pair<iter_by_zc_pkey_colidx, iter_by_zc_pkey_colidx>
-    iterpair_by_zc_pkey_colidx;
-typedef std::shared_ptr<t_zcdeltas> t_sptr_zcdeltas;
-
-struct t_tcdelta
-{
-    t_tcdelta(t_uindex nidx, t_uindex aggidx, t_tscalar old_value,
-        t_tscalar new_value);
+    void insert(t_uindex ridx, t_uindex colidx, const t_tscalar& old_value,
+        const t_tscalar& new_value);
 
-    t_uindex m_nidx;
-    t_uindex m_aggidx;
-    t_tscalar m_old_value;
-    t_tscalar m_new_value;
+    t_bool has_row(t_uindex ridx) const;
+
+    // Captures values only for rows and for columns flagged true.
+    // An empty columns vector keeps every column. The filter outlives
+    // clear().
+    void set_filter(
+        const std::vector<t_uindex>& rows, const std::vector<t_bool>& columns);
+    void clear_filter();
+    t_bool is_filtered() const;
+
+    // Calls fn(colidx, old_value, new_value) for every changed cell of
+    // ridx, in column order
+    template <typename FUNC_T>
+    void for_each_cell(t_uindex ridx, FUNC_T fn) const;
+
+    // Changed rows, in the order they were first touched
+    const std::vector<t_uindex>& get_rows() const;
+
+    // Rekeys deltas after gstate rows moved, pairs are (from, to).
+    // Deltas left on a to row belonged to a deleted pkey and move
+    // to from instead.
+    void remap_rows(const std::vector<t_uidxpair>& moves);
+
+    t_mem_usage get_memory_usage() const;
+
+    static const t_uindex m_npos = static_cast<t_uindex>(-1);
+
+private:
+    t_uindex get_slot(t_uindex ridx) const;
+
+    t_uindex m_ncols;
+    t_uindex m_nwords;
+    t_uindex m_ncells;
+    std::vector<t_uindex> m_row_slots;
+    std::vector<t_uindex> m_rows;
+    std::vector<t_uint64> m_masks;
+    std::vector<t_tscalvec> m_old_values;
+    std::vector<t_tscalvec> m_new_values;
+    t_uindex m_nuncaptured;
+    t_bool m_filtered;
+    std::vector<t_uint8> m_filter_rows;
+    std::vector<t_uindex> m_filter_list;
+    std::vector<t_bool> m_filter_columns;
 };
 
-struct by_tc_nidx_aggidx
+inline t_uindex
+t_cell_deltas::get_slot(t_uindex ridx) const
 {
-};
-
-typedef multi_index_container<t_tcdelta,
-    indexed_by<ordered_unique<tag<by_tc_nidx_aggidx>,
-        composite_key<t_tcdelta,
-            BOOST_MULTI_INDEX_MEMBER(t_tcdelta, t_uindex, m_nidx),
-            BOOST_MULTI_INDEX_MEMBER(t_tcdelta, t_uindex, m_aggidx)>>>>
-    t_tcdeltas;
-
-typedef t_tcdeltas::index<by_tc_nidx_aggidx>::type::iterator
-    iter_by_tc_nidx_aggidx;
-
-typedef std::pair<iter_by_tc_nidx_aggidx, iter_by_tc_nidx_aggidx>
-    iterpair_by_tc_nidx_aggidx;
+    return ridx < m_row_slots.size() ? m_row_slots[ridx] : m_npos;
+}
 
-typedef std::shared_ptr<t_tcdeltas> t_sptr_tcdeltas;
+template <typename FUNC_T>
+void
+t_cell_deltas::for_each_cell(t_uindex ridx, FUNC_T fn) const
+{
+    t_uindex slot = get_slot(ridx);
+    if (slot == m_npos)
+        return;
+
+    const t_uint64* mask = m_masks.data() + slot * m_nwords;
+    for (t_uindex widx = 0; widx < m_nwords; ++widx)
+    {
+        t_uint64 word = mask[widx];
+        while (word)
+        {
+            t_uindex colidx = widx * 64 + psp_ctz64(word);
+            fn(colidx, m_old_values[colidx][slot], m_new_values[colidx][slot]);
+            word &= word - 1;
+        }
+    }
+}
 
 struct PERSPECTIVE_EXPORT t_cellupd
 {
@@ -102,6 +133,21 @@ struct PERSPECTIVE_EXPORT t_cellupd
 
 typedef std::vector<t_cellupd> t_cellupdvec;
 
+// Window of a context a client subscribed to, rows [m_bidx, m_eidx)
+// and columns [m_bcol, m_ecol)
+struct PERSPECTIVE_EXPORT t_viewport
+{
+    t_viewport();
+    t_viewport(t_tvidx bidx, t_tvidx eidx, t_tvidx bcol, t_tvidx ecol);
+
+    t_tvidx m_bidx;
+    t_tvidx m_eidx;
+    t_tvidx m_bcol;
+    t_tvidx m_ecol;
+};
+
+typedef std::vector<t_viewport> t_viewportvec;
+
 struct PERSPECTIVE_EXPORT t_stepdelta
 {
     t_stepdelta();
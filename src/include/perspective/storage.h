@@ -13,9 +13,11 @@
 #include <perspective/raw_types.h>
 #include <perspective/exports.h>
 #include <perspective/mask.h>
+#include <perspective/memory_usage.h>
 #include <perspective/compat.h>
 #include <perspective/debug_helpers.h>
 #include <cmath>
+#include <vector>
 
 /*
 TODO.
@@ -31,6 +33,13 @@ file is deleted on exit.
 namespace perspective
 {
 
+// Chunk size of BACKING_STORE_CHUNKED stores, in bytes. A power of
+// two and a multiple of every fixed element size, so fixed size
+// elements never straddle two chunks.
+#define PSP_LSTORE_CHUNK_SHIFT 16
+#define PSP_LSTORE_CHUNK_SIZE (t_uindex(1) << PSP_LSTORE_CHUNK_SHIFT)
+#define PSP_LSTORE_CHUNK_MASK (PSP_LSTORE_CHUNK_SIZE - 1)
+
 struct t_lstore_tmp_init_tag
 {
 };
@@ -189,6 +198,12 @@ public:
 
     void fill(const t_lstore& other, const t_mask& mask, t_uindex elem_size);
 
+    // Compacts the elements of other selected by mask into this
+    // store. When status is non null the status bytes of
+    // other_status are compacted into it in the same pass.
+    void fill(const t_lstore& other, const t_mask& mask, t_uindex elem_size,
+        t_lstore* status, const t_lstore* other_status);
+
     template <typename DATA_T>
     void raw_fill(DATA_T v);
 
@@ -198,6 +213,30 @@ public:
 
     t_lstore_sptr clone() const;
 
+    t_mem_usage get_memory_usage(const t_str& name) const;
+
+    // True when all bytes live in a single allocation, i.e. when
+    // pointer arithmetic from get_ptr(0) reaches every element.
+    t_bool is_contiguous() const;
+
+    t_bool is_chunked() const;
+
+    t_uindex get_nchunks() const;
+
+    // Number of bytes addressable through get_ptr(offset) without
+    // crossing into another allocation.
+    t_uindex contiguous_bytes(t_uindex offset) const;
+
+    // Invokes f(ptr, bidx, n) for consecutive spans of the fixed size
+    // elements [bidx, eidx), each span lying within one chunk. ptr
+    // points at element bidx of the span. Contiguous stores produce
+    // a single span.
+    template <typename T, typename FUNC_T>
+    void for_each_span(t_uindex bidx, t_uindex eidx, FUNC_T f);
+
+    template <typename T, typename FUNC_T>
+    void for_each_span(t_uindex bidx, t_uindex eidx, FUNC_T f) const;
+
     t_bool
     get_init() const
     {
@@ -217,6 +256,19 @@ protected:
 
 private:
     void reserve_impl(t_uindex capacity, bool allow_shrink);
+    void reserve_chunks(t_uindex capacity, bool allow_shrink);
+    void* alloc_chunk(t_uindex nbytes);
+    void free_chunk(void* ptr);
+    void free_chunks();
+
+    // Copies len bytes from src at src_offset to dst_offset, splitting
+    // the copy at chunk boundaries of either store.
+    void copy_bytes(t_uindex dst_offset, const t_lstore& src,
+        t_uindex src_offset, t_uindex len);
+
+    t_uchar* chunk_ptr(t_uindex offset) const;
+
+
     t_handle create_file();
     void* create_mapping();
     void resize_mapping(t_uindex cap_new);
@@ -242,13 +294,20 @@ private:
     t_uindex m_version;
     t_bool m_from_recipe;
 
+    // BACKING_STORE_CHUNKED only. m_chunks maps each chunk index to its
+    // base address, m_allocs holds the allocations backing them; a
+    // single allocation may back several consecutive chunks when a
+    // push_back is larger than a chunk.
+    std::vector<t_uchar*> m_chunks;
+    std::vector<t_uchar*> m_allocs;
+
 #ifdef PSP_MPROTECT
     // size of padding + size of fields above
     // ==
     // page_size. this invariant is checked in
     // the constructor if
     // mprotect is enabled
-    char m_padding[3820];
+    char m_padding[3820 - 2 * sizeof(std::vector<t_uchar*>)];
 #endif
 };
 
@@ -276,10 +335,27 @@ struct t_unlock_store
 
 // typed uniform sized lstore
 
+inline t_uchar*
+t_lstore::chunk_ptr(t_uindex offset) const
+{
+    return m_chunks[offset >> PSP_LSTORE_CHUNK_SHIFT]
+        + (offset & PSP_LSTORE_CHUNK_MASK);
+}
+
 template <typename T>
 void
 t_lstore::push_back(T value)
 {
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+    {
+        if (m_size + sizeof(T) > m_capacity)
+            reserve(m_size + sizeof(T));
+        *reinterpret_cast<T*>(chunk_ptr(m_size)) = value;
+        m_size += sizeof(T);
+        PSP_CHECK_CAPACITY();
+        return;
+    }
+
     if (m_size + sizeof(T) >= m_capacity)
         reserve(static_cast<t_uindex>(std::ceil(m_capacity + m_size
             + sizeof(T)))); // reserve will multiply by m_resize_factor
@@ -301,6 +377,8 @@ T*
 t_lstore::get(t_uindex idx)
 {
     STORAGE_CHECK_ACCESS_GET(idx);
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+        return reinterpret_cast<T*>(chunk_ptr(idx));
     T* ptr = reinterpret_cast<T*>(static_cast<t_uchar*>(m_base) + idx);
     return ptr;
 }
@@ -310,6 +388,8 @@ const T*
 t_lstore::get(t_uindex idx) const
 {
     STORAGE_CHECK_ACCESS_GET(idx);
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+        return reinterpret_cast<T*>(chunk_ptr(idx));
     T* ptr = reinterpret_cast<T*>(static_cast<t_uchar*>(m_base) + idx);
     return ptr;
 }
@@ -319,6 +399,8 @@ T*
 t_lstore::get_nth(t_uindex idx)
 {
     STORAGE_CHECK_ACCESS_GET(idx);
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+        return reinterpret_cast<T*>(chunk_ptr(idx * sizeof(T)));
     return static_cast<T*>(m_base) + idx;
 }
 
@@ -327,6 +409,8 @@ const T*
 t_lstore::get_nth(t_uindex idx) const
 {
     STORAGE_CHECK_ACCESS_GET(idx);
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+        return reinterpret_cast<T*>(chunk_ptr(idx * sizeof(T)));
     return static_cast<T*>(m_base) + idx;
 }
 
@@ -335,7 +419,9 @@ void
 t_lstore::set_nth(t_uindex idx, T v)
 {
     STORAGE_CHECK_ACCESS(idx);
-    T* tgt = static_cast<T*>(m_base) + idx;
+    T* tgt = m_backing_store == BACKING_STORE_CHUNKED
+        ? reinterpret_cast<T*>(chunk_ptr(idx * sizeof(T)))
+        : static_cast<T*>(m_base) + idx;
     *tgt = v;
 }
 
@@ -350,7 +436,9 @@ t_lstore::extend(t_uindex idx)
         t_unlock_store tmp(this);
         m_size = nsize;
     }
-    T* rv = reinterpret_cast<T*>(static_cast<t_uchar*>(m_base) + osize);
+    // For chunked stores only the first extended element is
+    // guaranteed to be adjacent to the returned pointer.
+    T* rv = get<T>(osize);
     PSP_CHECK_CAPACITY();
     return rv;
 }
@@ -366,11 +454,50 @@ template <typename DATA_T>
 void
 t_lstore::raw_fill(DATA_T v)
 {
+    if (m_backing_store == BACKING_STORE_CHUNKED)
+    {
+        for_each_span<DATA_T>(0, size() / sizeof(DATA_T),
+            [v](DATA_T* ptr, t_uindex, t_uindex n) {
+                std::fill(ptr, ptr + n, v);
+            });
+        return;
+    }
+
     auto biter = static_cast<DATA_T*>(m_base);
     auto eiter = reinterpret_cast<DATA_T*>(static_cast<char*>(m_base) + size());
     std::fill(biter, eiter, v);
 }
 
+template <typename T, typename FUNC_T>
+void
+t_lstore::for_each_span(t_uindex bidx, t_uindex eidx, FUNC_T f)
+{
+    if (m_backing_store != BACKING_STORE_CHUNKED)
+    {
+        if (bidx < eidx)
+            f(static_cast<T*>(m_base) + bidx, bidx, eidx - bidx);
+        return;
+    }
+
+    const t_uindex per_chunk = PSP_LSTORE_CHUNK_SIZE / sizeof(T);
+    while (bidx < eidx)
+    {
+        t_uindex n = std::min(eidx - bidx, per_chunk - bidx % per_chunk);
+        f(reinterpret_cast<T*>(chunk_ptr(bidx * sizeof(T))), bidx, n);
+        bidx += n;
+    }
+}
+
+template <typename T, typename FUNC_T>
+void
+t_lstore::for_each_span(t_uindex bidx, t_uindex eidx, FUNC_T f) const
+{
+    const_cast<t_lstore*>(this)->for_each_span<T>(
+        bidx, eidx, [&f](T* ptr, t_uindex idx, t_uindex n) {
+            f(static_cast<const T*>(ptr), idx, n);
+        });
+}
+
 struct PERSPECTIVE_EXPORT t_column_recipe
 {
     t_column_recipe();
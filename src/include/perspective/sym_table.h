@@ -10,11 +10,42 @@
 #pragma once
 #include <perspective/first.h>
 #include <perspective/scalar.h>
+#include <perspective/memory_usage.h>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace perspective
 {
 
+// Bump allocator for interned strings. Strings live until the arena
+// is cleared or destroyed.
+class t_string_arena
+{
+public:
+    t_string_arena();
+    // Takes other's blocks, so strings it handed out stay valid
+    t_string_arena(t_string_arena&& other);
+    ~t_string_arena();
+
+    // Copies len bytes of s plus a terminating nul, preceded by
+    // prefix bytes of uninitialized space. Returns the string.
+    t_char* copy(const t_char* s, t_uindex len, t_uindex prefix = 0);
+    void clear();
+    t_uindex size() const;
+    t_uindex capacity() const;
+
+private:
+    t_string_arena(const t_string_arena&);
+    t_string_arena& operator=(const t_string_arena&);
+
+    std::vector<t_char*> m_blocks;
+    t_uindex m_used;
+    t_uindex m_avail;
+    t_uindex m_size;
+    t_uindex m_capacity;
+};
+
 class t_symtable
 {
     typedef std::unordered_map<const char*, const char*, t_cchar_umap_hash,
@@ -23,19 +54,68 @@ class t_symtable
 
 public:
     t_symtable();
+    // Scalars interned by other keep pointing into the moved arena.
+    // Copying is not supported, it would leave them dangling.
+    t_symtable(t_symtable&& other);
     ~t_symtable();
 
     const t_char* get_interned_cstr(const t_char* s);
     t_tscalar get_interned_tscalar(const t_char* s);
     t_tscalar get_interned_tscalar(const t_tscalar& s);
     t_uindex size() const;
+    t_mem_usage get_memory_usage() const;
+
+    // Frees every string, scalars interned here must be dropped first
+    void clear();
 
 private:
     t_mapping m_mapping;
+    t_string_arena m_arena;
 };
 
+// The global interner is sharded by hash. Lookups of strings already
+// interned take no lock; interning a new string locks its shard only.
+//
+// get_interned_cstr pins its string for the life of the process.
+// acquire_interned_cstr takes a reference instead, which
+// release_interned_cstr drops. Once a string is neither pinned nor
+// referenced it leaves the table, and its memory is reclaimed when no
+// lookup that could still see it is running. Scalars made from a
+// referenced string must be dropped before it is released.
 const t_char* get_interned_cstr(const t_char* s);
 t_tscalar get_interned_tscalar(const t_char* s);
 t_tscalar get_interned_tscalar(const t_tscalar& s);
+const t_char* acquire_interned_cstr(const t_char* s);
+void release_interned_cstr(const t_char* s);
+
+// Live bytes and capacity of the global strings and their tables
+t_mem_usage get_interned_memory_usage();
+
+// References to global strings held for one owner, one per distinct
+// string, and released together by clear() or the destructor
+class t_intern_lease
+{
+    typedef std::unordered_set<const char*, t_cchar_umap_hash,
+        t_cchar_umap_cmp>
+        t_held;
+
+public:
+    t_intern_lease();
+    ~t_intern_lease();
+
+    const t_char* get_interned_cstr(const t_char* s);
+    t_tscalar get_interned_tscalar(const t_char* s);
+    t_tscalar get_interned_tscalar(const t_tscalar& s);
+    t_uindex size() const;
+    t_mem_usage get_memory_usage() const;
+    void clear();
+
+private:
+    t_intern_lease(const t_intern_lease&);
+    t_intern_lease& operator=(const t_intern_lease&);
+
+    t_held m_held;
+    t_uindex m_bytes;
+};
 
 } // end namespace perspective
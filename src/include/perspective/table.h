@@ -93,6 +93,9 @@ public:
     // Only increment capacity
     void reserve(t_uindex nelems);
 
+    // Only decrement capacity, never below size
+    void shrink(t_uindex nelems);
+
     // Increment capacity and size
     void extend(t_uindex nelems);
 
@@ -106,6 +109,8 @@ public:
     t_bool is_same_shape(t_table& tbl) const;
 
     void pprint() const;
+
+    t_mem_usage get_memory_usage(const t_str& name) const;
     void pprint(t_uindex nrows, std::ostream* os = 0) const;
     void pprint(const t_str& fname) const;
     void pprint(const std::vector<t_uindex>& vec) const;
@@ -0,0 +1,111 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <cstddef>
+#include <vector>
+
+namespace perspective
+{
+
+// Bump allocator for temporaries that live for one gnode tick. All of
+// its memory is released at once by reset(). Blocks are kept across
+// resets, and a tick that needed several is given one block of their
+// total size, so similar ticks after it allocate nothing.
+class PERSPECTIVE_EXPORT t_tick_arena
+{
+public:
+    t_tick_arena();
+    // Copies start empty, temporaries are never shared
+    t_tick_arena(const t_tick_arena& other);
+    t_tick_arena& operator=(const t_tick_arena& other);
+    ~t_tick_arena();
+
+    void* allocate(t_uindex nbytes, t_uindex alignment);
+    void reset();
+    t_uindex capacity() const;
+
+private:
+    void add_block(t_uindex nbytes);
+    void free_blocks();
+
+    std::vector<t_uchar*> m_blocks;
+    std::vector<t_uindex> m_block_sizes;
+    t_uindex m_block;
+    t_uindex m_used;
+    // Bytes used by the current tick in blocks before m_block
+    t_uindex m_prev_used;
+};
+
+// Resets an arena when it goes out of scope. Declare it before the
+// containers using the arena, so they are destroyed first.
+class PERSPECTIVE_EXPORT t_tick_arena_scope
+{
+public:
+    t_tick_arena_scope(t_tick_arena& arena);
+    ~t_tick_arena_scope();
+
+private:
+    t_tick_arena& m_arena;
+};
+
+// Standard allocator over a tick arena. Deallocation is a no-op.
+template <typename T>
+class t_tick_allocator
+{
+public:
+    typedef T value_type;
+
+    explicit t_tick_allocator(t_tick_arena* arena)
+        : m_arena(arena)
+    {
+    }
+
+    template <typename U>
+    t_tick_allocator(const t_tick_allocator<U>& other)
+        : m_arena(other.m_arena)
+    {
+    }
+
+    T*
+    allocate(std::size_t n)
+    {
+        return static_cast<T*>(
+            m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void
+    deallocate(T*, std::size_t)
+    {
+    }
+
+    template <typename U>
+    bool
+    operator==(const t_tick_allocator<U>& other) const
+    {
+        return m_arena == other.m_arena;
+    }
+
+    template <typename U>
+    bool
+    operator!=(const t_tick_allocator<U>& other) const
+    {
+        return m_arena != other.m_arena;
+    }
+
+    t_tick_arena* m_arena;
+};
+
+template <typename T>
+using t_tick_vec = std::vector<T, t_tick_allocator<T>>;
+
+} // end namespace perspective
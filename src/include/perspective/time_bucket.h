@@ -0,0 +1,36 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/exports.h>
+#include <perspective/column.h>
+
+namespace perspective
+{
+
+// Whether pivots of mode group DTYPE_TIME and DTYPE_DATE values by the
+// start of their minute, hour, day, week (from Monday), month or year
+PERSPECTIVE_EXPORT t_bool is_time_bucket(t_pivot_mode mode);
+
+// Start of the bucket holding v, a t_time raw value (microseconds
+// since the epoch, UTC)
+PERSPECTIVE_EXPORT t_int64 bucket_time(t_int64 v, t_pivot_mode mode);
+
+// Start of the bucket holding v, a t_date raw value. Dates are their
+// own minute, hour and day buckets.
+PERSPECTIVE_EXPORT t_uint32 bucket_date(t_uint32 v, t_pivot_mode mode);
+
+// Copy of col, a DTYPE_TIME or DTYPE_DATE column, holding the bucket
+// of each value
+PERSPECTIVE_EXPORT t_col_sptr bucket_column(
+    const t_column* col, t_pivot_mode mode);
+
+} // end namespace perspective
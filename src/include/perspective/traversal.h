@@ -19,8 +19,12 @@
 #include <perspective/sort_specification.h>
 #include <perspective/sparse_tree_node.h>
 #include <perspective/arg_sort.h>
+#include <perspective/memory_usage.h>
+#include <perspective/traversal_seq.h>
 #include <algorithm>
 #include <queue>
+#include <unordered_map>
+#include <unordered_set>
 
 SUPPRESS_WARNINGS_VC(4503)
 
@@ -30,11 +34,28 @@ namespace perspective
 class t_config;
 class t_ctx2;
 
+// Visible rows of a tree context. Nodes live in slots which stay
+// put while rows are inserted and removed; t_tvseq maps row indices
+// to slots and back in O(log N), and a hash maps tree indices to
+// slots. Parents are kept as slots, so the relative parent offsets
+// reported by get_node are computed on demand.
+//
+// In lazy mode set_depth only records which nodes are expanded. Such
+// pending nodes hold the row count of their subtree as the weight of
+// their slot, and their children are sorted and materialized the
+// first time a row inside the subtree is touched or a node inside it
+// is looked up by tree index.
 class t_traversal
 {
 public:
     t_traversal(t_stree_csptr tree, t_bool handle_nan_sort);
 
+    void set_lazy(t_bool lazy);
+    t_bool is_lazy() const;
+
+    // Materializes rows [bidx, eidx)
+    void materialize(t_tvidx bidx, t_tvidx eidx) const;
+
     t_index expand_node(t_tvidx exp_idx);
 
     t_index expand_node(
@@ -48,8 +69,6 @@ public:
 
     t_rcode update_ancestors(t_tvidx nidx, t_index n_changed);
 
-    t_rcode update_sucessors(t_tvidx nidx, t_index n_changed);
-
     t_ptidx get_tree_index(t_tvidx idx) const;
 
     t_uindex size() const;
@@ -70,6 +89,8 @@ public:
 
     void pprint() const;
 
+    t_mem_usage get_memory_usage() const;
+
     t_tvnode get_node(t_tvidx idx) const;
 
     void get_leaves(std::vector<t_tvidx>& out_data) const;
@@ -113,9 +134,61 @@ public:
     void populate_root_children(t_stree_csptr tree);
 
 private:
+    // Slot of row idx, materializing it if needed
+    t_uindex get_slot(t_tvidx idx) const;
+    // Slot of tree index tnid, materializing its pending ancestors.
+    // False if tnid has no row.
+    t_bool find_slot(t_ptidx tnid, t_uindex& slot) const;
+    t_tvnode& node_at(t_tvidx idx);
+    const t_tvnode& node_at(t_tvidx idx) const;
+
+    t_uindex alloc_slot(const t_tvnode& node, t_uindex pslot) const;
+    void free_slots(const std::vector<t_uindex>& slots);
+    void add_ancestor_desc(t_uindex slot, t_index n_changed) const;
+
+    // Children of the node at position nidx of slots, a copy of the
+    // sequence, where cdesc holds the number of descendants in slots
+    void get_child_indices(const std::vector<t_uindex>& slots,
+        const std::vector<t_index>& cdesc, t_tvidx nidx,
+        std::vector<std::pair<t_tvidx, t_ptidx>>& out_data) const;
+
+    // Inserts nodes for tree children tnids, in order, under exp_idx
+    t_index insert_children(t_tvidx exp_idx, const std::vector<t_ptidx>& tnids);
+
+    void get_sorted_children(t_ptidx tnid, const t_sortsvec& sortby,
+        t_ctx2* ctx2, std::vector<t_ptidx>& out_tnids) const;
+
+    t_index collapse_slot(t_uindex slot);
+
+    // Rows below tnid, at depth, when expanded down to m_lazy_depth
+    t_index count_visible(t_ptidx tnid, t_depth depth,
+        const std::unordered_set<t_ptidx>& excluded) const;
+
+    // Marks slot pending and recounts its rows, skipping excluded.
+    // Returns the change in rows.
+    t_index set_pending(
+        t_uindex slot, const std::unordered_set<t_ptidx>& excluded) const;
+    void materialize_slot(t_uindex slot) const;
+    void flush_pending(const std::unordered_set<t_ptidx>& excluded) const;
+
     t_stree_csptr m_tree;
-    std::shared_ptr<std::vector<t_tvnode>> m_nodes;
+    // Nodes and parent slots, by slot. Mutable since const readers
+    // materialize pending rows.
+    mutable std::vector<t_tvnode> m_nodes;
+    mutable std::vector<t_uindex> m_pslots;
+    mutable std::vector<t_uindex> m_free_slots;
+    mutable t_tvseq m_seq;
+    mutable std::unordered_map<t_ptidx, t_uindex> m_tnid_slots;
     t_bool m_handle_nan_sort;
+
+    t_bool m_lazy;
+    t_depth m_lazy_depth;
+    t_sortsvec m_lazy_sortby;
+    t_ctx2* m_lazy_ctx2;
+    // Per slot, set while the children are not materialized
+    mutable std::vector<t_uint8> m_pending;
+    // Tree indices of pending nodes whose rows need a recount
+    mutable std::vector<t_ptidx> m_dirty;
 };
 
 template <typename SRC_T>
@@ -123,13 +196,32 @@ void
 t_traversal::sort_by(const t_config& config, const t_sortsvec& sortby,
     const SRC_T& src, t_ctx2* ctx2)
 {
-    std::vector<t_tvnode> new_nodes(m_nodes->size());
+    m_lazy_sortby = sortby;
+    m_lazy_ctx2 = ctx2;
+    flush_pending(std::unordered_set<t_ptidx>());
+
+    // Slots in current and sorted order. Pending nodes keep their
+    // rows unmaterialized, so count descendants in slots.
+    std::vector<t_uindex> slots;
+    m_seq.get_slots(0, m_seq.size(), slots);
+    std::vector<t_uindex> new_slots(slots.size());
+
+    std::vector<t_index> cdesc(slots.size(), 0);
+    std::vector<t_index> slot_pos(m_nodes.size());
+    for (t_index idx = 0, loop_end = slots.size(); idx < loop_end; ++idx)
+    {
+        slot_pos[slots[idx]] = idx;
+    }
+    for (t_index idx = slots.size() - 1; idx > 0; --idx)
+    {
+        cdesc[slot_pos[m_pslots[slots[idx]]]] += cdesc[idx] + 1;
+    }
 
     // Pair is -> (old tvidx, new tvidx)
     std::vector<std::pair<t_tvidx, t_tvidx>> queue;
 
     // Add root to queue
-    new_nodes[0] = (*m_nodes)[0];
+    new_slots[0] = slots[0];
     queue.emplace_back(std::pair<t_tvidx, t_tvidx>(0, 0));
 
     std::vector<t_index> sortby_agg_indices(sortby.size());
@@ -154,10 +246,8 @@ t_traversal::sort_by(const t_config& config, const t_sortsvec& sortby,
         // Heads idx in new traversal
         t_tvidx h_ntvidx = head_info.second;
 
-        const t_tvnode& head = (*m_nodes)[h_ctvidx];
-
         std::vector<std::pair<t_tvidx, t_ptidx>> h_children;
-        get_child_indices(h_ctvidx, h_children);
+        get_child_indices(slots, cdesc, h_ctvidx, h_children);
 
         if (!h_children.empty())
         {
@@ -185,7 +275,7 @@ t_traversal::sort_by(const t_config& config, const t_sortsvec& sortby,
             argsort(sorted_idx, sorter);
 
             t_index nchild = n_changed;
-            t_index ndesc = head.m_ndesc;
+            t_index ndesc = cdesc[h_ctvidx];
 
             // Fast path - if none of heads children are
             // expanded
@@ -199,9 +289,7 @@ t_traversal::sort_by(const t_config& config, const t_sortsvec& sortby,
                 for (t_uindex idx = bidx; idx < eidx; idx++)
                 {
                     t_index cidx = sorted_idx[idx - bidx];
-                    t_tvidx c_otvidx = h_children[cidx].first;
-                    new_nodes[idx] = (*m_nodes)[c_otvidx];
-                    new_nodes[idx].m_rel_pidx = idx - bidx + 1;
+                    new_slots[idx] = slots[h_children[cidx].first];
                 }
             }
             else
@@ -215,7 +303,7 @@ t_traversal::sort_by(const t_config& config, const t_sortsvec& sortby,
                     t_index cidx = sorted_idx[idx];
                     t_tvidx c_otvidx = h_children[cidx].first;
 
-                    const t_tvnode& child = (*m_nodes)[c_otvidx];
+                    const t_tvnode& child = m_nodes[slots[c_otvidx]];
 
                     // Enqueue child if it is expanded
                     if (child.m_expanded)
@@ -224,16 +312,16 @@ t_traversal::sort_by(const t_config& config, const t_sortsvec& sortby,
                             std::pair<t_tvidx, t_tvidx>(c_otvidx, c_ntvidx));
                     }
 
-                    new_nodes[c_ntvidx] = (*m_nodes)[c_otvidx];
-                    new_nodes[c_ntvidx].m_rel_pidx = c_ntvidx - h_ntvidx;
-                    c_ntvidx = c_ntvidx + child.m_ndesc + 1;
+                    new_slots[c_ntvidx] = slots[c_otvidx];
+                    c_ntvidx = c_ntvidx + cdesc[c_otvidx] + 1;
                 }
             }
         }
     }
 
-    std::swap(*m_nodes, new_nodes);
+    m_seq.assign(new_slots);
 }
+
 typedef std::shared_ptr<t_traversal> t_trav_sptr;
 typedef std::shared_ptr<const t_traversal> t_trav_csptr;
 
@@ -0,0 +1,101 @@
+/******************************************************************************
+ *
+ * Copyright (c) 2017, the Perspective Authors.
+ *
+ * This file is part of the Perspective library, distributed under the terms of
+ * the Apache License 2.0.  The full license can be found in the LICENSE file.
+ *
+ */
+
+#pragma once
+
+#include <perspective/first.h>
+#include <perspective/base.h>
+#include <perspective/raw_types.h>
+#include <perspective/exports.h>
+#include <perspective/memory_usage.h>
+#include <vector>
+
+namespace perspective
+{
+
+// Ordered sequence of slot ids, stored as an implicit treap with
+// subtree sizes and parent links. Positions are implicit, so
+// position -> slot, slot -> position, inserting and erasing ranges
+// are all O(log N) expected, plus the number of slots moved.
+// Slot ids are owned by the caller and may be any value below the
+// largest id seen so far plus one.
+//
+// Each slot spans weight positions, 1 unless set otherwise, so a
+// slot can stand in for rows that are not materialized yet. Inserts
+// and erases must fall on slot boundaries.
+class PERSPECTIVE_EXPORT t_tvseq
+{
+public:
+    t_tvseq();
+
+    void clear();
+    t_uindex size() const;
+
+    // Slot spanning position idx
+    t_uindex at(t_uindex idx) const;
+
+    // Slot spanning position idx, offset is set to idx minus the
+    // position of the slot
+    t_uindex locate(t_uindex idx, t_uindex& offset) const;
+
+    // First position of slot, which must be in the sequence
+    t_uindex index_of(t_uindex slot) const;
+
+    t_uindex get_weight(t_uindex slot) const;
+    void set_weight(t_uindex slot, t_uindex weight);
+
+    // Inserts slots, in order, before position idx. Weights are
+    // reset to 1 unless given.
+    void insert(t_uindex idx, const std::vector<t_uindex>& slots);
+    void insert(t_uindex idx, const std::vector<t_uindex>& slots,
+        const std::vector<t_uindex>& weights);
+    void insert(t_uindex idx, t_uindex slot);
+
+    // Removes positions [bidx, eidx), appending their slots to out
+    void erase(t_uindex bidx, t_uindex eidx, std::vector<t_uindex>& out);
+
+    // Replaces the sequence with slots, keeping their weights
+    void assign(const std::vector<t_uindex>& slots);
+
+    // Appends slots spanning positions [bidx, eidx) to out
+    void get_slots(
+        t_uindex bidx, t_uindex eidx, std::vector<t_uindex>& out) const;
+
+    t_mem_usage get_memory_usage() const;
+
+    static const t_uindex m_npos = static_cast<t_uindex>(-1);
+
+private:
+    void reserve_slot(t_uindex slot);
+    t_uindex subtree_size(t_uindex t) const;
+    void pull(t_uindex t);
+    t_uint32 next_priority();
+
+    // Splits t into the first k positions and the rest
+    void split(t_uindex t, t_uindex k, t_uindex& l, t_uindex& r);
+    t_uindex merge(t_uindex l, t_uindex r);
+
+    // Balanced subtree over slots[bidx, eidx), returns its root
+    t_uindex build(const std::vector<t_uindex>& slots, t_uindex bidx,
+        t_uindex eidx);
+
+    void collect(t_uindex t, std::vector<t_uindex>& out) const;
+    void set_root(t_uindex t);
+
+    t_uindex m_root;
+    std::vector<t_uindex> m_left;
+    std::vector<t_uindex> m_right;
+    std::vector<t_uindex> m_parent;
+    std::vector<t_uindex> m_size;
+    std::vector<t_uindex> m_weight;
+    std::vector<t_uint32> m_priority;
+    t_uint32 m_seed;
+};
+
+} // end namespace perspective
@@ -11,13 +11,34 @@
 #include <perspective/base.h>
 #include <perspective/storage.h>
 #include <perspective/exports.h>
+#include <boost/dynamic_bitset.hpp>
 #include <functional>
 #include <limits>
+#include <map>
+#include <memory>
 #include <unordered_map>
 
 namespace perspective
 {
 
+typedef boost::dynamic_bitset<> t_vocab_bitset;
+typedef std::shared_ptr<t_vocab_bitset> t_vocab_bitset_sptr;
+typedef std::shared_ptr<const t_vocab_bitset> t_vocab_bitset_csptr;
+
+// Result of a string predicate evaluated once per distinct
+// string in a vocabulary. m_bits is indexed by string id and
+// covers ids [0, m_upto). It is shared with callers, so evicting
+// the predicate does not free bits still in use.
+struct t_vocab_predicate
+{
+    t_vocab_predicate();
+
+    t_filter_op m_op;
+    t_str m_operand;
+    t_uindex m_upto;
+    t_vocab_bitset_sptr m_bits;
+};
+
 class PERSPECTIVE_EXPORT t_vocab
 {
     typedef std::unordered_map<const char*, t_uindex, t_cchar_umap_hash,
@@ -35,6 +56,7 @@ public:
     t_lstore_sptr get_extents();
     t_uindex get_vlenidx() const;
     t_uindex nbytes() const;
+    t_mem_usage get_memory_usage() const;
     void verify_size() const;
     void fill(
         const t_lstore& o_vlen, const t_lstore& o_extents, t_uindex vlenidx);
@@ -51,10 +73,29 @@ public:
 
     void reserve(size_t total_string_size, size_t string_count);
 
+    // Evaluates a case insensitive FILTER_OP_BEGINS_WITH,
+    // FILTER_OP_ENDS_WITH or FILTER_OP_CONTAINS predicate over
+    // the vocabulary. The returned bitset is indexed by string id.
+    // Results are cached per (op, operand) and only strings
+    // interned since the last call are evaluated.
+    t_vocab_bitset_csptr get_predicate_bits(
+        t_filter_op op, const t_str& operand);
+
+    // String ids ordered by case insensitive value.
+    const std::vector<t_stridx>& get_sorted_ids();
+
+    // Half open range into get_sorted_ids() of the ids whose
+    // lowercased value begins with prefix.
+    t_uidxpair get_prefix_range(const t_str& prefix);
+
+    void clear_predicate_cache();
+
 protected:
     // vlen interface
     t_uindex genidx();
 
+    void update_sorted_ids();
+
 private:
     // Max string id currently in use
     t_uindex m_vlenidx;
@@ -78,6 +119,13 @@ private:
     // for string with numeric id j.
     // These offsets index into m_vlendata
     t_lstore_sptr m_extents;
+
+    // Ids sorted by case insensitive value, covering
+    // ids [0, m_sorted_upto).
+    std::vector<t_stridx> m_sorted_ids;
+    t_uindex m_sorted_upto;
+
+    std::map<std::pair<t_filter_op, t_str>, t_vocab_predicate> m_predicates;
 };
 
 } // end namespace perspective
@@ -19,14 +19,24 @@
 #include <perspective/context_zero.h>
 #include <perspective/context_grouped_pkey.h>
 #include <perspective/node_processor.h>
+#include <perspective/dense_tree.h>
+#include <perspective/filter.h>
+#include <perspective/traversal.h>
+#include <perspective/sparse_tree.h>
 #include <perspective/storage.h>
 #include <perspective/none.h>
 #include <perspective/gnode.h>
+#include <perspective/gnode_state.h>
 #include <perspective/sym_table.h>
+#include <perspective/vocab.h>
+#include <perspective/time_bucket.h>
+#include <perspective/kernel_engine.h>
+#include <perspective/logtime.h>
 #include <gtest/gtest.h>
 #include <limits>
 #include <cmath>
 #include <sstream>
+#include <thread>
 
 using namespace perspective;
 
@@ -410,6 +420,93 @@ TEST(SCALAR, scalar_str)
     EXPECT_TRUE(mktscalar("a") == mktscalar("a"));
 }
 
+// Strings of up to 7 characters are stored in the scalar, longer ones
+// by pointer
+TEST(SCALAR, inplace_lengths)
+{
+    for (t_uindex len : {7, 8, 12})
+    {
+        t_str text = t_str("abcdefghijkl").substr(0, len);
+        t_str other = text;
+        t_str prefix = text.substr(0, len - 1);
+
+        t_tscalar a = mktscalar(text.c_str());
+        t_tscalar b = mktscalar(other.c_str());
+        EXPECT_EQ(a.is_inplace(), len < 8);
+        EXPECT_EQ(b.is_inplace(), len < 8);
+        EXPECT_EQ(a.to_string(), text);
+
+        t_tscalar copy = a;
+        t_tscalar assigned;
+        assigned.set(a);
+        for (const auto& c : {copy, assigned})
+        {
+            EXPECT_EQ(c.is_inplace(), a.is_inplace());
+            EXPECT_EQ(c.to_string(), text);
+            EXPECT_EQ(c, a);
+        }
+
+        EXPECT_EQ(a, b);
+        EXPECT_FALSE(a < b || b < a);
+        EXPECT_EQ(hash_value(a), hash_value(b));
+        EXPECT_EQ(std::hash<t_tscalar>()(a), std::hash<t_tscalar>()(b));
+
+        t_tscalar shorter = mktscalar(prefix.c_str());
+        EXPECT_TRUE(shorter < a);
+        EXPECT_NE(shorter, a);
+    }
+}
+
+TEST(SCALAR, inplace_lengths_tables)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "s", "v"},
+        {DTYPE_UINT8, DTYPE_STR, DTYPE_STR, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx0 = t_ctx0::build(sch, t_config{{"s", "v"}});
+    auto ctx1 = t_ctx1::build(sch, t_config({"s"}, {AGGTYPE_SUM, "v"}));
+    gn->register_context("ctx0", ctx0);
+    gn->register_context("ctx1", ctx1);
+    ctx0->sort_by({{0, SORTTYPE_ASCENDING}});
+    ctx1->sort_by({{0, SORTTYPE_ASCENDING}});
+
+    std::vector<t_str> texts{"abcdefg", "abcdefgh", "abcdefghijkl"};
+    {
+        // Input strings go away once the table is processed
+        std::vector<t_str> input(texts);
+        std::vector<t_tscalvec> rows;
+        for (t_uindex idx = 0; idx < input.size(); ++idx)
+        {
+            rows.push_back({iop, mktscalar(input[idx].c_str()),
+                mktscalar(input[idx].c_str()), mktscalar(t_int64(idx))});
+        }
+        gn->_send_and_process(t_table(sch, rows));
+    }
+
+    auto data = ctx0->get_data(0, 3, 0, 2);
+    ASSERT_EQ(data.size(), t_uindex(6));
+    for (t_uindex idx = 0; idx < texts.size(); ++idx)
+    {
+        EXPECT_EQ(data[2 * idx].to_string(), texts[idx]);
+        EXPECT_EQ(data[2 * idx].is_inplace(), texts[idx].size() < 8);
+        EXPECT_EQ(data[2 * idx + 1], mktscalar(t_int64(idx)));
+    }
+    EXPECT_EQ(ctx0->get_pkeys({{0, 0}, {1, 0}, {2, 0}}),
+        t_tscalvec({mktscalar(texts[0].c_str()), mktscalar(texts[1].c_str()),
+            mktscalar(texts[2].c_str())}));
+
+    ASSERT_EQ(ctx1->get_row_count(), 4);
+    for (t_uindex idx = 0; idx < texts.size(); ++idx)
+    {
+        auto path = ctx1->get_row_path(idx + 1);
+        ASSERT_EQ(path.size(), t_uindex(1));
+        EXPECT_EQ(path[0].to_string(), texts[idx]);
+        EXPECT_EQ(ctx1->get_row_idx(path), t_index(idx + 1));
+    }
+}
+
 TEST(SCALAR, nan_test)
 {
     EXPECT_TRUE(
@@ -2389,4 +2486,1786 @@ TEST(GNODE_TEST, get_registered_contexts)
     EXPECT_EQ(gn->get_registered_contexts().size(), 0);
 
     gn->reset();
-}
\ No newline at end of file
+}
+
+TEST(VOCAB, predicate_bits)
+{
+    t_vocab vocab;
+    vocab.init(false);
+    auto a = vocab.get_interned("Apple");
+    auto b = vocab.get_interned("apricot");
+    auto c = vocab.get_interned("banana");
+
+    auto bits = vocab.get_predicate_bits(FILTER_OP_BEGINS_WITH, "AP");
+    EXPECT_TRUE(bits->test(a));
+    EXPECT_TRUE(bits->test(b));
+    EXPECT_FALSE(bits->test(c));
+
+    bits = vocab.get_predicate_bits(FILTER_OP_ENDS_WITH, "NA");
+    EXPECT_FALSE(bits->test(a));
+    EXPECT_TRUE(bits->test(c));
+
+    bits = vocab.get_predicate_bits(FILTER_OP_CONTAINS, "ric");
+    EXPECT_FALSE(bits->test(a));
+    EXPECT_TRUE(bits->test(b));
+
+    // cached predicates are extended with newly interned strings
+    auto d = vocab.get_interned("apex");
+    bits = vocab.get_predicate_bits(FILTER_OP_BEGINS_WITH, "ap");
+    EXPECT_EQ(bits->size(), vocab.get_vlenidx());
+    EXPECT_TRUE(bits->test(d));
+
+    auto range = vocab.get_prefix_range("ap");
+    EXPECT_EQ(range.second - range.first, 3);
+}
+
+TEST(TABLE, filter_string_predicates)
+{
+    t_schema sch{{"s"}, {DTYPE_STR}};
+    t_table tbl(sch,
+        {{"apple"_ts}, {"Apricot"_ts}, {"banana"_ts}, {snull}, {"grape"_ts}});
+
+    auto contains = tbl.filter_cpp(FILTER_OP_AND,
+        {t_fterm("s", FILTER_OP_CONTAINS, "AP"_ts, t_tscalvec())});
+    EXPECT_EQ(contains->count(), 3);
+    EXPECT_TRUE(contains->get(4));
+    EXPECT_FALSE(contains->get(3));
+
+    auto begins = tbl.filter_cpp(FILTER_OP_OR,
+        {t_fterm("s", FILTER_OP_BEGINS_WITH, "ap"_ts, t_tscalvec()),
+            t_fterm("s", FILTER_OP_ENDS_WITH, "NA"_ts, t_tscalvec())});
+    EXPECT_EQ(begins->count(), 3);
+    EXPECT_FALSE(begins->get(4));
+}
+
+TEST(TABLE, filter_string_predicates_evicted)
+{
+    t_schema sch{{"s"}, {DTYPE_STR}};
+    t_table tbl(sch, {{"apple"_ts}, {"Apricot"_ts}, {"banana"_ts}});
+
+    // Leaves the vocab's predicate cache one short of full, so the
+    // second term of the next filter evicts the first term's bits
+    for (t_uindex idx = 0; idx < 127; ++idx)
+    {
+        auto mask = tbl.filter_cpp(FILTER_OP_AND,
+            {t_fterm("s", FILTER_OP_CONTAINS,
+                 mktscalar(get_interned_cstr(
+                     ("operand_" + std::to_string(idx)).c_str())),
+                 t_tscalvec())});
+        EXPECT_EQ(mask->count(), 0);
+    }
+
+    auto mask = tbl.filter_cpp(FILTER_OP_AND,
+        {t_fterm("s", FILTER_OP_CONTAINS, "P"_ts, t_tscalvec()),
+            t_fterm("s", FILTER_OP_CONTAINS, "a"_ts, t_tscalvec()),
+            t_fterm("s", FILTER_OP_ENDS_WITH, "e"_ts, t_tscalvec())});
+    EXPECT_EQ(mask->count(), 1);
+    EXPECT_TRUE(mask->get(0));
+}
+
+TEST(MASK, modes_and_ops)
+{
+    std::mt19937 gen(42);
+
+    for (auto density : {0.001, 0.1, 0.5, 0.999})
+    {
+        t_uindex sz = 1000;
+        std::bernoulli_distribution d(density);
+        std::vector<bool> ref_a(sz), ref_b(sz);
+        t_mask a(sz), b(sz);
+
+        for (t_uindex idx = 0; idx < sz; ++idx)
+        {
+            ref_a[idx] = d(gen);
+            ref_b[idx] = d(gen);
+            a.set(idx, ref_a[idx]);
+            b.set(idx, ref_b[idx]);
+        }
+
+        t_mask dense_a = a;
+        a.optimize();
+        b.optimize();
+
+        t_uindex expected = std::count(ref_a.begin(), ref_a.end(), true);
+        EXPECT_EQ(a.count(), expected);
+        EXPECT_LE(a.nbytes(), dense_a.nbytes());
+
+        std::vector<t_uindex> indices;
+        a.get_indices(indices);
+        EXPECT_EQ(indices.size(), expected);
+
+        t_uindex run_total = 0;
+        a.for_each_run([&](t_uindex bidx, t_uindex eidx) {
+            for (t_uindex idx = bidx; idx < eidx; ++idx)
+            {
+                EXPECT_TRUE(ref_a[idx]);
+            }
+            run_total += eidx - bidx;
+        });
+        EXPECT_EQ(run_total, expected);
+
+        t_uindex iter_total = 0;
+        for (auto idx = a.find_first(); idx != t_mask::m_npos;
+             idx = a.find_next(idx))
+        {
+            EXPECT_TRUE(ref_a[idx]);
+            ++iter_total;
+        }
+        EXPECT_EQ(iter_total, expected);
+
+        t_mask and_m = a, or_m = a, xor_m = a, sub_m = a;
+        and_m &= b;
+        or_m |= b;
+        xor_m ^= b;
+        sub_m -= b;
+
+        for (t_uindex idx = 0; idx < sz; ++idx)
+        {
+            EXPECT_EQ(a.get(idx), ref_a[idx]);
+            EXPECT_EQ(and_m.get(idx), ref_a[idx] && ref_b[idx]);
+            EXPECT_EQ(or_m.get(idx), ref_a[idx] || ref_b[idx]);
+            EXPECT_EQ(xor_m.get(idx), ref_a[idx] != ref_b[idx]);
+            EXPECT_EQ(sub_m.get(idx), ref_a[idx] && !ref_b[idx]);
+        }
+    }
+}
+
+TEST(COLUMN, clone_mask)
+{
+    std::mt19937 gen(7);
+
+    for (auto density : {0.001, 0.3, 0.97})
+    {
+        std::bernoulli_distribution d(density);
+        t_uindex sz = 777;
+        t_mask mask(sz);
+        for (t_uindex idx = 0; idx < sz; ++idx)
+        {
+            mask.set(idx, d(gen));
+        }
+
+        for (auto dtype : {DTYPE_INT8, DTYPE_INT16, DTYPE_INT32, DTYPE_INT64,
+                 DTYPE_TIME})
+        {
+            t_column col(dtype, true, sz);
+            col.init();
+            col.set_size(sz);
+            for (t_uindex idx = 0; idx < sz; ++idx)
+            {
+                if (idx % 5 == 0)
+                    col.clear(idx);
+                else
+                    col.set_scalar(idx,
+                        mktscalar<t_int64>(idx % 100).coerce_numeric_dtype(
+                            dtype));
+            }
+
+            for (auto optimize : {false, true})
+            {
+                t_mask m = mask;
+                if (optimize)
+                    m.optimize();
+
+                auto cloned = col.clone(m);
+                t_uindex oidx = 0;
+                for (t_uindex idx = 0; idx < sz; ++idx)
+                {
+                    if (!mask.get(idx))
+                        continue;
+                    EXPECT_EQ(cloned->get_scalar(oidx), col.get_scalar(idx));
+                    EXPECT_EQ(*cloned->get_nth_status(oidx),
+                        *col.get_nth_status(idx));
+                    ++oidx;
+                }
+            }
+        }
+    }
+}
+
+TEST(STORAGE, chunked)
+{
+    t_lstore_recipe recipe("", "chunked", 0, BACKING_STORE_CHUNKED);
+    t_lstore store(recipe);
+    store.init();
+
+    t_uindex nelems = 3 * PSP_LSTORE_CHUNK_SIZE / sizeof(t_uint64) + 17;
+    for (t_uindex idx = 0; idx < nelems; ++idx)
+    {
+        store.push_back<t_uint64>(idx);
+        if (idx == 0)
+        {
+            EXPECT_EQ(*store.get_nth<t_uint64>(0), 0);
+        }
+    }
+
+    const t_uint64* first = store.get_nth<t_uint64>(0);
+    store.reserve(store.capacity() * 4);
+    EXPECT_EQ(first, store.get_nth<t_uint64>(0));
+    EXPECT_FALSE(store.is_contiguous());
+    EXPECT_EQ(store.get_nchunks(), store.capacity() / PSP_LSTORE_CHUNK_SIZE);
+
+    t_uindex expected = 0;
+    t_uindex nspans = 0;
+    store.for_each_span<t_uint64>(
+        0, nelems, [&](const t_uint64* ptr, t_uindex bidx, t_uindex n) {
+            for (t_uindex idx = 0; idx < n; ++idx)
+            {
+                EXPECT_EQ(ptr[idx], bidx + idx);
+                ++expected;
+            }
+            ++nspans;
+        });
+    EXPECT_EQ(expected, nelems);
+    EXPECT_EQ(nspans, 4);
+
+    t_lstore flat(t_lstore_recipe{8});
+    flat.init();
+    flat.fill(store);
+    for (t_uindex idx = 0; idx < nelems; ++idx)
+    {
+        EXPECT_EQ(*flat.get_nth<t_uint64>(idx), idx);
+    }
+
+    // strings never straddle chunks, even larger than one chunk
+    t_str big(PSP_LSTORE_CHUNK_SIZE + 10, 'x');
+    t_lstore strs(recipe);
+    strs.init();
+    strs.push_back("abc", 4);
+    strs.push_back(big.c_str(), big.size() + 1);
+    t_uindex small = PSP_LSTORE_CHUNK_SIZE - 3;
+    t_str pad(small, 'y');
+    strs.push_back(pad.c_str(), pad.size() + 1);
+    EXPECT_EQ(t_str(static_cast<const char*>(strs.get_ptr(
+                  strs.size() - pad.size() - 1))),
+        pad);
+    EXPECT_EQ(t_str(static_cast<const char*>(strs.get_ptr(0))), "abc");
+
+    t_schema schema{{"s", "i"}, {DTYPE_STR, DTYPE_INT64}};
+    t_table tbl("", "", schema, 5, BACKING_STORE_CHUNKED);
+    tbl.init();
+    t_uindex nrows = 40000;
+    tbl.extend(nrows);
+    auto scol = tbl.get_column("s");
+    auto icol = tbl.get_column("i");
+    const t_column* cscol = scol.get();
+    const char* s0 = 0;
+    for (t_uindex idx = 0; idx < nrows; ++idx)
+    {
+        scol->set_nth<const char*>(idx, std::to_string(idx).c_str());
+        icol->set_nth<t_int64>(idx, idx);
+        if (idx == 0)
+            s0 = cscol->get_nth<const char>(0);
+    }
+    EXPECT_EQ(s0, cscol->get_nth<const char>(0));
+
+    t_mask mask(nrows);
+    for (t_uindex idx = 0; idx < nrows; idx += 3)
+    {
+        mask.set(idx);
+    }
+
+    auto icopy = icol->clone(mask);
+    std::shared_ptr<const t_column> scopy = scol->clone(mask);
+    for (t_uindex idx = 0; idx < mask.count(); ++idx)
+    {
+        EXPECT_EQ(*icopy->get_nth<t_int64>(idx), t_int64(idx * 3));
+        EXPECT_EQ(t_str(scopy->get_nth<const char>(idx)),
+            std::to_string(idx * 3));
+    }
+}
+
+TEST(GNODE_TEST, chunked_state)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "s", "i"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    options.m_backing_store = BACKING_STORE_CHUNKED;
+    auto gn = t_gnode::build(options);
+
+    t_uindex nrows = 20000;
+    std::vector<t_tscalvec> data;
+    for (t_uindex idx = 0; idx < nrows; ++idx)
+    {
+        data.push_back({iop, mktscalar<t_int64>(idx),
+            mktscalar<const char*>(idx % 2 ? "odd" : "even"),
+            mktscalar<t_int64>(idx)});
+    }
+    t_table tbl(sch, data);
+    gn->_send_and_process(tbl);
+
+    auto state = gn->get_table();
+    EXPECT_EQ(state->num_rows(), nrows);
+    auto col = state->get_const_column("i");
+    t_int64 total = 0;
+    for (t_uindex idx = 0; idx < nrows; ++idx)
+    {
+        total += *col->get_nth<t_int64>(idx);
+    }
+    EXPECT_EQ(total, t_int64(nrows * (nrows - 1) / 2));
+}
+
+TEST(GNODE_TEST, memory_usage)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "s", "i"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+
+    auto ctx0 = t_ctx0::build(sch, t_config{{"s"}});
+    auto ctx1 = t_ctx1::build(sch, t_config({"s"}, {AGGTYPE_SUM, "i"}));
+    gn->register_context("ctx0", ctx0);
+    gn->register_context("ctx1", ctx1);
+
+    t_table tbl(sch, {{iop, 1_ts, "a"_ts, 1_ts}, {iop, 2_ts, "b"_ts, 2_ts}});
+    gn->_send_and_process(tbl);
+
+    auto usage = gn->get_memory_usage();
+    EXPECT_GE(usage.m_capacity, usage.m_size);
+
+    auto state = usage.find("gstate");
+    ASSERT_TRUE(state != nullptr);
+    auto scol = state->find("table")->find("s");
+    ASSERT_TRUE(scol != nullptr);
+    EXPECT_TRUE(scol->find("vocab") != nullptr);
+    EXPECT_GT(state->find("mapping")->m_size, 0);
+
+    auto contexts = usage.find("contexts");
+    ASSERT_TRUE(contexts != nullptr);
+    EXPECT_EQ(contexts->m_children.size(), 2);
+    auto c1 = contexts->find("ctx1");
+    ASSERT_TRUE(c1 != nullptr);
+    EXPECT_GT(c1->find("tree")->find("nodes")->m_size, 0);
+    EXPECT_TRUE(contexts->find("ctx0")->find("traversal") != nullptr);
+
+    t_uindex total = 0;
+    for (const auto& c : usage.m_children)
+    {
+        total += c.m_size;
+    }
+    EXPECT_EQ(total, usage.m_size);
+}
+
+TEST(DTREE, typed_pivot)
+{
+    t_schema sch{{"i", "s", "f", "b"},
+        {DTYPE_INT64, DTYPE_STR, DTYPE_FLOAT64, DTYPE_BOOL}};
+
+    std::vector<t_tscalvec> rows;
+    const char* strs[] = {"d", "a", "c", "b", "a"};
+    for (t_int64 idx = 0; idx < 40; ++idx)
+    {
+        t_int64 ival = (idx % 7 - 3) * (t_int64(1) << 40);
+        t_float64 fval = (idx % 5) - 2.5;
+        rows.push_back({mktscalar(ival), mktscalar(strs[idx % 5]),
+            mktscalar(fval), mktscalar(t_bool(idx % 3 == 0))});
+    }
+    auto tbl = std::make_shared<t_table>(sch, rows);
+
+    for (auto order : {PARTITION_SORTED, PARTITION_HASHED})
+    {
+        for (const auto& colname : sch.m_columns)
+        {
+            t_dtree tree(tbl, {t_pivot(colname)}, {});
+            tree.set_partition_order(order);
+            tree.init();
+            t_filter fltr;
+            tree.pivot(fltr, 2);
+
+            auto col = tbl->get_const_column(colname);
+            const t_column* leaves = tree.get_leaf_cptr();
+            // children are returned last to first
+            std::vector<t_ptidx> children;
+            tree.get_child_indices(0, children);
+            std::reverse(children.begin(), children.end());
+
+            std::set<t_tscalar> expected;
+            for (t_uindex idx = 0; idx < tbl->size(); ++idx)
+            {
+                expected.insert(col->get_scalar(idx));
+            }
+            EXPECT_EQ(children.size(), expected.size());
+
+            t_uindex nleaves = 0;
+            for (t_uindex cidx = 0; cidx < children.size(); ++cidx)
+            {
+                t_tscalar value = tree.get_value(fltr, children[cidx]);
+                if (order == PARTITION_SORTED && cidx > 0)
+                {
+                    EXPECT_TRUE(
+                        tree.get_value(fltr, children[cidx - 1]) < value);
+                }
+                auto node = tree.get_node_ptr(children[cidx]);
+                for (t_uindex lidx = node->m_flidx;
+                     lidx < node->m_flidx + node->m_nleaves; ++lidx)
+                {
+                    t_uindex ridx = *(leaves->get_nth<t_uindex>(lidx));
+                    EXPECT_EQ(col->get_scalar(ridx), value);
+                }
+                nleaves += node->m_nleaves;
+            }
+            EXPECT_EQ(nleaves, tbl->size());
+        }
+    }
+}
+
+TEST(TRAVERSAL, index_lookups)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "a", "b", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx1
+        = t_ctx1::build(sch, t_config({"a", "b"}, {AGGTYPE_SUM, "v"}));
+    gn->register_context("ctx1", ctx1);
+
+    std::vector<t_tscalvec> rows;
+    for (t_int64 idx = 0; idx < 100; ++idx)
+    {
+        rows.push_back({iop, mktscalar(idx), mktscalar(idx % 10),
+            mktscalar((idx / 10) % 4), mktscalar(idx)});
+    }
+    gn->_send_and_process(t_table(sch, rows));
+
+    // non owning, the tree belongs to ctx1
+    t_stree_csptr tree(ctx1->get_trees()[0], [](const t_stree*) {});
+    t_traversal trav(tree, false);
+    EXPECT_EQ(trav.size(), 11);
+
+    auto check = [&trav]() {
+        for (t_tvidx idx = 0; idx < t_tvidx(trav.size()); ++idx)
+        {
+            t_tvnode node = trav.get_node(idx);
+            EXPECT_EQ(trav.get_traversal_index(node.m_tnid), idx);
+            std::vector<t_tvidx> ancestors;
+            trav.get_node_ancestors(idx, ancestors);
+            if (idx > 0)
+            {
+                EXPECT_EQ(idx - node.m_rel_pidx, ancestors[0]);
+            }
+            EXPECT_EQ(ancestors.size(), node.m_depth);
+        }
+    };
+
+    EXPECT_EQ(trav.set_depth({}, 1), 40);
+    EXPECT_EQ(trav.size(), 51);
+    check();
+
+    EXPECT_EQ(trav.collapse_node(1), 4);
+    EXPECT_EQ(trav.size(), 47);
+    EXPECT_EQ(trav.get_node(0).m_ndesc, 46);
+    check();
+
+    t_ptidx removed = trav.get_tree_index(3);
+    EXPECT_EQ(trav.remove_subtree(3), 1);
+    EXPECT_EQ(trav.get_traversal_index(removed), INVALID_INDEX);
+    EXPECT_EQ(trav.get_node(2).m_nchild, 3);
+    check();
+
+    EXPECT_EQ(trav.expand_node(1), 4);
+    EXPECT_EQ(trav.size(), 50);
+    check();
+}
+
+TEST(TRAVERSAL, lazy_set_depth)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "a", "b", "c", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64,
+            DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    t_config cfg({"a", "b", "c"}, {AGGTYPE_SUM, "v"});
+    auto eager = t_ctx1::build(sch, cfg);
+    auto lazy = t_ctx1::build(sch, cfg);
+    lazy->set_lazy_expansion(true);
+    gn->register_context("eager", eager);
+    gn->register_context("lazy", lazy);
+
+    auto send = [&gn, &sch](t_int64 bidx, t_int64 eidx, t_tscalar op) {
+        std::vector<t_tscalvec> rows;
+        for (t_int64 idx = bidx; idx < eidx; ++idx)
+        {
+            rows.push_back({op, mktscalar(idx), mktscalar(idx % 7),
+                mktscalar((idx / 7) % 5), mktscalar((idx / 35) % 3),
+                mktscalar((idx * 37) % 101)});
+        }
+        gn->_send_and_process(t_table(sch, rows));
+    };
+
+    auto check = [&eager, &lazy]() {
+        ASSERT_EQ(lazy->get_row_count(), eager->get_row_count());
+        for (t_tvidx idx = 0; idx < eager->get_row_count(); ++idx)
+        {
+            EXPECT_EQ(lazy->get_row_path(idx), eager->get_row_path(idx));
+            EXPECT_EQ(lazy->get_trav_depth(idx), eager->get_trav_depth(idx));
+        }
+    };
+
+    send(0, 100, iop);
+    eager->sort_by({{0, SORTTYPE_DESCENDING}});
+    lazy->sort_by({{0, SORTTYPE_DESCENDING}});
+
+    eager->set_depth(2);
+    lazy->set_depth(2);
+    check();
+
+    eager->set_depth(0);
+    lazy->set_depth(0);
+    check();
+
+    eager->set_depth(1);
+    lazy->set_depth(1);
+    EXPECT_EQ(eager->close(3), lazy->close(3));
+    check();
+
+    // New groups under pending and materialized rows, and deletes
+    eager->set_depth(2);
+    lazy->set_depth(2);
+    send(100, 140, iop);
+    send(0, 20, dop);
+    check();
+}
+
+TEST(TRAVERSAL, lazy_row_idx)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "a", "b", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    t_config cfg({"a", "b"}, {AGGTYPE_SUM, "v"});
+    auto eager = t_ctx1::build(sch, cfg);
+    auto lazy = t_ctx1::build(sch, cfg);
+    lazy->set_lazy_expansion(true);
+    gn->register_context("eager", eager);
+    gn->register_context("lazy", lazy);
+
+    std::vector<t_tscalvec> rows;
+    for (t_int64 idx = 0; idx < 30; ++idx)
+    {
+        rows.push_back({iop, mktscalar(idx), mktscalar(idx % 3),
+            mktscalar(idx % 5), mktscalar(idx)});
+    }
+    gn->_send_and_process(t_table(sch, rows));
+    eager->sort_by({{0, SORTTYPE_DESCENDING}});
+    lazy->sort_by({{0, SORTTYPE_DESCENDING}});
+    eager->set_depth(2);
+
+    std::vector<t_tscalvec> paths;
+    for (t_tvidx idx = 0; idx < eager->get_row_count(); ++idx)
+    {
+        paths.push_back(eager->get_row_path(idx));
+    }
+
+    // Lookups land in subtrees that have not been materialized yet
+    auto check = [&]() {
+        for (auto iter = paths.rbegin(); iter != paths.rend(); ++iter)
+        {
+            EXPECT_EQ(lazy->get_row_idx(*iter), eager->get_row_idx(*iter));
+        }
+    };
+    lazy->set_depth(2);
+    check();
+
+    lazy->set_depth(0);
+    lazy->set_depth(2);
+    t_index aidx = eager->get_row_idx({mktscalar(t_int64(1))});
+    EXPECT_EQ(eager->close(aidx), lazy->close(aidx));
+    check();
+    t_tscalvec closed{mktscalar(t_int64(0)), mktscalar(t_int64(1))};
+    EXPECT_EQ(lazy->get_row_idx(closed), INVALID_INDEX);
+}
+
+TEST(FTRAV, topk)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "k", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto full = t_ctx0::build(sch, t_config{{"k", "v"}});
+    auto topk = t_ctx0::build(sch, t_config{{"k", "v"}});
+    topk->set_topk(5);
+    gn->register_context("full", full);
+    gn->register_context("topk", topk);
+    full->sort_by({{1, SORTTYPE_DESCENDING}});
+    topk->sort_by({{1, SORTTYPE_DESCENDING}});
+
+    auto check = [&full, &topk](t_tvidx bidx, t_tvidx eidx) {
+        ASSERT_EQ(topk->get_row_count(), full->get_row_count());
+        EXPECT_EQ(topk->get_data(bidx, eidx, 0, 2),
+            full->get_data(bidx, eidx, 0, 2));
+    };
+
+    std::mt19937 rng(7);
+    for (t_int64 step = 0; step < 30; ++step)
+    {
+        std::vector<t_tscalvec> rows;
+        for (t_int64 idx = 0; idx < 20; ++idx)
+        {
+            t_int64 pkey = rng() % 100;
+            t_tscalar op = rng() % 5 == 0 ? dop : iop;
+            rows.push_back({op, mktscalar(pkey), mktscalar(pkey),
+                op == dop ? i64_null : mktscalar(t_int64(rng() % 1000))});
+        }
+        gn->_send_and_process(t_table(sch, rows));
+
+        check(0, 10);
+        if (step % 3 == 0)
+            check(20, 40);
+        if (step % 7 == 0)
+            check(0, full->get_row_count());
+    }
+}
+
+TEST(FTRAV, topk_ties)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "k", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto full = t_ctx0::build(sch, t_config{{"k", "v"}});
+    auto topk = t_ctx0::build(sch, t_config{{"k", "v"}});
+    topk->set_topk(3);
+    gn->register_context("full", full);
+    gn->register_context("topk", topk);
+    full->sort_by({{1, SORTTYPE_DESCENDING}});
+    topk->sort_by({{1, SORTTYPE_DESCENDING}});
+
+    // Few distinct values, so most comparisons fall back to pkeys,
+    // read from the gstate by row, including rows deleted in the step
+    std::mt19937 rng(11);
+    for (t_int64 step = 0; step < 40; ++step)
+    {
+        std::vector<t_tscalvec> rows;
+        for (t_int64 idx = 0; idx < 10; ++idx)
+        {
+            t_int64 pkey = rng() % 30;
+            t_tscalar op = rng() % 3 == 0 ? dop : iop;
+            rows.push_back({op, mktscalar(pkey), mktscalar(pkey),
+                op == dop ? i64_null : mktscalar(t_int64(rng() % 2))});
+        }
+        gn->_send_and_process(t_table(sch, rows));
+
+        ASSERT_EQ(topk->get_row_count(), full->get_row_count());
+        EXPECT_EQ(topk->get_data(0, 6, 0, 2), full->get_data(0, 6, 0, 2));
+        EXPECT_EQ(topk->get_pkeys({{0, 0}, {1, 0}, {2, 0}}),
+            full->get_pkeys({{0, 0}, {1, 0}, {2, 0}}));
+    }
+}
+
+TEST(CTX0, step_delta)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "k", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx0::build(sch, t_config{{"k", "v"}});
+    gn->register_context("ctx", ctx);
+
+    std::vector<t_tscalvec> rows;
+    for (t_int64 pkey = 0; pkey < 4; ++pkey)
+    {
+        rows.push_back({iop, mktscalar(pkey), mktscalar(pkey),
+            mktscalar(pkey * 10)});
+    }
+    gn->_send_and_process(t_table(sch, rows));
+
+    gn->_send_and_process(t_table(sch,
+        {{iop, mktscalar(t_int64(1)), mktscalar(t_int64(1)),
+             mktscalar(t_int64(15))},
+            {iop, mktscalar(t_int64(3)), mktscalar(t_int64(3)),
+                mktscalar(t_int64(35))}}));
+    auto cells = ctx->get_step_delta(0, 4).cells;
+    ASSERT_EQ(cells.size(), 2);
+    EXPECT_EQ(cells[0].row, 1);
+    EXPECT_EQ(cells[0].column, 1);
+    EXPECT_EQ(cells[0].old_value, mktscalar(t_int64(10)));
+    EXPECT_EQ(cells[0].new_value, mktscalar(t_int64(15)));
+    EXPECT_EQ(cells[1].row, 3);
+    EXPECT_EQ(cells[1].new_value, mktscalar(t_int64(35)));
+
+    ctx->sort_by({{1, SORTTYPE_DESCENDING}});
+    gn->_send_and_process(t_table(sch,
+        {{iop, mktscalar(t_int64(0)), mktscalar(t_int64(0)),
+            mktscalar(t_int64(50))}}));
+    cells = ctx->get_step_delta(0, 1).cells;
+    ASSERT_EQ(cells.size(), 1);
+    EXPECT_EQ(cells[0].row, 0);
+    EXPECT_EQ(cells[0].new_value, mktscalar(t_int64(50)));
+}
+
+TEST(CTX0, step_delta_strings_retired)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "s"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx0::build(sch, t_config{{"s"}});
+    gn->register_context("ctx", ctx);
+
+    auto value = [](t_uindex idx) {
+        return "a value too long for a scalar " + std::to_string(idx + 100);
+    };
+    auto delta_strings = [&ctx]() {
+        return ctx->get_memory_usage().find("delta_strings")->m_size;
+    };
+
+    gn->_send_and_process(t_table(sch, {{iop, mktscalar(t_int64(0)), "a"_ts}}));
+
+    // Each step changes the value. Strings of earlier steps are freed
+    // once their delta has been read.
+    t_uindex size = 0;
+    for (t_uindex idx = 0; idx < 50; ++idx)
+    {
+        t_str v = value(idx);
+        gn->_send_and_process(
+            t_table(sch, {{iop, mktscalar(t_int64(0)), mktscalar(v.c_str())}}));
+        auto cells = ctx->get_step_delta(0, 1).cells;
+        ASSERT_EQ(cells.size(), 1);
+        EXPECT_EQ(cells[0].new_value.to_string(), v);
+        if (idx == 2)
+            size = delta_strings();
+    }
+    EXPECT_GT(size, t_uindex(0));
+    EXPECT_EQ(delta_strings(), size);
+}
+
+TEST(CTX0, cell_deltas_sparse_columns)
+{
+    // Rows changing a single column of a wide context only grow the
+    // buffers of that column
+    t_cell_deltas deltas;
+    deltas.init(1000);
+    for (t_uindex ridx = 0; ridx < 100; ++ridx)
+    {
+        deltas.insert(ridx, 3, mktscalar(t_int64(ridx)),
+            mktscalar(t_int64(ridx + 1)));
+    }
+    deltas.insert(50, 999, mktscalar(t_int64(0)), mktscalar(t_int64(1)));
+
+    EXPECT_EQ(deltas.size(), t_uindex(101));
+    EXPECT_EQ(deltas.get_memory_usage().find("values")->m_size,
+        (2 * 100 + 2 * 51) * sizeof(t_tscalar));
+
+    std::vector<t_uindex> columns;
+    deltas.for_each_cell(50,
+        [&columns](t_uindex colidx, const t_tscalar& old_value,
+            const t_tscalar& new_value) {
+            columns.push_back(colidx);
+            EXPECT_EQ(new_value.to_int64(), old_value.to_int64() + 1);
+        });
+    EXPECT_EQ(columns, std::vector<t_uindex>({3, 999}));
+}
+
+TEST(CTX0, viewport_deltas)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "k", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx0::build(sch, t_config{{"k", "v"}});
+    gn->register_context("ctx", ctx);
+
+    std::vector<t_tscalvec> rows;
+    for (t_int64 pkey = 0; pkey < 10; ++pkey)
+    {
+        rows.push_back(
+            {iop, mktscalar(pkey), mktscalar(pkey), mktscalar(pkey * 10)});
+    }
+    gn->_send_and_process(t_table(sch, rows));
+    ctx->subscribe_viewport(t_viewport(0, 3, 0, 2));
+
+    auto update = [&](t_int64 pkey, t_int64 v) {
+        gn->_send_and_process(t_table(
+            sch, {{iop, mktscalar(pkey), mktscalar(pkey), mktscalar(v)}}));
+    };
+
+    // Outside the window: counted, not captured
+    update(6, 61);
+    EXPECT_TRUE(ctx->has_deltas());
+    EXPECT_FALSE(ctx->get_viewport_changed());
+    EXPECT_TRUE(gn->get_viewports_last_updated().empty());
+    EXPECT_TRUE(ctx->get_step_delta(0, 10).cells.empty());
+
+    update(2, 21);
+    EXPECT_TRUE(ctx->get_viewport_changed());
+    EXPECT_EQ(gn->get_viewports_last_updated(), std::vector<t_str>{"ctx"});
+    auto delta = ctx->get_step_delta(0, 10);
+    EXPECT_FALSE(delta.rows_changed);
+    ASSERT_EQ(delta.cells.size(), 1);
+    EXPECT_EQ(delta.cells[0].row, 2);
+    EXPECT_EQ(delta.cells[0].old_value, mktscalar(t_int64(20)));
+
+    // A row sorting into the window was not captured, so the window
+    // has to be refetched
+    ctx->sort_by({{1, SORTTYPE_DESCENDING}});
+    update(3, 500);
+    EXPECT_TRUE(ctx->get_viewport_changed());
+    EXPECT_TRUE(ctx->get_step_delta(0, 3).rows_changed);
+}
+
+TEST(CTX0, viewport_negative_start)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "k", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx0::build(sch, t_config{{"k", "v"}});
+    gn->register_context("ctx", ctx);
+
+    auto update = [&](t_int64 pkey, t_int64 v) {
+        gn->_send_and_process(t_table(
+            sch, {{iop, mktscalar(pkey), mktscalar(pkey), mktscalar(v)}}));
+    };
+    for (t_int64 pkey = 0; pkey < 10; ++pkey)
+        update(pkey, pkey * 10);
+
+    // A start before the first row is clamped to it
+    ctx->subscribe_viewport(t_viewport(-2, 3, 0, 2));
+
+    update(6, 61);
+    EXPECT_FALSE(ctx->get_viewport_changed());
+
+    update(0, 1);
+    EXPECT_TRUE(ctx->get_viewport_changed());
+    auto delta = ctx->get_step_delta(0, 10);
+    ASSERT_EQ(delta.cells.size(), 1);
+    EXPECT_EQ(delta.cells[0].row, 0);
+    EXPECT_EQ(delta.cells[0].new_value, mktscalar(t_int64(1)));
+}
+
+TEST(CTX0, deleted_rows_reused)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "k", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx0::build(sch, t_config{{"k", "v"}});
+    gn->register_context("ctx", ctx);
+    ctx->sort_by({{1, SORTTYPE_DESCENDING}});
+
+    auto row = [](t_tscalar op, t_int64 pkey) {
+        return t_tscalvec{op, mktscalar(pkey), mktscalar(pkey),
+            op == dop ? i64_null : mktscalar(pkey * 10)};
+    };
+    auto keys = [&ctx]() {
+        return ctx->get_data(0, ctx->get_row_count(), 0, 1);
+    };
+
+    gn->_send_and_process(t_table(sch,
+        {row(iop, 0), row(iop, 1), row(iop, 2), row(iop, 3), row(iop, 4)}));
+
+    // The deleted row is not handed out again within the same batch
+    gn->_send_and_process(t_table(sch, {row(dop, 2), row(iop, 10)}));
+    EXPECT_EQ(keys(),
+        t_tscalvec({mktscalar(t_int64(10)), mktscalar(t_int64(4)),
+            mktscalar(t_int64(3)), mktscalar(t_int64(1)),
+            mktscalar(t_int64(0))}));
+
+    gn->_send_and_process(t_table(sch, {row(iop, 11), row(dop, 0)}));
+    EXPECT_EQ(keys(),
+        t_tscalvec({mktscalar(t_int64(11)), mktscalar(t_int64(10)),
+            mktscalar(t_int64(4)), mktscalar(t_int64(3)),
+            mktscalar(t_int64(1))}));
+}
+
+TEST(GNODE, compaction)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "k", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    options.m_compaction_threshold = 0.5;
+    options.m_compaction_budget = 2;
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx0::build(sch, t_config{{"k", "v"}});
+    gn->register_context("ctx", ctx);
+    ctx->sort_by({{1, SORTTYPE_DESCENDING}});
+
+    auto row = [](t_tscalar op, t_int64 pkey, t_int64 v) {
+        return t_tscalvec{op, mktscalar(pkey), mktscalar(pkey),
+            op == dop ? i64_null : mktscalar(v)};
+    };
+
+    std::vector<t_tscalvec> rows;
+    for (t_int64 pkey = 0; pkey < 10; ++pkey)
+        rows.push_back(row(iop, pkey, pkey * 10));
+    gn->_send_and_process(t_table(sch, rows));
+
+    rows.clear();
+    for (t_int64 pkey = 0; pkey < 7; ++pkey)
+        rows.push_back(row(dop, pkey, 0));
+    gn->_send_and_process(t_table(sch, rows));
+
+    // Two rows moved, the rest waits for the next step
+    EXPECT_EQ(gn->get_table()->size(), t_uindex(8));
+
+    gn->_send_and_process(t_table(sch, {row(iop, 9, 5)}));
+    EXPECT_EQ(gn->get_table()->size(), t_uindex(3));
+    EXPECT_EQ(ctx->get_data(0, ctx->get_row_count(), 0, 2),
+        t_tscalvec({mktscalar(t_int64(8)), mktscalar(t_int64(80)),
+            mktscalar(t_int64(7)), mktscalar(t_int64(70)),
+            mktscalar(t_int64(9)), mktscalar(t_int64(5))}));
+
+    gn->_send_and_process(t_table(sch, {row(iop, 8, 1), row(iop, 12, 120)}));
+    EXPECT_EQ(gn->get_table()->size(), t_uindex(4));
+    EXPECT_EQ(ctx->get_data(0, ctx->get_row_count(), 0, 2),
+        t_tscalvec({mktscalar(t_int64(12)), mktscalar(t_int64(120)),
+            mktscalar(t_int64(7)), mktscalar(t_int64(70)),
+            mktscalar(t_int64(9)), mktscalar(t_int64(5)),
+            mktscalar(t_int64(8)), mktscalar(t_int64(1))}));
+}
+
+TEST(GNODE, retention)
+{
+    t_schema isch{{"t", "v"}, {DTYPE_TIME, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_IMPLICIT_PKEYED;
+    options.m_port_schema = isch;
+    options.m_retention_rows = 3;
+    options.m_retention_column = "t";
+    options.m_retention_age = 100;
+    auto gn = t_gnode::build(options);
+    t_schema sch{{"psp_op", "psp_pkey", "t", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_TIME, DTYPE_INT64}};
+    auto ctx = t_ctx0::build(sch, t_config{{"v"}});
+    gn->register_context("ctx", ctx);
+
+    auto row = [](t_int64 t) {
+        return t_tscalvec{mktscalar(t_time(t)), mktscalar(t)};
+    };
+    auto values = [&ctx]() {
+        return ctx->get_data(0, ctx->get_row_count(), 0, 1);
+    };
+
+    gn->_send_and_process(t_table(isch, {row(0), row(10), row(20)}));
+    EXPECT_EQ(values(),
+        t_tscalvec({mktscalar(t_int64(0)), mktscalar(t_int64(10)),
+            mktscalar(t_int64(20))}));
+
+    // Over the row bound, the oldest rows go
+    gn->_send_and_process(t_table(isch, {row(40), row(30)}));
+    EXPECT_EQ(values(),
+        t_tscalvec({mktscalar(t_int64(20)), mktscalar(t_int64(40)),
+            mktscalar(t_int64(30))}));
+
+    // Older than 100 before the newest time
+    gn->_send_and_process(t_table(isch, {row(200), row(120)}));
+    EXPECT_EQ(values(),
+        t_tscalvec({mktscalar(t_int64(200)), mktscalar(t_int64(120))}));
+    EXPECT_EQ(gn->get_table()->size(), t_uindex(5));
+}
+
+TEST(GNODE, retention_string_pkeys)
+{
+    t_schema sch{{"psp_op", "psp_pkey"}, {DTYPE_UINT8, DTYPE_STR}};
+    t_retention retention(2, "", 0);
+
+    // Expired pkeys free their strings, so tracking stays bounded on
+    // an unbounded stream of pkeys
+    t_tscalvec expired;
+    for (t_uindex idx = 0; idx < 100; ++idx)
+    {
+        t_str pkey = "a pkey too long for a scalar " + std::to_string(idx);
+        retention.update(t_table(sch, {{iop, mktscalar(pkey.c_str())}}));
+        expired.clear();
+        retention.get_expired(expired);
+    }
+    EXPECT_EQ(retention.size(), t_uindex(2));
+    ASSERT_EQ(expired.size(), t_uindex(1));
+    EXPECT_EQ(expired[0].to_string(), "a pkey too long for a scalar 97");
+
+    t_mem_usage usage = retention.get_memory_usage();
+    auto strings = usage.find("strings");
+    ASSERT_TRUE(strings != nullptr);
+    EXPECT_EQ(strings->m_size, t_uindex(2 * 32));
+
+    // Moved pkeys outlive the moved from retention
+    t_retention* src = new t_retention(std::move(retention));
+    t_retention moved(std::move(*src));
+    delete src;
+    moved.update(t_table(sch, {{iop, "another long pkey"_ts}}));
+    expired.clear();
+    moved.get_expired(expired);
+    ASSERT_EQ(expired.size(), t_uindex(1));
+    EXPECT_EQ(expired[0].to_string(), "a pkey too long for a scalar 98");
+}
+
+TEST(GSTATE, ring_erase)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64}};
+    t_gstate state(t_schema{{"v"}, {DTYPE_INT64}}, sch);
+    state.init();
+    state.set_ring_capacity(8);
+
+    auto row = [](t_uint8 op, t_int64 pkey) {
+        return t_tscalvec{mktscalar(op), mktscalar(pkey), mktscalar(pkey)};
+    };
+    t_table inserts(
+        sch, {row(OP_INSERT, 0), row(OP_INSERT, 1), row(OP_INSERT, 2)});
+    state.update_history(&inserts);
+    EXPECT_TRUE(state.lookup(mktscalar(t_int64(1))).m_exists);
+
+    // Deleted without their rows being taken over
+    t_table deletes(sch, {row(OP_DELETE, 1)});
+    state.update_history(&deletes);
+    EXPECT_FALSE(state.lookup(mktscalar(t_int64(1))).m_exists);
+    EXPECT_TRUE(state.lookup_erased(mktscalar(t_int64(1))).m_exists);
+
+    t_table next(sch, {row(OP_INSERT, 3)});
+    state.update_history(&next);
+    EXPECT_FALSE(state.lookup(mktscalar(t_int64(1))).m_exists);
+    EXPECT_FALSE(state.lookup_erased(mktscalar(t_int64(1))).m_exists);
+    EXPECT_TRUE(state.lookup(mktscalar(t_int64(2))).m_exists);
+}
+
+TEST(GNODE, ring_capacity)
+{
+    t_schema isch{{"v"}, {DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_IMPLICIT_PKEYED;
+    options.m_port_schema = isch;
+    options.m_ring_capacity = 3;
+    auto gn = t_gnode::build(options);
+    t_schema sch{{"psp_op", "psp_pkey", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64}};
+    auto ctx = t_ctx0::build(sch, t_config{{"v"}});
+    gn->register_context("ctx", ctx);
+    ctx->sort_by({{0, SORTTYPE_ASCENDING}});
+
+    auto send = [&gn, &isch](t_int64 bidx, t_int64 eidx) {
+        std::vector<t_tscalvec> rows;
+        for (t_int64 v = bidx; v < eidx; ++v)
+            rows.push_back(t_tscalvec{mktscalar(v)});
+        gn->_send_and_process(t_table(isch, rows));
+    };
+    auto values = [&ctx]() {
+        return ctx->get_data(0, ctx->get_row_count(), 0, 1);
+    };
+
+    send(0, 2);
+    t_uindex capacity = gn->get_table()->get_capacity();
+
+    send(2, 4);
+    EXPECT_EQ(values(),
+        t_tscalvec({mktscalar(t_int64(1)), mktscalar(t_int64(2)),
+            mktscalar(t_int64(3))}));
+
+    // Batches past the capacity keep their last rows
+    send(4, 9);
+    EXPECT_EQ(values(),
+        t_tscalvec({mktscalar(t_int64(6)), mktscalar(t_int64(7)),
+            mktscalar(t_int64(8))}));
+    EXPECT_EQ(gn->get_table()->size(), t_uindex(3));
+    EXPECT_EQ(gn->get_table()->get_capacity(), capacity);
+}
+
+TEST(GROUPED_PKEY, incremental)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "id", "parent", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+
+    t_config cfg({t_pivot("id")}, {}, {t_aggspec("v", AGGTYPE_IDENTITY, "v")},
+        {"v"}, TOTALS_HIDDEN, {}, {}, FILTER_OP_AND, {}, true, "parent", "id",
+        "", FMODE_SIMPLE_CLAUSES, {}, "");
+    auto ctx = t_ctx_grouped_pkey::build(sch, cfg);
+    gn->register_context("ctx", ctx);
+
+    auto row = [](t_tscalar op, t_int64 id, t_tscalar parent, t_int64 v) {
+        return t_tscalvec{op, mktscalar(id), mktscalar(id), parent,
+            op == dop ? i64_null : mktscalar(v)};
+    };
+    auto p = [](t_int64 id) { return mktscalar(id); };
+    auto data = [](t_ctx_grouped_pkey_sptr c) {
+        return c->get_data(1, c->get_row_count(), 0, 2);
+    };
+    auto i64 = [](t_int64 v) { return mktscalar(v); };
+
+    // 4 waits on 9 under the root
+    gn->_send_and_process(t_table(sch,
+        {row(iop, 1, i64_null, 10), row(iop, 2, p(1), 20),
+            row(iop, 3, p(2), 30), row(iop, 4, p(9), 40)}));
+    ctx->open(1);
+    ctx->open(2);
+    EXPECT_EQ(data(ctx),
+        t_tscalvec({i64(1), i64(10), i64(2), i64(20), i64(3), i64(30), i64(4),
+            i64(40)}));
+
+    gn->_send_and_process(t_table(sch,
+        {row(iop, 3, p(2), 33), row(iop, 9, p(1), 90),
+            row(iop, 2, p(2), 20)}));
+    EXPECT_EQ(data(ctx),
+        t_tscalvec({i64(1), i64(10), i64(9), i64(90), i64(2), i64(20), i64(3),
+            i64(33)}));
+
+    gn->_send_and_process(t_table(sch, {row(dop, 1, i64_null, 0)}));
+    EXPECT_EQ(data(ctx),
+        t_tscalvec({i64(2), i64(20), i64(3), i64(33), i64(9), i64(90)}));
+
+    // A cycle is left to a rebuild, which drops it
+    gn->_send_and_process(t_table(sch,
+        {row(iop, 1, i64_null, 11), row(iop, 2, p(3), 20)}));
+    ctx->open(1);
+
+    auto fresh = t_ctx_grouped_pkey::build(sch, cfg);
+    gn->register_context("fresh", fresh);
+    fresh->set_expansion_state(ctx->get_expansion_state());
+    EXPECT_EQ(data(ctx), data(fresh));
+    EXPECT_EQ(data(ctx), t_tscalvec({i64(1), i64(11), i64(9), i64(90)}));
+}
+
+TEST(GROUPED_PKEY, register_populated)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "id", "parent", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+
+    auto row = [](t_int64 id, t_tscalar parent, t_int64 v) {
+        return t_tscalvec{
+            iop, mktscalar(id), mktscalar(id), parent, mktscalar(v)};
+    };
+    auto i64 = [](t_int64 v) { return mktscalar(v); };
+
+    gn->_send_and_process(t_table(sch,
+        {row(1, i64_null, 10), row(2, i64(1), 20), row(3, i64(1), 30)}));
+
+    // Registering on a populated gnode hands the context the gnode state
+    t_config cfg({t_pivot("id")}, {}, {t_aggspec("v", AGGTYPE_IDENTITY, "v")},
+        {"v"}, TOTALS_HIDDEN, {}, {}, FILTER_OP_AND, {}, true, "parent", "id",
+        "", FMODE_SIMPLE_CLAUSES, {}, "");
+    auto ctx = t_ctx_grouped_pkey::build(sch, cfg);
+    gn->register_context("ctx", ctx);
+    ctx->open(1);
+    EXPECT_EQ(ctx->get_data(1, ctx->get_row_count(), 0, 2),
+        t_tscalvec({i64(1), i64(10), i64(2), i64(20), i64(3), i64(30)}));
+
+    gn->_send_and_process(t_table(sch, {row(2, i64(1), 22)}));
+    EXPECT_EQ(ctx->get_data(1, ctx->get_row_count(), 0, 2),
+        t_tscalvec({i64(1), i64(10), i64(2), i64(22), i64(3), i64(30)}));
+    EXPECT_EQ(ctx->get_pkeys({{2, 0}}), t_tscalvec({i64(2)}));
+}
+
+TEST(CTX2, rollup_trees)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "a", "b", "c", "x"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_STR, DTYPE_STR,
+            DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+
+    t_aggspecvec aggs{{"sum_x", AGGTYPE_SUM, "x"},
+        {"mean_x", AGGTYPE_MEAN, "x"}, {"count_x", AGGTYPE_COUNT, "x"},
+        {"median_x", AGGTYPE_MEDIAN, "x"},
+        {"distinct_b", AGGTYPE_DISTINCT_COUNT, "b"},
+        {"join_a", AGGTYPE_JOIN, "a"}, {"any_c", AGGTYPE_ANY, "c"}};
+    t_config cfg{
+        {"a", "b"}, {"c"}, aggs, TOTALS_HIDDEN, FILTER_OP_AND, {}};
+    auto ctx = t_ctx2::build(sch, cfg);
+    gn->register_context("ctx", ctx);
+
+    gn->_send_and_process(t_table(sch,
+        {{iop, 1_ts, "a0"_ts, "b0"_ts, "c0"_ts, 1_ts},
+            {iop, 2_ts, "a0"_ts, "b1"_ts, "c1"_ts, 2_ts},
+            {iop, 3_ts, "a1"_ts, "b0"_ts, "c0"_ts, 3_ts},
+            {iop, 4_ts, "a1"_ts, "b1"_ts, "c1"_ts, 4_ts}}));
+
+    // Moves within a coarser node, across row and column nodes, and
+    // drops a leaf
+    gn->_send_and_process(t_table(sch,
+        {{iop, 1_ts, "a0"_ts, "b1"_ts, "c0"_ts, 5_ts},
+            {iop, 2_ts, "a1"_ts, "b1"_ts, "c0"_ts, 2_ts},
+            {iop, 5_ts, "a0"_ts, "b0"_ts, "c1"_ts, 6_ts},
+            {dop, 3_ts, "a1"_ts, "b0"_ts, "c0"_ts, i64_null}}));
+
+    auto fresh = t_ctx2::build(sch, cfg);
+    gn->register_context("fresh", fresh);
+
+    // A high water mark cannot be rolled up, so every tree of ref is
+    // built from its own pkeys
+    t_aggspecvec ref_aggs(aggs);
+    ref_aggs.push_back({"hwm_x", AGGTYPE_HIGH_WATER_MARK, "x"});
+    auto ref = t_ctx2::build(sch,
+        t_config{{"a", "b"}, {"c"}, ref_aggs, TOTALS_HIDDEN, FILTER_OP_AND,
+            {}});
+    gn->register_context("ref", ref);
+
+    auto data = [](t_ctx2_sptr c) {
+        c->set_depth(HEADER_ROW, 2);
+        c->set_depth(HEADER_COLUMN, 1);
+        return c->get_data(
+            0, c->get_row_count(), 0, c->get_column_count());
+    };
+
+    // Every row, with the high water mark dropped from ref
+    auto ctx_data = data(ctx);
+    auto ref_data = data(ref);
+    t_uindex naggs = aggs.size();
+    t_uindex width = ref->get_column_count();
+    t_tscalvec expected;
+    for (t_uindex idx = 0; idx < ref_data.size(); ++idx)
+    {
+        t_uindex cidx = idx % width;
+        if (cidx == 0 || (cidx - 1) % (naggs + 1) < naggs)
+            expected.push_back(ref_data[idx]);
+    }
+
+    // JOIN lists values in hash set order, so compare its items sorted
+    auto text = [](const t_tscalvec& values) {
+        std::vector<t_str> rval;
+        for (const auto& v : values)
+        {
+            t_str str = v.to_string();
+            std::vector<t_str> items;
+            t_uindex bidx = 0;
+            for (auto eidx = str.find(", "); eidx != t_str::npos;
+                 eidx = str.find(", ", bidx))
+            {
+                items.push_back(str.substr(bidx, eidx - bidx));
+                bidx = eidx + 2;
+            }
+            if (!items.empty() && bidx == str.size())
+            {
+                std::sort(items.begin(), items.end());
+                str.clear();
+                for (const auto& item : items)
+                    str += item + ", ";
+            }
+            rval.push_back(str);
+        }
+        return rval;
+    };
+    EXPECT_EQ(text(ctx_data), text(data(fresh)));
+    EXPECT_EQ(text(ctx_data), text(expected));
+
+    // Grand total row under c0 and c1. MEDIAN, DISTINCT_COUNT, JOIN and
+    // ANY are recomputed from the pkeys of the finest tree.
+    auto u32 = [](t_uint32 v) { return mktscalar(v); };
+    EXPECT_EQ(text(ctx->get_data(0, 1, 0, ctx->get_column_count())),
+        text({"Grand Aggregate"_ts, 7_ts, mktscalar<t_float64>(3.5), 2_ts,
+            5_ts, u32(1), "a0, a1, "_ts, "c0"_ts, 10_ts,
+            mktscalar<t_float64>(5.0), 2_ts, 6_ts, u32(2), "a0, a1, "_ts,
+            "c1"_ts}));
+
+    gn->reset();
+}
+
+TEST(STREE, incremental_minmax)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "a", "b", "x"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_STR, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+
+    t_config cfg({"a", "b"}, {AGGTYPE_SUM, "x"});
+    auto ctx = t_ctx1::build(sch, cfg);
+    auto scan = t_ctx1::build(sch, cfg);
+    ctx->set_minmax_enabled(true);
+    gn->register_context("ctx", ctx);
+    gn->register_context("scan", scan);
+
+    auto check = [&]() {
+        for (t_depth depth = 1; depth <= 2; ++depth)
+        {
+            auto mm = ctx->get_agg_min_max(0, depth);
+            auto expected = scan->get_agg_min_max(0, depth);
+            EXPECT_EQ(mm.m_min, expected.m_min);
+            EXPECT_EQ(mm.m_max, expected.m_max);
+        }
+        EXPECT_EQ(ctx->get_min_max()[0].m_min, scan->get_min_max()[0].m_min);
+        EXPECT_EQ(ctx->get_min_max()[0].m_max, scan->get_min_max()[0].m_max);
+    };
+
+    gn->_send_and_process(t_table(sch,
+        {{iop, 1_ts, "p"_ts, "u"_ts, 1_ts}, {iop, 2_ts, "p"_ts, "v"_ts, 9_ts},
+            {iop, 3_ts, "q"_ts, "u"_ts, 4_ts},
+            {iop, 4_ts, "q"_ts, "v"_ts, 4_ts}}));
+    check();
+    EXPECT_EQ(ctx->get_agg_min_max(0, 2).m_min_count, 1);
+    EXPECT_EQ(ctx->get_agg_min_max(0, 2).m_max, 9_ts);
+
+    // Removes the extremes of both depths
+    gn->_send_and_process(t_table(sch,
+        {{dop, 2_ts, "p"_ts, "v"_ts, i64_null},
+            {iop, 1_ts, "q"_ts, "w"_ts, 5_ts}}));
+    check();
+    EXPECT_EQ(ctx->get_agg_min_max(0, 1).m_max, 13_ts);
+    EXPECT_EQ(ctx->get_agg_min_max(0, 2).m_min, 4_ts);
+    EXPECT_EQ(ctx->get_agg_min_max(0, 2).m_min_count, 2);
+
+    gn->reset();
+}
+
+TEST(GNODE, custom_columns)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "x", "y", "s", "z", "label", "k"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_FLOAT64, DTYPE_STR,
+            DTYPE_FLOAT64, DTYPE_STR, DTYPE_INT64}};
+
+    t_custom_column_recipe z;
+    z.m_ocol = "z";
+    z.m_expr = "x * 2 + y";
+    t_custom_column_recipe label;
+    label.m_ocol = "label";
+    label.m_expr = "if(x > 1 and not isnull(s), upper(s), concat(s, '!'))";
+    t_custom_column_recipe k;
+    k.m_ocol = "k";
+    k.m_expr = "s";
+    k.m_where_keys = {"'a'", "'b'"};
+    k.m_where_values = {"1", "len(s) + 1"};
+    k.m_base_case = "-1";
+
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    options.m_custom_columns = {z, label, k};
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx0::build(sch, t_config{{"z", "label", "k"}});
+    gn->register_context("ctx", ctx);
+
+    auto row = [](t_int64 pkey, t_tscalar x, t_tscalar y, t_tscalar s) {
+        return t_tscalvec{iop, mktscalar(pkey), x, y, s, mknull(DTYPE_FLOAT64),
+            snull, i64_null};
+    };
+
+    gn->_send_and_process(t_table(sch,
+        {row(1, 1_ts, mktscalar(0.5), "a"_ts),
+            row(2, 3_ts, mktscalar(1.0), "b"_ts)}));
+    EXPECT_EQ(ctx->get_data(0, 2, 0, 3),
+        t_tscalvec({mktscalar(2.5), "a!"_ts, 1_ts, mktscalar(7.0), "B"_ts,
+            2_ts}));
+
+    // Inputs missing from an update come from the current row
+    gn->_send_and_process(t_table(sch,
+        {row(1, 5_ts, mknull(DTYPE_FLOAT64), snull),
+            row(2, i64_null, mktscalar(2.0), "c"_ts)}));
+    EXPECT_EQ(ctx->get_data(0, 2, 0, 3),
+        t_tscalvec({mktscalar(10.5), "A"_ts, 1_ts, mktscalar(8.0), "C"_ts,
+            mktscalar<t_int64>(-1)}));
+}
+
+TEST(GNODE, custom_columns_incremental)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "x", "y", "z", "a", "b"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64, DTYPE_INT64,
+            DTYPE_FLOAT64, DTYPE_FLOAT64}};
+
+    t_custom_column_recipe a;
+    a.m_ocol = "a";
+    a.m_expr = "x * 2";
+    t_custom_column_recipe b;
+    b.m_ocol = "b";
+    b.m_expr = "a + y";
+
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    options.m_custom_columns = {a, b};
+    auto gn = t_gnode::build(options);
+    auto ctx = t_ctx0::build(sch, t_config{{"a", "b"}});
+    gn->register_context("ctx", ctx);
+
+    auto row = [](t_tscalar op, t_int64 pkey, t_tscalar x, t_tscalar y,
+                   t_tscalar z) {
+        return t_tscalvec{op, mktscalar(pkey), x, y, z,
+            mknull(DTYPE_FLOAT64), mknull(DTYPE_FLOAT64)};
+    };
+
+    // Rows each custom column computed in the last step
+    std::vector<t_uindex> computed(2);
+    auto step = [&](const std::vector<t_tscalvec>& rows) {
+        gn->_send_and_process(t_table(sch, rows));
+        std::vector<t_uindex> rval;
+        auto ccols = gn->get_custom_columns();
+        for (t_uindex idx = 0; idx < ccols.size(); ++idx)
+        {
+            rval.push_back(ccols[idx].get_num_computed() - computed[idx]);
+            computed[idx] = ccols[idx].get_num_computed();
+        }
+        return rval;
+    };
+    auto counts = [](t_uindex na, t_uindex nb) {
+        return std::vector<t_uindex>({na, nb});
+    };
+
+    EXPECT_EQ(step({row(iop, 1, 1_ts, 10_ts, 0_ts),
+                  row(iop, 2, 2_ts, 20_ts, 0_ts)}),
+        counts(2, 2));
+    EXPECT_EQ(ctx->get_data(0, 2, 0, 2),
+        t_tscalvec({mktscalar(2.0), mktscalar(12.0), mktscalar(4.0),
+            mktscalar(24.0)}));
+
+    // b follows a when only x changes. Row 2 sets neither input, so
+    // neither column runs for it.
+    EXPECT_EQ(step({row(iop, 1, 3_ts, i64_null, i64_null),
+                  row(iop, 2, i64_null, i64_null, 7_ts)}),
+        counts(1, 1));
+    EXPECT_EQ(ctx->get_data(0, 2, 0, 2),
+        t_tscalvec({mktscalar(6.0), mktscalar(16.0), mktscalar(4.0),
+            mktscalar(24.0)}));
+
+    // a runs for the new row only, b for both rows
+    EXPECT_EQ(step({row(iop, 2, i64_null, 30_ts, i64_null),
+                  row(iop, 3, 5_ts, i64_null, i64_null)}),
+        counts(1, 2));
+    EXPECT_EQ(ctx->get_data(0, 3, 0, 2),
+        t_tscalvec({mktscalar(6.0), mktscalar(16.0), mktscalar(4.0),
+            mktscalar(34.0), mktscalar(10.0), mknone()}));
+
+    EXPECT_EQ(step({row(dop, 3, i64_null, i64_null, i64_null)}),
+        counts(0, 0));
+    EXPECT_EQ(ctx->get_row_count(), 2);
+}
+
+TEST(PIVOT, time_buckets)
+{
+    t_time t(2018, 3, 15, 13, 45, 10);
+    auto bucket = [&t](t_pivot_mode mode) {
+        return t_time(bucket_time(t.raw_value(), mode));
+    };
+    EXPECT_EQ(bucket(PIVOT_MODE_TIME_BUCKET_MIN),
+        t_time(2018, 3, 15, 13, 45, 0));
+    EXPECT_EQ(bucket(PIVOT_MODE_TIME_BUCKET_HOUR),
+        t_time(2018, 3, 15, 13, 0, 0));
+    EXPECT_EQ(bucket(PIVOT_MODE_TIME_BUCKET_DAY),
+        t_time(2018, 3, 15, 0, 0, 0));
+    EXPECT_EQ(bucket(PIVOT_MODE_TIME_BUCKET_WEEK),
+        t_time(2018, 3, 12, 0, 0, 0));
+    EXPECT_EQ(bucket(PIVOT_MODE_TIME_BUCKET_MONTH),
+        t_time(2018, 3, 1, 0, 0, 0));
+    EXPECT_EQ(bucket(PIVOT_MODE_TIME_BUCKET_YEAR),
+        t_time(2018, 1, 1, 0, 0, 0));
+
+    t = t_time(1969, 12, 31, 23, 0, 0);
+    EXPECT_EQ(bucket(PIVOT_MODE_TIME_BUCKET_DAY),
+        t_time(1969, 12, 31, 0, 0, 0));
+    EXPECT_EQ(bucket(PIVOT_MODE_TIME_BUCKET_WEEK),
+        t_time(1969, 12, 29, 0, 0, 0));
+
+    t_date d(2016, 3, 1);
+    EXPECT_EQ(t_date(bucket_date(d.raw_value(), PIVOT_MODE_TIME_BUCKET_WEEK)),
+        t_date(2016, 2, 29));
+    EXPECT_EQ(t_date(bucket_date(d.raw_value(), PIVOT_MODE_TIME_BUCKET_YEAR)),
+        t_date(2016, 1, 1));
+
+    t_schema sch{{"psp_op", "psp_pkey", "t", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_TIME, DTYPE_INT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx1 = t_ctx1::build(sch,
+        t_config(t_pivotvec{t_pivot("t", PIVOT_MODE_TIME_BUCKET_DAY)},
+            t_aggspecvec{t_aggspec(AGGTYPE_SUM, "v")}));
+    gn->register_context("ctx1", ctx1);
+
+    auto row = [](t_int64 pkey, t_int32 day, t_int32 hour, t_int64 v) {
+        return t_tscalvec{iop, mktscalar(pkey),
+            mktscalar(t_time(2018, 3, day, hour, 0, 0)), mktscalar(v)};
+    };
+    auto day = [](t_int32 day) {
+        return t_tscalvec{mktscalar(t_time(2018, 3, day, 0, 0, 0))};
+    };
+
+    gn->_send_and_process(t_table(
+        sch, {row(1, 15, 10, 1), row(2, 15, 23, 2), row(3, 16, 1, 4)}));
+    ctx1->set_depth(1);
+    ASSERT_EQ(ctx1->get_row_count(), 3);
+    EXPECT_EQ(ctx1->get_row_path(1), day(15));
+    EXPECT_EQ(ctx1->get_row_path(2), day(16));
+    EXPECT_EQ(ctx1->get_data(0, 3, 1, 2),
+        t_tscalvec({mktscalar(t_int64(7)), mktscalar(t_int64(3)),
+            mktscalar(t_int64(4))}));
+
+    gn->_send_and_process(t_table(sch, {row(2, 16, 5, 2)}));
+    EXPECT_EQ(ctx1->get_data(0, 3, 1, 2),
+        t_tscalvec({mktscalar(t_int64(7)), mktscalar(t_int64(1)),
+            mktscalar(t_int64(6))}));
+}
+
+TEST(KERNEL, batched_reduce)
+{
+    t_uindex ncalls = 0;
+    get_evaluator()->register_kernel("test_range",
+        [&ncalls](const t_kernel_batch& batch, t_float64* out) {
+            ++ncalls;
+            for (t_uindex idx = 0; idx < batch.size(); ++idx)
+            {
+                auto begin = batch.m_values.begin() + batch.m_offsets[idx];
+                auto end = batch.m_values.begin() + batch.m_offsets[idx + 1];
+                auto mm = std::minmax_element(begin, end);
+                out[idx] = begin == end ? 0 : *mm.second - *mm.first;
+            }
+        });
+
+    t_schema sch{{"psp_op", "psp_pkey", "s", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_FLOAT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+
+    t_kernel kernel("test_range");
+    t_aggspec range("range", AGGTYPE_UDF_JS_REDUCE_FLOAT64,
+        t_depvec{t_dep("v", DEPTYPE_COLUMN)}, kernel);
+    auto ctx1 = t_ctx1::build(sch, t_config(t_pivotvec{t_pivot("s")}, {range}));
+    gn->register_context("ctx1", ctx1);
+
+    auto row = [](t_int64 pkey, const char* s, t_float64 v) {
+        return t_tscalvec{iop, mktscalar(pkey), mktscalar(s), mktscalar(v)};
+    };
+
+    gn->_send_and_process(t_table(sch,
+        {row(1, "a", 1), row(2, "a", 4), row(3, "b", 2), row(4, "b", 10)}));
+    ctx1->set_depth(1);
+    EXPECT_EQ(ncalls, t_uindex(1));
+    EXPECT_EQ(ctx1->get_data(0, 3, 1, 2),
+        t_tscalvec({mktscalar(9.0), mktscalar(3.0), mktscalar(8.0)}));
+
+    gn->_send_and_process(t_table(sch, {row(2, "b", 4), row(5, "a", -1)}));
+    EXPECT_EQ(ncalls, t_uindex(2));
+    EXPECT_EQ(ctx1->get_data(0, 3, 1, 2),
+        t_tscalvec({mktscalar(11.0), mktscalar(2.0), mktscalar(8.0)}));
+}
+
+TEST(SYMTABLE, concurrent_interning)
+{
+    // Enough distinct strings to grow every shard's table a few times
+    const t_uindex nstrs = 40000;
+    std::vector<t_str> strs;
+    for (t_uindex idx = 0; idx < nstrs; ++idx)
+    {
+        strs.push_back("symbol_" + std::to_string(idx) + "_long_enough");
+    }
+
+    const t_uindex nthreads = 4;
+    std::vector<std::vector<const t_char*>> interned(nthreads);
+    std::vector<std::thread> threads;
+    for (t_uindex tidx = 0; tidx < nthreads; ++tidx)
+    {
+        threads.emplace_back([&, tidx]() {
+            auto& out = interned[tidx];
+            out.resize(nstrs);
+            for (t_uindex idx = 0; idx < nstrs; ++idx)
+            {
+                t_uindex sidx = tidx % 2 ? nstrs - 1 - idx : idx;
+                out[sidx] = get_interned_cstr(strs[sidx].c_str());
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    for (t_uindex idx = 0; idx < nstrs; ++idx)
+    {
+        EXPECT_STREQ(interned[0][idx], strs[idx].c_str());
+        for (t_uindex tidx = 1; tidx < nthreads; ++tidx)
+        {
+            EXPECT_EQ(interned[tidx][idx], interned[0][idx]);
+        }
+    }
+    EXPECT_EQ(get_interned_cstr(strs[17].c_str()), interned[0][17]);
+}
+
+TEST(SYMTABLE, move_keeps_strings)
+{
+    t_symtable* src = new t_symtable;
+    const t_char* s = src->get_interned_cstr("a string kept by its arena");
+    t_symtable moved(std::move(*src));
+    delete src;
+
+    EXPECT_EQ(moved.size(), 1);
+    EXPECT_STREQ(s, "a string kept by its arena");
+    EXPECT_EQ(moved.get_interned_cstr("a string kept by its arena"), s);
+}
+
+TEST(SYMTABLE, release_reclaims)
+{
+    auto live = []() {
+        auto usage = get_interned_memory_usage();
+        return usage.find("strings")->m_size;
+    };
+    auto held = []() {
+        auto usage = get_interned_memory_usage();
+        return usage.find("strings")->m_capacity
+            + usage.find("tables")->m_capacity;
+    };
+
+    t_uindex base = live();
+    t_uindex warm = 0;
+    t_uindex interned = 0;
+    const t_uindex nrounds = 40;
+    for (t_uindex round = 0; round < nrounds; ++round)
+    {
+        t_intern_lease lease;
+        for (t_uindex idx = 0; idx < 2000; ++idx)
+        {
+            t_str s = "a string only referenced by its lease, round "
+                + std::to_string(round) + " index " + std::to_string(idx);
+            const t_char* p = lease.get_interned_cstr(s.c_str());
+            EXPECT_STREQ(p, s.c_str());
+            EXPECT_EQ(lease.get_interned_cstr(s.c_str()), p);
+            interned += s.size() + 1;
+        }
+        EXPECT_EQ(lease.size(), 2000);
+        EXPECT_GT(live(), base);
+        lease.clear();
+        EXPECT_EQ(live(), base);
+        if (round == 4)
+            warm = held();
+    }
+
+    // Later rounds reuse what the first ones allocated
+    EXPECT_LT(held() - std::min(held(), warm), t_uindex(1 << 20));
+    EXPECT_GT(interned, t_uindex(4 << 20));
+}
+
+TEST(SYMTABLE, pin_after_acquire)
+{
+    const t_char* a = acquire_interned_cstr("a string pinned while referenced");
+    EXPECT_EQ(acquire_interned_cstr("a string pinned while referenced"), a);
+    EXPECT_EQ(get_interned_cstr("a string pinned while referenced"), a);
+    release_interned_cstr(a);
+    release_interned_cstr(a);
+    EXPECT_EQ(get_interned_cstr("a string pinned while referenced"), a);
+    EXPECT_STREQ(a, "a string pinned while referenced");
+
+    t_str text = "a string released, then referenced again";
+    const t_char* b = acquire_interned_cstr(text.c_str());
+    release_interned_cstr(b);
+    const t_char* c = acquire_interned_cstr(text.c_str());
+    EXPECT_STREQ(c, text.c_str());
+    EXPECT_EQ(acquire_interned_cstr(text.c_str()), c);
+    release_interned_cstr(c);
+    release_interned_cstr(c);
+}
+
+TEST(SYMTABLE, concurrent_release)
+{
+    const t_uindex nstrs = 2000;
+    std::vector<t_str> strs;
+    for (t_uindex idx = 0; idx < nstrs; ++idx)
+    {
+        strs.push_back("shared_symbol_" + std::to_string(idx) + "_released");
+    }
+
+    // Half the threads reference and release the pool, the other half
+    // pin every tenth string and look the rest up
+    const t_uindex nthreads = 4;
+    std::vector<t_uindex> mismatches(nthreads, 0);
+    std::vector<std::thread> threads;
+    for (t_uindex tidx = 0; tidx < nthreads; ++tidx)
+    {
+        threads.emplace_back([&, tidx]() {
+            for (t_uindex pass = 0; pass < 20; ++pass)
+            {
+                for (t_uindex idx = 0; idx < nstrs; ++idx)
+                {
+                    t_uindex sidx = (idx * 7 + pass + tidx) % nstrs;
+                    const t_char* s = strs[sidx].c_str();
+                    if (tidx % 2 && sidx % 10 == 0)
+                    {
+                        if (strcmp(get_interned_cstr(s), s) != 0)
+                            ++mismatches[tidx];
+                        continue;
+                    }
+                    const t_char* p = acquire_interned_cstr(s);
+                    if (strcmp(p, s) != 0)
+                        ++mismatches[tidx];
+                    release_interned_cstr(p);
+                }
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    for (t_uindex tidx = 0; tidx < nthreads; ++tidx)
+    {
+        EXPECT_EQ(mismatches[tidx], 0);
+    }
+    const t_char* pinned = get_interned_cstr(strs[10].c_str());
+    const t_char* p = acquire_interned_cstr(strs[10].c_str());
+    EXPECT_EQ(p, pinned);
+    release_interned_cstr(p);
+}
+
+TEST(GNODE, tick_allocations_reused)
+{
+    t_schema sch{{"psp_op", "psp_pkey", "s", "v"},
+        {DTYPE_UINT8, DTYPE_INT64, DTYPE_STR, DTYPE_FLOAT64}};
+    t_gnode_options options;
+    options.m_gnode_type = GNODE_TYPE_PKEYED;
+    options.m_port_schema = sch;
+    auto gn = t_gnode::build(options);
+    auto ctx1 = t_ctx1::build(sch,
+        t_config(t_pivotvec{t_pivot("s")},
+            t_aggspecvec{t_aggspec(AGGTYPE_SUM, "v")}));
+    gn->register_context("ctx1", ctx1);
+
+    auto tick = [&](t_float64 v) {
+        std::vector<t_tscalvec> rows;
+        for (t_int64 pkey = 0; pkey < 1000; ++pkey)
+        {
+            rows.push_back(t_tscalvec{iop, mktscalar(pkey),
+                mktscalar(pkey % 2 ? "odd" : "even"), mktscalar(v)});
+        }
+        t_table tbl(sch, rows);
+        t_uindex nallocs = psp_alloc_count();
+        gn->_send_and_process(tbl);
+        return psp_alloc_count() - nallocs;
+    };
+
+    // Once the pools and arena have warmed up, a tick of the same
+    // shape reuses their memory
+    for (t_uindex idx = 0; idx < 4; ++idx)
+    {
+        tick(idx);
+    }
+    t_uindex nreuses = psp_reuse_count();
+    EXPECT_EQ(tick(4), t_uindex(0));
+    EXPECT_GT(psp_reuse_count(), nreuses);
+
+    ctx1->set_depth(1);
+    EXPECT_EQ(ctx1->get_data(0, 3, 1, 2),
+        t_tscalvec({mktscalar(4000.0), mktscalar(2000.0),
+            mktscalar(2000.0)}));
+}